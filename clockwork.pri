@@ -26,7 +26,7 @@ greaterThan(QT_MAJOR_VERSION, 4):greaterThan(QT_MINOR_VERSION, 4) {
 	REPOSITORY = "https://github.com/othieno/clockwork"
 
 	# Setup Qt configurations.
-	QT += qml quick
+	QT += qml quick network
 
 	# Setup the compiler.
 	CONFIG += c++14
@@ -65,18 +65,35 @@ greaterThan(QT_MAJOR_VERSION, 4):greaterThan(QT_MINOR_VERSION, 4) {
 		src/ui \
 		src
 	HEADERS += \
+		src/graphics/blockCompression.hh \
 		src/graphics/Camera.hh \
 		src/graphics/Color.hh \
 		src/graphics/Material.hh \
 		src/graphics/Mesh.hh \
+		src/graphics/PageCache.hh \
 		src/graphics/Projection.hh \
 		src/graphics/Texture.hh \
 		src/graphics/ViewFrustum.hh \
 		src/graphics/Viewport.hh \
+		src/graphics/filter/AnisotropicTextureFilter.hh \
+		src/graphics/filter/BilinearTextureFilter.hh \
+		src/graphics/filter/BlackAndWhiteImageFilter.hh \
+		src/graphics/filter/BloomImageFilter.hh \
+		src/graphics/filter/FramebufferImageFilter.hh \
+		src/graphics/filter/FXAAImageFilter.hh \
+		src/graphics/filter/GaussianBlurImageFilter.hh \
+		src/graphics/filter/GrayscaleImageFilter.hh \
 		src/graphics/filter/ImageFilter.hh \
+		src/graphics/filter/ImageFilterChain.hh \
 		src/graphics/filter/ImageFilterFactory.hh \
+		src/graphics/filter/ImageTile.hh \
+		src/graphics/filter/luma.hh \
+		src/graphics/filter/NeighborhoodImageFilter.hh \
+		src/graphics/filter/PixelImageFilter.hh \
+		src/graphics/filter/SSAOImageFilter.hh \
 		src/graphics/filter/TextureFilter.hh \
 		src/graphics/filter/TextureFilterFactory.hh \
+		src/graphics/filter/TrilinearTextureFilter.hh \
 		src/graphics/lighting/IlluminationModel.hh \
 		src/graphics/renderer/BaseFragment.hh \
 		src/graphics/renderer/BaseRenderer.hh \
@@ -92,6 +109,7 @@ greaterThan(QT_MAJOR_VERSION, 4):greaterThan(QT_MINOR_VERSION, 4) {
 		src/graphics/renderer/ShaderProgramIdentifier.hh \
 		src/graphics/renderer/ShaderProgram.hh \
 		src/graphics/renderer/ShaderProgram.inl \
+		src/graphics/renderer/SwapChain.hh \
 		src/graphics/renderer/Uniform.hh \
 		src/graphics/renderer/shader/BumpMapShaderProgram.hh \
 		src/graphics/renderer/shader/CelShadingShaderProgram.hh \
@@ -115,33 +133,55 @@ greaterThan(QT_MAJOR_VERSION, 4):greaterThan(QT_MINOR_VERSION, 4) {
 		src/system/Application.hh \
 		src/system/ApplicationSettings.hh \
 		src/system/Error.hh \
+		src/system/FrameScheduler.hh \
+		src/system/RenderCluster.hh \
+		src/system/RenderWorker.hh \
 		src/system/Service.hh \
 		src/system/io/fileReader.hh \
 		src/system/io/Resource.hh \
 		src/system/io/ResourceManager.hh \
+		src/system/task/parallelFor.hh \
 		src/system/task/Task.hh \
 		src/system/task/TaskManager.hh \
 		src/system/subsystem/GraphicsSubsystem.hh \
+		src/types/AlignedBuffer.hh \
 		src/types/enum_traits.hh \
 		src/types/Factory.hh \
+		src/types/SpscQueue.hh \
 		src/types/WeakVariant.hh \
 		src/ui/components/FramebufferView.hh \
 		src/ui/models/SelectModel.hh \
 		src/ui/FramebufferProvider.hh \
 		src/ui/UserInterface.hh
 	SOURCES += \
+		src/graphics/blockCompression.cc \
 		src/graphics/Camera.cc \
 		src/graphics/Color.cc \
 		src/graphics/Material.cc \
 		src/graphics/Mesh.cc \
+		src/graphics/PageCache.cc \
 		src/graphics/Texture.cc \
+		src/graphics/filter/AnisotropicTextureFilter.cc \
+		src/graphics/filter/BilinearTextureFilter.cc \
+		src/graphics/filter/BlackAndWhiteImageFilter.cc \
+		src/graphics/filter/BloomImageFilter.cc \
+		src/graphics/filter/FramebufferImageFilter.cc \
+		src/graphics/filter/FXAAImageFilter.cc \
+		src/graphics/filter/GaussianBlurImageFilter.cc \
+		src/graphics/filter/GrayscaleImageFilter.cc \
 		src/graphics/filter/ImageFilter.cc \
+		src/graphics/filter/ImageFilterChain.cc \
+		src/graphics/filter/NeighborhoodImageFilter.cc \
+		src/graphics/filter/PixelImageFilter.cc \
+		src/graphics/filter/SSAOImageFilter.cc \
 		src/graphics/filter/TextureFilter.cc \
+		src/graphics/filter/TrilinearTextureFilter.cc \
 		src/graphics/renderer/BaseFragment.cc \
 		src/graphics/renderer/BaseRenderer.cc \
 		src/graphics/renderer/BaseVertex.cc \
 		src/graphics/renderer/BaseVertexAttributes.cc \
 		src/graphics/renderer/Framebuffer.cc \
+		src/graphics/renderer/SwapChain.cc \
 		src/graphics/renderer/shader/BumpMapShaderProgram.cc \
 		src/graphics/renderer/shader/CelShadingShaderProgram.cc \
 		src/graphics/renderer/shader/DepthMapShaderProgram.cc \
@@ -165,13 +205,18 @@ greaterThan(QT_MAJOR_VERSION, 4):greaterThan(QT_MINOR_VERSION, 4) {
 		src/scene/property/SceneObjectAppearance.cc \
 		src/system/Application.cc \
 		src/system/ApplicationSettings.cc \
+		src/system/FrameScheduler.cc \
+		src/system/RenderCluster.cc \
+		src/system/RenderWorker.cc \
 		src/system/Service.cc \
 		src/system/io/fileReader.cc \
 		src/system/io/Resource.cc \
 		src/system/io/ResourceManager.cc \
+		src/system/task/parallelFor.cc \
 		src/system/task/Task.cc \
 		src/system/task/TaskManager.cc \
 		src/system/subsystem/GraphicsSubsystem.cc \
+		src/types/AlignedBuffer.cc \
 		src/ui/components/FramebufferView.cc \
 		src/ui/models/SelectModel.cc \
 		src/ui/FramebufferProvider.cc \
@@ -33,11 +33,15 @@
 
 
 namespace clockwork {
+namespace testsuite {
+class TestSortLastRendering;
+} // namespace testsuite
 /**
  *
  */
 class Mesh : public Resource {
 	friend class ResourceManager;
+	friend class testsuite::TestSortLastRendering;
 public:
 	/**
 	 * A polygon mesh's triangular face.
@@ -0,0 +1,262 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "PageCache.hh"
+#include "Service.hh"
+#include <QMutexLocker>
+#include <algorithm>
+
+using clockwork::PageCache;
+using clockwork::Texture;
+
+
+constexpr std::size_t PageCache::DEFAULT_CAPACITY;
+constexpr std::size_t PageCache::MAX_LOADER_COUNT;
+
+
+class PageCache::Loader : public clockwork::Task {
+public:
+	/**
+	 * Instantiates a Loader object that loads pending pages into the specified cache.
+	 */
+	explicit Loader(PageCache& cache) :
+	Task(Priority::Background),
+	cache_(cache) {}
+	/**
+	 * Reads pending pages from their textures' page files and hands them to the cache,
+	 * until no pages are pending.
+	 */
+	void run() override {
+		QMutexLocker locker(&cache_.mutex_);
+		cache_.readPendingPages(locker);
+		if (--cache_.loaderCount_ == 0) {
+			cache_.loadersDone_.wakeAll();
+		}
+	}
+private:
+	/**
+	 * The cache that pages are loaded into.
+	 */
+	PageCache& cache_;
+};
+
+
+PageCache::PageCache() :
+capacity_(DEFAULT_CAPACITY),
+size_(0),
+deterministicLoading_(false),
+frame_(1),
+loaderCount_(0),
+readCount_(0) {}
+
+
+PageCache::~PageCache() {
+	QMutexLocker locker(&mutex_);
+	pending_.clear();
+	while (loaderCount_ > 0) {
+		loadersDone_.wait(&mutex_);
+	}
+}
+
+
+PageCache&
+PageCache::getInstance() {
+	static PageCache INSTANCE;
+	return INSTANCE;
+}
+
+
+std::size_t
+PageCache::getCapacity() const {
+	QMutexLocker locker(&mutex_);
+	return capacity_;
+}
+
+
+void
+PageCache::setCapacity(const std::size_t capacity) {
+	QMutexLocker locker(&mutex_);
+	capacity_ = capacity;
+}
+
+
+std::size_t
+PageCache::getSize() const {
+	QMutexLocker locker(&mutex_);
+	return size_;
+}
+
+
+std::uint32_t
+PageCache::getFrame() const {
+	return frame_.load(std::memory_order_relaxed);
+}
+
+
+bool
+PageCache::isDeterministicLoadingEnabled() const {
+	return deterministicLoading_;
+}
+
+
+void
+PageCache::enableDeterministicLoading(const bool enable) {
+	deterministicLoading_ = enable;
+}
+
+
+void
+PageCache::request(const Texture& texture, const std::size_t level, const std::size_t page) {
+	const Request request{&texture, level, page};
+	if (!getPage(request).requested.exchange(true)) {
+		QMutexLocker locker(&mutex_);
+		feedback_.push_back(request);
+	}
+}
+
+
+void
+PageCache::update() {
+	// The mutex is held throughout, since textures may release their pages from any
+	// thread while the cache is updated.
+	QMutexLocker locker(&mutex_);
+	if (deterministicLoading_) {
+		// The pending pages are read here rather than by the loaders, which are background
+		// tasks that the TaskManager's workers may not run while a frame is drawn. Only
+		// reads that loaders have already started, and are thus running, are waited for.
+		readPendingPages(locker);
+		while (readCount_ > 0) {
+			loadersDone_.wait(&mutex_);
+		}
+	}
+	std::vector<Entry> loaded;
+	loaded.swap(loaded_);
+
+	const auto frame = getFrame();
+	for (auto& entry : loaded) {
+		auto& page = getPage(entry.request);
+		if (entry.data != nullptr) {
+			page.data = entry.data.get();
+			page.frame.store(frame, std::memory_order_relaxed);
+			size_ += getSize(*entry.data);
+			resident_.push_back(std::move(entry));
+		}
+		// A page that could not be loaded may be requested again.
+		page.requested.store(false);
+	}
+
+	// Evict the least recently sampled pages, i.e. those at the end of the list
+	// once it's sorted by the frame in which each page was last sampled. Pages that
+	// were last sampled in the same frame are ordered by level and position, rather
+	// than by when they were loaded.
+	if (size_ > capacity_) {
+		std::sort(resident_.begin(), resident_.end(), [](const Entry& a, const Entry& b) {
+			const auto frameA = getPage(a.request).frame.load(std::memory_order_relaxed);
+			const auto frameB = getPage(b.request).frame.load(std::memory_order_relaxed);
+			if (frameA != frameB) {
+				return frameA > frameB;
+			}
+			const auto levelA = a.request.texture->getLevel(a.request.level).identifier;
+			const auto levelB = b.request.texture->getLevel(b.request.level).identifier;
+			return levelA != levelB ? levelA < levelB : a.request.page < b.request.page;
+		});
+		while (size_ > capacity_ && !resident_.empty()) {
+			auto& entry = resident_.back();
+			getPage(entry.request).data = nullptr;
+			size_ -= getSize(*entry.data);
+			resident_.pop_back();
+		}
+	}
+
+	if (!feedback_.empty()) {
+		pending_.insert(pending_.end(), feedback_.begin(), feedback_.end());
+		feedback_.clear();
+		while (!deterministicLoading_ && loaderCount_ < std::min(MAX_LOADER_COUNT, pending_.size())) {
+			++loaderCount_;
+			Service::Tasks.submit(new Loader(*this));
+		}
+	}
+	frame_.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void
+PageCache::release(const Texture& texture) {
+	const auto& belongsToTexture = [&texture](const Request& request) {
+		return request.texture == &texture;
+	};
+	const auto& entryBelongsToTexture = [&belongsToTexture](const Entry& entry) {
+		return belongsToTexture(entry.request);
+	};
+	// The mutex is held until the texture's resident pages are removed, since the
+	// cache may be updated on another thread in the meantime.
+	QMutexLocker locker(&mutex_);
+	pending_.erase(std::remove_if(pending_.begin(), pending_.end(), belongsToTexture), pending_.end());
+	while (loaderCount_ > 0 || readCount_ > 0) {
+		loadersDone_.wait(&mutex_);
+	}
+	feedback_.erase(std::remove_if(feedback_.begin(), feedback_.end(), belongsToTexture), feedback_.end());
+	loaded_.erase(std::remove_if(loaded_.begin(), loaded_.end(), entryBelongsToTexture), loaded_.end());
+	for (auto it = resident_.begin(); it != resident_.end();) {
+		if (entryBelongsToTexture(*it)) {
+			getPage(it->request).data = nullptr;
+			size_ -= getSize(*it->data);
+			it = resident_.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+
+void
+PageCache::readPendingPages(QMutexLocker& locker) {
+	while (!pending_.empty()) {
+		Entry entry;
+		entry.request = pending_.front();
+		pending_.pop_front();
+		++readCount_;
+
+		locker.unlock();
+		entry.data = entry.request.texture->readPage(entry.request.level, entry.request.page);
+		locker.relock();
+
+		loaded_.push_back(std::move(entry));
+		if (--readCount_ == 0) {
+			loadersDone_.wakeAll();
+		}
+	}
+}
+
+
+Texture::Page&
+PageCache::getPage(const Request& request) {
+	return request.texture->getLevel(request.level).pages[request.page];
+}
+
+
+std::size_t
+PageCache::getSize(const Texture::Level& data) {
+	return (data.texels.size() * sizeof(std::uint32_t)) + (data.blocks.size() * sizeof(std::uint64_t));
+}
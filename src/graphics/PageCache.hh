@@ -0,0 +1,239 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_PAGE_CACHE_HH
+#define CLOCKWORK_PAGE_CACHE_HH
+
+#include "Texture.hh"
+#include <QMutex>
+#include <QWaitCondition>
+#include <deque>
+
+
+namespace clockwork {
+/**
+ * The PageCache holds the resident pages of all sparse textures. While a frame is
+ * rendered, texture filters report the pages that they need but that are not resident,
+ * and sample a coarser level instead. Between frames, the cache makes the pages that
+ * were loaded since the previous frame resident, evicts the least recently sampled
+ * pages until its size fits in its capacity, and starts loading the requested pages
+ * from disk in the background.
+ *
+ * Which pages are resident in a frame normally depends on how long they took to load.
+ * With deterministic loading, the cache reads the pages that were requested in a frame
+ * itself before the frame after next, so a sequence of frames samples the same pages
+ * on every run.
+ */
+class PageCache {
+public:
+	/**
+	 * The default capacity, in bytes.
+	 */
+	static constexpr std::size_t DEFAULT_CAPACITY = 128 * 1024 * 1024;
+	/**
+	 * The maximum number of pages that are loaded concurrently. Pages are read one at
+	 * a time from each page file, so a couple of loaders are enough to keep the disk
+	 * busy without tying up the TaskManager's workers.
+	 */
+	static constexpr std::size_t MAX_LOADER_COUNT = 2;
+	/**
+	 *
+	 */
+	PageCache(const PageCache&) = delete;
+	/**
+	 *
+	 */
+	PageCache(PageCache&&) = delete;
+	/**
+	 *
+	 */
+	PageCache& operator=(const PageCache&) = delete;
+	/**
+	 *
+	 */
+	PageCache& operator=(PageCache&&) = delete;
+	/**
+	 * Waits for pending loads to complete.
+	 */
+	~PageCache();
+	/**
+	 * Returns the cache's unique instance.
+	 */
+	static PageCache& getInstance();
+	/**
+	 * Returns the maximum size of the resident pages, in bytes.
+	 */
+	std::size_t getCapacity() const;
+	/**
+	 * Sets the maximum size of the resident pages. Pages are evicted, if need be, when
+	 * the cache is next updated.
+	 * @param capacity the maximum size, in bytes.
+	 */
+	void setCapacity(const std::size_t capacity);
+	/**
+	 * Returns the size of the resident pages, in bytes.
+	 */
+	std::size_t getSize() const;
+	/**
+	 * Returns the number of the current frame, which is used to record when a page
+	 * was last sampled.
+	 */
+	std::uint32_t getFrame() const;
+	/**
+	 * Returns true if deterministic loading is enabled, false otherwise.
+	 */
+	bool isDeterministicLoadingEnabled() const;
+	/**
+	 * Toggles deterministic loading. This function must be called between frames.
+	 * @param enable enables deterministic loading if set to true, disables it otherwise.
+	 */
+	void enableDeterministicLoading(const bool enable = true);
+	/**
+	 * Requests that the specified page be made resident. A page is only requested once
+	 * until it becomes resident. This function is thread-safe.
+	 * @param texture the texture that contains the page.
+	 * @param level the index of the level that contains the page.
+	 * @param page the page's position in the level's page array.
+	 */
+	void request(const Texture& texture, const std::size_t level, const std::size_t page);
+	/**
+	 * Makes the pages that were loaded since the last update resident, evicts the least
+	 * recently sampled pages, and starts loading the pages that were requested since
+	 * the last update. This function must be called between frames, when no texture
+	 * is being sampled.
+	 */
+	void update();
+	/**
+	 * Removes all pages of the specified texture from the cache, after waiting for
+	 * pending loads to complete.
+	 * @param texture the texture whose pages are to be removed.
+	 */
+	void release(const Texture& texture);
+private:
+	/**
+	 * A request for a page to be made resident.
+	 */
+	struct Request {
+		/**
+		 * The texture that contains the page.
+		 */
+		const Texture* texture;
+		/**
+		 * The index of the level that contains the page.
+		 */
+		std::size_t level;
+		/**
+		 * The page's position in the level's page array.
+		 */
+		std::size_t page;
+	};
+	/**
+	 * A page's texels.
+	 */
+	struct Entry {
+		/**
+		 * The page that the texels belong to.
+		 */
+		Request request;
+		/**
+		 * The page's texels, or nullptr if they could not be loaded.
+		 */
+		std::unique_ptr<Texture::Level> data;
+	};
+	/**
+	 * A background task that loads pending pages from disk.
+	 */
+	class Loader;
+	/**
+	 * Reads the pending pages and adds them to the loaded pages, until no pages are
+	 * pending. The mutex is released while each page is read.
+	 * @param locker the locker that holds the cache's mutex.
+	 */
+	void readPendingPages(QMutexLocker& locker);
+	/**
+	 * Instantiates a PageCache object.
+	 */
+	PageCache();
+	/**
+	 * Returns the page that the specified request refers to.
+	 */
+	static Texture::Page& getPage(const Request& request);
+	/**
+	 * Returns the size, in bytes, of the specified page's texels.
+	 */
+	static std::size_t getSize(const Texture::Level& data);
+	/**
+	 * The maximum size of the resident pages, in bytes.
+	 */
+	std::size_t capacity_;
+	/**
+	 * The size of the resident pages, in bytes.
+	 */
+	std::size_t size_;
+	/**
+	 * True if the cache waits for requested pages to load, false otherwise.
+	 */
+	bool deterministicLoading_;
+	/**
+	 * The number of the current frame.
+	 */
+	std::atomic<std::uint32_t> frame_;
+	/**
+	 * A mutex that guards the feedback, pending, loaded and resident page lists, the
+	 * cache's size and capacity, and the number of loaders and page reads.
+	 */
+	mutable QMutex mutex_;
+	/**
+	 * The pages that were requested since the last update.
+	 */
+	std::vector<Request> feedback_;
+	/**
+	 * The pages that are waiting to be loaded.
+	 */
+	std::deque<Request> pending_;
+	/**
+	 * The pages that were loaded since the last update.
+	 */
+	std::vector<Entry> loaded_;
+	/**
+	 * The resident pages.
+	 */
+	std::vector<Entry> resident_;
+	/**
+	 * The number of loaders that have been submitted to the TaskManager.
+	 */
+	std::size_t loaderCount_;
+	/**
+	 * The number of pages that are being read from their page files.
+	 */
+	std::size_t readCount_;
+	/**
+	 * A condition that is signaled when the last loader is done, or the last page
+	 * that was being read is loaded.
+	 */
+	QWaitCondition loadersDone_;
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_PAGE_CACHE_HH
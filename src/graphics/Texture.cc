@@ -23,5 +23,411 @@
  * THE SOFTWARE.
  */
 #include "Texture.hh"
+#include "blockCompression.hh"
+#include "PageCache.hh"
+#include <QFile>
+#include <QImage>
+#include <QTemporaryFile>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using clockwork::Texture;
+
+
+constexpr std::uint32_t Texture::BLOCK_SIZE;
+constexpr std::uint32_t Texture::PAGE_SIZE;
+constexpr std::uint32_t Texture::SPARSE_THRESHOLD;
+
+
+/**
+ * The identifier of the next mip level to be created.
+ */
+static std::atomic<std::uint64_t> NEXT_LEVEL_IDENTIFIER(1);
+
+
+/**
+ * Stores the specified texels, which are stored in rows, in the block layout of the
+ * specified level.
+ */
+static void
+swizzle(const std::vector<std::uint32_t>& texels, Texture::Level& level) {
+	constexpr std::uint32_t B = Texture::BLOCK_SIZE;
+	const std::uint32_t w = level.width;
+	const std::uint32_t h = level.height;
+	const std::uint32_t blocksPerColumn = (h + B - 1) / B;
+
+	level.blocksPerRow = (w + B - 1) / B;
+	level.texels.resize(static_cast<std::size_t>(level.blocksPerRow) * blocksPerColumn * B * B);
+
+	auto* output = level.texels.data();
+	for (std::uint32_t by = 0; by < blocksPerColumn; ++by) {
+		for (std::uint32_t bx = 0; bx < level.blocksPerRow; ++bx) {
+			const std::uint32_t x = bx * B;
+			for (std::uint32_t j = 0; j < B; ++j, output += B) {
+				const auto* const row = &texels[std::min((by * B) + j, h - 1) * w];
+				if (x + B <= w) {
+					std::memcpy(output, row + x, B * sizeof(std::uint32_t));
+				} else {
+					for (std::uint32_t i = 0; i < B; ++i) {
+						output[i] = row[std::min(x + i, w - 1)];
+					}
+				}
+			}
+		}
+	}
+}
+
+
+/**
+ * Returns the size, in bytes, of a block of texels in the specified format.
+ */
+static std::size_t
+getBlockSize(const Texture::Format format) {
+	switch (format) {
+		case Texture::Format::BC1:
+			return sizeof(std::uint64_t);
+		case Texture::Format::BC3:
+			return 2 * sizeof(std::uint64_t);
+		default:
+			return Texture::BLOCK_SIZE * Texture::BLOCK_SIZE * sizeof(std::uint32_t);
+	}
+}
+
+
+/**
+ * Returns the specified level's texels, or its compressed blocks, as raw bytes.
+ */
+static char*
+getBlockData(Texture::Level& level) {
+	if (level.format == Texture::Format::ARGB32) {
+		return reinterpret_cast<char*>(level.texels.data());
+	} else {
+		return reinterpret_cast<char*>(level.blocks.data());
+	}
+}
+
+
+/**
+ * Compresses the specified level's texels into blocks of the specified format.
+ */
+static void
+compress(Texture::Level& level, const Texture::Format format) {
+	constexpr std::size_t N = Texture::BLOCK_SIZE * Texture::BLOCK_SIZE;
+	const std::size_t count = level.texels.size() / N;
+	switch (format) {
+		case Texture::Format::BC1:
+			level.blocks.resize(count);
+			for (std::size_t i = 0; i < count; ++i) {
+				level.blocks[i] = clockwork::encodeColorBlock(&level.texels[i * N]);
+			}
+			break;
+		case Texture::Format::BC3:
+			level.blocks.resize(2 * count);
+			for (std::size_t i = 0; i < count; ++i) {
+				level.blocks[(2 * i)] = clockwork::encodeAlphaBlock(&level.texels[i * N]);
+				level.blocks[(2 * i) + 1] = clockwork::encodeColorBlock(&level.texels[i * N]);
+			}
+			break;
+		default:
+			return;
+	}
+	level.format = format;
+	std::vector<std::uint32_t>().swap(level.texels);
+}
+
+
+/**
+ * Reduces the specified texels, which are stored in rows, to an image that is half
+ * their width and height. Each texel in the output is the average of the 2x2 texels
+ * it covers in the input. When a dimension is odd, its last row or column is dropped,
+ * and when it is already 1, the same row or column is read twice.
+ */
+static void
+downsample(
+	const std::vector<std::uint32_t>& texels,
+	const std::uint32_t sw,
+	const std::uint32_t sh,
+	std::vector<std::uint32_t>& output,
+	const std::uint32_t w,
+	const std::uint32_t h
+) {
+	output.resize(static_cast<std::size_t>(w) * h);
+	for (std::uint32_t y = 0; y < h; ++y) {
+		const std::uint32_t* const a = &texels[(2 * y) * sw];
+		const std::uint32_t* const b = &texels[std::min((2 * y) + 1, sh - 1) * sw];
+		std::uint32_t* const row = &output[y * w];
+		std::uint32_t x = 0;
+#ifdef __SSE2__
+		if (sw > 1) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i rounding = _mm_set1_epi16(2);
+			for (; x + 2 <= w; x += 2) {
+				const __m128i ra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + (2 * x)));
+				const __m128i rb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + (2 * x)));
+
+				// Add the two rows, then each pair of adjacent texels, in 16 bits.
+				const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(ra, zero), _mm_unpacklo_epi8(rb, zero));
+				const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(ra, zero), _mm_unpackhi_epi8(rb, zero));
+				const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+				const __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(row + x), _mm_packus_epi16(average, average));
+			}
+		}
+#endif
+		for (; x < w; ++x) {
+			const std::uint32_t x0 = std::min(2 * x, sw - 1);
+			const std::uint32_t x1 = std::min((2 * x) + 1, sw - 1);
+			std::uint32_t texel = 0;
+			for (int shift = 0; shift < 32; shift += 8) {
+				const std::uint32_t sum =
+					((a[x0] >> shift) & 0xFF) + ((a[x1] >> shift) & 0xFF) +
+					((b[x0] >> shift) & 0xFF) + ((b[x1] >> shift) & 0xFF);
+				texel |= ((sum + 2) >> 2) << shift;
+			}
+			row[x] = texel;
+		}
+	}
+}
+
+
+std::uint32_t
+Texture::Level::at(const std::uint32_t x, const std::uint32_t y) const {
+	const auto i = index(x, y);
+	if (format == Format::ARGB32) {
+		return texels[i];
+	}
+	std::uint32_t block[BLOCK_SIZE * BLOCK_SIZE];
+	decode(i / (BLOCK_SIZE * BLOCK_SIZE), block);
+	return block[i % (BLOCK_SIZE * BLOCK_SIZE)];
+}
+
+
+void
+Texture::Level::decode(const std::size_t block, std::uint32_t* const output) const {
+	constexpr std::size_t N = BLOCK_SIZE * BLOCK_SIZE;
+	switch (format) {
+		case Format::BC1:
+			decodeColorBlock(blocks[block], true, output);
+			break;
+		case Format::BC3:
+			decodeColorBlock(blocks[(2 * block) + 1], false, output);
+			decodeAlphaBlock(blocks[2 * block], output);
+			break;
+		default:
+			std::memcpy(output, &texels[block * N], N * sizeof(std::uint32_t));
+			break;
+	}
+}
+
+
+Texture::Texture(const QImage& image, const Format format, const bool sparse) {
+	setImage(image, format, sparse);
+}
+
+
+Texture::~Texture() {
+	if (isSparse()) {
+		PageCache::getInstance().release(*this);
+	}
+}
+
+
+bool
+Texture::isEmpty() const {
+	return levels_.empty();
+}
+
+
+std::uint32_t
+Texture::getWidth() const {
+	return levels_.empty() ? 0 : levels_.front().width;
+}
+
+
+std::uint32_t
+Texture::getHeight() const {
+	return levels_.empty() ? 0 : levels_.front().height;
+}
+
+
+Texture::Format
+Texture::getFormat() const {
+	return format_;
+}
+
+
+bool
+Texture::isSparse() const {
+	return pageFile_ != nullptr;
+}
+
+
+std::size_t
+Texture::getLevelCount() const {
+	return levels_.size();
+}
+
+
+const Texture::Level&
+Texture::getLevel(const std::size_t index) const {
+	return levels_[std::min(index, levels_.size() - 1)];
+}
+
+
+void
+Texture::load(QFile& file) {
+	// The resource manager reads the whole file to hash it, so it is rewound first.
+	QImage image;
+	file.reset();
+	if (!image.load(&file, nullptr)) {
+		qWarning("[Texture::load] Could not load texture data.");
+		return;
+	}
+	setImage(
+		image,
+		image.hasAlphaChannel() ? Format::BC3 : Format::BC1,
+		static_cast<std::uint32_t>(std::max(image.width(), image.height())) > SPARSE_THRESHOLD
+	);
+}
+
+
+void
+Texture::setImage(const QImage& image, const Format format, const bool sparse) {
+	if (isSparse()) {
+		PageCache::getInstance().release(*this);
+	}
+	levels_.clear();
+	format_ = format;
+	pageFile_.reset();
+	if (sparse) {
+		pageFile_.reset(new QTemporaryFile);
+		if (!pageFile_->open()) {
+			qFatal("[Texture::setImage] Could not create a page file!");
+		}
+	}
+	if (image.isNull()) {
+		return;
+	}
+	// QImage stores rows from the top of the image to its bottom, while texture
+	// coordinates start at the bottom.
+	const auto& argb = image.convertToFormat(QImage::Format_ARGB32).mirrored(false, true);
+
+	const std::uint32_t w = argb.width();
+	const std::uint32_t h = argb.height();
+	std::vector<std::uint32_t> texels(static_cast<std::size_t>(w) * h);
+	for (std::uint32_t y = 0; y < h; ++y) {
+		std::memcpy(&texels[y * w], argb.constScanLine(y), w * sizeof(std::uint32_t));
+	}
+	generateMipChain(std::move(texels), w, h);
+}
+
+
+void
+Texture::generateMipChain(std::vector<std::uint32_t> texels, std::uint32_t w, std::uint32_t h) {
+	// The levels are generated from each other in rows, which is simpler and faster
+	// to filter, and only then stored in blocks.
+	std::vector<std::uint32_t> next;
+	for (;;) {
+		Level level;
+		level.format = Format::ARGB32;
+		level.identifier = NEXT_LEVEL_IDENTIFIER++;
+		level.width = w;
+		level.height = h;
+		swizzle(texels, level);
+		compress(level, format_);
+		if (pageFile_ != nullptr && (w > PAGE_SIZE || h > PAGE_SIZE)) {
+			paginate(level);
+		}
+		levels_.push_back(std::move(level));
+		if (w == 1 && h == 1) {
+			break;
+		}
+
+		const std::uint32_t nw = std::max(w / 2, 1u);
+		const std::uint32_t nh = std::max(h / 2, 1u);
+		downsample(texels, w, h, next, nw, nh);
+		texels.swap(next);
+		w = nw;
+		h = nh;
+	}
+}
+
+
+void
+Texture::paginate(Level& level) {
+	constexpr std::uint32_t blocksPerPage = PAGE_SIZE / BLOCK_SIZE;
+	const std::uint32_t blocksPerColumn = (level.height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	const std::uint32_t pagesPerColumn = (level.height + PAGE_SIZE - 1) / PAGE_SIZE;
+	const std::size_t blockSize = getBlockSize(level.format);
+
+	level.pagesPerRow = (level.width + PAGE_SIZE - 1) / PAGE_SIZE;
+	level.pages.reset(new Page[level.pagesPerRow * pagesPerColumn]);
+
+	// Each page holds a square of blocks, in rows. The blocks of the pages at the
+	// right and top edges that lie outside the level are zeroed.
+	const auto* const blocks = getBlockData(level);
+	std::vector<char> page(blocksPerPage * blocksPerPage * blockSize);
+	for (std::uint32_t py = 0; py < pagesPerColumn; ++py) {
+		for (std::uint32_t px = 0; px < level.pagesPerRow; ++px) {
+			std::fill(page.begin(), page.end(), 0);
+
+			const std::uint32_t bx = px * blocksPerPage;
+			const std::uint32_t count = std::min(blocksPerPage, level.blocksPerRow - bx);
+			for (std::uint32_t j = 0; j < blocksPerPage; ++j) {
+				const std::uint32_t by = (py * blocksPerPage) + j;
+				if (by >= blocksPerColumn) {
+					break;
+				}
+				std::memcpy(
+					&page[j * blocksPerPage * blockSize],
+					blocks + (((static_cast<std::size_t>(by) * level.blocksPerRow) + bx) * blockSize),
+					count * blockSize
+				);
+			}
+			level.pages[(py * level.pagesPerRow) + px].offset = pageFile_->pos();
+			if (pageFile_->write(page.data(), page.size()) != static_cast<qint64>(page.size())) {
+				qFatal("[Texture::paginate] Could not write to the page file!");
+			}
+		}
+	}
+	std::vector<std::uint32_t>().swap(level.texels);
+	std::vector<std::uint64_t>().swap(level.blocks);
+}
+
+
+std::unique_ptr<Texture::Level>
+Texture::readPage(const std::size_t index, const std::size_t position) const {
+	const auto& level = levels_[index];
+	constexpr std::uint32_t blocksPerPage = PAGE_SIZE / BLOCK_SIZE;
+	const std::size_t blockCount = blocksPerPage * blocksPerPage;
+
+	std::unique_ptr<Level> page(new Level);
+	page->format = level.format;
+	page->identifier = NEXT_LEVEL_IDENTIFIER++;
+	page->width = PAGE_SIZE;
+	page->height = PAGE_SIZE;
+	page->blocksPerRow = blocksPerPage;
+	switch (level.format) {
+		case Format::BC1:
+			page->blocks.resize(blockCount);
+			break;
+		case Format::BC3:
+			page->blocks.resize(2 * blockCount);
+			break;
+		default:
+			page->texels.resize(blockCount * BLOCK_SIZE * BLOCK_SIZE);
+			break;
+	}
+
+	const auto size = static_cast<qint64>(blockCount * getBlockSize(level.format));
+	QMutexLocker locker(&pageFileMutex_);
+	if (!pageFile_->seek(level.pages[position].offset) || pageFile_->read(getBlockData(*page), size) != size) {
+		qWarning("[Texture::readPage] Could not read a page from the page file!");
+		return nullptr;
+	}
+	return page;
+}
@@ -26,15 +26,184 @@
 #define CLOCKWORK_TEXTURE_HH
 
 #include "Resource.hh"
+#include <QMutex>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 
+class QImage;
+class QTemporaryFile;
 namespace clockwork {
 /**
+ * A texture is an image that is mapped onto a surface. Each texture holds a mip
+ * chain, i.e. a sequence of images where the first is the original image and each
+ * subsequent image is half the width and height of its predecessor, down to a
+ * single texel. The chain is generated when the texture is loaded so that minified
+ * textures can be sampled from a level whose texels are about the size of a pixel.
  *
+ * A texture may also be sparse, in which case each level that is larger than a page
+ * is split into pages of PAGE_SIZE x PAGE_SIZE texels that are stored on disk, and
+ * only loaded into the PageCache when they are sampled.
  */
 class Texture : public Resource {
 	friend class ResourceManager;
 public:
+	/**
+	 * The width and height, in texels, of the square blocks that texels are stored
+	 * in. A block of 4 x 4 texels fills a 64-byte cache line, so that the texels
+	 * fetched by a filter, which are close to each other in both dimensions, are
+	 * rarely more than a cache line apart.
+	 */
+	static constexpr std::uint32_t BLOCK_SIZE = 4;
+	/**
+	 * The width and height, in texels, of a sparse texture's pages.
+	 */
+	static constexpr std::uint32_t PAGE_SIZE = 128;
+	/**
+	 * The width or height, in texels, above which textures that are loaded from
+	 * image files are sparse.
+	 */
+	static constexpr std::uint32_t SPARSE_THRESHOLD = 2048;
+	/**
+	 * Available texel formats.
+	 */
+	enum class Format {
+		/**
+		 * Uncompressed 32-bit ARGB texels.
+		 */
+		ARGB32,
+		/**
+		 * Opaque texels compressed into a 64-bit color block per 4x4 texels, i.e. an
+		 * eighth of the uncompressed size.
+		 */
+		BC1,
+		/**
+		 * Texels compressed into a 64-bit alpha block and a 64-bit color block per
+		 * 4x4 texels, i.e. a quarter of the uncompressed size.
+		 */
+		BC3,
+	};
+	/**
+	 * @see Texture::Level.
+	 */
+	struct Level;
+	/**
+	 * A page of a sparse texture's level.
+	 */
+	struct Page {
+		/**
+		 * The page's texels, stored as a level of PAGE_SIZE x PAGE_SIZE texels, or
+		 * nullptr if the page is not resident. The pointer only changes between frames,
+		 * when the PageCache is updated.
+		 */
+		const Level* data = nullptr;
+		/**
+		 * The position of the page's texels in the texture's page file.
+		 */
+		std::int64_t offset = 0;
+		/**
+		 * The last frame in which the page was sampled.
+		 */
+		mutable std::atomic<std::uint32_t> frame{0};
+		/**
+		 * True if the page has been requested but is not yet resident, false otherwise.
+		 */
+		mutable std::atomic<bool> requested{false};
+	};
+	/**
+	 * A level in the texture's mip chain.
+	 */
+	struct Level {
+		/**
+		 * The format of the level's texels.
+		 */
+		Format format;
+		/**
+		 * A number that identifies the level among all levels of all textures,
+		 * which is used to cache decompressed blocks.
+		 */
+		std::uint64_t identifier;
+		/**
+		 * The level's width in texels.
+		 */
+		std::uint32_t width;
+		/**
+		 * The level's height in texels.
+		 */
+		std::uint32_t height;
+		/**
+		 * The number of blocks in each row of blocks.
+		 */
+		std::uint32_t blocksPerRow;
+		/**
+		 * The level's 32-bit ARGB texels, stored in blocks of BLOCK_SIZE x BLOCK_SIZE
+		 * texels. The texels in a block, as well as the blocks themselves, are stored
+		 * in rows from the bottom of the image to its top, so that the texel at <0, 0>
+		 * maps to the texture coordinate <0, 0>. When a dimension is not a multiple of
+		 * the block size, the last blocks are padded with copies of the edge texels.
+		 * The array is empty if the level is compressed.
+		 */
+		std::vector<std::uint32_t> texels;
+		/**
+		 * The level's compressed blocks, in the same order as the blocks of texels.
+		 * BC1 levels store a color block per block of texels, while BC3 levels store
+		 * an alpha block followed by a color block. The array is empty if the level
+		 * is not compressed.
+		 */
+		std::vector<std::uint64_t> blocks;
+		/**
+		 * The number of pages in each row of pages if the level is split into pages,
+		 * 0 otherwise. The texel and block arrays of a level that is split into pages
+		 * are empty.
+		 */
+		std::uint32_t pagesPerRow = 0;
+		/**
+		 * The level's pages, stored in rows, if the level is split into pages.
+		 */
+		std::unique_ptr<Page[]> pages;
+		/**
+		 * Returns the position of the texel at <x, y> in the texel array.
+		 * @param x the texel's horizontal position.
+		 * @param y the texel's vertical position.
+		 */
+		std::size_t index(const std::uint32_t x, const std::uint32_t y) const {
+			const std::size_t block = (static_cast<std::size_t>(y / BLOCK_SIZE) * blocksPerRow) + (x / BLOCK_SIZE);
+			return (block * BLOCK_SIZE * BLOCK_SIZE) + ((y % BLOCK_SIZE) * BLOCK_SIZE) + (x % BLOCK_SIZE);
+		}
+		/**
+		 * Returns the texel at <x, y>. If the level is compressed, the texel's block
+		 * is decompressed, so prefer decode when reading several texels in a block.
+		 * The level must not be split into pages.
+		 * @param x the texel's horizontal position.
+		 * @param y the texel's vertical position.
+		 */
+		std::uint32_t at(const std::uint32_t x, const std::uint32_t y) const;
+		/**
+		 * Decompresses the block of texels at the specified position in the texel array.
+		 * @param block the block's position, i.e. the position of its first texel
+		 * divided by BLOCK_SIZE x BLOCK_SIZE.
+		 * @param output the BLOCK_SIZE x BLOCK_SIZE texels to write.
+		 */
+		void decode(const std::size_t block, std::uint32_t* const output) const;
+		/**
+		 * Returns the page that contains the texel at <x, y>, if the level is split
+		 * into pages.
+		 * @param x the texel's horizontal position.
+		 * @param y the texel's vertical position.
+		 */
+		const Page& getPage(const std::uint32_t x, const std::uint32_t y) const {
+			return pages[((y / PAGE_SIZE) * pagesPerRow) + (x / PAGE_SIZE)];
+		}
+	};
+	/**
+	 * Instantiates a Texture object from the specified image.
+	 * @param image the texture's image.
+	 * @param format the format that the texels are stored in.
+	 * @param sparse true if the texture's levels are split into pages, false otherwise.
+	 */
+	explicit Texture(const QImage& image, const Format format = Format::ARGB32, const bool sparse = false);
 	/**
 	 *
 	 */
@@ -51,11 +220,101 @@ public:
 	 *
 	 */
 	Texture& operator=(Texture&&) = delete;
+	/**
+	 * Removes the texture's pages from the PageCache.
+	 */
+	~Texture();
+	/**
+	 * Returns true if the texture holds no texels, false otherwise.
+	 */
+	bool isEmpty() const;
+	/**
+	 * Returns the width of the texture's original image.
+	 */
+	std::uint32_t getWidth() const;
+	/**
+	 * Returns the height of the texture's original image.
+	 */
+	std::uint32_t getHeight() const;
+	/**
+	 * Returns the format that the texture's texels are stored in.
+	 */
+	Format getFormat() const;
+	/**
+	 * Returns true if the texture is sparse, i.e. if its largest levels are split
+	 * into pages, false otherwise.
+	 */
+	bool isSparse() const;
+	/**
+	 * Returns the number of levels in the texture's mip chain.
+	 */
+	std::size_t getLevelCount() const;
+	/**
+	 * Returns the level with the specified index in the texture's mip chain, where
+	 * level 0 is the original image.
+	 * @param index the level's index.
+	 */
+	const Level& getLevel(const std::size_t index) const;
+	/**
+	 * Reads the texels of the specified page from the texture's page file. This
+	 * function is thread-safe.
+	 * @param level the index of the level that contains the page.
+	 * @param page the page's position in the level's page array.
+	 * @return the page's texels, or nullptr if they could not be read.
+	 */
+	std::unique_ptr<Level> readPage(const std::size_t level, const std::size_t page) const;
 private:
 	/**
 	 * Instantiates a Texture object.
 	 */
 	Texture() = default;
+	/**
+	 * Loads a texture from the specified image file. To reduce the memory used by
+	 * textures, the texels are compressed into BC3 blocks if the image has an alpha
+	 * channel, and into BC1 blocks otherwise. Images that are larger than the sparse
+	 * threshold produce sparse textures.
+	 * @param file a file containing the image to load.
+	 */
+	void load(QFile& file) override;
+	/**
+	 * Replaces the texture's texels with those of the specified image, then
+	 * generates the texture's mip chain.
+	 * @param image the texture's image.
+	 * @param format the format that the texels are stored in.
+	 * @param sparse true if the texture's levels are split into pages, false otherwise.
+	 */
+	void setImage(const QImage& image, const Format format, const bool sparse);
+	/**
+	 * Generates the mip chain from the specified image, where each level is generated
+	 * from its predecessor.
+	 * @param texels the image's texels, stored in rows from the bottom of the image to its top.
+	 * @param width the image's width.
+	 * @param height the image's height.
+	 */
+	void generateMipChain(std::vector<std::uint32_t> texels, std::uint32_t width, std::uint32_t height);
+	/**
+	 * Splits the specified level into pages that are written to the page file, then
+	 * releases the level's texels.
+	 * @param level the level to split.
+	 */
+	void paginate(Level& level);
+	/**
+	 * The texture's mip chain.
+	 */
+	std::vector<Level> levels_;
+	/**
+	 * The format that the texture's texels are stored in.
+	 */
+	Format format_ = Format::ARGB32;
+	/**
+	 * The file that holds the pages of a sparse texture, or nullptr if the texture is
+	 * not sparse.
+	 */
+	std::unique_ptr<QTemporaryFile> pageFile_;
+	/**
+	 * A mutex that serializes access to the page file.
+	 */
+	mutable QMutex pageFileMutex_;
 };
 } // namespace clockwork
 
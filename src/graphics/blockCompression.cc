@@ -0,0 +1,322 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "blockCompression.hh"
+#include <algorithm>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * Converts an RGB565 color into a 32-bit opaque ARGB color.
+ */
+static std::uint32_t
+expand565(const std::uint32_t color) {
+	const std::uint32_t r = (color >> 11) & 0x1F;
+	const std::uint32_t g = (color >> 5) & 0x3F;
+	const std::uint32_t b = color & 0x1F;
+	return 0xFF000000 | (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+}
+
+
+/**
+ * Converts a 32-bit ARGB color into an RGB565 color.
+ */
+static std::uint32_t
+compress565(const std::uint32_t color) {
+	const std::uint32_t r = (((color >> 16) & 0xFF) * 31 + 127) / 255;
+	const std::uint32_t g = (((color >> 8) & 0xFF) * 63 + 127) / 255;
+	const std::uint32_t b = ((color & 0xFF) * 31 + 127) / 255;
+	return (r << 11) | (g << 5) | b;
+}
+
+
+/**
+ * Returns the channel of a color that is found at the specified shift.
+ */
+static std::int32_t
+channel(const std::uint32_t color, const int shift) {
+	return (color >> shift) & 0xFF;
+}
+
+
+/**
+ * Computes the four colors that a color block's indices select from.
+ */
+static void
+getColorPalette(const std::uint32_t c0, const std::uint32_t c1, const bool transparency, std::uint32_t* const palette) {
+	palette[0] = expand565(c0);
+	palette[1] = expand565(c1);
+	if (transparency && c0 <= c1) {
+		palette[2] = 0xFF000000;
+		for (int shift = 0; shift < 24; shift += 8) {
+			palette[2] |= ((channel(palette[0], shift) + channel(palette[1], shift) + 1) >> 1) << shift;
+		}
+		palette[3] = 0;
+	} else {
+		palette[2] = 0xFF000000;
+		palette[3] = 0xFF000000;
+		for (int shift = 0; shift < 24; shift += 8) {
+			const std::uint32_t a = channel(palette[0], shift);
+			const std::uint32_t b = channel(palette[1], shift);
+			palette[2] |= (((2 * a) + b + 1) / 3) << shift;
+			palette[3] |= ((a + (2 * b) + 1) / 3) << shift;
+		}
+	}
+}
+
+
+/**
+ * Computes the eight values that an alpha block's indices select from.
+ */
+static void
+getAlphaPalette(const std::uint32_t a0, const std::uint32_t a1, std::uint32_t* const palette) {
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1) {
+		for (std::uint32_t k = 1; k < 7; ++k) {
+			palette[k + 1] = (((7 - k) * a0) + (k * a1) + 3) / 7;
+		}
+	} else {
+		for (std::uint32_t k = 1; k < 5; ++k) {
+			palette[k + 1] = (((5 - k) * a0) + (k * a1) + 2) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+
+std::uint64_t
+clockwork::encodeColorBlock(const std::uint32_t* const texels) {
+	float mean[3] = {0.0f, 0.0f, 0.0f};
+	for (int i = 0; i < 16; ++i) {
+		for (int c = 0; c < 3; ++c) {
+			mean[c] += channel(texels[i], 16 - (8 * c));
+		}
+	}
+	for (auto& m : mean) {
+		m /= 16.0f;
+	}
+
+	// Find the principal axis of the colors, i.e. the eigenvector of their covariance
+	// matrix with the largest eigenvalue, by power iteration.
+	float covariance[3][3] = {};
+	for (int i = 0; i < 16; ++i) {
+		float d[3];
+		for (int c = 0; c < 3; ++c) {
+			d[c] = channel(texels[i], 16 - (8 * c)) - mean[c];
+		}
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 3; ++c) {
+				covariance[r][c] += d[r] * d[c];
+			}
+		}
+	}
+	int row = 0;
+	for (int r = 1; r < 3; ++r) {
+		if (covariance[r][r] > covariance[row][row]) {
+			row = r;
+		}
+	}
+	float axis[3] = {covariance[row][0], covariance[row][1], covariance[row][2]};
+	for (int iteration = 0; iteration < 4; ++iteration) {
+		float next[3];
+		float norm = 0.0f;
+		for (int r = 0; r < 3; ++r) {
+			next[r] = (covariance[r][0] * axis[0]) + (covariance[r][1] * axis[1]) + (covariance[r][2] * axis[2]);
+			norm = std::max(norm, std::abs(next[r]));
+		}
+		if (norm == 0.0f) {
+			break;
+		}
+		for (int r = 0; r < 3; ++r) {
+			axis[r] = next[r] / norm;
+		}
+	}
+
+	// The texels at either end of the axis are used as the block's endpoints.
+	int minimum = 0;
+	int maximum = 0;
+	float minimumProjection = INFINITY;
+	float maximumProjection = -INFINITY;
+	for (int i = 0; i < 16; ++i) {
+		float projection = 0.0f;
+		for (int c = 0; c < 3; ++c) {
+			projection += channel(texels[i], 16 - (8 * c)) * axis[c];
+		}
+		if (projection < minimumProjection) {
+			minimumProjection = projection;
+			minimum = i;
+		}
+		if (projection > maximumProjection) {
+			maximumProjection = projection;
+			maximum = i;
+		}
+	}
+	std::uint32_t c0 = compress565(texels[maximum]);
+	std::uint32_t c1 = compress565(texels[minimum]);
+	if (c0 < c1) {
+		std::swap(c0, c1);
+	}
+	std::uint64_t block = c0 | (c1 << 16);
+	if (c0 == c1) {
+		return block;
+	}
+
+	std::uint32_t palette[4];
+	getColorPalette(c0, c1, false, palette);
+
+	std::uint64_t indices = 0;
+	for (int i = 0; i < 16; ++i) {
+		std::int32_t closest = INT32_MAX;
+		for (std::uint64_t j = 0; j < 4; ++j) {
+			std::int32_t distance = 0;
+			for (int shift = 0; shift < 24; shift += 8) {
+				const std::int32_t d = channel(texels[i], shift) - channel(palette[j], shift);
+				distance += d * d;
+			}
+			if (distance < closest) {
+				closest = distance;
+				indices = (indices & ~(std::uint64_t(3) << (2 * i))) | (j << (2 * i));
+			}
+		}
+	}
+	return block | (indices << 32);
+}
+
+
+std::uint64_t
+clockwork::encodeAlphaBlock(const std::uint32_t* const texels) {
+	std::uint32_t a0 = 0;
+	std::uint32_t a1 = 255;
+	for (int i = 0; i < 16; ++i) {
+		a0 = std::max(a0, texels[i] >> 24);
+		a1 = std::min(a1, texels[i] >> 24);
+	}
+	std::uint64_t block = a0 | (a1 << 8);
+	if (a0 == a1) {
+		return block;
+	}
+
+	std::uint32_t palette[8];
+	getAlphaPalette(a0, a1, palette);
+
+	std::uint64_t indices = 0;
+	for (int i = 0; i < 16; ++i) {
+		const std::int32_t alpha = texels[i] >> 24;
+		std::uint64_t closest = 0;
+		for (std::uint64_t j = 1; j < 8; ++j) {
+			if (std::abs(alpha - std::int32_t(palette[j])) < std::abs(alpha - std::int32_t(palette[closest]))) {
+				closest = j;
+			}
+		}
+		indices |= closest << (3 * i);
+	}
+	return block | (indices << 16);
+}
+
+
+void
+clockwork::decodeColorBlock(const std::uint64_t block, const bool transparency, std::uint32_t* const texels) {
+	const std::uint32_t c0 = block & 0xFFFF;
+	const std::uint32_t c1 = (block >> 16) & 0xFFFF;
+	const std::uint32_t indices = block >> 32;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i e0 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(expand565(c0)), zero);
+	const __m128i e1 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(expand565(c1)), zero);
+	__m128i palette;
+	if (transparency && c0 <= c1) {
+		const __m128i p2 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(e0, e1), _mm_set1_epi16(1)), 1);
+		palette = _mm_packus_epi16(_mm_unpacklo_epi64(e0, e1), p2);
+	} else {
+		// Dividing by 3 is done by multiplying by 65536 / 3, which is exact for
+		// numerators that are smaller than 768.
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i third = _mm_set1_epi16(21846);
+		const __m128i p2 = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(_mm_add_epi16(e0, e0), e1), one), third);
+		const __m128i p3 = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(_mm_add_epi16(e1, e1), e0), one), third);
+		palette = _mm_packus_epi16(_mm_unpacklo_epi64(e0, e1), _mm_unpacklo_epi64(p2, p3));
+	}
+
+	// Each texel selects its color by comparing its index to each of the four
+	// possible values and masking the matching palette entry.
+	const __m128i P0 = _mm_shuffle_epi32(palette, 0x00);
+	const __m128i P1 = _mm_shuffle_epi32(palette, 0x55);
+	const __m128i P2 = _mm_shuffle_epi32(palette, 0xAA);
+	const __m128i P3 = _mm_shuffle_epi32(palette, 0xFF);
+	const __m128i three = _mm_set1_epi32(3);
+	for (int row = 0; row < 4; ++row) {
+		const std::uint32_t bits = indices >> (8 * row);
+		const __m128i index = _mm_and_si128(_mm_set_epi32(bits >> 6, bits >> 4, bits >> 2, bits), three);
+		const __m128i color = _mm_or_si128(
+			_mm_or_si128(
+				_mm_and_si128(_mm_cmpeq_epi32(index, zero), P0),
+				_mm_and_si128(_mm_cmpeq_epi32(index, _mm_set1_epi32(1)), P1)
+			),
+			_mm_or_si128(
+				_mm_and_si128(_mm_cmpeq_epi32(index, _mm_set1_epi32(2)), P2),
+				_mm_and_si128(_mm_cmpeq_epi32(index, three), P3)
+			)
+		);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(texels + (4 * row)), color);
+	}
+#else
+	std::uint32_t palette[4];
+	getColorPalette(c0, c1, transparency, palette);
+	for (int i = 0; i < 16; ++i) {
+		texels[i] = palette[(indices >> (2 * i)) & 3];
+	}
+#endif
+}
+
+
+void
+clockwork::decodeAlphaBlock(const std::uint64_t block, std::uint32_t* const texels) {
+	std::uint32_t palette[8];
+	getAlphaPalette(block & 0xFF, (block >> 8) & 0xFF, palette);
+
+	const std::uint64_t indices = block >> 16;
+#ifdef __SSE2__
+	const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+	for (int row = 0; row < 4; ++row) {
+		const std::uint64_t bits = indices >> (12 * row);
+		const __m128i alpha = _mm_set_epi32(
+			palette[(bits >> 9) & 7] << 24,
+			palette[(bits >> 6) & 7] << 24,
+			palette[(bits >> 3) & 7] << 24,
+			palette[bits & 7] << 24
+		);
+		auto* const p = reinterpret_cast<__m128i*>(texels + (4 * row));
+		_mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(p), rgb), alpha));
+	}
+#else
+	for (int i = 0; i < 16; ++i) {
+		texels[i] = (texels[i] & 0x00FFFFFF) | (palette[(indices >> (3 * i)) & 7] << 24);
+	}
+#endif
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_BLOCK_COMPRESSION_HH
+#define CLOCKWORK_BLOCK_COMPRESSION_HH
+
+#include <cstdint>
+
+
+namespace clockwork {
+/**
+ * Compresses the colors of the specified block of 16 32-bit ARGB texels into a
+ * 64-bit BC1 color block. The block holds two RGB565 endpoints and a 2-bit index
+ * per texel, which selects one of the endpoints or one of two colors in between.
+ * The endpoints are found along the principal axis of the block's colors.
+ * @param texels the 4x4 texels to compress, in rows.
+ */
+std::uint64_t encodeColorBlock(const std::uint32_t* const texels);
+/**
+ * Compresses the alpha channel of the specified block of 16 32-bit ARGB texels into
+ * a 64-bit BC3 alpha block. The block holds two 8-bit endpoints and a 3-bit index
+ * per texel, which selects one of the endpoints or one of six values in between.
+ * @param texels the 4x4 texels to compress, in rows.
+ */
+std::uint64_t encodeAlphaBlock(const std::uint32_t* const texels);
+/**
+ * Decompresses the specified BC1 color block into 16 32-bit ARGB texels.
+ * @param block the color block to decompress.
+ * @param transparency true if the block may use BC1's three-color mode, where the
+ * fourth color is transparent black, false if it always holds four opaque colors,
+ * as is the case in a BC3 block.
+ * @param texels the 4x4 texels to write, in rows.
+ */
+void decodeColorBlock(const std::uint64_t block, const bool transparency, std::uint32_t* const texels);
+/**
+ * Decompresses the specified BC3 alpha block into the alpha channel of 16 32-bit
+ * ARGB texels, leaving their other channels unchanged.
+ * @param block the alpha block to decompress.
+ * @param texels the 4x4 texels to update, in rows.
+ */
+void decodeAlphaBlock(const std::uint64_t block, std::uint32_t* const texels);
+} // namespace clockwork
+
+#endif // CLOCKWORK_BLOCK_COMPRESSION_HH
@@ -0,0 +1,90 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "AnisotropicTextureFilter.hh"
+#include <algorithm>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using clockwork::AnisotropicTextureFilter;
+
+
+constexpr std::uint32_t AnisotropicTextureFilter::MAXIMUM_ANISOTROPY;
+
+
+AnisotropicTextureFilter::AnisotropicTextureFilter() :
+TextureFilter(TextureFilter::Identifier::Anisotropic) {}
+
+
+std::uint32_t
+AnisotropicTextureFilter::sample(const Texture& texture, const QPointF& uv, const QPointF& dx, const QPointF& dy) const {
+	const float w = texture.getWidth();
+	const float h = texture.getHeight();
+	const float px = std::hypot(dx.x() * w, dx.y() * h);
+	const float py = std::hypot(dy.x() * w, dy.y() * h);
+	const float pmax = std::max(px, py);
+	const float pmin = std::max(std::min(px, py), 1e-6f);
+
+	const auto N = std::min(static_cast<std::uint32_t>(std::ceil(pmax / pmin)), MAXIMUM_ANISOTROPY);
+	if (N <= 1) {
+		return sampleTrilinear(texture, uv.x(), uv.y(), getLevelOfDetail(texture, dx, dy));
+	}
+
+	// The samples are distributed evenly along the major axis, i.e. the derivative
+	// with the longest footprint, and filtered from the level that matches the
+	// length of each sample's share of that axis.
+	const float lod = std::log2(std::max(pmax / N, 1e-6f));
+	const auto& axis = px > py ? dx : dy;
+	const float du = axis.x();
+	const float dv = axis.y();
+
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = zero;
+	for (std::uint32_t i = 0; i < N; ++i) {
+		const float t = ((i + 0.5f) / N) - 0.5f;
+		const auto texel = sampleTrilinear(texture, uv.x() + (t * du), uv.y() + (t * dv), lod);
+		sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(_mm_cvtsi32_si128(texel), zero));
+	}
+	const __m128 average = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(sum, zero)), _mm_set1_ps(1.0f / N));
+	const __m128i result = _mm_packs_epi32(_mm_cvtps_epi32(average), zero);
+	return _mm_cvtsi128_si32(_mm_packus_epi16(result, result));
+#else
+	std::uint32_t sum[4] = {0, 0, 0, 0};
+	for (std::uint32_t i = 0; i < N; ++i) {
+		const float t = ((i + 0.5f) / N) - 0.5f;
+		const auto texel = sampleTrilinear(texture, uv.x() + (t * du), uv.y() + (t * dv), lod);
+		for (std::uint32_t c = 0; c < 4; ++c) {
+			sum[c] += (texel >> (8 * c)) & 0xFF;
+		}
+	}
+	std::uint32_t result = 0;
+	for (std::uint32_t c = 0; c < 4; ++c) {
+		result |= static_cast<std::uint32_t>(std::lround(static_cast<float>(sum[c]) / N)) << (8 * c);
+	}
+	return result;
+#endif
+}
@@ -0,0 +1,40 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "BilinearTextureFilter.hh"
+#include <cmath>
+
+using clockwork::BilinearTextureFilter;
+
+
+BilinearTextureFilter::BilinearTextureFilter() :
+TextureFilter(TextureFilter::Identifier::Bilinear) {}
+
+
+std::uint32_t
+BilinearTextureFilter::sample(const Texture& texture, const QPointF& uv, const QPointF& dx, const QPointF& dy) const {
+	const float lod = getLevelOfDetail(texture, dx, dy);
+	const auto index = lod > 0.0f ? static_cast<std::size_t>(std::lround(lod)) : 0;
+	return sampleBilinear(texture, index, uv.x(), uv.y());
+}
@@ -0,0 +1,52 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "BlackAndWhiteImageFilter.hh"
+#include "luma.hh"
+
+using clockwork::BlackAndWhiteImageFilter;
+
+
+BlackAndWhiteImageFilter::BlackAndWhiteImageFilter() :
+PixelImageFilter(ImageFilter::Identifier::BlackAndWhite) {}
+
+
+void
+BlackAndWhiteImageFilter::filter(std::uint32_t* const pixels, const std::size_t count) const {
+	std::size_t i = 0;
+#ifdef __SSE2__
+	const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+	const __m128i threshold = _mm_set1_epi32(THRESHOLD - 1);
+	for (; i + 4 <= count; i += 4) {
+		auto* const p = reinterpret_cast<__m128i*>(pixels + i);
+		const __m128i argb = _mm_loadu_si128(p);
+		const __m128i white = _mm_andnot_si128(alphaMask, _mm_cmpgt_epi32(luma(argb), threshold));
+		_mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(argb, alphaMask), white));
+	}
+#endif
+	for (; i < count; ++i) {
+		const std::uint32_t white = luma(pixels[i]) >= THRESHOLD ? 0x00FFFFFF : 0;
+		pixels[i] = (pixels[i] & 0xFF000000) | white;
+	}
+}
@@ -0,0 +1,54 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_BLACK_AND_WHITE_IMAGE_FILTER_HH
+#define CLOCKWORK_BLACK_AND_WHITE_IMAGE_FILTER_HH
+
+#include "PixelImageFilter.hh"
+
+
+namespace clockwork {
+/**
+ * An image filter that replaces each pixel's color with white if its luma is
+ * above a threshold, and black otherwise.
+ */
+class BlackAndWhiteImageFilter final : public PixelImageFilter {
+public:
+	/**
+	 * Instantiates a BlackAndWhiteImageFilter object.
+	 */
+	BlackAndWhiteImageFilter();
+	/**
+	 * @see PixelImageFilter::filter.
+	 */
+	void filter(std::uint32_t* const pixels, const std::size_t count) const override;
+private:
+	/**
+	 * The luma at and above which a pixel is considered white.
+	 */
+	static constexpr std::uint32_t THRESHOLD = 128;
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_BLACK_AND_WHITE_IMAGE_FILTER_HH
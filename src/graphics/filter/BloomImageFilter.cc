@@ -0,0 +1,254 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "BloomImageFilter.hh"
+#include "Framebuffer.hh"
+#include "parallelFor.hh"
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using clockwork::BloomImageFilter;
+
+
+constexpr std::size_t BloomImageFilter::LEVEL_COUNT;
+constexpr std::uint8_t BloomImageFilter::THRESHOLD;
+
+
+namespace {
+/**
+ * The standard deviation of the blur applied to each level of the pyramid.
+ */
+constexpr float LEVEL_SIGMA = 1.5f;
+/**
+ * Returns the per-channel average of two 32-bit pixels, rounded up. This is the
+ * scalar equivalent of _mm_avg_epu8.
+ */
+inline std::uint32_t
+average(const std::uint32_t a, const std::uint32_t b) {
+	return (a | b) - (((a ^ b) & 0xFEFEFEFE) >> 1);
+}
+/**
+ * Returns the per-channel value of (3a + b) / 4, i.e. the value a quarter of the way
+ * from a to b.
+ */
+inline std::uint32_t
+interpolate(const std::uint32_t a, const std::uint32_t b) {
+	return average(a, average(a, b));
+}
+/**
+ * Returns the per-channel sum of two 32-bit pixels, saturated to 255.
+ */
+inline std::uint32_t
+addSaturate(const std::uint32_t a, const std::uint32_t b) {
+	std::uint32_t result = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		const std::uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF);
+		result |= std::min(sum, 0xFFu) << shift;
+	}
+	return result;
+}
+/**
+ * Returns the bright part of the specified pixel, i.e. the amount by which each
+ * channel exceeds the threshold, scaled back to the range [0, 255].
+ */
+inline std::uint32_t
+extractBrightPixel(const std::uint32_t pixel, const std::uint8_t threshold) {
+	std::uint32_t result = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		const std::uint32_t channel = (pixel >> shift) & 0xFF;
+		const std::uint32_t bright = channel > threshold ? (2 * (channel - threshold)) : 0;
+		result |= std::min(bright, 0xFFu) << shift;
+	}
+	return result;
+}
+/**
+ * Returns the row buffer of the calling thread, resized to hold at least the
+ * specified number of pixels.
+ */
+std::uint32_t*
+getRowBuffer(const std::size_t size) {
+	thread_local std::vector<std::uint32_t> buffer;
+	if (buffer.size() < size) {
+		buffer.resize(size);
+	}
+	return &buffer[0];
+}
+} // namespace
+
+
+BloomImageFilter::BloomImageFilter() :
+FramebufferImageFilter(ImageFilter::Identifier::Bloom),
+blur_(LEVEL_SIGMA) {}
+
+
+void
+BloomImageFilter::filter(const RenderingContext&, Framebuffer& framebuffer) {
+	auto* const pixels = framebuffer.getResolvedPixelBuffer();
+	const std::uint32_t width = framebuffer.getWidth();
+	const std::uint32_t height = framebuffer.getHeight();
+	if (pixels == nullptr || width < 2 || height < 2) {
+		return;
+	}
+	// Build the pyramid. A level is only added if it is at least twice as large as
+	// the blur's radius, since smaller levels would not contribute much to the glow.
+	const std::uint32_t minimumSize = 2 * blur_.getHaloSize();
+	std::size_t levelCount = 0;
+	const std::uint32_t* source = pixels;
+	std::uint32_t sourceWidth = width;
+	std::uint32_t sourceHeight = height;
+	std::uint32_t sourcePitch = framebuffer.getPitch();
+	while (levelCount < LEVEL_COUNT && sourceWidth >= 2 && sourceHeight >= 2) {
+		auto& level = levels_[levelCount];
+		downsample(source, sourceWidth, sourceHeight, sourcePitch, level, levelCount == 0);
+		blur_.apply(&level.pixels[0], level.width, level.height, level.width, blurBuffer_);
+		++levelCount;
+
+		source = &level.pixels[0];
+		sourceWidth = level.width;
+		sourceHeight = level.height;
+		sourcePitch = level.width;
+		if (sourceWidth < minimumSize || sourceHeight < minimumSize) {
+			break;
+		}
+	}
+
+	// Collapse the pyramid.
+	for (std::size_t i = levelCount - 1; i > 0; --i) {
+		auto& destination = levels_[i - 1];
+		upsampleAndAdd(levels_[i], &destination.pixels[0], destination.width, destination.height, destination.width);
+	}
+	upsampleAndAdd(levels_[0], pixels, width, height, framebuffer.getPitch());
+}
+
+
+void
+BloomImageFilter::downsample(
+	const std::uint32_t* const source,
+	const std::uint32_t sourceWidth,
+	const std::uint32_t sourceHeight,
+	const std::uint32_t sourcePitch,
+	Level& destination,
+	const bool extractBrightPixels
+) {
+	destination.width = (sourceWidth + 1) / 2;
+	destination.height = (sourceHeight + 1) / 2;
+	destination.pixels.resize(static_cast<std::size_t>(destination.width) * destination.height);
+
+	auto* const output = &destination.pixels[0];
+	const std::uint32_t w = destination.width;
+	parallelFor(destination.height, [=](const std::size_t y) {
+		// Images with an odd resolution have their last row and column repeated.
+		const std::uint32_t* const a = source + ((2 * y) * sourcePitch);
+		const std::uint32_t* const b = source + (std::min<std::size_t>((2 * y) + 1, sourceHeight - 1) * sourcePitch);
+		std::uint32_t* const row = output + (y * w);
+		std::uint32_t x = 0;
+#ifdef __SSE2__
+		const __m128i threshold = _mm_set1_epi8(static_cast<char>(THRESHOLD));
+		const auto& load = [extractBrightPixels, threshold](const std::uint32_t* const p) {
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			if (extractBrightPixels) {
+				const __m128i bright = _mm_subs_epu8(v, threshold);
+				return _mm_adds_epu8(bright, bright);
+			}
+			return v;
+		};
+		for (; (2 * x) + 8 <= sourceWidth; x += 4) {
+			// Average the two rows, then each pair of adjacent pixels, four output
+			// pixels at a time.
+			const __m128i lo = _mm_avg_epu8(load(a + (2 * x)), load(b + (2 * x)));
+			const __m128i hi = _mm_avg_epu8(load(a + (2 * x) + 4), load(b + (2 * x) + 4));
+			const __m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), _mm_avg_epu8(even, odd));
+		}
+#endif
+		for (; x < w; ++x) {
+			const std::uint32_t x0 = 2 * x;
+			const std::uint32_t x1 = std::min(x0 + 1, sourceWidth - 1);
+			std::uint32_t p[] = {a[x0], a[x1], b[x0], b[x1]};
+			if (extractBrightPixels) {
+				for (auto& pixel : p) {
+					pixel = extractBrightPixel(pixel, THRESHOLD);
+				}
+			}
+			row[x] = average(average(p[0], p[2]), average(p[1], p[3]));
+		}
+	});
+}
+
+
+void
+BloomImageFilter::upsampleAndAdd(
+	const Level& source,
+	std::uint32_t* const destination,
+	const std::uint32_t destinationWidth,
+	const std::uint32_t destinationHeight,
+	const std::uint32_t destinationPitch
+) {
+	const std::uint32_t sw = source.width;
+	const std::uint32_t sh = source.height;
+	const std::uint32_t* const input = &source.pixels[0];
+	parallelFor(destinationHeight, [=](const std::size_t y) {
+		// Each destination pixel lies a quarter of the way between its nearest source
+		// pixel and the next nearest one, both horizontally and vertically.
+		const std::uint32_t sy = y / 2;
+		const std::uint32_t ny = (y % 2) ? std::min(sy + 1, sh - 1) : (sy > 0 ? sy - 1 : 0);
+		const std::uint32_t* const near = input + (sy * sw);
+		const std::uint32_t* const far = input + (ny * sw);
+
+		auto* const interpolated = getRowBuffer(sw);
+		std::uint32_t i = 0;
+#ifdef __SSE2__
+		for (; i + 4 <= sw; i += 4) {
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(near + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(far + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(interpolated + i), _mm_avg_epu8(a, _mm_avg_epu8(a, b)));
+		}
+#endif
+		for (; i < sw; ++i) {
+			interpolated[i] = interpolate(near[i], far[i]);
+		}
+
+		std::uint32_t* const output = destination + (y * destinationPitch);
+		std::uint32_t x = 0;
+#ifdef __SSE2__
+		const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+		for (; x + 4 <= destinationWidth && (x / 2) + 2 < sw; x += 4) {
+			const std::uint32_t s = x / 2;
+			const __m128i a = _mm_setr_epi32(interpolated[s], interpolated[s], interpolated[s + 1], interpolated[s + 1]);
+			const __m128i b = _mm_setr_epi32(interpolated[s > 0 ? s - 1 : 0], interpolated[s + 1], interpolated[s], interpolated[s + 2]);
+			const __m128i glow = _mm_and_si128(_mm_avg_epu8(a, _mm_avg_epu8(a, b)), colorMask);
+			auto* const p = reinterpret_cast<__m128i*>(output + x);
+			_mm_storeu_si128(p, _mm_adds_epu8(_mm_loadu_si128(p), glow));
+		}
+#endif
+		for (; x < destinationWidth; ++x) {
+			const std::uint32_t s = x / 2;
+			const std::uint32_t n = (x % 2) ? std::min(s + 1, sw - 1) : (s > 0 ? s - 1 : 0);
+			output[x] = addSaturate(output[x], interpolate(interpolated[s], interpolated[n]) & 0x00FFFFFF);
+		}
+	});
+}
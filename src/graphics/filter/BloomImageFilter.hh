@@ -0,0 +1,130 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_BLOOM_IMAGE_FILTER_HH
+#define CLOCKWORK_BLOOM_IMAGE_FILTER_HH
+
+#include "FramebufferImageFilter.hh"
+#include "GaussianBlurImageFilter.hh"
+#include <array>
+
+
+namespace clockwork {
+/**
+ * An image filter that makes bright areas of the image glow. Bright pixels are
+ * extracted into a half-resolution image that is repeatedly downsampled and blurred
+ * to build a pyramid. The pyramid is then collapsed, from its coarsest level to its
+ * finest, by upsampling each level and adding it to the next, and the result is
+ * added to the framebuffer. Blurring small kernels at reduced resolutions produces
+ * a wide glow at a fraction of the cost of blurring the full-resolution image.
+ */
+class BloomImageFilter final : public FramebufferImageFilter {
+public:
+	/**
+	 * Instantiates a BloomImageFilter object.
+	 */
+	BloomImageFilter();
+	/**
+	 * @see FramebufferImageFilter::filter.
+	 */
+	void filter(const RenderingContext& context, Framebuffer& framebuffer) override;
+private:
+	/**
+	 * The maximum number of levels in the pyramid.
+	 */
+	static constexpr std::size_t LEVEL_COUNT = 5;
+	/**
+	 * The value that is subtracted from each channel to extract bright pixels.
+	 */
+	static constexpr std::uint8_t THRESHOLD = 128;
+	/**
+	 * An image in the pyramid.
+	 */
+	struct Level {
+		/**
+		 * The image's width.
+		 */
+		std::uint32_t width;
+		/**
+		 * The image's height.
+		 */
+		std::uint32_t height;
+		/**
+		 * The image's pixels.
+		 */
+		std::vector<std::uint32_t> pixels;
+	};
+	/**
+	 * Downsamples the specified source image to half its resolution by averaging
+	 * each 2x2 block of pixels.
+	 * @param source the image to downsample.
+	 * @param sourceWidth the source image's width.
+	 * @param sourceHeight the source image's height.
+	 * @param sourcePitch the number of pixels between two rows of the source image.
+	 * @param destination the half-resolution image.
+	 * @param extractBrightPixels if set to true, bright pixels are extracted from the
+	 * source image before it is downsampled.
+	 */
+	static void downsample(
+		const std::uint32_t* const source,
+		const std::uint32_t sourceWidth,
+		const std::uint32_t sourceHeight,
+		const std::uint32_t sourcePitch,
+		Level& destination,
+		const bool extractBrightPixels
+	);
+	/**
+	 * Upsamples the specified level to twice its resolution with bilinear filtering,
+	 * and adds the result to the destination image. The destination's alpha channel
+	 * is left unchanged.
+	 * @param source the level to upsample.
+	 * @param destination the image to add the upsampled level to.
+	 * @param destinationWidth the destination image's width.
+	 * @param destinationHeight the destination image's height.
+	 * @param destinationPitch the number of pixels between two rows of the destination image.
+	 */
+	static void upsampleAndAdd(
+		const Level& source,
+		std::uint32_t* const destination,
+		const std::uint32_t destinationWidth,
+		const std::uint32_t destinationHeight,
+		const std::uint32_t destinationPitch
+	);
+	/**
+	 * The blur that is applied to each level of the pyramid.
+	 */
+	const GaussianBlurImageFilter blur_;
+	/**
+	 * The pyramid's levels, where the first level has half the framebuffer's
+	 * resolution. Levels are reused across frames to avoid reallocating them.
+	 */
+	std::array<Level, LEVEL_COUNT> levels_;
+	/**
+	 * The buffer used by the blur to hold the halo-padded copy of each level.
+	 */
+	std::vector<std::uint32_t> blurBuffer_;
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_BLOOM_IMAGE_FILTER_HH
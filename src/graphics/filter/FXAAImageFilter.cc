@@ -0,0 +1,284 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "FXAAImageFilter.hh"
+#include "luma.hh"
+#include <algorithm>
+#include <cmath>
+
+using clockwork::FXAAImageFilter;
+using clockwork::ImageTile;
+
+
+namespace {
+/**
+ * The minimum amount of local contrast, relative to the maximum local luma, required
+ * for a pixel to be considered part of an edge. Lower values are slower but
+ * catch more edges.
+ */
+constexpr float EDGE_THRESHOLD = 0.166f;
+/**
+ * The minimum amount of local contrast required for a pixel to be considered part of
+ * an edge. This prevents dark areas, where aliasing is barely visible, from being
+ * processed.
+ */
+constexpr float EDGE_THRESHOLD_MINIMUM = 0.0833f;
+/**
+ * The amount of sub-pixel aliasing removal, where 0 is off and 1 is the softest.
+ */
+constexpr float SUBPIXEL_QUALITY = 0.75f;
+/**
+ * The distance, in pixels, covered by each step of the search for an edge's end points.
+ * Steps are coarser the further the search goes from the pixel being processed.
+ */
+constexpr int SEARCH_STEPS[] = {1, 1, 1, 1, 1, 2, 2, 2, 2, 4, 8};
+/**
+ * Returns the sum of the search steps, i.e. the farthest distance from the pixel
+ * being processed that the edge search can reach.
+ */
+constexpr int
+getSearchDistance() {
+	int distance = 0;
+	for (const auto step : SEARCH_STEPS) {
+		distance += step;
+	}
+	return distance;
+}
+/**
+ * Returns the luma, in the range [0, 1], of the pixel at <x, y> in the specified
+ * prepared tile.
+ */
+inline float
+getLuma(const clockwork::ImageTile& tile, const int x, const int y) {
+	return (1.0f / 255.0f) * (tile.at(x, y) >> 24);
+}
+/**
+ * Blends two 32-bit ARGB pixels where p, in the range [0, 1], is the weight of the
+ * second pixel. The first pixel's alpha channel is preserved.
+ */
+inline std::uint32_t
+blend(const std::uint32_t a, const std::uint32_t b, const float p) {
+	const std::uint32_t wb = static_cast<std::uint32_t>((p * 256.0f) + 0.5f);
+	const std::uint32_t wa = 256 - wb;
+	const std::uint32_t rb = ((((a & 0x00FF00FF) * wa) + ((b & 0x00FF00FF) * wb)) >> 8) & 0x00FF00FF;
+	const std::uint32_t g  = ((((a & 0x0000FF00) * wa) + ((b & 0x0000FF00) * wb)) >> 8) & 0x0000FF00;
+	return (a & 0xFF000000) | rb | g;
+}
+} // namespace
+
+
+FXAAImageFilter::FXAAImageFilter() :
+NeighborhoodImageFilter(ImageFilter::Identifier::FXAA) {}
+
+
+std::uint32_t
+FXAAImageFilter::getHaloSize() const {
+	// The 3x3 neighborhood read by the edge detection is always covered by the
+	// edge search, which also reads the neighbors across the edge.
+	return getSearchDistance();
+}
+
+
+void
+FXAAImageFilter::prepare(const std::uint32_t* const input, std::uint32_t* const output, const std::size_t count) const {
+	std::size_t i = 0;
+#ifdef __SSE2__
+	const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+	for (; i + 4 <= count; i += 4) {
+		const __m128i argb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+		const __m128i result = _mm_or_si128(_mm_and_si128(argb, colorMask), _mm_slli_epi32(luma(argb), 24));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), result);
+	}
+#endif
+	for (; i < count; ++i) {
+		output[i] = (input[i] & 0x00FFFFFF) | (luma(input[i]) << 24);
+	}
+}
+
+
+void
+FXAAImageFilter::filter(const ImageTile& source, const ImageTile& destination) const {
+	const int w = source.width;
+	const int h = source.height;
+	for (int y = 0; y < h; ++y) {
+		std::uint32_t* const output = destination.row(y);
+		int x = 0;
+#ifdef __SSE2__
+		// The source tile's halo makes the neighbors of its border pixels readable,
+		// so the vector loop needs no special handling at the tile's edges.
+		const auto* const M = source.row(y);
+		const auto* const N = source.row(y - 1);
+		const auto* const S = source.row(y + 1);
+		const auto& loadLuma = [](const std::uint32_t* const pixels) {
+			const __m128i argb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+			return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(argb, 24)), _mm_set1_ps(1.0f / 255.0f));
+		};
+		const __m128 threshold = _mm_set1_ps(EDGE_THRESHOLD);
+		const __m128 thresholdMinimum = _mm_set1_ps(EDGE_THRESHOLD_MINIMUM);
+		for (; x + 4 <= w; x += 4) {
+			const __m128 m = loadLuma(M + x);
+			const __m128 n = loadLuma(N + x);
+			const __m128 s = loadLuma(S + x);
+			const __m128 west = loadLuma(M + x - 1);
+			const __m128 east = loadLuma(M + x + 1);
+
+			const __m128 lumaMax = _mm_max_ps(m, _mm_max_ps(_mm_max_ps(n, s), _mm_max_ps(west, east)));
+			const __m128 lumaMin = _mm_min_ps(m, _mm_min_ps(_mm_min_ps(n, s), _mm_min_ps(west, east)));
+			const __m128 range = _mm_sub_ps(lumaMax, lumaMin);
+			const __m128 limit = _mm_max_ps(thresholdMinimum, _mm_mul_ps(lumaMax, threshold));
+
+			// Most pixels are not on an edge so entire groups are usually skipped.
+			const int edges = _mm_movemask_ps(_mm_cmpge_ps(range, limit));
+			if (edges != 0) {
+				for (int i = 0; i < 4; ++i) {
+					if (edges & (1 << i)) {
+						output[x + i] = (output[x + i] & 0xFF000000) | (resolveEdge(source, x + i, y) & 0x00FFFFFF);
+					}
+				}
+			}
+		}
+#endif
+		for (; x < w; ++x) {
+			if (isEdge(source, x, y)) {
+				output[x] = (output[x] & 0xFF000000) | (resolveEdge(source, x, y) & 0x00FFFFFF);
+			}
+		}
+	}
+}
+
+
+bool
+FXAAImageFilter::isEdge(const ImageTile& tile, const int X, const int Y) {
+	const float M = getLuma(tile, X, Y);
+	const float N = getLuma(tile, X, Y - 1);
+	const float S = getLuma(tile, X, Y + 1);
+	const float W = getLuma(tile, X - 1, Y);
+	const float E = getLuma(tile, X + 1, Y);
+
+	const float lumaMax = std::max(M, std::max(std::max(N, S), std::max(W, E)));
+	const float lumaMin = std::min(M, std::min(std::min(N, S), std::min(W, E)));
+
+	return (lumaMax - lumaMin) >= std::max(EDGE_THRESHOLD_MINIMUM, lumaMax * EDGE_THRESHOLD);
+}
+
+
+std::uint32_t
+FXAAImageFilter::resolveEdge(const ImageTile& tile, const int X, const int Y) {
+
+	const float M = getLuma(tile, X, Y);
+	const float N = getLuma(tile, X, Y - 1);
+	const float S = getLuma(tile, X, Y + 1);
+	const float W = getLuma(tile, X - 1, Y);
+	const float E = getLuma(tile, X + 1, Y);
+	const float NW = getLuma(tile, X - 1, Y - 1);
+	const float NE = getLuma(tile, X + 1, Y - 1);
+	const float SW = getLuma(tile, X - 1, Y + 1);
+	const float SE = getLuma(tile, X + 1, Y + 1);
+
+	const float range =
+		std::max(M, std::max(std::max(N, S), std::max(W, E))) -
+		std::min(M, std::min(std::min(N, S), std::min(W, E)));
+
+	// Estimate the edge's orientation. A horizontal edge has a strong vertical gradient.
+	const float NS = N + S;
+	const float WE = W + E;
+	const float westCorners = NW + SW;
+	const float eastCorners = NE + SE;
+	const float northCorners = NW + NE;
+	const float southCorners = SW + SE;
+	const float horizontalGradient =
+		std::abs(westCorners - (2.0f * W)) +
+		std::abs(NS - (2.0f * M)) * 2.0f +
+		std::abs(eastCorners - (2.0f * E));
+	const float verticalGradient =
+		std::abs(northCorners - (2.0f * N)) +
+		std::abs(WE - (2.0f * M)) * 2.0f +
+		std::abs(southCorners - (2.0f * S));
+	const bool isHorizontal = horizontalGradient >= verticalGradient;
+
+	// Find which side of the edge the pixel is on, i.e. the neighbor across the edge
+	// with the steepest gradient.
+	const float luma1 = isHorizontal ? N : W;
+	const float luma2 = isHorizontal ? S : E;
+	const float gradient1 = luma1 - M;
+	const float gradient2 = luma2 - M;
+	const bool isSide1Steepest = std::abs(gradient1) >= std::abs(gradient2);
+	const float gradientScaled = 0.25f * std::max(std::abs(gradient1), std::abs(gradient2));
+	const float lumaLocalAverage = 0.5f * ((isSide1Steepest ? luma1 : luma2) + M);
+	const int across = isSide1Steepest ? -1 : 1;
+
+	// The direction along the edge, and the offset to the neighbor across the edge.
+	const int dx = isHorizontal ? 1 : 0;
+	const int dy = isHorizontal ? 0 : 1;
+	const int ax = isHorizontal ? 0 : across;
+	const int ay = isHorizontal ? across : 0;
+
+	// The edge's luma is sampled halfway between the pixel and its neighbor across
+	// the edge, and compared against the local average to find the edge's end points.
+	const auto& sampleEdge = [&](const int distance) {
+		const int sx = X + (distance * dx);
+		const int sy = Y + (distance * dy);
+		return 0.5f * (getLuma(tile, sx, sy) + getLuma(tile, sx + ax, sy + ay)) - lumaLocalAverage;
+	};
+	int distance1 = SEARCH_STEPS[0];
+	int distance2 = SEARCH_STEPS[0];
+	float lumaEnd1 = sampleEdge(-distance1);
+	float lumaEnd2 = sampleEdge(distance2);
+	bool reached1 = std::abs(lumaEnd1) >= gradientScaled;
+	bool reached2 = std::abs(lumaEnd2) >= gradientScaled;
+	constexpr std::size_t STEP_COUNT = sizeof(SEARCH_STEPS) / sizeof(SEARCH_STEPS[0]);
+	for (std::size_t i = 1; i < STEP_COUNT && !(reached1 && reached2); ++i) {
+		if (!reached1) {
+			distance1 += SEARCH_STEPS[i];
+			lumaEnd1 = sampleEdge(-distance1);
+			reached1 = std::abs(lumaEnd1) >= gradientScaled;
+		}
+		if (!reached2) {
+			distance2 += SEARCH_STEPS[i];
+			lumaEnd2 = sampleEdge(distance2);
+			reached2 = std::abs(lumaEnd2) >= gradientScaled;
+		}
+	}
+
+	// The closer the pixel is to one of the edge's end points, the more it is
+	// blended with its neighbor across the edge. The blend is only valid if the
+	// luma variation at the nearest end point is coherent with the pixel's luma.
+	const bool isDirection1 = distance1 < distance2;
+	const float edgeLength = static_cast<float>(distance1 + distance2);
+	const float pixelOffset = 0.5f - (std::min(distance1, distance2) / edgeLength);
+	const bool isLumaCenterSmaller = M < lumaLocalAverage;
+	const bool isVariationCorrect = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0f) != isLumaCenterSmaller;
+	const float edgeOffset = isVariationCorrect ? pixelOffset : 0.0f;
+
+	// Sub-pixel aliasing, e.g. thin lines that are less than a pixel wide, is detected
+	// by comparing the pixel's luma with the average luma of its 3x3 neighborhood.
+	const float lumaAverage = (1.0f / 12.0f) * ((2.0f * (NS + WE)) + westCorners + eastCorners);
+	const float subpixel1 = std::min(1.0f, std::max(0.0f, std::abs(lumaAverage - M) / range));
+	const float subpixel2 = ((-2.0f * subpixel1) + 3.0f) * subpixel1 * subpixel1;
+	const float subpixelOffset = subpixel2 * subpixel2 * SUBPIXEL_QUALITY;
+
+	const float offset = std::max(edgeOffset, subpixelOffset);
+	return blend(tile.at(X, Y), tile.at(X + ax, Y + ay), offset);
+}
+
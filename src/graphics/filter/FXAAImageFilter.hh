@@ -0,0 +1,73 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_FXAA_IMAGE_FILTER_HH
+#define CLOCKWORK_FXAA_IMAGE_FILTER_HH
+
+#include "NeighborhoodImageFilter.hh"
+
+
+namespace clockwork {
+/**
+ * An implementation of Timothy Lottes' Fast Approximate Anti-Aliasing (FXAA).
+ * The filter detects edges from local contrast in the image's luma, estimates
+ * each edge's orientation and length, then blends edge pixels with their
+ * neighbors across the edge. For more information, please refer to the FXAA
+ * white paper in documentation/research.
+ */
+class FXAAImageFilter final : public NeighborhoodImageFilter {
+public:
+	/**
+	 * Instantiates an FXAAImageFilter object.
+	 */
+	FXAAImageFilter();
+	/**
+	 * @see NeighborhoodImageFilter::getHaloSize.
+	 */
+	std::uint32_t getHaloSize() const override;
+	/**
+	 * Copies the pixels and stores each pixel's luma in its alpha channel, where the
+	 * edge detection and edge search passes read it from.
+	 * @see NeighborhoodImageFilter::prepare.
+	 */
+	void prepare(const std::uint32_t* const input, std::uint32_t* const output, const std::size_t count) const override;
+	/**
+	 * @see NeighborhoodImageFilter::filter.
+	 */
+	void filter(const ImageTile& source, const ImageTile& destination) const override;
+private:
+	/**
+	 * Returns true if the pixel at <x, y> in the specified tile lies on an edge,
+	 * false otherwise.
+	 */
+	static bool isEdge(const ImageTile& tile, const int x, const int y);
+	/**
+	 * Returns the anti-aliased color of the edge pixel at <x, y> in the specified
+	 * tile. The returned pixel's alpha channel is undefined.
+	 */
+	static std::uint32_t resolveEdge(const ImageTile& tile, const int x, const int y);
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_FXAA_IMAGE_FILTER_HH
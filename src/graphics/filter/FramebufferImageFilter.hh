@@ -0,0 +1,62 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_FRAMEBUFFER_IMAGE_FILTER_HH
+#define CLOCKWORK_FRAMEBUFFER_IMAGE_FILTER_HH
+
+#include "ImageFilter.hh"
+
+
+namespace clockwork {
+/**
+ * @see Framebuffer.hh.
+ */
+class Framebuffer;
+/**
+ * @see RenderingContext.hh.
+ */
+struct RenderingContext;
+/**
+ * An image filter that needs the whole framebuffer at once, e.g. because it makes
+ * several passes over intermediate images of a different resolution, or because it
+ * reads buffers other than the pixel buffer. Such filters are responsible for
+ * parallelizing their own passes.
+ */
+class FramebufferImageFilter : public ImageFilter {
+public:
+	/**
+	 * Filters the specified framebuffer's pixel buffer in place.
+	 * @param context the rendering context the framebuffer's contents were rendered with.
+	 * @param framebuffer the framebuffer to filter.
+	 */
+	virtual void filter(const RenderingContext& context, Framebuffer& framebuffer) = 0;
+protected:
+	/**
+	 * Instantiates a FramebufferImageFilter object with the specified identifier.
+	 */
+	explicit FramebufferImageFilter(const Identifier identifier);
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_FRAMEBUFFER_IMAGE_FILTER_HH
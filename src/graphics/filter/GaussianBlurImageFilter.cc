@@ -0,0 +1,237 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "GaussianBlurImageFilter.hh"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using clockwork::GaussianBlurImageFilter;
+
+
+constexpr float GaussianBlurImageFilter::DEFAULT_SIGMA;
+constexpr int GaussianBlurImageFilter::MAXIMUM_RADIUS;
+constexpr int GaussianBlurImageFilter::WEIGHT_BITS;
+constexpr int GaussianBlurImageFilter::INTERMEDIATE_BITS;
+
+
+namespace {
+/**
+ * Returns the intermediate buffer of the calling thread, resized to hold at least
+ * the specified number of 16-bit channels. Each thread keeps its own buffer so that
+ * tiles can be blurred concurrently without allocating memory for each tile.
+ */
+std::uint16_t*
+getIntermediateBuffer(const std::size_t size) {
+	thread_local std::vector<std::uint16_t> buffer;
+	if (buffer.size() < size) {
+		buffer.resize(size);
+	}
+	return &buffer[0];
+}
+#ifdef __SSE2__
+/**
+ * Returns a vector that holds the pair of 16-bit weights (w0, w1) in each of its
+ * 32-bit lanes. Multiplying it with _mm_madd_epi16 computes (a * w0) + (b * w1)
+ * where a and b are interleaved 16-bit values.
+ */
+inline __m128i
+getWeightPair(const std::int16_t w0, const std::int16_t w1) {
+	return _mm_set1_epi32((static_cast<std::uint32_t>(static_cast<std::uint16_t>(w1)) << 16) | static_cast<std::uint16_t>(w0));
+}
+/**
+ * Returns the four 8-bit channels of the specified pixel, widened to 16 bits.
+ */
+inline __m128i
+unpack(const std::uint32_t pixel) {
+	return _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(pixel)), _mm_setzero_si128());
+}
+#endif
+} // namespace
+
+
+GaussianBlurImageFilter::GaussianBlurImageFilter(const float sigma) :
+NeighborhoodImageFilter(ImageFilter::Identifier::GaussianBlur),
+sigma_(std::max(sigma, 0.1f)),
+radius_(std::min(static_cast<int>(std::ceil(3.0f * sigma_)), MAXIMUM_RADIUS)),
+weights_() {
+	const int n = (2 * radius_) + 1;
+	float w[(2 * MAXIMUM_RADIUS) + 1];
+	float sum = 0.0f;
+	for (int i = 0; i < n; ++i) {
+		const float x = static_cast<float>(i - radius_);
+		w[i] = std::exp(-(x * x) / (2.0f * sigma_ * sigma_));
+		sum += w[i];
+	}
+	// Rounding errors are compensated by the central weight so that the weights add
+	// up to exactly one and the blur does not brighten or darken the image.
+	int total = 0;
+	for (int i = 0; i < n; ++i) {
+		weights_[i] = static_cast<std::int16_t>(std::lround((w[i] / sum) * (1 << WEIGHT_BITS)));
+		total += weights_[i];
+	}
+	weights_[radius_] += (1 << WEIGHT_BITS) - total;
+}
+
+
+float
+GaussianBlurImageFilter::getSigma() const {
+	return sigma_;
+}
+
+
+int
+GaussianBlurImageFilter::getRadius() const {
+	return radius_;
+}
+
+
+std::uint32_t
+GaussianBlurImageFilter::getHaloSize() const {
+	return radius_;
+}
+
+
+void
+GaussianBlurImageFilter::filter(const ImageTile& source, const ImageTile& destination) const {
+	// The intermediate buffer is sized for the tile's rows and the halo above and below
+	// it, but not the halo to its left and right, which is only read by the first pass.
+	const std::size_t size = static_cast<std::size_t>(source.height + (2 * radius_)) * source.width * 4;
+	auto* const intermediate = getIntermediateBuffer(size);
+
+	blurRows(source, intermediate);
+	blurColumns(intermediate, destination);
+}
+
+
+void
+GaussianBlurImageFilter::blurRows(const ImageTile& source, std::uint16_t* const intermediate) const {
+	const int n = (2 * radius_) + 1;
+	const int w = source.width;
+	const int rows = source.height + (2 * radius_);
+	constexpr int SHIFT = WEIGHT_BITS - INTERMEDIATE_BITS;
+#ifdef __SSE2__
+	__m128i pairs[MAXIMUM_RADIUS + 1];
+	for (int k = 0; k < n; k += 2) {
+		pairs[k / 2] = getWeightPair(weights_[k], weights_[k + 1]);
+	}
+	const __m128i rounding = _mm_set1_epi32(1 << (SHIFT - 1));
+#endif
+	for (int r = 0; r < rows; ++r) {
+		const std::uint32_t* const row = source.row(r - radius_) - radius_;
+		std::uint16_t* const output = intermediate + (static_cast<std::size_t>(r) * w * 4);
+		for (int x = 0; x < w; ++x) {
+			const std::uint32_t* const input = row + x;
+#ifdef __SSE2__
+			// Each multiply-add applies two taps to all four channels of a pixel.
+			__m128i sum = _mm_setzero_si128();
+			for (int k = 0; k < n; k += 2) {
+				const __m128i a = unpack(input[k]);
+				const __m128i b = unpack(input[std::min(k + 1, n - 1)]);
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), pairs[k / 2]));
+			}
+			const __m128i result = _mm_srai_epi32(_mm_add_epi32(sum, rounding), SHIFT);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(output + (x * 4)), _mm_packs_epi32(result, result));
+#else
+			for (int c = 0; c < 4; ++c) {
+				int sum = 0;
+				for (int k = 0; k < n; ++k) {
+					sum += weights_[k] * static_cast<int>((input[k] >> (8 * c)) & 0xFF);
+				}
+				output[(x * 4) + c] = static_cast<std::uint16_t>((sum + (1 << (SHIFT - 1))) >> SHIFT);
+			}
+#endif
+		}
+	}
+}
+
+
+void
+GaussianBlurImageFilter::blurColumns(const std::uint16_t* const intermediate, const ImageTile& destination) const {
+	const int n = (2 * radius_) + 1;
+	const int w = destination.width;
+	const int h = destination.height;
+	const std::ptrdiff_t stride = static_cast<std::ptrdiff_t>(w) * 4;
+	constexpr int SHIFT = WEIGHT_BITS + INTERMEDIATE_BITS;
+#ifdef __SSE2__
+	__m128i pairs[MAXIMUM_RADIUS + 1];
+	for (int k = 0; k < n; k += 2) {
+		pairs[k / 2] = getWeightPair(weights_[k], weights_[k + 1]);
+	}
+	const __m128i rounding = _mm_set1_epi32(1 << (SHIFT - 1));
+#endif
+	for (int y = 0; y < h; ++y) {
+		// Row y of the destination is centered on row y + r of the intermediate buffer.
+		const std::uint16_t* const column = intermediate + (y * stride);
+		std::uint32_t* const output = destination.row(y);
+		int x = 0;
+#ifdef __SSE2__
+		// Two pixels are processed at a time, and each multiply-add applies two taps
+		// to all four channels of a pixel.
+		for (; x + 2 <= w; x += 2) {
+			__m128i sum0 = _mm_setzero_si128();
+			__m128i sum1 = _mm_setzero_si128();
+			for (int k = 0; k < n; k += 2) {
+				const auto* const p = column + (k * stride) + (x * 4);
+				const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				const __m128i b = (k + 1 < n) ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + stride)) : a;
+				sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), pairs[k / 2]));
+				sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), pairs[k / 2]));
+			}
+			sum0 = _mm_srai_epi32(_mm_add_epi32(sum0, rounding), SHIFT);
+			sum1 = _mm_srai_epi32(_mm_add_epi32(sum1, rounding), SHIFT);
+			const __m128i result = _mm_packs_epi32(sum0, sum1);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(output + x), _mm_packus_epi16(result, result));
+		}
+		for (; x < w; ++x) {
+			__m128i sum = _mm_setzero_si128();
+			for (int k = 0; k < n; k += 2) {
+				const auto* const p = column + (k * stride) + (x * 4);
+				const __m128i a = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+				const __m128i b = (k + 1 < n) ? _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + stride)) : a;
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), pairs[k / 2]));
+			}
+			sum = _mm_srai_epi32(_mm_add_epi32(sum, rounding), SHIFT);
+			const __m128i result = _mm_packs_epi32(sum, sum);
+			output[x] = static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(result, result)));
+		}
+#else
+		for (; x < w; ++x) {
+			std::uint32_t pixel = 0;
+			for (int c = 0; c < 4; ++c) {
+				int sum = 0;
+				for (int k = 0; k < n; ++k) {
+					sum += weights_[k] * column[(k * stride) + (x * 4) + c];
+				}
+				const int value = (sum + (1 << (SHIFT - 1))) >> SHIFT;
+				pixel |= static_cast<std::uint32_t>(std::min(std::max(value, 0), 255)) << (8 * c);
+			}
+			output[x] = pixel;
+		}
+#endif
+	}
+}
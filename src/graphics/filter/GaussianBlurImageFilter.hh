@@ -0,0 +1,113 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_GAUSSIAN_BLUR_IMAGE_FILTER_HH
+#define CLOCKWORK_GAUSSIAN_BLUR_IMAGE_FILTER_HH
+
+#include "NeighborhoodImageFilter.hh"
+
+
+namespace clockwork {
+/**
+ * An image filter that applies a Gaussian blur. Since the Gaussian kernel is
+ * separable, each tile is blurred horizontally into a 16-bit intermediate buffer,
+ * then vertically into the destination, which costs 2r + 1 rather than (2r + 1)²
+ * samples per pixel for a kernel of radius r. Weights are stored in fixed point.
+ *
+ * The blur is applied at full resolution, tile by tile, so it can be fused with the
+ * other tiled filters of a chain, and its radius is limited to MAXIMUM_RADIUS. Wider
+ * blurs need the whole image to be downsampled first, which BloomImageFilter does
+ * with its half-resolution pyramid.
+ */
+class GaussianBlurImageFilter final : public NeighborhoodImageFilter {
+public:
+	/**
+	 * The default standard deviation of the Gaussian kernel.
+	 */
+	static constexpr float DEFAULT_SIGMA = 2.0f;
+	/**
+	 * The largest supported kernel radius.
+	 */
+	static constexpr int MAXIMUM_RADIUS = 32;
+	/**
+	 * Instantiates a GaussianBlurImageFilter object whose kernel has the specified
+	 * standard deviation. The kernel's radius is three times the standard deviation.
+	 * @param sigma the kernel's standard deviation.
+	 */
+	explicit GaussianBlurImageFilter(const float sigma = DEFAULT_SIGMA);
+	/**
+	 * Returns the kernel's standard deviation.
+	 */
+	float getSigma() const;
+	/**
+	 * Returns the kernel's radius.
+	 */
+	int getRadius() const;
+	/**
+	 * @see NeighborhoodImageFilter::getHaloSize.
+	 */
+	std::uint32_t getHaloSize() const override;
+	/**
+	 * @see NeighborhoodImageFilter::filter.
+	 */
+	void filter(const ImageTile& source, const ImageTile& destination) const override;
+private:
+	/**
+	 * The number of fractional bits in the kernel's weights.
+	 */
+	static constexpr int WEIGHT_BITS = 12;
+	/**
+	 * The number of fractional bits in the intermediate buffer's channels.
+	 */
+	static constexpr int INTERMEDIATE_BITS = 7;
+	/**
+	 * Blurs the specified tile's rows, as well as the rows of its halo above and below
+	 * it, into the intermediate buffer where each channel is stored in 16 bits.
+	 * @param source the tile to blur.
+	 * @param intermediate the buffer to write to.
+	 */
+	void blurRows(const ImageTile& source, std::uint16_t* const intermediate) const;
+	/**
+	 * Blurs the intermediate buffer's columns into the destination tile.
+	 * @param intermediate the buffer to read.
+	 * @param destination the tile to write to.
+	 */
+	void blurColumns(const std::uint16_t* const intermediate, const ImageTile& destination) const;
+	/**
+	 * The kernel's standard deviation.
+	 */
+	const float sigma_;
+	/**
+	 * The kernel's radius.
+	 */
+	const int radius_;
+	/**
+	 * The kernel's 2r + 1 weights, which add up to 1 << WEIGHT_BITS. The array is
+	 * padded with a null weight so that weights can be read in pairs.
+	 */
+	std::int16_t weights_[(2 * MAXIMUM_RADIUS) + 2];
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_GAUSSIAN_BLUR_IMAGE_FILTER_HH
@@ -24,14 +24,21 @@
  */
 #include "ImageFilter.hh"
 #include "ImageFilterFactory.hh"
+#include "BlackAndWhiteImageFilter.hh"
+#include "BloomImageFilter.hh"
+#include "FXAAImageFilter.hh"
+#include "GaussianBlurImageFilter.hh"
+#include "GrayscaleImageFilter.hh"
+#include "SSAOImageFilter.hh"
 
 using clockwork::ImageFilter;
 using clockwork::ImageFilterFactory;
 using clockwork::Factory;
 
 
-ImageFilter::ImageFilter(const Identifier id) :
-identifier_(id) {}
+ImageFilter::ImageFilter(const Identifier id, const Type type) :
+identifier_(id),
+type_(type) {}
 
 
 ImageFilter::Identifier
@@ -40,6 +47,12 @@ ImageFilter::getIdentifier() const {
 }
 
 
+ImageFilter::Type
+ImageFilter::getType() const {
+	return type_;
+}
+
+
 ImageFilterFactory&
 ImageFilterFactory::getInstance() {
 	static ImageFilterFactory INSTANCE;
@@ -51,7 +64,17 @@ template<> ImageFilter*
 Factory<ImageFilter::Identifier, ImageFilter>::create(const ImageFilter::Identifier& id) {
 	switch (id) {
 		case ImageFilter::Identifier::BlackAndWhite:
+			return new BlackAndWhiteImageFilter;
 		case ImageFilter::Identifier::Grayscale:
+			return new GrayscaleImageFilter;
+		case ImageFilter::Identifier::FXAA:
+			return new FXAAImageFilter;
+		case ImageFilter::Identifier::GaussianBlur:
+			return new GaussianBlurImageFilter;
+		case ImageFilter::Identifier::Bloom:
+			return new BloomImageFilter;
+		case ImageFilter::Identifier::SSAO:
+			return new SSAOImageFilter;
 		default:
 			return nullptr;
 	}
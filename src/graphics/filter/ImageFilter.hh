@@ -25,10 +25,13 @@
 #ifndef CLOCKWORK_IMAGE_FILTER_HH
 #define CLOCKWORK_IMAGE_FILTER_HH
 
+#include <QtGlobal>
+
 
 namespace clockwork {
 /**
- *
+ * A post-processing filter that is applied to a framebuffer's pixel buffer once a
+ * frame has been rendered. Filters are applied by an ImageFilterChain.
  */
 class ImageFilter {
 public:
@@ -38,22 +41,64 @@ public:
 	enum class Identifier {
 		BlackAndWhite,
 		Grayscale,
+		FXAA,
+		GaussianBlur,
+		Bloom,
+		SSAO,
 	};
+	/**
+	 * The type of an image filter, i.e. the set of pixels it reads to compute a
+	 * single output pixel.
+	 */
+	enum class Type {
+		/**
+		 * The filter reads a single pixel (@see PixelImageFilter.hh).
+		 */
+		Pixel,
+		/**
+		 * The filter reads a neighborhood of pixels (@see NeighborhoodImageFilter.hh).
+		 */
+		Neighborhood,
+		/**
+		 * The filter reads the whole framebuffer (@see FramebufferImageFilter.hh).
+		 */
+		Framebuffer,
+	};
+	/**
+	 * Destroys the ImageFilter instance.
+	 */
+	virtual ~ImageFilter() = default;
 	/**
 	 * Returns the filter's identifier.
 	 */
 	Identifier getIdentifier() const;
+	/**
+	 * Returns the filter's type.
+	 */
+	Type getType() const;
 protected:
 	/**
-	 * Instantiates an ImageFilter object with the specified identifier.
+	 * Instantiates an ImageFilter object with the specified identifier and type.
 	 */
-	explicit ImageFilter(const Identifier identifier);
+	ImageFilter(const Identifier identifier, const Type type);
 private:
 	/**
 	 * The filter's identifier.
 	 */
 	const Identifier identifier_;
+	/**
+	 * The filter's type.
+	 */
+	const Type type_;
 };
+/**
+ * Returns the specified image filter identifier's hash.
+ * @param identifier the image filter identifier to hash.
+ */
+constexpr uint
+qHash(const ImageFilter::Identifier identifier) {
+	return static_cast<uint>(identifier);
+}
 } // namespace clockwork
 
 #endif // CLOCKWORK_IMAGE_FILTER_HH
@@ -0,0 +1,122 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "ImageFilterChain.hh"
+#include "ImageFilterFactory.hh"
+#include "FramebufferImageFilter.hh"
+#include "NeighborhoodImageFilter.hh"
+#include "PixelImageFilter.hh"
+#include "Framebuffer.hh"
+#include "parallelFor.hh"
+#include <algorithm>
+
+using clockwork::ImageFilterChain;
+
+
+constexpr std::size_t ImageFilterChain::BLOCK_SIZE;
+
+
+void
+ImageFilterChain::apply(
+	const QList<ImageFilter::Identifier>& identifiers,
+	const RenderingContext& context,
+	Framebuffer& framebuffer
+) {
+	auto* const pixels = framebuffer.getResolvedPixelBuffer();
+	const std::uint32_t width = framebuffer.getWidth();
+	const std::uint32_t height = framebuffer.getHeight();
+	if (pixels == nullptr || width == 0 || height == 0 || identifiers.isEmpty()) {
+		return;
+	}
+	// The filters read and write the resolved pixel buffer.
+	framebuffer.resolve();
+	for (const auto& stage : createStages(identifiers)) {
+		const auto& pixelFilters = stage.pixelFilters;
+		if (stage.filter == nullptr) {
+			applyPixelFilters(pixelFilters, framebuffer);
+		} else if (stage.filter->getType() == ImageFilter::Type::Neighborhood) {
+			// The stage's pixel filters are applied to each tile while it is still in
+			// cache, instead of in another pass over the image.
+			const auto& filter = *static_cast<const NeighborhoodImageFilter*>(stage.filter);
+			filter.apply(pixels, width, height, framebuffer.getPitch(), source_, [&pixelFilters](const ImageTile& tile) {
+				for (std::uint32_t row = 0; row < tile.height; ++row) {
+					for (const auto* const pixelFilter : pixelFilters) {
+						pixelFilter->filter(tile.row(row), tile.width);
+					}
+				}
+			});
+		} else {
+			static_cast<FramebufferImageFilter*>(stage.filter)->filter(context, framebuffer);
+			applyPixelFilters(pixelFilters, framebuffer);
+		}
+	}
+	// The filtered pixels must be encoded in the framebuffer's pixel format again.
+	framebuffer.encode();
+}
+
+
+QList<ImageFilterChain::Stage>
+ImageFilterChain::createStages(const QList<ImageFilter::Identifier>& identifiers) {
+	QList<Stage> stages;
+	auto& factory = ImageFilterFactory::getInstance();
+	for (const auto identifier : identifiers) {
+		auto* const filter = factory.get(identifier);
+		if (filter == nullptr) {
+			continue;
+		}
+		switch (filter->getType()) {
+			case ImageFilter::Type::Pixel:
+				if (stages.isEmpty()) {
+					stages.append(Stage{nullptr, {}});
+				}
+				stages.last().pixelFilters.append(static_cast<const PixelImageFilter*>(filter));
+				break;
+			case ImageFilter::Type::Neighborhood:
+			case ImageFilter::Type::Framebuffer:
+				stages.append(Stage{filter, {}});
+				break;
+		}
+	}
+	return stages;
+}
+
+
+void
+ImageFilterChain::applyPixelFilters(const QList<const PixelImageFilter*>& filters, Framebuffer& framebuffer) {
+	if (filters.isEmpty()) {
+		return;
+	}
+	auto* const pixels = framebuffer.getResolvedPixelBuffer();
+	// The rows' padding is filtered too, so the image is processed as a single range.
+	const std::size_t size = static_cast<std::size_t>(framebuffer.getPitch()) * framebuffer.getHeight();
+	const std::size_t blockCount = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	parallelFor(blockCount, [&filters, pixels, size](const std::size_t block) {
+		const std::size_t begin = block * BLOCK_SIZE;
+		const std::size_t count = std::min(BLOCK_SIZE, size - begin);
+		for (const auto* const filter : filters) {
+			filter->filter(pixels + begin, count);
+		}
+	});
+}
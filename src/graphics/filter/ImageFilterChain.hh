@@ -0,0 +1,128 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_IMAGE_FILTER_CHAIN_HH
+#define CLOCKWORK_IMAGE_FILTER_CHAIN_HH
+
+#include "ImageFilter.hh"
+#include <QList>
+#include <cstdint>
+#include <vector>
+
+
+namespace clockwork {
+/**
+ * @see Framebuffer.hh.
+ */
+class Framebuffer;
+/**
+ * @see PixelImageFilter.hh.
+ */
+class PixelImageFilter;
+/**
+ * @see RenderingContext.hh.
+ */
+struct RenderingContext;
+/**
+ * An ImageFilterChain applies a sequence of image filters to a framebuffer's pixel
+ * buffer. Rather than making one pass over the image per filter, the chain is
+ * split into stages: a stage runs at most one neighborhood or framebuffer filter
+ * followed by any number of pixel filters, which are fused together. Each pass
+ * divides the image into blocks or tiles that are processed in parallel.
+ */
+class ImageFilterChain {
+public:
+	/**
+	 * Instantiates an ImageFilterChain object.
+	 */
+	ImageFilterChain() = default;
+	/**
+	 *
+	 */
+	ImageFilterChain(const ImageFilterChain&) = delete;
+	/**
+	 *
+	 */
+	ImageFilterChain(ImageFilterChain&&) = delete;
+	/**
+	 *
+	 */
+	ImageFilterChain& operator=(const ImageFilterChain&) = delete;
+	/**
+	 *
+	 */
+	ImageFilterChain& operator=(ImageFilterChain&&) = delete;
+	/**
+	 * Applies the image filters with the specified identifiers, in order, to the
+	 * framebuffer's pixel buffer.
+	 * @param identifiers the identifiers of the filters to apply.
+	 * @param context the rendering context the framebuffer's contents were rendered with.
+	 * @param framebuffer the framebuffer to filter.
+	 */
+	void apply(
+		const QList<ImageFilter::Identifier>& identifiers,
+		const RenderingContext& context,
+		Framebuffer& framebuffer
+	);
+private:
+	/**
+	 * A single pass over the image.
+	 */
+	struct Stage {
+		/**
+		 * The stage's neighborhood or framebuffer filter, or nullptr if the stage
+		 * only contains pixel filters.
+		 */
+		ImageFilter* filter;
+		/**
+		 * The pixel filters that are applied to the filter's output.
+		 */
+		QList<const PixelImageFilter*> pixelFilters;
+	};
+	/**
+	 * The number of contiguous pixels processed by a pixel-only stage at a time.
+	 * Blocks are small enough to remain in the L1 cache while every fused filter
+	 * is applied to them.
+	 */
+	static constexpr std::size_t BLOCK_SIZE = 4096;
+	/**
+	 * Splits the image filters with the specified identifiers into stages.
+	 * @param identifiers the identifiers of the filters to split.
+	 */
+	static QList<Stage> createStages(const QList<ImageFilter::Identifier>& identifiers);
+	/**
+	 * Applies the specified pixel filters to each pixel in the image.
+	 * @param filters the pixel filters to apply.
+	 * @param framebuffer the framebuffer to filter.
+	 */
+	static void applyPixelFilters(const QList<const PixelImageFilter*>& filters, Framebuffer& framebuffer);
+	/**
+	 * The source of a neighborhood stage, i.e. a prepared copy of the image that is
+	 * padded with a halo on each side. The halo replicates the image's border pixels.
+	 */
+	std::vector<std::uint32_t> source_;
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_IMAGE_FILTER_CHAIN_HH
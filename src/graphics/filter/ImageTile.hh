@@ -0,0 +1,81 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_IMAGE_TILE_HH
+#define CLOCKWORK_IMAGE_TILE_HH
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace clockwork {
+/**
+ * A rectangular view into a 32-bit ARGB image. The tile does not own its pixels.
+ */
+struct ImageTile {
+	/**
+	 * Returns a pointer to the first pixel in the specified row, relative to the tile.
+	 * Negative rows, or rows past the tile's height, are valid as long as they lie
+	 * inside the image the tile views.
+	 * @param y the row's offset from the tile's top edge.
+	 */
+	inline std::uint32_t* row(const int y) const {
+		return pixels + (y * stride);
+	}
+	/**
+	 * Returns the pixel at <x, y>, relative to the tile's top-left corner.
+	 * @param x the pixel's offset from the tile's left edge.
+	 * @param y the pixel's offset from the tile's top edge.
+	 */
+	inline std::uint32_t& at(const int x, const int y) const {
+		return row(y)[x];
+	}
+	/**
+	 * A pointer to the tile's top-left pixel.
+	 */
+	std::uint32_t* pixels;
+	/**
+	 * The number of pixels between the start of two consecutive rows.
+	 */
+	std::ptrdiff_t stride;
+	/**
+	 * The horizontal position of the tile's top-left pixel in the image.
+	 */
+	std::uint32_t x;
+	/**
+	 * The vertical position of the tile's top-left pixel in the image.
+	 */
+	std::uint32_t y;
+	/**
+	 * The tile's width.
+	 */
+	std::uint32_t width;
+	/**
+	 * The tile's height.
+	 */
+	std::uint32_t height;
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_IMAGE_TILE_HH
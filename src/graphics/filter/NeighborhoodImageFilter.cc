@@ -0,0 +1,107 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "NeighborhoodImageFilter.hh"
+#include "parallelFor.hh"
+#include <algorithm>
+#include <cstring>
+
+using clockwork::NeighborhoodImageFilter;
+
+
+constexpr std::uint32_t NeighborhoodImageFilter::TILE_SIZE;
+
+
+NeighborhoodImageFilter::NeighborhoodImageFilter(const Identifier identifier) :
+ImageFilter(identifier, ImageFilter::Type::Neighborhood) {}
+
+
+void
+NeighborhoodImageFilter::prepare(
+	const std::uint32_t* const input,
+	std::uint32_t* const output,
+	const std::size_t count
+) const {
+	std::memcpy(output, input, count * sizeof(std::uint32_t));
+}
+
+
+void
+NeighborhoodImageFilter::apply(
+	std::uint32_t* const pixels,
+	const std::uint32_t width,
+	const std::uint32_t height,
+	const std::uint32_t pitch,
+	std::vector<std::uint32_t>& buffer,
+	const TileFunction& function
+) const {
+	if (pixels == nullptr || width == 0 || height == 0) {
+		return;
+	}
+	const std::uint32_t halo = getHaloSize();
+	const std::size_t stride = width + (2 * halo);
+
+	buffer.resize(stride * (height + (2 * halo)));
+	auto* const source = &buffer[0];
+
+	// Prepare the source image, then replicate its border pixels into the halo.
+	parallelFor(height, [this, pixels, source, width, pitch, halo, stride](const std::size_t y) {
+		auto* const row = source + ((y + halo) * stride);
+		prepare(pixels + (y * pitch), row + halo, width);
+		std::fill(row, row + halo, row[halo]);
+		std::fill(row + halo + width, row + stride, row[halo + width - 1]);
+	});
+	for (std::uint32_t y = 0; y < halo; ++y) {
+		std::memcpy(source + (y * stride), source + (halo * stride), stride * sizeof(std::uint32_t));
+		std::memcpy(
+			source + ((halo + height + y) * stride),
+			source + ((halo + height - 1) * stride),
+			stride * sizeof(std::uint32_t)
+		);
+	}
+
+	const std::uint32_t columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const std::uint32_t rows = (height + TILE_SIZE - 1) / TILE_SIZE;
+	parallelFor(columns * rows, [&](const std::size_t tile) {
+		const std::uint32_t x = (tile % columns) * TILE_SIZE;
+		const std::uint32_t y = (tile / columns) * TILE_SIZE;
+		const std::uint32_t w = std::min(TILE_SIZE, width - x);
+		const std::uint32_t h = std::min(TILE_SIZE, height - y);
+
+		const ImageTile sourceTile{
+			source + ((y + halo) * stride) + x + halo,
+			static_cast<std::ptrdiff_t>(stride),
+			x, y, w, h
+		};
+		const ImageTile destinationTile{
+			pixels + (static_cast<std::size_t>(y) * pitch) + x,
+			static_cast<std::ptrdiff_t>(pitch),
+			x, y, w, h
+		};
+		filter(sourceTile, destinationTile);
+		if (function) {
+			function(destinationTile);
+		}
+	});
+}
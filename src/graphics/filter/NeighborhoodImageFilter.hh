@@ -0,0 +1,100 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_NEIGHBORHOOD_IMAGE_FILTER_HH
+#define CLOCKWORK_NEIGHBORHOOD_IMAGE_FILTER_HH
+
+#include "ImageFilter.hh"
+#include "ImageTile.hh"
+#include <functional>
+#include <vector>
+
+
+namespace clockwork {
+/**
+ * An image filter that computes each output pixel from a neighborhood of input
+ * pixels. The image is filtered tile by tile where each source tile is surrounded
+ * by a halo of pixels, i.e. the neighbors of the tile's border pixels.
+ */
+class NeighborhoodImageFilter : public ImageFilter {
+public:
+	/**
+	 * A function that is called on each tile once it has been filtered.
+	 */
+	using TileFunction = std::function<void(const ImageTile& tile)>;
+	/**
+	 * The width and height of the tiles an image is divided into.
+	 */
+	static constexpr std::uint32_t TILE_SIZE = 128;
+	/**
+	 * Filters the specified image in place. The image is divided into tiles that are
+	 * filtered in parallel.
+	 * @param pixels the image's pixels.
+	 * @param width the image's width.
+	 * @param height the image's height.
+	 * @param pitch the number of pixels between the starts of two rows of the image.
+	 * @param buffer the buffer that holds the prepared, halo-padded copy of the image.
+	 * The buffer is reused across calls to avoid reallocating it every frame.
+	 * @param function an optional function that is called on each filtered tile while
+	 * it is still in cache.
+	 */
+	void apply(
+		std::uint32_t* const pixels,
+		const std::uint32_t width,
+		const std::uint32_t height,
+		const std::uint32_t pitch,
+		std::vector<std::uint32_t>& buffer,
+		const TileFunction& function = nullptr
+	) const;
+	/**
+	 * Returns the width, in pixels, of the halo that surrounds each source tile.
+	 * This is the farthest distance at which the filter reads a neighbor.
+	 */
+	virtual std::uint32_t getHaloSize() const = 0;
+	/**
+	 * Copies a contiguous range of pixels from the image into the buffer that the
+	 * source tiles are read from. Filters may override this to precompute per-pixel
+	 * values that are read more than once during filtering, e.g. luma.
+	 * @param input the pixels to copy.
+	 * @param output the buffer to copy the pixels to.
+	 * @param count the number of pixels to copy.
+	 */
+	virtual void prepare(const std::uint32_t* const input, std::uint32_t* const output, const std::size_t count) const;
+	/**
+	 * Filters the specified source tile and writes the result to the destination tile.
+	 * The destination tile initially holds the unfiltered pixels, and the source tile's
+	 * halo is readable.
+	 * @param source the prepared unfiltered pixels.
+	 * @param destination the tile to write the filtered pixels to.
+	 */
+	virtual void filter(const ImageTile& source, const ImageTile& destination) const = 0;
+protected:
+	/**
+	 * Instantiates a NeighborhoodImageFilter object with the specified identifier.
+	 */
+	explicit NeighborhoodImageFilter(const Identifier identifier);
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_NEIGHBORHOOD_IMAGE_FILTER_HH
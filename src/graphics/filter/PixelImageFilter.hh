@@ -0,0 +1,55 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_PIXEL_IMAGE_FILTER_HH
+#define CLOCKWORK_PIXEL_IMAGE_FILTER_HH
+
+#include "ImageFilter.hh"
+#include <cstddef>
+#include <cstdint>
+
+
+namespace clockwork {
+/**
+ * An image filter that computes each output pixel from the input pixel at the
+ * same location. Since pixels are independent of one another, consecutive pixel
+ * filters are fused into a single pass over the image.
+ */
+class PixelImageFilter : public ImageFilter {
+public:
+	/**
+	 * Filters the specified contiguous range of pixels in place.
+	 * @param pixels the pixels to filter.
+	 * @param count the number of pixels to filter.
+	 */
+	virtual void filter(std::uint32_t* const pixels, const std::size_t count) const = 0;
+protected:
+	/**
+	 * Instantiates a PixelImageFilter object with the specified identifier.
+	 */
+	explicit PixelImageFilter(const Identifier identifier);
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_PIXEL_IMAGE_FILTER_HH
@@ -0,0 +1,387 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "SSAOImageFilter.hh"
+#include "RenderingContext.hh"
+#include "parallelFor.hh"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using clockwork::SSAOImageFilter;
+
+
+constexpr std::size_t SSAOImageFilter::SAMPLE_COUNT;
+constexpr std::size_t SSAOImageFilter::ROTATION_COUNT;
+constexpr int SSAOImageFilter::RADIUS;
+constexpr int SSAOImageFilter::BORDER;
+
+
+namespace {
+/**
+ * The minimum depth difference, relative to a pixel's depth, for a neighbor to
+ * occlude it. This prevents flat surfaces from occluding themselves.
+ */
+constexpr float BIAS = 0.002f;
+/**
+ * The maximum depth difference, relative to a pixel's depth, for a neighbor to
+ * occlude it. Occlusion falls off linearly over this range so that foreground
+ * objects do not darken the background they are in front of.
+ */
+constexpr float RANGE = 0.1f;
+/**
+ * The occlusion's strength, where 0 disables it.
+ */
+constexpr float STRENGTH = 1.0f;
+/**
+ * The maximum depth difference, relative to a pixel's depth, for a neighbor to
+ * contribute to the blur.
+ */
+constexpr float BLUR_TOLERANCE = 0.05f;
+/**
+ * The weights of the blur's neighbors, from the farthest to the nearest. The
+ * five-tap blur covers the kernel's four rotations along each axis.
+ */
+constexpr float BLUR_WEIGHTS[] = {0.5f, 1.0f};
+/**
+ * A small value that bounds the depth weights used during upsampling.
+ */
+constexpr float UPSAMPLE_EPSILON = 0.01f;
+/**
+ * Returns the rotation of the kernel used by the half-resolution pixel at <x, y>.
+ * The rotation is constant across each group of four pixels in a row so that the
+ * vectorized passes can process a group with a single kernel.
+ */
+inline std::size_t
+getRotation(const std::uint32_t x, const std::uint32_t y) {
+	return ((y & 3) << 2) | ((x >> 2) & 3);
+}
+/**
+ * Returns the specified pixel's color multiplied by a factor in [0, 1]. The alpha
+ * channel is left unchanged.
+ */
+inline std::uint32_t
+modulate(const std::uint32_t pixel, const float factor) {
+	const std::uint32_t f = static_cast<std::uint32_t>((factor * 256.0f) + 0.5f);
+	const std::uint32_t rb = (((pixel & 0x00FF00FF) * f) >> 8) & 0x00FF00FF;
+	const std::uint32_t g = (((pixel & 0x0000FF00) * f) >> 8) & 0x0000FF00;
+	return (pixel & 0xFF000000) | rb | g;
+}
+} // namespace
+
+
+SSAOImageFilter::SSAOImageFilter() :
+FramebufferImageFilter(ImageFilter::Identifier::SSAO),
+near_(0),
+far_(0),
+width_(0),
+height_(0),
+stride_(0) {
+	// Samples are spread over a circle, each at a different distance from its center,
+	// and each rotation turns the circle by a sixteenth of the angle between samples.
+	const double pi = std::acos(-1.0);
+	for (std::size_t r = 0; r < ROTATION_COUNT; ++r) {
+		for (std::size_t i = 0; i < SAMPLE_COUNT; ++i) {
+			const double angle = 2.0 * pi * ((i + (static_cast<double>(r) / ROTATION_COUNT)) / SAMPLE_COUNT);
+			const double distance = RADIUS * ((i + 1.0) / SAMPLE_COUNT);
+			auto& offset = kernel_[r][i];
+			offset.x = static_cast<int>(std::lround(distance * std::cos(angle)));
+			offset.y = static_cast<int>(std::lround(distance * std::sin(angle)));
+			if (offset.x == 0 && offset.y == 0) {
+				offset.x = 1;
+			}
+		}
+	}
+}
+
+
+void
+SSAOImageFilter::filter(const RenderingContext& context, Framebuffer& framebuffer) {
+	auto* const pixels = framebuffer.getResolvedPixelBuffer();
+	const std::uint32_t width = framebuffer.getWidth();
+	const std::uint32_t height = framebuffer.getHeight();
+	if (pixels == nullptr || width == 0 || height == 0) {
+		return;
+	}
+	// The viewport transformation maps normalized device depth to the range
+	// [near, far]. Its scale and translation factors are (far - near) / 2 and
+	// (far + near) / 2 respectively.
+	const double scale = context.viewportTransform(2, 0);
+	const double translation = context.viewportTransform(2, 1);
+	near_ = translation - scale;
+	far_ = translation + scale;
+	if (near_ <= 0.0 || far_ <= near_) {
+		return;
+	}
+	windowDepth_.resize(width * height);
+	framebuffer.readDepthBuffer(windowDepth_.data());
+	const float* const depth = windowDepth_.data();
+
+	width_ = (width + 1) / 2;
+	height_ = (height + 1) / 2;
+	stride_ = width_ + (2 * BORDER);
+
+	// The vectorized passes process groups of four pixels and may read up to three
+	// pixels past the end of the last row.
+	const std::size_t size = (stride_ * (height_ + (2 * BORDER))) + 4;
+	depth_.resize(size);
+	occlusion_.resize(size);
+	blurred_.resize(size);
+
+	downsampleDepth(depth, width, height);
+	computeOcclusion();
+
+	const std::ptrdiff_t origin = (BORDER * stride_) + BORDER;
+	blur(&occlusion_[origin], &blurred_[origin], 1);
+	replicateBorder(blurred_);
+	blur(&blurred_[origin], &occlusion_[origin], stride_);
+	replicateBorder(occlusion_);
+
+	applyOcclusion(pixels, depth, width, height, framebuffer.getPitch());
+}
+
+
+void
+SSAOImageFilter::downsampleDepth(const float* const depth, const std::uint32_t width, const std::uint32_t height) {
+	float* const output = &depth_[(BORDER * stride_) + BORDER];
+	parallelFor(height_, [this, depth, width, height, output](const std::size_t y) {
+		const float* const a = depth + ((2 * y) * width);
+		const float* const b = depth + (std::min<std::size_t>((2 * y) + 1, height - 1) * width);
+		float* const row = output + (y * stride_);
+		for (std::uint32_t x = 0; x < width_; ++x) {
+			const std::uint32_t x0 = 2 * x;
+			const std::uint32_t x1 = std::min(x0 + 1, width - 1);
+			row[x] = linearize(std::min(std::min(a[x0], a[x1]), std::min(b[x0], b[x1])));
+		}
+	});
+	replicateBorder(depth_);
+}
+
+
+void
+SSAOImageFilter::computeOcclusion() {
+	std::array<std::array<std::ptrdiff_t, SAMPLE_COUNT>, ROTATION_COUNT> offsets;
+	for (std::size_t r = 0; r < ROTATION_COUNT; ++r) {
+		for (std::size_t i = 0; i < SAMPLE_COUNT; ++i) {
+			offsets[r][i] = (kernel_[r][i].y * stride_) + kernel_[r][i].x;
+		}
+	}
+	const std::ptrdiff_t origin = (BORDER * stride_) + BORDER;
+	const float* const depth = &depth_[origin];
+	float* const occlusion = &occlusion_[origin];
+	parallelFor(height_, [this, &offsets, depth, occlusion](const std::size_t y) {
+		const float* const D = depth + (y * stride_);
+		float* const output = occlusion + (y * stride_);
+#ifdef __SSE2__
+		// Groups of four pixels share a kernel rotation. The last group may extend
+		// into the border, which is overwritten once the pass is complete.
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 bias = _mm_set1_ps(BIAS);
+		const __m128 range = _mm_set1_ps(RANGE);
+		const __m128 strength = _mm_set1_ps(STRENGTH / SAMPLE_COUNT);
+		for (std::uint32_t x = 0; x < width_; x += 4) {
+			const auto& kernel = offsets[getRotation(x, y)];
+			const __m128 center = _mm_loadu_ps(D + x);
+			const __m128 minimum = _mm_mul_ps(center, bias);
+			const __m128 maximum = _mm_mul_ps(center, range);
+			const __m128 falloff = _mm_div_ps(one, maximum);
+
+			__m128 sum = _mm_setzero_ps();
+			for (const auto offset : kernel) {
+				const __m128 difference = _mm_sub_ps(center, _mm_loadu_ps(D + x + offset));
+				const __m128 mask = _mm_and_ps(_mm_cmpgt_ps(difference, minimum), _mm_cmplt_ps(difference, maximum));
+				const __m128 weight = _mm_sub_ps(one, _mm_mul_ps(difference, falloff));
+				sum = _mm_add_ps(sum, _mm_and_ps(mask, weight));
+			}
+			_mm_storeu_ps(output + x, _mm_max_ps(_mm_setzero_ps(), _mm_sub_ps(one, _mm_mul_ps(sum, strength))));
+		}
+#else
+		for (std::uint32_t x = 0; x < width_; ++x) {
+			const float center = D[x];
+			const float minimum = center * BIAS;
+			const float maximum = center * RANGE;
+
+			float sum = 0.0f;
+			for (const auto offset : offsets[getRotation(x, y)]) {
+				const float difference = center - D[x + offset];
+				if (difference > minimum && difference < maximum) {
+					sum += 1.0f - (difference / maximum);
+				}
+			}
+			output[x] = std::max(0.0f, 1.0f - (sum * (STRENGTH / SAMPLE_COUNT)));
+		}
+#endif
+	});
+	replicateBorder(occlusion_);
+}
+
+
+void
+SSAOImageFilter::blur(const float* const input, float* const output, const std::ptrdiff_t step) const {
+	const float* const depth = &depth_[(BORDER * stride_) + BORDER];
+	parallelFor(height_, [this, input, output, step, depth](const std::size_t y) {
+		const float* const D = depth + (y * stride_);
+		const float* const I = input + (y * stride_);
+		float* const O = output + (y * stride_);
+#ifdef __SSE2__
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		const __m128 tolerance = _mm_set1_ps(BLUR_TOLERANCE);
+		for (std::uint32_t x = 0; x < width_; x += 4) {
+			// A pixel always contributes to its own blur, so the sum of weights is never
+			// zero, even if the pixel has no depth.
+			const __m128 center = _mm_loadu_ps(D + x);
+			const __m128 limit = _mm_mul_ps(center, tolerance);
+			__m128 sum = _mm_loadu_ps(I + x);
+			__m128 weights = _mm_set1_ps(1.0f);
+			for (int t = -2; t <= 2; ++t) {
+				if (t == 0) {
+					continue;
+				}
+				const std::ptrdiff_t offset = x + (t * step);
+				const __m128 difference = _mm_andnot_ps(signMask, _mm_sub_ps(center, _mm_loadu_ps(D + offset)));
+				const __m128 weight = _mm_and_ps(_mm_cmplt_ps(difference, limit), _mm_set1_ps(BLUR_WEIGHTS[std::abs(t) == 1]));
+				sum = _mm_add_ps(sum, _mm_mul_ps(weight, _mm_loadu_ps(I + offset)));
+				weights = _mm_add_ps(weights, weight);
+			}
+			_mm_storeu_ps(O + x, _mm_div_ps(sum, weights));
+		}
+#else
+		for (std::uint32_t x = 0; x < width_; ++x) {
+			const float center = D[x];
+			const float limit = center * BLUR_TOLERANCE;
+			float sum = I[x];
+			float weights = 1.0f;
+			for (int t = -2; t <= 2; ++t) {
+				const std::ptrdiff_t offset = x + (t * step);
+				if (t != 0 && std::abs(center - D[offset]) < limit) {
+					const float weight = BLUR_WEIGHTS[std::abs(t) == 1];
+					sum += weight * I[offset];
+					weights += weight;
+				}
+			}
+			O[x] = sum / weights;
+		}
+#endif
+	});
+}
+
+
+void
+SSAOImageFilter::applyOcclusion(
+	std::uint32_t* const pixels,
+	const float* const depth,
+	const std::uint32_t width,
+	const std::uint32_t height,
+	const std::uint32_t pitch
+) const {
+	const std::ptrdiff_t origin = (BORDER * stride_) + BORDER;
+	const float* const halfDepth = &depth_[origin];
+	const float* const occlusion = &occlusion_[origin];
+	parallelFor(height, [=](const std::size_t y) {
+		// A full-resolution pixel lies a quarter of the way between its nearest
+		// half-resolution pixel and the next nearest one along each axis, so the four
+		// half-resolution pixels around it have one of four sets of bilinear weights.
+		const std::ptrdiff_t y0 = (y % 2) ? (y / 2) : (static_cast<std::ptrdiff_t>(y / 2) - 1);
+		const float fy = (y % 2) ? 0.25f : 0.75f;
+		for (std::uint32_t x = 0; x < width; ++x) {
+			const float D = linearize(depth[(y * width) + x]);
+			if (std::isinf(D)) {
+				continue;
+			}
+			const std::ptrdiff_t x0 = (x % 2) ? (x / 2) : (static_cast<std::ptrdiff_t>(x / 2) - 1);
+			const float fx = (x % 2) ? 0.25f : 0.75f;
+			const std::ptrdiff_t tap = (y0 * stride_) + x0;
+#ifdef __SSE2__
+			// The four taps are processed in a single vector: <x0, y0>, <x0 + 1, y0>,
+			// <x0, y0 + 1> and <x0 + 1, y0 + 1>.
+			const auto& load = [this, tap](const float* const buffer) {
+				const __m128 top = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(buffer + tap)));
+				const __m128 bottom = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(buffer + tap + stride_)));
+				return _mm_movelh_ps(top, bottom);
+			};
+			const __m128 bilinear = _mm_setr_ps((1.0f - fx) * (1.0f - fy), fx * (1.0f - fy), (1.0f - fx) * fy, fx * fy);
+			const __m128 difference = _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(_mm_set1_ps(D), load(halfDepth)));
+			const __m128 similarity = _mm_div_ps(
+				_mm_set1_ps(1.0f),
+				_mm_add_ps(_mm_set1_ps(UPSAMPLE_EPSILON), _mm_mul_ps(difference, _mm_set1_ps(1.0f / D)))
+			);
+			const __m128 weight = _mm_mul_ps(bilinear, similarity);
+
+			// Horizontal sums of the weighted occlusion and of the weights.
+			__m128 a = _mm_unpacklo_ps(_mm_mul_ps(weight, load(occlusion)), weight);
+			__m128 b = _mm_unpackhi_ps(_mm_mul_ps(weight, load(occlusion)), weight);
+			a = _mm_add_ps(a, b);
+			a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+			const float sum = _mm_cvtss_f32(a);
+			const float weights = _mm_cvtss_f32(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)));
+#else
+			const float bilinear[] = {(1.0f - fx) * (1.0f - fy), fx * (1.0f - fy), (1.0f - fx) * fy, fx * fy};
+			const std::ptrdiff_t taps[] = {tap, tap + 1, tap + stride_, tap + stride_ + 1};
+			float sum = 0.0f;
+			float weights = 0.0f;
+			for (int t = 0; t < 4; ++t) {
+				const float difference = std::abs(D - halfDepth[taps[t]]) / D;
+				const float weight = bilinear[t] / (UPSAMPLE_EPSILON + difference);
+				sum += weight * occlusion[taps[t]];
+				weights += weight;
+			}
+#endif
+			if (weights > 0.0f) {
+				auto& pixel = pixels[(y * pitch) + x];
+				pixel = modulate(pixel, std::min(1.0f, sum / weights));
+			}
+		}
+	});
+}
+
+
+void
+SSAOImageFilter::replicateBorder(std::vector<float>& buffer) const {
+	float* const origin = &buffer[(BORDER * stride_) + BORDER];
+	for (std::uint32_t y = 0; y < height_; ++y) {
+		float* const row = origin + (y * stride_);
+		std::fill(row - BORDER, row, row[0]);
+		std::fill(row + width_, row + width_ + BORDER, row[width_ - 1]);
+	}
+	float* const first = origin - BORDER;
+	float* const last = first + ((height_ - 1) * stride_);
+	for (int y = 1; y <= BORDER; ++y) {
+		std::copy(first, first + stride_, first - (y * stride_));
+		std::copy(last, last + stride_, last + (y * stride_));
+	}
+}
+
+
+float
+SSAOImageFilter::linearize(const float depth) const {
+	if (std::isinf(depth)) {
+		return std::numeric_limits<float>::infinity();
+	}
+	// Inverts the perspective projection's depth mapping, where window-space depth
+	// goes from near to far.
+	return static_cast<float>((far_ * near_) / std::max(far_ + near_ - depth, near_));
+}
@@ -0,0 +1,162 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_SSAO_IMAGE_FILTER_HH
+#define CLOCKWORK_SSAO_IMAGE_FILTER_HH
+
+#include "FramebufferImageFilter.hh"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace clockwork {
+/**
+ * An implementation of screen-space ambient occlusion (SSAO), which darkens pixels
+ * that are surrounded by nearer geometry. Occlusion is estimated from the depth
+ * buffer at half resolution by comparing each pixel's depth with the depth of a
+ * small kernel of neighbors. The kernel is rotated in a 4x4 pattern so that few
+ * samples cover many directions, and the resulting noise is removed by a
+ * depth-aware (bilateral) blur that does not bleed across depth discontinuities.
+ * The occlusion is then upsampled to full resolution, again weighted by depth, and
+ * multiplied with the pixel buffer's colors.
+ */
+class SSAOImageFilter final : public FramebufferImageFilter {
+public:
+	/**
+	 * Instantiates an SSAOImageFilter object.
+	 */
+	SSAOImageFilter();
+	/**
+	 * @see FramebufferImageFilter::filter.
+	 */
+	void filter(const RenderingContext& context, Framebuffer& framebuffer) override;
+private:
+	/**
+	 * The number of depth samples taken per pixel.
+	 */
+	static constexpr std::size_t SAMPLE_COUNT = 8;
+	/**
+	 * The number of kernel rotations, i.e. the number of pixels in the 4x4 pattern.
+	 */
+	static constexpr std::size_t ROTATION_COUNT = 16;
+	/**
+	 * The kernel's radius in half-resolution pixels.
+	 */
+	static constexpr int RADIUS = 8;
+	/**
+	 * The width of the border that surrounds the half-resolution buffers. The border
+	 * replicates the buffers' edges so that no pass has to clamp its reads.
+	 */
+	static constexpr int BORDER = RADIUS;
+	/**
+	 * A kernel sample's offset from the pixel being processed.
+	 */
+	struct Offset {
+		int x;
+		int y;
+	};
+	/**
+	 * Converts the framebuffer's window-space depth into linear depth at half resolution,
+	 * where each pixel holds the nearest depth of the 2x2 pixels it covers.
+	 */
+	void downsampleDepth(const float* const depth, const std::uint32_t width, const std::uint32_t height);
+	/**
+	 * Computes the occlusion of each half-resolution pixel.
+	 */
+	void computeOcclusion();
+	/**
+	 * Blurs the occlusion along one axis, ignoring neighbors whose depth differs
+	 * too much from that of the pixel being processed.
+	 * @param input the occlusion to blur.
+	 * @param output the buffer to write the blurred occlusion to.
+	 * @param step the distance, in elements, between two neighbors along the axis.
+	 */
+	void blur(const float* const input, float* const output, const std::ptrdiff_t step) const;
+	/**
+	 * Upsamples the occlusion to full resolution and multiplies the framebuffer's
+	 * colors with it. The depth is tightly packed while the pixels' rows are the
+	 * specified pitch apart.
+	 */
+	void applyOcclusion(
+		std::uint32_t* const pixels,
+		const float* const depth,
+		const std::uint32_t width,
+		const std::uint32_t height,
+		const std::uint32_t pitch
+	) const;
+	/**
+	 * Copies the edges of the specified half-resolution buffer into its border.
+	 */
+	void replicateBorder(std::vector<float>& buffer) const;
+	/**
+	 * Returns the linear depth, i.e. the distance to the viewer, of the specified
+	 * window-space depth value. Cleared depth values return infinity.
+	 */
+	float linearize(const float depth) const;
+	/**
+	 * The kernel's sample offsets for each rotation.
+	 */
+	std::array<std::array<Offset, SAMPLE_COUNT>, ROTATION_COUNT> kernel_;
+	/**
+	 * The distance to the near clipping plane of the frame being filtered.
+	 */
+	double near_;
+	/**
+	 * The distance to the far clipping plane of the frame being filtered.
+	 */
+	double far_;
+	/**
+	 * The width of the half-resolution buffers, excluding their border.
+	 */
+	std::uint32_t width_;
+	/**
+	 * The height of the half-resolution buffers, excluding their border.
+	 */
+	std::uint32_t height_;
+	/**
+	 * The number of elements in a row of the half-resolution buffers.
+	 */
+	std::ptrdiff_t stride_;
+	/**
+	 * The framebuffer's window-space depth, converted from the depth buffer's format.
+	 */
+	std::vector<float> windowDepth_;
+	/**
+	 * The half-resolution linear depth.
+	 */
+	std::vector<float> depth_;
+	/**
+	 * The half-resolution occlusion factor, where 1 means unoccluded.
+	 */
+	std::vector<float> occlusion_;
+	/**
+	 * An intermediate buffer that holds the horizontally blurred occlusion.
+	 */
+	std::vector<float> blurred_;
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_SSAO_IMAGE_FILTER_HH
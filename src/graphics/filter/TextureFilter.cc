@@ -24,10 +24,130 @@
  */
 #include "TextureFilter.hh"
 #include "TextureFilterFactory.hh"
+#include "BilinearTextureFilter.hh"
+#include "TrilinearTextureFilter.hh"
+#include "AnisotropicTextureFilter.hh"
+#include "PageCache.hh"
+#include <algorithm>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using clockwork::TextureFilter;
 using clockwork::TextureFilterFactory;
 using clockwork::Factory;
+using clockwork::Texture;
+
+
+namespace {
+/**
+ * A decompressed block of texels.
+ */
+struct DecodedBlock {
+	/**
+	 * The identifier of the level that the block belongs to, or 0 if the entry is unused.
+	 */
+	std::uint64_t level = 0;
+	/**
+	 * The block's position in the level.
+	 */
+	std::size_t block = 0;
+	/**
+	 * The block's texels.
+	 */
+	std::uint32_t texels[Texture::BLOCK_SIZE * Texture::BLOCK_SIZE];
+};
+/**
+ * The base-2 logarithm of the number of decompressed blocks that are cached by each
+ * thread. The 64 blocks take about 5 KiB, which leaves most of a core's L1 data cache
+ * to the rasterizer.
+ */
+constexpr std::uint32_t DECODED_BLOCK_CACHE_BITS = 6;
+} // namespace
+
+
+/**
+ * Returns the texels of the block at the specified position in a compressed level.
+ * Blocks are decompressed into a small direct-mapped cache that is local to the
+ * calling thread, so neighbouring samples rarely decompress the same block twice.
+ * The returned texels are only valid until the next call.
+ */
+static const std::uint32_t*
+getDecodedBlock(const Texture::Level& level, const std::size_t block) {
+	thread_local DecodedBlock cache[1 << DECODED_BLOCK_CACHE_BITS];
+
+	// Blocks are scattered across the cache with a multiplicative hash, so that
+	// vertically adjacent blocks, whose distance is often a power of two, do not
+	// compete for the same entry.
+	const auto hash = static_cast<std::uint32_t>((block ^ (level.identifier << 20)) * 2654435761U);
+	auto& entry = cache[hash >> (32 - DECODED_BLOCK_CACHE_BITS)];
+	if (entry.level != level.identifier || entry.block != block) {
+		level.decode(block, entry.texels);
+		entry.level = level.identifier;
+		entry.block = block;
+	}
+	return entry.texels;
+}
+
+
+/**
+ * Returns the texel at <x, y> in the specified level, which must not be split into pages.
+ */
+static std::uint32_t
+fetch(const Texture::Level& level, const std::uint32_t x, const std::uint32_t y) {
+	constexpr std::size_t N = Texture::BLOCK_SIZE * Texture::BLOCK_SIZE;
+	const auto i = level.index(x, y);
+	if (level.format == Texture::Format::ARGB32) {
+		return level.texels[i];
+	} else {
+		return getDecodedBlock(level, i / N)[i % N];
+	}
+}
+
+
+/**
+ * Copies the texels at <x0, y0>, <x1, y0>, <x0, y1> and <x1, y1> in the specified level,
+ * which must not be split into pages, to the footprint. The texels are addressed
+ * directly in the level's block layout, and when they lie in the same compressed
+ * block, it's only decompressed once. Otherwise, each texel is copied as soon as
+ * its block is decompressed, since decompressing another block may evict it from
+ * the cache.
+ */
+static void
+gather(
+	const Texture::Level& level,
+	const std::uint32_t x0,
+	const std::uint32_t y0,
+	const std::uint32_t x1,
+	const std::uint32_t y1,
+	std::uint32_t* const footprint
+) {
+	constexpr std::size_t N = Texture::BLOCK_SIZE * Texture::BLOCK_SIZE;
+	const std::size_t indices[4] = {
+		level.index(x0, y0),
+		level.index(x1, y0),
+		level.index(x0, y1),
+		level.index(x1, y1),
+	};
+	if (level.format == Texture::Format::ARGB32) {
+		for (int i = 0; i < 4; ++i) {
+			footprint[i] = level.texels[indices[i]];
+		}
+	} else {
+		const auto block = indices[0] / N;
+		if (indices[1] / N == block && indices[2] / N == block && indices[3] / N == block) {
+			const auto* const texels = getDecodedBlock(level, block);
+			for (int i = 0; i < 4; ++i) {
+				footprint[i] = texels[indices[i] % N];
+			}
+		} else {
+			for (int i = 0; i < 4; ++i) {
+				footprint[i] = getDecodedBlock(level, indices[i] / N)[indices[i] % N];
+			}
+		}
+	}
+}
 
 
 TextureFilter::TextureFilter(const Identifier id) :
@@ -40,6 +160,167 @@ TextureFilter::getIdentifier() const {
 }
 
 
+float
+TextureFilter::getLevelOfDetail(const Texture& texture, const QPointF& dx, const QPointF& dy) {
+	const float w = texture.getWidth();
+	const float h = texture.getHeight();
+	const float dudx = dx.x() * w;
+	const float dvdx = dx.y() * h;
+	const float dudy = dy.x() * w;
+	const float dvdy = dy.y() * h;
+
+	// The level of detail is log2 of the length of the pixel's longest side in texel
+	// space. Since log2(sqrt(x)) = 0.5 * log2(x), the square root can be omitted.
+	const float rho = std::max((dudx * dudx) + (dvdx * dvdx), (dudy * dudy) + (dvdy * dvdy));
+	return 0.5f * std::log2(std::max(rho, 1e-12f));
+}
+
+
+std::uint32_t
+TextureFilter::sampleBilinear(const Texture& texture, const std::size_t index, const float u, const float v) {
+	const auto& level = texture.getLevel(index);
+	const auto w = static_cast<int>(level.width);
+	const auto h = static_cast<int>(level.height);
+
+	// Wrap the texture coordinate, then shift it by half a texel so that <x, y>
+	// is relative to the center of the texel at <x0, y0>.
+	const float x = ((u - std::floor(u)) * w) - 0.5f;
+	const float y = ((v - std::floor(v)) * h) - 0.5f;
+	const float fx = std::floor(x);
+	const float fy = std::floor(y);
+	const std::uint32_t wx = std::min(static_cast<std::uint32_t>((x - fx) * 256.0f), 256U);
+	const std::uint32_t wy = std::min(static_cast<std::uint32_t>((y - fy) * 256.0f), 256U);
+
+	int x0 = static_cast<int>(fx);
+	int y0 = static_cast<int>(fy);
+	if (x0 < 0) {
+		x0 += w;
+	} else if (x0 >= w) {
+		x0 -= w;
+	}
+	if (y0 < 0) {
+		y0 += h;
+	} else if (y0 >= h) {
+		y0 -= h;
+	}
+	const int x1 = x0 + 1 < w ? x0 + 1 : 0;
+	const int y1 = y0 + 1 < h ? y0 + 1 : 0;
+
+	// The footprint holds the texels at <x0, y0>, <x1, y0>, <x0, y1> and <x1, y1>.
+	std::uint32_t footprint[4];
+	if (level.pagesPerRow == 0) {
+		gather(level, x0, y0, x1, y1, footprint);
+	} else {
+		// The texels of a sparse level may lie in up to four pages. If any of them is
+		// not resident, it's requested and the next, coarser level is sampled instead.
+		// The levels that fit in a single page are never split, so this terminates.
+		const Texture::Page* const pages[4] = {
+			&level.getPage(x0, y0),
+			&level.getPage(x1, y0),
+			&level.getPage(x0, y1),
+			&level.getPage(x1, y1),
+		};
+		auto& cache = PageCache::getInstance();
+		const auto frame = cache.getFrame();
+		bool resident = true;
+		for (const auto* const page : pages) {
+			if (page->data == nullptr) {
+				cache.request(texture, index, page - level.pages.get());
+				resident = false;
+			} else if (page->frame.load(std::memory_order_relaxed) != frame) {
+				page->frame.store(frame, std::memory_order_relaxed);
+			}
+		}
+		if (!resident) {
+			return sampleBilinear(texture, index + 1, u, v);
+		}
+
+		constexpr int P = Texture::PAGE_SIZE;
+		if (pages[0] == pages[3]) {
+			gather(*pages[0]->data, x0 % P, y0 % P, x1 % P, y1 % P, footprint);
+		} else {
+			footprint[0] = fetch(*pages[0]->data, x0 % P, y0 % P);
+			footprint[1] = fetch(*pages[1]->data, x1 % P, y0 % P);
+			footprint[2] = fetch(*pages[2]->data, x0 % P, y1 % P);
+			footprint[3] = fetch(*pages[3]->data, x1 % P, y1 % P);
+		}
+	}
+#ifdef __SSE2__
+	// The two rows are interpolated at once, with the left column's channels in
+	// the lower half of each register and the right column's in the upper half.
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(footprint));
+	const __m128i top = _mm_unpacklo_epi8(texels, zero);
+	const __m128i bottom = _mm_unpackhi_epi8(texels, zero);
+	const __m128i rounding = _mm_set1_epi16(128);
+	const __m128i column = _mm_srli_epi16(
+		_mm_add_epi16(
+			_mm_add_epi16(
+				_mm_mullo_epi16(top, _mm_set1_epi16(256 - wy)),
+				_mm_mullo_epi16(bottom, _mm_set1_epi16(wy))
+			),
+			rounding
+		),
+		8
+	);
+	const __m128i weighted = _mm_mullo_epi16(column, _mm_set_epi16(wx, wx, wx, wx, 256 - wx, 256 - wx, 256 - wx, 256 - wx));
+	const __m128i result = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(weighted, _mm_srli_si128(weighted, 8)), rounding), 8);
+	return _mm_cvtsi128_si32(_mm_packus_epi16(result, result));
+#else
+	return lerp(lerp(footprint[0], footprint[2], wy), lerp(footprint[1], footprint[3], wy), wx);
+#endif
+}
+
+
+std::uint32_t
+TextureFilter::sampleTrilinear(const Texture& texture, const float u, const float v, const float lod) {
+	const auto last = texture.getLevelCount() - 1;
+	if (lod <= 0.0f) {
+		return sampleBilinear(texture, 0, u, v);
+	} else if (lod >= last) {
+		return sampleBilinear(texture, last, u, v);
+	} else {
+		const float l = std::floor(lod);
+		const auto index = static_cast<std::size_t>(l);
+		const auto weight = static_cast<std::uint32_t>((lod - l) * 256.0f);
+		return lerp(
+			sampleBilinear(texture, index, u, v),
+			sampleBilinear(texture, index + 1, u, v),
+			weight
+		);
+	}
+}
+
+
+std::uint32_t
+TextureFilter::lerp(const std::uint32_t from, const std::uint32_t to, const std::uint32_t weight) {
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(from), zero);
+	const __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(to), zero);
+	const __m128i result = _mm_srli_epi16(
+		_mm_add_epi16(
+			_mm_add_epi16(
+				_mm_mullo_epi16(a, _mm_set1_epi16(256 - weight)),
+				_mm_mullo_epi16(b, _mm_set1_epi16(weight))
+			),
+			_mm_set1_epi16(128)
+		),
+		8
+	);
+	return _mm_cvtsi128_si32(_mm_packus_epi16(result, result));
+#else
+	std::uint32_t result = 0;
+	for (std::uint32_t shift = 0; shift < 32; shift += 8) {
+		const std::uint32_t a = (from >> shift) & 0xFF;
+		const std::uint32_t b = (to >> shift) & 0xFF;
+		result |= ((((256 - weight) * a) + (weight * b) + 128) >> 8) << shift;
+	}
+	return result;
+#endif
+}
+
+
 TextureFilterFactory&
 TextureFilterFactory::getInstance() {
 	static TextureFilterFactory INSTANCE;
@@ -51,8 +332,11 @@ template<> TextureFilter*
 Factory<TextureFilter::Identifier, TextureFilter>::create(const TextureFilter::Identifier& id) {
 	switch (id) {
 		case TextureFilter::Identifier::Bilinear:
+			return new BilinearTextureFilter;
 		case TextureFilter::Identifier::Trilinear:
+			return new TrilinearTextureFilter;
 		case TextureFilter::Identifier::Anisotropic:
+			return new AnisotropicTextureFilter;
 		default:
 			return nullptr;
 	}
@@ -25,10 +25,15 @@
 #ifndef CLOCKWORK_TEXTURE_FILTER_HH
 #define CLOCKWORK_TEXTURE_FILTER_HH
 
+#include "Texture.hh"
+#include <QPointF>
 
 namespace clockwork {
 /**
- *
+ * A texture filter determines the color of a texture at a given texture coordinate
+ * by combining the texels that surround it. Minified textures are filtered from the
+ * level of the texture's mip chain whose texels are about the size of a pixel, which
+ * is selected from the screen-space derivatives of the texture coordinates.
  */
 class TextureFilter {
 public:
@@ -40,15 +45,63 @@ public:
 		Trilinear,
 		Anisotropic,
 	};
+	/**
+	 *
+	 */
+	virtual ~TextureFilter() = default;
 	/**
 	 * Returns the filter's identifier.
 	 */
 	Identifier getIdentifier() const;
+	/**
+	 * Returns the 32-bit ARGB color of the specified texture at the texture coordinate
+	 * <u, v>. Texture coordinates outside the range [0, 1] wrap around the texture.
+	 * @param texture the texture to sample.
+	 * @param uv the texture coordinate to sample.
+	 * @param dx the rate of change of the texture coordinate along the screen's x-axis.
+	 * @param dy the rate of change of the texture coordinate along the screen's y-axis.
+	 */
+	virtual std::uint32_t sample(const Texture& texture, const QPointF& uv, const QPointF& dx, const QPointF& dy) const = 0;
 protected:
 	/**
 	 * Instantiates an TextureFilter object with the specified identifier.
 	 */
 	explicit TextureFilter(const Identifier identifier);
+	/**
+	 * Returns the level of detail, i.e. the (fractional) index of the mip level to
+	 * sample, given the screen-space derivatives of a texture coordinate. A negative
+	 * level of detail indicates that the texture is magnified.
+	 * @param texture the texture to sample.
+	 * @param dx the rate of change of the texture coordinate along the screen's x-axis.
+	 * @param dy the rate of change of the texture coordinate along the screen's y-axis.
+	 */
+	static float getLevelOfDetail(const Texture& texture, const QPointF& dx, const QPointF& dy);
+	/**
+	 * Returns the bilinear interpolation of the four texels in the specified mip level
+	 * that surround the texture coordinate <u, v>. If the texture is sparse and any of
+	 * the texels is not resident, its page is requested and a coarser level is sampled.
+	 * @param texture the texture to sample.
+	 * @param level the index of the mip level to sample.
+	 * @param u the texture coordinate's horizontal component.
+	 * @param v the texture coordinate's vertical component.
+	 */
+	static std::uint32_t sampleBilinear(const Texture& texture, const std::size_t level, const float u, const float v);
+	/**
+	 * Returns the linear interpolation of the bilinear samples taken from the two mip
+	 * levels that are closest to the specified level of detail.
+	 * @param texture the texture to sample.
+	 * @param u the texture coordinate's horizontal component.
+	 * @param v the texture coordinate's vertical component.
+	 * @param lod the level of detail.
+	 */
+	static std::uint32_t sampleTrilinear(const Texture& texture, const float u, const float v, const float lod);
+	/**
+	 * Returns the linear interpolation of two 32-bit ARGB colors.
+	 * @param from the color returned when the weight is 0.
+	 * @param to the color returned when the weight is 256.
+	 * @param weight the interpolation weight, in the range [0, 256].
+	 */
+	static std::uint32_t lerp(const std::uint32_t from, const std::uint32_t to, const std::uint32_t weight);
 private:
 	/**
 	 * The filter's identifier.
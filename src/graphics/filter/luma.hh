@@ -0,0 +1,69 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_LUMA_HH
+#define CLOCKWORK_LUMA_HH
+
+#include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+namespace clockwork {
+/**
+ * Returns the luma, in the range [0, 255], of the specified 32-bit ARGB pixel. The
+ * channels are weighted according to ITU-R BT.601 in 8-bit fixed point, i.e. the
+ * weights of the red, green and blue channels are 77, 150 and 29 respectively.
+ * @param pixel the pixel to query.
+ */
+inline std::uint32_t
+luma(const std::uint32_t pixel) {
+	return ((77 * ((pixel >> 16) & 0xFF)) + (150 * ((pixel >> 8) & 0xFF)) + (29 * (pixel & 0xFF))) >> 8;
+}
+#ifdef __SSE2__
+/**
+ * Returns the luma of four 32-bit ARGB pixels, where each 32-bit lane of the result
+ * holds a value in the range [0, 255].
+ * @param pixels the pixels to query.
+ */
+inline __m128i
+luma(const __m128i pixels) {
+	const __m128i channelMask = _mm_set1_epi32(0xFF);
+	const __m128i r = _mm_and_si128(_mm_srli_epi32(pixels, 16), channelMask);
+	const __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 8), channelMask);
+	const __m128i b = _mm_and_si128(pixels, channelMask);
+
+	// The weighted sum never exceeds 16 bits, so a 16-bit multiplication of each
+	// lane's lower half is enough.
+	const __m128i sum = _mm_add_epi32(
+		_mm_add_epi32(_mm_mullo_epi16(r, _mm_set1_epi32(77)), _mm_mullo_epi16(g, _mm_set1_epi32(150))),
+		_mm_mullo_epi16(b, _mm_set1_epi32(29))
+	);
+	return _mm_srli_epi32(sum, 8);
+}
+#endif
+} // namespace clockwork
+
+#endif // CLOCKWORK_LUMA_HH
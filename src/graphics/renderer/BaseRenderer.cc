@@ -28,13 +28,21 @@
 using clockwork::BaseRenderer;
 
 
+constexpr std::size_t BaseRenderer::FACE_CHUNK_SIZE;
+constexpr std::size_t BaseRenderer::FACE_BATCH_SIZE;
+
+
 int
-BaseRenderer::fragmentPasses(const RenderingContext& context, const BaseFragment& fragment) {
+BaseRenderer::fragmentPasses(
+	const RenderingContext& context,
+	const BaseFragment& fragment,
+	const bool depthWritten
+) {
 	const bool passes =
 		fragmentPassesPixelOwnershipTest(context, fragment) &&
 		fragmentPassesScissorTest(context, fragment) &&
 		fragmentPassesStencilTest(context, fragment) &&
-		fragmentPassesDepthTest(context, fragment);
+		(depthWritten || fragmentPassesDepthTest(context, fragment));
 
 	return passes ? context.framebuffer.getOffset(fragment.x, fragment.y) : -1;
 }
@@ -86,8 +94,7 @@ BaseRenderer::fragmentPassesDepthTest(
 ) {
 	bool passes = true;
 	if (context.enableDepthTest) {
-		const std::size_t index = context.framebuffer.getOffset(fragment.x, fragment.y);
-		passes = fragment.z < context.framebuffer.getDepthBuffer()[index];
+		passes = context.framebuffer.testDepth(fragment.x, fragment.y, fragment.z);
 	}
 	return passes;
 }
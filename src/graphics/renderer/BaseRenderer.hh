@@ -26,6 +26,7 @@
 #define CLOCKWORK_BASE_RENDERER_HH
 
 #include "RenderingContext.hh"
+#include <cstddef>
 
 
 namespace clockwork {
@@ -38,6 +39,15 @@ struct BaseFragment;
  */
 class BaseRenderer {
 protected:
+	/**
+	 * The number of faces in each chunk of a mesh that is transformed by a single thread.
+	 */
+	static constexpr std::size_t FACE_CHUNK_SIZE = 256;
+	/**
+	 * The number of faces that are transformed before being rasterized, which bounds
+	 * the size of the post-transform buffer.
+	 */
+	static constexpr std::size_t FACE_BATCH_SIZE = 64 * FACE_CHUNK_SIZE;
 	/**
 	 * Instantiates a BaseRenderer object.
 	 */
@@ -49,8 +59,14 @@ protected:
 	 * however, -1 is returned.
 	 * @param context the rendering context.
 	 * @param fragment the fragment to test.
+	 * @param depthWritten true if the fragment's depth was already tested and written
+	 * to the framebuffer, in which case the depth test is skipped.
 	 */
-	static int fragmentPasses(const RenderingContext& context, const BaseFragment& fragment);
+	static int fragmentPasses(
+		const RenderingContext& context,
+		const BaseFragment& fragment,
+		const bool depthWritten = false
+	);
 private:
 	/**
 	 * Returns true if the specified fragment passes the pixel-ownership test, false otherwise.
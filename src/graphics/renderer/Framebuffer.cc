@@ -23,25 +23,154 @@
  * THE SOFTWARE.
  */
 #include "Framebuffer.hh"
+#include "parallelFor.hh"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using clockwork::Framebuffer;
 
 
+constexpr std::uint32_t Framebuffer::BLOCK_SIZE;
+constexpr std::uint32_t Framebuffer::ROW_ALIGNMENT;
+constexpr std::uint32_t Framebuffer::TILE_SIZE;
+
+
+/**
+ * The largest 24-bit fixed-point depth value.
+ */
+static constexpr std::uint32_t D24_MAXIMUM = 0xFFFFFF;
+/**
+ * The largest 16-bit fixed-point depth value.
+ */
+static constexpr std::uint32_t UNORM16_MAXIMUM = 0xFFFF;
+
+
+/**
+ * Returns the size in bytes of an element in a depth buffer with the specified format.
+ */
+static std::size_t
+getDepthBufferElementSize(const Framebuffer::DepthFormat format) {
+	switch (format) {
+		case Framebuffer::DepthFormat::Float32:
+			return sizeof(float);
+		case Framebuffer::DepthFormat::D24S8:
+			return sizeof(std::uint32_t);
+		case Framebuffer::DepthFormat::Unorm16:
+			return sizeof(std::uint16_t);
+		default:
+			qFatal("[getDepthBufferElementSize] Unspecified depth format!");
+	}
+}
+
+
+/**
+ * Encodes the specified number of 32-bit ARGB pixels in the specified format.
+ */
+static void
+encodePixels(const std::uint32_t* const input, std::uint8_t* const output, const std::size_t count, const Framebuffer::PixelFormat format) {
+	std::size_t i = 0;
+	switch (format) {
+		case Framebuffer::PixelFormat::RGBA8: {
+			// Swap the red and blue channels.
+			auto* const pixels = reinterpret_cast<std::uint32_t*>(output);
+#ifdef __SSE2__
+			const __m128i alphaGreen = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+			for (; i + 4 <= count; i += 4) {
+				const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+				const __m128i redBlue = _mm_andnot_si128(alphaGreen, p);
+				const __m128i blueRed = _mm_or_si128(_mm_srli_epi32(redBlue, 16), _mm_slli_epi32(redBlue, 16));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), _mm_or_si128(_mm_and_si128(p, alphaGreen), blueRed));
+			}
+#endif
+			for (; i < count; ++i) {
+				const std::uint32_t p = input[i];
+				pixels[i] = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+			}
+			break;
+		}
+		case Framebuffer::PixelFormat::RGB565: {
+			auto* const pixels = reinterpret_cast<std::uint16_t*>(output);
+#ifdef __SSE2__
+			const auto& pack = [](const __m128i p) {
+				const __m128i r = _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xF800));
+				const __m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(0x07E0));
+				const __m128i b = _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001F));
+				// The words are offset into the signed range so they survive the signed
+				// saturation of _mm_packs_epi32.
+				return _mm_sub_epi32(_mm_or_si128(r, _mm_or_si128(g, b)), _mm_set1_epi32(0x8000));
+			};
+			for (; i + 8 <= count; i += 8) {
+				const __m128i lo = pack(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)));
+				const __m128i hi = pack(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 4)));
+				const __m128i words = _mm_xor_si128(_mm_packs_epi32(lo, hi), _mm_set1_epi16(static_cast<short>(0x8000)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), words);
+			}
+#endif
+			for (; i < count; ++i) {
+				const std::uint32_t p = input[i];
+				pixels[i] = static_cast<std::uint16_t>(((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F));
+			}
+			break;
+		}
+		default:
+			std::memcpy(output, input, count * sizeof(std::uint32_t));
+			break;
+	}
+}
+
+
+#ifdef __SSE2__
+/**
+ * Converts four window-space depth values into fixed-point values. The operations
+ * are performed in the same order as Framebuffer::quantize so both produce
+ * identical results.
+ */
+static inline __m128i
+quantize(const __m128 depth, const float near, const float scale, const std::uint32_t maximum) {
+	__m128 d = _mm_mul_ps(_mm_sub_ps(depth, _mm_set1_ps(near)), _mm_set1_ps(scale));
+	d = _mm_min_ps(_mm_max_ps(d, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	return _mm_cvtps_epi32(_mm_mul_ps(d, _mm_set1_ps(static_cast<float>(maximum))));
+}
+#endif
+
+
 Framebuffer::Framebuffer(const Resolution resolutionIdentifier) :
 resolutionIdentifier_(resolutionIdentifier),
 resolution_(getResolution(resolutionIdentifier_)),
-pixelBuffer_(nullptr),
 pixelBufferClearValue_(0xFF000000),
-depthBuffer_(nullptr),
+pixelFormat_(PixelFormat::BGRA8),
+layout_(Layout::Linear),
+pitch_(0),
+blocksPerRow_(0),
+dirty_(false),
+depthFormat_(DepthFormat::Float32),
 depthBufferClearValue_(std::numeric_limits<double>::max()),
-stencilBuffer_(nullptr),
-stencilBufferClearValue_(0x00) {
+depthRangeNear_(0.0f),
+depthRangeScale_(1.0f),
+stencilBufferClearValue_(0x00),
+fastClear_(false),
+generation_(0),
+tilesPerRow_(0),
+depthCompression_(false),
+tileClearValues_({0xFF000000, 0, 0x00}) {
 	if (resolution_.isValid() && !resolution_.isNull()) {
 		resize();
 	}
 }
 
 
+Framebuffer::Framebuffer(const QSize& resolution) :
+Framebuffer() {
+	setResolution(resolution);
+}
+
+
 Framebuffer::~Framebuffer() {}
 
 
@@ -69,9 +198,17 @@ Framebuffer::getHeight() const {
 }
 
 
+std::uint32_t
+Framebuffer::getPitch() const {
+	return pitch_;
+}
+
+
 void
 Framebuffer::setResolution(const Resolution resolutionIdentifier) {
-	if (resolutionIdentifier_ != resolutionIdentifier) {
+	if (resolutionIdentifier == Resolution::CUSTOM) {
+		qWarning("[Framebuffer::setResolution] Use a QSize to set a custom resolution.");
+	} else if (resolutionIdentifier_ != resolutionIdentifier) {
 		resolutionIdentifier_ = resolutionIdentifier;
 		resolution_ = getResolution(resolutionIdentifier);
 		resize();
@@ -79,6 +216,20 @@ Framebuffer::setResolution(const Resolution resolutionIdentifier) {
 }
 
 
+void
+Framebuffer::setResolution(const QSize& resolution) {
+	if (!resolution.isValid()) {
+		qWarning("[Framebuffer::setResolution] Invalid resolution.");
+		return;
+	}
+	if (resolution_ != resolution) {
+		resolutionIdentifier_ = getResolutionIdentifier(resolution);
+		resolution_ = resolution;
+		resize();
+	}
+}
+
+
 std::uint32_t*
 Framebuffer::getPixelBuffer() {
 	return pixelBuffer_.get();
@@ -91,12 +242,63 @@ Framebuffer::getPixelBuffer() const {
 }
 
 
+std::uint32_t*
+Framebuffer::getResolvedPixelBuffer() {
+	return layout_ == Layout::Tiled ? resolvedPixelBuffer_.get() : pixelBuffer_.get();
+}
+
+
+const std::uint32_t*
+Framebuffer::getResolvedPixelBuffer() const {
+	return layout_ == Layout::Tiled ? resolvedPixelBuffer_.get() : pixelBuffer_.get();
+}
+
+
+const void*
+Framebuffer::getOutputBuffer() const {
+	if (pixelFormat_ == PixelFormat::BGRA8) {
+		return getResolvedPixelBuffer();
+	}
+	return outputBuffer_.get();
+}
+
+
 const QImage&
 Framebuffer::getPixelBufferImage() const {
 	return pixelBufferImage_;
 }
 
 
+Framebuffer::PixelFormat
+Framebuffer::getPixelFormat() const {
+	return pixelFormat_;
+}
+
+
+void
+Framebuffer::setPixelFormat(const PixelFormat format) {
+	if (pixelFormat_ != format) {
+		pixelFormat_ = format;
+		resize();
+	}
+}
+
+
+Framebuffer::Layout
+Framebuffer::getLayout() const {
+	return layout_;
+}
+
+
+void
+Framebuffer::setLayout(const Layout layout) {
+	if (layout_ != layout) {
+		layout_ = layout;
+		resize();
+	}
+}
+
+
 std::uint32_t
 Framebuffer::getPixelBufferClearValue() const {
 	return pixelBufferClearValue_;
@@ -109,15 +311,36 @@ Framebuffer::setPixelBufferClearValue(const std::uint32_t value) {
 }
 
 
-double*
-Framebuffer::getDepthBuffer() {
-	return depthBuffer_.get();
+Framebuffer::DepthFormat
+Framebuffer::getDepthFormat() const {
+	return depthFormat_;
+}
+
+
+void
+Framebuffer::setDepthFormat(const DepthFormat format) {
+	if (depthFormat_ != format) {
+		depthFormat_ = format;
+		resizeDepthStencilBuffers();
+		tileClearValues_.depth = getEncodedDepthBufferClearValue();
+		std::fill_n(tileCompressed_.get(), tilesPerRow_ * getTileCount(getHeight()), 0);
+
+		const std::size_t storageWidth = getStorageWidth();
+		forEachTileRow([this, storageWidth](const std::uint32_t y0, const std::uint32_t y1) {
+			fillDepthStencilBuffers(y0 * storageWidth, (y1 - y0) * storageWidth);
+		});
+	}
 }
 
 
-const double*
-Framebuffer::getDepthBuffer() const {
-	return depthBuffer_.get();
+void
+Framebuffer::setDepthRange(const double near, const double far) {
+	if (far > near) {
+		depthRangeNear_ = static_cast<float>(near);
+		depthRangeScale_ = static_cast<float>(1.0 / (far - near));
+	} else {
+		qWarning("[Framebuffer::setDepthRange] The far depth value must be greater than the near depth value.");
+	}
 }
 
 
@@ -133,15 +356,218 @@ Framebuffer::setDepthBufferClearValue(const double value) {
 }
 
 
-std::uint8_t*
-Framebuffer::getStencilBuffer() {
-	return stencilBuffer_.get();
+bool
+Framebuffer::testDepth(const std::uint32_t x, const std::uint32_t y, const double depth) const {
+	std::uint32_t stored;
+	if (isTileCleared(x, y)) {
+		stored = tileClearValues_.depth;
+	} else if (isTileCompressed(x, y)) {
+		stored = getEncodedDepth(tileDepthPlanes_[getTileIndex(x, y)], x, y);
+	} else {
+		stored = getEncodedDepth(getOffset(x, y));
+	}
+	switch (depthFormat_) {
+		case DepthFormat::Float32: {
+			float value;
+			std::memcpy(&value, &stored, sizeof(value));
+			return static_cast<float>(depth) < value;
+		}
+		case DepthFormat::D24S8:
+			return quantize(depth, D24_MAXIMUM) < (stored >> 8);
+		case DepthFormat::Unorm16:
+			return quantize(depth, UNORM16_MAXIMUM) < stored;
+		default:
+			return false;
+	}
+}
+
+
+std::uint32_t
+Framebuffer::testDepth(const std::uint32_t x, const std::uint32_t y, const float* const depth) const {
+#ifdef __SSE2__
+	// The vectorized test reads four consecutive depth buffer elements, which holds
+	// stale values in tiles that are cleared or compressed. In the tiled layout, the
+	// four elements must lie in the same block, and within the framebuffer's width.
+	const bool contiguous = x + 3 < getWidth() && (layout_ == Layout::Linear || (x % BLOCK_SIZE) + 4 <= BLOCK_SIZE);
+	const auto& isTileStored = [this](const std::uint32_t x, const std::uint32_t y) {
+		return !isTileCleared(x, y) && !isTileCompressed(x, y);
+	};
+	if (contiguous && isTileStored(x, y) && isTileStored(x + 3, y)) {
+		const std::size_t offset = getOffset(x, y);
+		const __m128 z = _mm_loadu_ps(depth);
+		__m128i passes = _mm_setzero_si128();
+		switch (depthFormat_) {
+			case DepthFormat::Float32: {
+				const __m128 stored = _mm_loadu_ps(reinterpret_cast<const float*>(depthBuffer_.get()) + offset);
+				return _mm_movemask_ps(_mm_cmplt_ps(z, stored));
+			}
+			case DepthFormat::D24S8: {
+				const auto* const buffer = reinterpret_cast<const __m128i*>(reinterpret_cast<const std::uint32_t*>(depthBuffer_.get()) + offset);
+				const __m128i stored = _mm_srli_epi32(_mm_loadu_si128(buffer), 8);
+				passes = _mm_cmplt_epi32(::quantize(z, depthRangeNear_, depthRangeScale_, D24_MAXIMUM), stored);
+				break;
+			}
+			case DepthFormat::Unorm16: {
+				const auto* const buffer = reinterpret_cast<const __m128i*>(reinterpret_cast<const std::uint16_t*>(depthBuffer_.get()) + offset);
+				const __m128i stored = _mm_unpacklo_epi16(_mm_loadl_epi64(buffer), _mm_setzero_si128());
+				passes = _mm_cmplt_epi32(::quantize(z, depthRangeNear_, depthRangeScale_, UNORM16_MAXIMUM), stored);
+				break;
+			}
+			default:
+				break;
+		}
+		return _mm_movemask_ps(_mm_castsi128_ps(passes));
+	}
+#endif
+	std::uint32_t mask = 0;
+	for (std::uint32_t i = 0; i < 4 && x + i < getWidth(); ++i) {
+		mask |= static_cast<std::uint32_t>(testDepth(x + i, y, static_cast<double>(depth[i]))) << i;
+	}
+	return mask;
+}
+
+
+void
+Framebuffer::setDepth(const std::uint32_t x, const std::uint32_t y, const double depth) {
+	resolveTile(x, y);
+	decompressTile(x, y);
+	const std::size_t offset = getOffset(x, y);
+	switch (depthFormat_) {
+		case DepthFormat::Float32:
+			reinterpret_cast<float*>(depthBuffer_.get())[offset] = static_cast<float>(depth);
+			break;
+		case DepthFormat::D24S8: {
+			auto& element = reinterpret_cast<std::uint32_t*>(depthBuffer_.get())[offset];
+			element = (quantize(depth, D24_MAXIMUM) << 8) | (element & 0xFF);
+			break;
+		}
+		case DepthFormat::Unorm16:
+			reinterpret_cast<std::uint16_t*>(depthBuffer_.get())[offset] = quantize(depth, UNORM16_MAXIMUM);
+			break;
+		default:
+			break;
+	}
+}
+
+
+void
+Framebuffer::readDepthBuffer(float* const output) const {
+	const float infinity = std::numeric_limits<float>::infinity();
+	if (depthFormat_ == DepthFormat::Float32) {
+		const auto* const buffer = reinterpret_cast<const float*>(depthBuffer_.get());
+		float clearValue;
+		std::memcpy(&clearValue, &tileClearValues_.depth, sizeof(clearValue));
+		forEachRun(getWidth(), [=](const std::size_t offset, const std::size_t linearOffset, const std::size_t length) {
+			std::replace_copy(buffer + offset, buffer + offset + length, output + linearOffset, clearValue, infinity);
+		});
+	} else {
+		const bool packed = depthFormat_ == DepthFormat::D24S8;
+		const std::uint32_t maximum = packed ? D24_MAXIMUM : UNORM16_MAXIMUM;
+		const std::uint32_t clearValue = packed ? (tileClearValues_.depth >> 8) : tileClearValues_.depth;
+		const float near = depthRangeNear_;
+		const float scale = 1.0f / (depthRangeScale_ * maximum);
+		const auto* const words = reinterpret_cast<const std::uint32_t*>(depthBuffer_.get());
+		const auto* const halves = reinterpret_cast<const std::uint16_t*>(depthBuffer_.get());
+
+		forEachRun(getWidth(), [=](const std::size_t offset, const std::size_t linearOffset, const std::size_t length) {
+			float* const out = output + linearOffset;
+			std::size_t i = 0;
+#ifdef __SSE2__
+			const __m128i cleared = _mm_set1_epi32(static_cast<int>(clearValue));
+			for (; i + 4 <= length; i += 4) {
+				const __m128i values = packed ?
+					_mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words + offset + i)), 8) :
+					_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(halves + offset + i)), _mm_setzero_si128());
+				const __m128 depth = _mm_add_ps(_mm_set1_ps(near), _mm_mul_ps(_mm_cvtepi32_ps(values), _mm_set1_ps(scale)));
+				const __m128 mask = _mm_castsi128_ps(_mm_cmpeq_epi32(values, cleared));
+				_mm_storeu_ps(out + i, _mm_or_ps(_mm_and_ps(mask, _mm_set1_ps(infinity)), _mm_andnot_ps(mask, depth)));
+			}
+#endif
+			for (; i < length; ++i) {
+				const std::uint32_t value = packed ? (words[offset + i] >> 8) : halves[offset + i];
+				out[i] = value == clearValue ? infinity : near + (value * scale);
+			}
+		});
+	}
+	const std::uint32_t w = getWidth();
+	const std::uint32_t h = getHeight();
+	forEachClearedTile([=](const std::uint32_t x0, const std::uint32_t y0, const std::uint32_t x1, const std::uint32_t y1) {
+		for (std::uint32_t y = y0; y < y1; ++y) {
+			std::fill(output + (y * w) + x0, output + (y * w) + x1, infinity);
+		}
+	});
+	// Compressed tiles are decoded exactly as their decompressed elements would be.
+	const float scale = 1.0f / (depthRangeScale_ * UNORM16_MAXIMUM);
+	for (std::uint32_t y0 = 0; y0 < h; y0 += TILE_SIZE) {
+		for (std::uint32_t x0 = 0; x0 < w; x0 += TILE_SIZE) {
+			if (!isTileCompressed(x0, y0)) {
+				continue;
+			}
+			const auto& plane = tileDepthPlanes_[getTileIndex(x0, y0)];
+			for (std::uint32_t y = y0; y < std::min(y0 + TILE_SIZE, h); ++y) {
+				for (std::uint32_t x = x0; x < std::min(x0 + TILE_SIZE, w); ++x) {
+					const std::uint32_t value = getEncodedDepth(plane, x, y);
+					float& out = output[(y * w) + x];
+					if (depthFormat_ == DepthFormat::Float32) {
+						std::memcpy(&out, &value, sizeof(out));
+					} else {
+						out = depthRangeNear_ + (value * scale);
+					}
+				}
+			}
+		}
+	}
+}
+
+
+std::uint8_t
+Framebuffer::getStencil(const std::uint32_t x, const std::uint32_t y) const {
+	if (isTileCleared(x, y)) {
+		return tileClearValues_.stencil;
+	}
+	const std::size_t offset = getOffset(x, y);
+	if (depthFormat_ == DepthFormat::D24S8) {
+		return reinterpret_cast<const std::uint32_t*>(depthBuffer_.get())[offset] & 0xFF;
+	}
+	return stencilBuffer_[offset];
+}
+
+
+void
+Framebuffer::setStencil(const std::uint32_t x, const std::uint32_t y, const std::uint8_t value) {
+	resolveTile(x, y);
+	const std::size_t offset = getOffset(x, y);
+	if (depthFormat_ == DepthFormat::D24S8) {
+		auto& element = reinterpret_cast<std::uint32_t*>(depthBuffer_.get())[offset];
+		element = (element & ~0xFFu) | value;
+	} else {
+		stencilBuffer_[offset] = value;
+	}
 }
 
 
-const std::uint8_t*
-Framebuffer::getStencilBuffer() const {
-	return stencilBuffer_.get();
+void
+Framebuffer::readStencilBuffer(std::uint8_t* const output) const {
+	if (depthFormat_ == DepthFormat::D24S8) {
+		const auto* const buffer = reinterpret_cast<const std::uint32_t*>(depthBuffer_.get());
+		forEachRun(getWidth(), [=](const std::size_t offset, const std::size_t linearOffset, const std::size_t length) {
+			std::transform(buffer + offset, buffer + offset + length, output + linearOffset, [](const std::uint32_t element) {
+				return static_cast<std::uint8_t>(element & 0xFF);
+			});
+		});
+	} else {
+		const auto* const buffer = stencilBuffer_.get();
+		forEachRun(getWidth(), [=](const std::size_t offset, const std::size_t linearOffset, const std::size_t length) {
+			std::copy_n(buffer + offset, length, output + linearOffset);
+		});
+	}
+	const std::uint32_t w = getWidth();
+	const std::uint8_t clearValue = tileClearValues_.stencil;
+	forEachClearedTile([=](const std::uint32_t x0, const std::uint32_t y0, const std::uint32_t x1, const std::uint32_t y1) {
+		for (std::uint32_t y = y0; y < y1; ++y) {
+			std::fill(output + (y * w) + x0, output + (y * w) + x1, clearValue);
+		}
+	});
 }
 
 
@@ -159,15 +585,205 @@ Framebuffer::setStencilBufferClearValue(const std::uint8_t value) {
 
 void
 Framebuffer::clear() {
-	if (resolutionIdentifier_ == Resolution::ZERO) {
+	const std::size_t size = getStorageSize();
+	if (size == 0) {
+		return;
+	}
+
+	dirty_ = true;
+	tileClearValues_.pixel = pixelBufferClearValue_;
+	tileClearValues_.depth = getEncodedDepthBufferClearValue();
+	tileClearValues_.stencil = stencilBufferClearValue_;
+
+	const std::size_t tileCount = tilesPerRow_ * getTileCount(getHeight());
+	if (fastClear_) {
+		// Tiles whose generation differs from the framebuffer's are cleared. When the
+		// generation counter wraps around, all tiles are reset to an older generation.
+		if (++generation_ == 0) {
+			std::fill_n(tileGenerations_.get(), tileCount, 0);
+			generation_ = 1;
+		}
+	} else {
+		const std::uint32_t storageWidth = getStorageWidth();
+		forEachTileRow([this, storageWidth](const std::uint32_t y0, const std::uint32_t y1) {
+			fillRectangle(0, y0, storageWidth, y1);
+		});
+		std::fill_n(tileGenerations_.get(), tileCount, generation_);
+		std::fill_n(tileCompressed_.get(), tileCount, 0);
+	}
+}
+
+
+bool
+Framebuffer::isFastClearEnabled() const {
+	return fastClear_;
+}
+
+
+void
+Framebuffer::enableFastClear(const bool enable) {
+	if (fastClear_ && !enable) {
+		resolve();
+	}
+	fastClear_ = enable;
+}
+
+
+void
+Framebuffer::resolve() {
+	if (!dirty_) {
 		return;
 	}
-	const std::size_t size = resolution_.width() * resolution_.height();
-	Q_ASSERT(size > 0);
+	dirty_ = false;
+
+	const std::uint32_t w = getWidth();
+	const std::uint32_t storageWidth = getStorageWidth();
+	const std::uint32_t storageHeight = getStorageHeight();
+	const std::uint32_t h = getHeight();
+	forEachTileRow([this, w, h, storageWidth](const std::uint32_t y0, const std::uint32_t y1) {
+		// Consecutive cleared tiles in a row of tiles are filled together, so a frame
+		// that was barely drawn to is filled almost linearly.
+		for (std::uint32_t x0 = 0; x0 < w;) {
+			if (!isTileCleared(x0, y0)) {
+				x0 += TILE_SIZE;
+				continue;
+			}
+			std::uint32_t x1 = x0;
+			while (x1 < w && isTileCleared(x1, y0)) {
+				tileGenerations_[getTileIndex(x1, y0)] = generation_;
+				tileCompressed_[getTileIndex(x1, y0)] = 0;
+				x1 += TILE_SIZE;
+			}
+			fillRectangle(x0, y0, std::min(x1, storageWidth), y1);
+			x0 = x1;
+		}
+		// In the linear layout, the row of tiles is encoded while it's still in cache.
+		if (layout_ == Layout::Linear) {
+			encodeRows(y0, std::min(y1, h));
+		}
+	});
+	if (layout_ == Layout::Tiled) {
+		const std::uint32_t* const source = pixelBuffer_.get();
+		std::uint32_t* const destination = resolvedPixelBuffer_.get();
+		parallelFor(storageHeight / BLOCK_SIZE, [this, h, source, destination](const std::size_t row) {
+			forEachRun(row, pitch_, [source, destination](const std::size_t offset, const std::size_t linearOffset, const std::size_t length) {
+				std::copy_n(source + offset, length, destination + linearOffset);
+			});
+			const std::uint32_t y0 = row * BLOCK_SIZE;
+			encodeRows(y0, std::min(y0 + BLOCK_SIZE, h));
+		});
+	}
+}
+
+
+void
+Framebuffer::encode() {
+	if (pixelFormat_ != PixelFormat::BGRA8) {
+		const std::uint32_t h = getHeight();
+		forEachTileRow([this, h](const std::uint32_t y0, const std::uint32_t y1) {
+			encodeRows(y0, std::min(y1, h));
+		});
+	}
+}
+
+
+std::uint64_t
+Framebuffer::getHash() const {
+	// Each row of tiles is hashed with 64-bit FNV-1a, two pixels at a time, and the
+	// rows' hashes are then hashed in order.
+	constexpr std::uint64_t OFFSET_BASIS = 0xcbf29ce484222325;
+	constexpr std::uint64_t PRIME = 0x100000001b3;
+	const auto& hash = [](std::uint64_t value, const std::uint64_t word) {
+		return (value ^ word) * PRIME;
+	};
+	const std::uint32_t w = getWidth();
+	const std::uint32_t h = getHeight();
+	const std::uint32_t* const pixels = getResolvedPixelBuffer();
+	std::vector<std::uint64_t> rowHashes(getTileCount(h), OFFSET_BASIS);
+	parallelFor(rowHashes.size(), [this, &rowHashes, &hash, pixels, w, h](const std::size_t row) {
+		std::uint64_t value = rowHashes[row];
+		const std::uint32_t y0 = row * TILE_SIZE;
+		for (std::uint32_t y = y0; y < std::min(y0 + TILE_SIZE, h); ++y) {
+			const std::uint32_t* const line = pixels + (static_cast<std::size_t>(y) * pitch_);
+			std::uint32_t x = 0;
+			for (; x + 1 < w; x += 2) {
+				value = hash(value, (static_cast<std::uint64_t>(line[x + 1]) << 32) | line[x]);
+			}
+			if (x < w) {
+				value = hash(value, line[x]);
+			}
+		}
+		rowHashes[row] = value;
+	});
+
+	std::uint64_t value = hash(OFFSET_BASIS, (static_cast<std::uint64_t>(h) << 32) | w);
+	for (const auto rowHash : rowHashes) {
+		value = hash(value, rowHash);
+	}
+	return value;
+}
+
+
+void
+Framebuffer::resolveTile(const std::uint32_t x, const std::uint32_t y) {
+	dirty_ = true;
+	if (isTileCleared(x, y)) {
+		const std::uint32_t x0 = x - (x % TILE_SIZE);
+		const std::uint32_t y0 = y - (y % TILE_SIZE);
+		fillRectangle(x0, y0, std::min(x0 + TILE_SIZE, getStorageWidth()), std::min(y0 + TILE_SIZE, getStorageHeight()));
+		tileGenerations_[getTileIndex(x, y)] = generation_;
+		tileCompressed_[getTileIndex(x, y)] = 0;
+	}
+}
+
+
+bool
+Framebuffer::isDepthCompressionEnabled() const {
+	return depthCompression_;
+}
+
+
+void
+Framebuffer::enableDepthCompression(const bool enable) {
+	if (depthCompression_ && !enable) {
+		const std::uint32_t w = getWidth();
+		const std::uint32_t h = getHeight();
+		for (std::uint32_t y = 0; y < h; y += TILE_SIZE) {
+			for (std::uint32_t x = 0; x < w; x += TILE_SIZE) {
+				decompressTile(x, y);
+			}
+		}
+	}
+	depthCompression_ = enable;
+}
+
 
-	std::fill_n(pixelBuffer_.get(), size, pixelBufferClearValue_);
-	std::fill_n(depthBuffer_.get(), size, depthBufferClearValue_);
-	std::fill_n(stencilBuffer_.get(), size, stencilBufferClearValue_);
+bool
+Framebuffer::setDepthPlane(const std::uint32_t x, const std::uint32_t y, const DepthPlane& plane, const float* const depths) {
+	// The D24S8 format's stencil values are packed with the depth values, so they
+	// would be lost if the depth values weren't stored.
+	if (!depthCompression_ || depthFormat_ == DepthFormat::D24S8 || getOffset(x, y) < 0) {
+		return false;
+	}
+	const std::uint32_t x0 = x - (x % TILE_SIZE);
+	const std::uint32_t y0 = y - (y % TILE_SIZE);
+	const std::uint32_t x1 = std::min(x0 + TILE_SIZE, getWidth());
+	const std::uint32_t y1 = std::min(y0 + TILE_SIZE, getHeight());
+	// The plane is only stored if it is indistinguishable from the depth values, so
+	// that depth compression never changes the rendered image.
+	for (std::uint32_t j = y0; j < y1; ++j) {
+		for (std::uint32_t i = x0; i < x1; ++i) {
+			const double depth = depths[((j - y0) * TILE_SIZE) + (i - x0)];
+			if (!testDepth(i, j, depth) || getEncodedDepth(plane, i, j) != encodeDepth(depth)) {
+				return false;
+			}
+		}
+	}
+	resolveTile(x, y);
+	const std::size_t tile = getTileIndex(x, y);
+	tileCompressed_[tile] = 1;
+	tileDepthPlanes_[tile] = plane;
+	return true;
 }
 
 
@@ -175,9 +791,136 @@ void
 Framebuffer::discard(const std::uint32_t x, const std::uint32_t y) {
 	const int offset = getOffset(x, y);
 	if (offset >= 0) {
+		resolveTile(x, y);
+		decompressTile(x, y);
+		const std::uint32_t depth = getEncodedDepthBufferClearValue();
 		pixelBuffer_[offset] = pixelBufferClearValue_;
-		depthBuffer_[offset] = depthBufferClearValue_;
-		stencilBuffer_[offset] = stencilBufferClearValue_;
+		switch (depthFormat_) {
+			case DepthFormat::Float32:
+				std::memcpy(&reinterpret_cast<float*>(depthBuffer_.get())[offset], &depth, sizeof(float));
+				stencilBuffer_[offset] = stencilBufferClearValue_;
+				break;
+			case DepthFormat::D24S8:
+				reinterpret_cast<std::uint32_t*>(depthBuffer_.get())[offset] = depth;
+				break;
+			case DepthFormat::Unorm16:
+				reinterpret_cast<std::uint16_t*>(depthBuffer_.get())[offset] = static_cast<std::uint16_t>(depth);
+				stencilBuffer_[offset] = stencilBufferClearValue_;
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+void
+Framebuffer::composite(const Framebuffer& layer) {
+	if (layer.resolution_ != resolution_ || layer.layout_ != layout_ || layer.depthFormat_ != depthFormat_) {
+		qWarning("[Framebuffer::composite] The layer's resolution, layout and depth format must match the framebuffer's.");
+		return;
+	}
+	dirty_ = true;
+
+	const std::uint32_t w = getWidth();
+	const std::uint32_t h = getHeight();
+	const std::uint32_t storageWidth = getStorageWidth();
+	forEachTileRow([this, &layer, w, h, storageWidth](const std::uint32_t y0, const std::uint32_t y1) {
+		for (std::uint32_t x0 = 0; x0 < w; x0 += TILE_SIZE) {
+			if (layer.isTileCleared(x0, y0)) {
+				continue;
+			}
+			// Cleared tiles are filled here rather than by resolveTile, which would mark
+			// the framebuffer as dirty from each row of tiles concurrently.
+			const std::size_t tile = getTileIndex(x0, y0);
+			if (isTileCleared(x0, y0)) {
+				fillRectangle(x0, y0, std::min(x0 + TILE_SIZE, storageWidth), y1);
+				tileGenerations_[tile] = generation_;
+				tileCompressed_[tile] = 0;
+			}
+			decompressTile(x0, y0);
+
+			const std::uint32_t x1 = std::min(x0 + TILE_SIZE, w);
+			if (layer.isTileCompressed(x0, y0)) {
+				// Tiles are never compressed in the D24S8 format, so a plane's encoded
+				// depth is also a depth buffer element.
+				const auto& plane = layer.tileDepthPlanes_[tile];
+				for (std::uint32_t y = y0; y < std::min(y1, h); ++y) {
+					for (std::uint32_t x = x0; x < x1; ++x) {
+						compositeElement(layer, getOffset(x, y), layer.getEncodedDepth(plane, x, y));
+					}
+				}
+			} else if (layout_ == Layout::Tiled) {
+				// The tile's blocks in a row of blocks are contiguous, so each row of blocks
+				// is merged as a single run.
+				const std::size_t blockLength = BLOCK_SIZE * BLOCK_SIZE;
+				const std::size_t length = ((x1 - x0 + BLOCK_SIZE - 1) / BLOCK_SIZE) * blockLength;
+				for (std::uint32_t y = y0; y < y1; y += BLOCK_SIZE) {
+					compositeRun(layer, (((y / BLOCK_SIZE) * blocksPerRow_) + (x0 / BLOCK_SIZE)) * blockLength, length);
+				}
+			} else {
+				for (std::uint32_t y = y0; y < std::min(y1, h); ++y) {
+					compositeRun(layer, (static_cast<std::size_t>(y) * pitch_) + x0, x1 - x0);
+				}
+			}
+		}
+	});
+}
+
+
+
+void
+Framebuffer::readTile(const std::uint32_t x, const std::uint32_t y, std::uint32_t* const pixels, std::uint32_t* const depths) const {
+	const std::uint32_t x0 = x - (x % TILE_SIZE);
+	const std::uint32_t y0 = y - (y % TILE_SIZE);
+	const std::uint32_t x1 = std::min(x0 + TILE_SIZE, getWidth());
+	const std::uint32_t y1 = std::min(y0 + TILE_SIZE, getHeight());
+	const bool cleared = isTileCleared(x0, y0);
+	const bool compressed = isTileCompressed(x0, y0);
+	std::size_t k = 0;
+	for (std::uint32_t j = y0; j < y1; ++j) {
+		for (std::uint32_t i = x0; i < x1; ++i, ++k) {
+			if (cleared) {
+				pixels[k] = tileClearValues_.pixel;
+				depths[k] = tileClearValues_.depth;
+			} else {
+				const std::size_t offset = getOffset(i, j);
+				pixels[k] = pixelBuffer_[offset];
+				depths[k] = compressed ? getEncodedDepth(tileDepthPlanes_[getTileIndex(i, j)], i, j) : getEncodedDepth(offset);
+			}
+		}
+	}
+}
+
+
+void
+Framebuffer::writeTile(const std::uint32_t x, const std::uint32_t y, const std::uint32_t* pixels, const std::uint32_t* depths) {
+	resolveTile(x, y);
+	tileCompressed_[getTileIndex(x, y)] = 0;
+
+	const std::uint32_t x0 = x - (x % TILE_SIZE);
+	const std::uint32_t y0 = y - (y % TILE_SIZE);
+	const std::uint32_t x1 = std::min(x0 + TILE_SIZE, getWidth());
+	const std::uint32_t y1 = std::min(y0 + TILE_SIZE, getHeight());
+	for (std::uint32_t j = y0; j < y1; ++j) {
+		for (std::uint32_t i = x0; i < x1; ++i, ++pixels, ++depths) {
+			const std::size_t offset = getOffset(i, j);
+			pixelBuffer_[offset] = *pixels;
+			switch (depthFormat_) {
+				case DepthFormat::Float32:
+					reinterpret_cast<std::uint32_t*>(depthBuffer_.get())[offset] = *depths;
+					stencilBuffer_[offset] = tileClearValues_.stencil;
+					break;
+				case DepthFormat::D24S8:
+					reinterpret_cast<std::uint32_t*>(depthBuffer_.get())[offset] = *depths;
+					break;
+				case DepthFormat::Unorm16:
+					reinterpret_cast<std::uint16_t*>(depthBuffer_.get())[offset] = static_cast<std::uint16_t>(*depths);
+					stencilBuffer_[offset] = tileClearValues_.stencil;
+					break;
+				default:
+					break;
+			}
+		}
 	}
 }
 
@@ -188,7 +931,12 @@ Framebuffer::getOffset(const std::uint32_t x, const std::uint32_t y) const {
 	const std::uint32_t w = resolution_.width();
 	const std::uint32_t h = resolution_.height();
 	if (x < w && y < h) {
-		offset = x + (y * w);
+		if (layout_ == Layout::Tiled) {
+			const std::uint32_t block = ((y / BLOCK_SIZE) * blocksPerRow_) + (x / BLOCK_SIZE);
+			offset = (block * BLOCK_SIZE * BLOCK_SIZE) + ((y % BLOCK_SIZE) * BLOCK_SIZE) + (x % BLOCK_SIZE);
+		} else {
+			offset = x + (y * pitch_);
+		}
 	}
 	return offset;
 }
@@ -209,6 +957,35 @@ Framebuffer::getAvailableResolutions() {
 }
 
 
+std::size_t
+Framebuffer::getPixelSize(const PixelFormat format) {
+	switch (format) {
+		case PixelFormat::BGRA8:
+		case PixelFormat::RGBA8:
+			return sizeof(std::uint32_t);
+		case PixelFormat::RGB565:
+			return sizeof(std::uint16_t);
+		default:
+			qFatal("[Framebuffer::getPixelSize] Unspecified pixel format!");
+	}
+}
+
+
+QImage::Format
+Framebuffer::getImageFormat(const PixelFormat format) {
+	switch (format) {
+		case PixelFormat::BGRA8:
+			return QImage::Format_ARGB32;
+		case PixelFormat::RGBA8:
+			return QImage::Format_RGBA8888;
+		case PixelFormat::RGB565:
+			return QImage::Format_RGB16;
+		default:
+			return QImage::Format_Invalid;
+	}
+}
+
+
 QSize
 Framebuffer::getResolution(const Resolution resolutionIdentifier) {
 	switch (resolutionIdentifier) {
@@ -228,32 +1005,461 @@ Framebuffer::getResolution(const Resolution resolutionIdentifier) {
 			return QSize(2560, 2048);
 		case Resolution::UHD8K:
 			return QSize(7680, 4320);
+		case Resolution::CUSTOM:
+			return QSize();
 		default:
 			qFatal("[Framebuffer::getResolution] Unspecified resolution identifier!");
 	}
 }
 
 
+Framebuffer::Resolution
+Framebuffer::getResolutionIdentifier(const QSize& resolution) {
+	for (const auto identifier : getAvailableResolutions()) {
+		if (getResolution(identifier) == resolution) {
+			return identifier;
+		}
+	}
+	return Resolution::CUSTOM;
+}
+
+
 void
 Framebuffer::resize() {
 	// Destroy the reference to the previous pixel buffer before the buffer itself is destroyed.
 	pixelBufferImage_ = QImage();
 
-	const std::uint32_t w = resolution_.width();
-	const std::uint32_t h = resolution_.height();
+	const std::uint32_t w = getWidth();
+	const std::uint32_t h = getHeight();
+	pitch_ = ((w + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT) * ROW_ALIGNMENT;
+	blocksPerRow_ = (w + BLOCK_SIZE - 1) / BLOCK_SIZE;
 
-	const std::size_t bufferSize = w * h;
-	if (bufferSize == 0) {
-		pixelBuffer_.reset(nullptr);
-		depthBuffer_.reset(nullptr);
-		stencilBuffer_.reset(nullptr);
-	} else {
-		pixelBuffer_.reset(new std::uint32_t[bufferSize]);
-		depthBuffer_.reset(new double[bufferSize]);
-		stencilBuffer_.reset(new std::uint8_t[bufferSize]);
-		pixelBufferImage_ = QImage(reinterpret_cast<uchar*>(pixelBuffer_.get()), w, h, QImage::Format_ARGB32);
+	// The buffers only grow, so a framebuffer that shrinks keeps its storage.
+	const std::size_t bufferSize = getStorageSize();
+	bool reallocated = false;
+	if (bufferSize > 0) {
+		reallocated = pixelBuffer_.reserve(bufferSize);
+		if (layout_ == Layout::Tiled) {
+			resolvedPixelBuffer_.reserve(static_cast<std::size_t>(pitch_) * h);
+		}
+		const std::size_t pixelSize = getPixelSize(pixelFormat_);
+		if (pixelFormat_ != PixelFormat::BGRA8) {
+			outputBuffer_.reserve(static_cast<std::size_t>(pitch_) * h * pixelSize);
+		}
+		pixelBufferImage_ = QImage(static_cast<const uchar*>(getOutputBuffer()), w, h, pitch_ * pixelSize, getImageFormat(pixelFormat_));
 	}
+	reallocated = resizeDepthStencilBuffers() || reallocated;
+
+	// Tiles are stamped with an older generation than the framebuffer's, so they're
+	// all cleared until they're written to.
+	tilesPerRow_ = getTileCount(w);
+	const std::size_t tileCount = tilesPerRow_ * getTileCount(h);
+	tileGenerations_.reserve(tileCount);
+	std::fill_n(tileGenerations_.get(), tileCount, 0);
+	tileCompressed_.reserve(tileCount);
+	std::fill_n(tileCompressed_.get(), tileCount, 0);
+	tileDepthPlanes_.reserve(tileCount);
+	generation_ = 1;
 
 	clear();
+	if (reallocated && fastClear_) {
+		// A fast clear doesn't write to the buffers, which would leave the first write
+		// to each page, and so the page's NUMA node, to whichever thread resolves its
+		// tile. The resolved pixel buffer needs no such treatment since it is only
+		// written to by the parallel de-tiling pass.
+		const std::uint32_t storageWidth = getStorageWidth();
+		forEachTileRow([this, storageWidth](const std::uint32_t y0, const std::uint32_t y1) {
+			fillRectangle(0, y0, storageWidth, y1);
+		});
+	}
 	emit resized(resolution_);
 }
+
+
+bool
+Framebuffer::resizeDepthStencilBuffers() {
+	// The stencil buffer isn't used by the D24S8 format, but its storage is kept
+	// in case the format changes again.
+	const std::size_t bufferSize = getStorageSize();
+	bool reallocated = depthBuffer_.reserve(bufferSize * getDepthBufferElementSize(depthFormat_));
+	if (depthFormat_ != DepthFormat::D24S8) {
+		reallocated = stencilBuffer_.reserve(bufferSize) || reallocated;
+	}
+	return reallocated;
+}
+
+
+void
+Framebuffer::fillDepthStencilBuffers(const std::size_t offset, const std::size_t length) {
+	if (length == 0) {
+		return;
+	}
+	const std::uint32_t value = tileClearValues_.depth;
+	switch (depthFormat_) {
+		case DepthFormat::Float32: {
+			float depth;
+			std::memcpy(&depth, &value, sizeof(depth));
+			std::fill_n(reinterpret_cast<float*>(depthBuffer_.get()) + offset, length, depth);
+			std::fill_n(stencilBuffer_.get() + offset, length, tileClearValues_.stencil);
+			break;
+		}
+		case DepthFormat::D24S8:
+			std::fill_n(reinterpret_cast<std::uint32_t*>(depthBuffer_.get()) + offset, length, value);
+			break;
+		case DepthFormat::Unorm16:
+			std::fill_n(reinterpret_cast<std::uint16_t*>(depthBuffer_.get()) + offset, length, static_cast<std::uint16_t>(value));
+			std::fill_n(stencilBuffer_.get() + offset, length, tileClearValues_.stencil);
+			break;
+		default:
+			break;
+	}
+}
+
+
+std::uint32_t
+Framebuffer::getEncodedDepth(const std::size_t offset) const {
+	switch (depthFormat_) {
+		case DepthFormat::Float32:
+		case DepthFormat::D24S8:
+			return reinterpret_cast<const std::uint32_t*>(depthBuffer_.get())[offset];
+		case DepthFormat::Unorm16:
+			return reinterpret_cast<const std::uint16_t*>(depthBuffer_.get())[offset];
+		default:
+			return 0;
+	}
+}
+
+
+void
+Framebuffer::encodeRows(const std::uint32_t y0, const std::uint32_t y1) {
+	if (pixelFormat_ == PixelFormat::BGRA8) {
+		return;
+	}
+	const std::size_t rowSize = pitch_ * getPixelSize(pixelFormat_);
+	const std::uint32_t* const input = getResolvedPixelBuffer();
+	for (std::uint32_t y = y0; y < y1; ++y) {
+		encodePixels(input + (static_cast<std::size_t>(y) * pitch_), outputBuffer_.get() + (y * rowSize), getWidth(), pixelFormat_);
+	}
+}
+
+
+std::uint32_t
+Framebuffer::getEncodedDepth(const DepthPlane& plane, const std::uint32_t x, const std::uint32_t y) const {
+	const float depth = (plane.a * static_cast<float>(x)) + (plane.b * static_cast<float>(y)) + plane.c;
+	return encodeDepth(depth);
+}
+
+
+std::uint32_t
+Framebuffer::encodeDepth(const double depth) const {
+	if (depthFormat_ == DepthFormat::Float32) {
+		const float value = static_cast<float>(depth);
+		std::uint32_t encoded;
+		std::memcpy(&encoded, &value, sizeof(encoded));
+		return encoded;
+	}
+	return quantize(depth, depthFormat_ == DepthFormat::D24S8 ? D24_MAXIMUM : UNORM16_MAXIMUM);
+}
+
+
+void
+Framebuffer::setEncodedDepth(const std::size_t offset, const std::uint32_t depth) {
+	switch (depthFormat_) {
+		case DepthFormat::Float32:
+			reinterpret_cast<std::uint32_t*>(depthBuffer_.get())[offset] = depth;
+			break;
+		case DepthFormat::D24S8: {
+			auto& element = reinterpret_cast<std::uint32_t*>(depthBuffer_.get())[offset];
+			element = (depth << 8) | (element & 0xFF);
+			break;
+		}
+		case DepthFormat::Unorm16:
+			reinterpret_cast<std::uint16_t*>(depthBuffer_.get())[offset] = static_cast<std::uint16_t>(depth);
+			break;
+		default:
+			break;
+	}
+}
+
+
+std::uint32_t
+Framebuffer::getStorageWidth() const {
+	return layout_ == Layout::Tiled ? blocksPerRow_ * BLOCK_SIZE : pitch_;
+}
+
+
+std::uint32_t
+Framebuffer::getStorageHeight() const {
+	const std::uint32_t h = getHeight();
+	return layout_ == Layout::Tiled ? ((h + BLOCK_SIZE - 1) / BLOCK_SIZE) * BLOCK_SIZE : h;
+}
+
+
+std::size_t
+Framebuffer::getStorageSize() const {
+	return static_cast<std::size_t>(getStorageWidth()) * getStorageHeight();
+}
+
+
+void
+Framebuffer::fillRectangle(const std::uint32_t x0, const std::uint32_t y0, const std::uint32_t x1, const std::uint32_t y1) {
+	const auto& fill = [this](const std::size_t offset, const std::size_t length) {
+		std::fill_n(pixelBuffer_.get() + offset, length, tileClearValues_.pixel);
+		fillDepthStencilBuffers(offset, length);
+	};
+	if (layout_ == Layout::Tiled) {
+		// The rectangle is aligned to blocks, and the blocks in a row of blocks are
+		// contiguous so each row of blocks is filled with a single run.
+		const std::size_t blockLength = BLOCK_SIZE * BLOCK_SIZE;
+		const std::size_t length = ((x1 - x0 + BLOCK_SIZE - 1) / BLOCK_SIZE) * blockLength;
+		for (std::uint32_t y = y0; y < y1; y += BLOCK_SIZE) {
+			fill((((y / BLOCK_SIZE) * blocksPerRow_) + (x0 / BLOCK_SIZE)) * blockLength, length);
+		}
+	} else {
+		for (std::uint32_t y = y0; y < y1; ++y) {
+			fill((static_cast<std::size_t>(y) * pitch_) + x0, x1 - x0);
+		}
+	}
+}
+
+
+std::uint32_t
+Framebuffer::getTileCount(const std::uint32_t length) {
+	return (length + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+
+std::size_t
+Framebuffer::getTileIndex(const std::uint32_t x, const std::uint32_t y) const {
+	return ((y / TILE_SIZE) * tilesPerRow_) + (x / TILE_SIZE);
+}
+
+
+bool
+Framebuffer::isTileCleared(const std::uint32_t x, const std::uint32_t y) const {
+	return tileGenerations_[getTileIndex(x, y)] != generation_;
+}
+
+
+bool
+Framebuffer::isTileCompressed(const std::uint32_t x, const std::uint32_t y) const {
+	return tileCompressed_[getTileIndex(x, y)] != 0 && !isTileCleared(x, y);
+}
+
+
+void
+Framebuffer::decompressTile(const std::uint32_t x, const std::uint32_t y) {
+	if (isTileCompressed(x, y)) {
+		const std::size_t tile = getTileIndex(x, y);
+		const auto& plane = tileDepthPlanes_[tile];
+		const std::uint32_t x0 = x - (x % TILE_SIZE);
+		const std::uint32_t y0 = y - (y % TILE_SIZE);
+		const std::uint32_t x1 = std::min(x0 + TILE_SIZE, getWidth());
+		const std::uint32_t y1 = std::min(y0 + TILE_SIZE, getHeight());
+		for (std::uint32_t j = y0; j < y1; ++j) {
+			for (std::uint32_t i = x0; i < x1; ++i) {
+				setEncodedDepth(getOffset(i, j), getEncodedDepth(plane, i, j));
+			}
+		}
+		tileCompressed_[tile] = 0;
+	}
+}
+
+void
+Framebuffer::compositeRun(const Framebuffer& layer, const std::size_t offset, const std::size_t length) {
+	std::size_t i = 0;
+#ifdef __SSE2__
+	// Four elements are merged at once by selecting the layer's pixels and depth
+	// values with the mask of those that pass the depth test.
+	const auto& select = [](const __m128i mask, const __m128i source, const __m128i destination) {
+		return _mm_or_si128(_mm_and_si128(mask, source), _mm_andnot_si128(mask, destination));
+	};
+	const auto& compositeStencils = [this, &layer, offset](const std::size_t i, const int passes) {
+		for (std::size_t j = 0; j < 4; ++j) {
+			if (passes & (1 << j)) {
+				stencilBuffer_[offset + i + j] = layer.stencilBuffer_[offset + i + j];
+			}
+		}
+	};
+	auto* const pixels = reinterpret_cast<__m128i*>(pixelBuffer_.get() + offset);
+	const auto* const layerPixels = reinterpret_cast<const __m128i*>(layer.pixelBuffer_.get() + offset);
+	switch (depthFormat_) {
+		case DepthFormat::Float32:
+		case DepthFormat::D24S8: {
+			auto* const depths = reinterpret_cast<std::uint32_t*>(depthBuffer_.get()) + offset;
+			const auto* const layerDepths = reinterpret_cast<const std::uint32_t*>(layer.depthBuffer_.get()) + offset;
+			for (; i + 4 <= length; i += 4) {
+				const __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(layerDepths + i));
+				const __m128i destination = _mm_loadu_si128(reinterpret_cast<const __m128i*>(depths + i));
+				// The D24S8 format's depth values are compared without their stencil values,
+				// which are merged along with them.
+				const __m128i mask = depthFormat_ == DepthFormat::Float32 ?
+					_mm_castps_si128(_mm_cmplt_ps(_mm_castsi128_ps(source), _mm_castsi128_ps(destination))) :
+					_mm_cmplt_epi32(_mm_srli_epi32(source, 8), _mm_srli_epi32(destination, 8));
+				const int passes = _mm_movemask_ps(_mm_castsi128_ps(mask));
+				if (passes != 0) {
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(depths + i), select(mask, source, destination));
+					_mm_storeu_si128(pixels + (i / 4), select(mask, _mm_loadu_si128(layerPixels + (i / 4)), _mm_loadu_si128(pixels + (i / 4))));
+					if (depthFormat_ == DepthFormat::Float32) {
+						compositeStencils(i, passes);
+					}
+				}
+			}
+			break;
+		}
+		case DepthFormat::Unorm16: {
+			auto* const depths = reinterpret_cast<std::uint16_t*>(depthBuffer_.get()) + offset;
+			const auto* const layerDepths = reinterpret_cast<const std::uint16_t*>(layer.depthBuffer_.get()) + offset;
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 4 <= length; i += 4) {
+				const __m128i source = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(layerDepths + i));
+				const __m128i destination = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(depths + i));
+				// The depth values are widened since SSE2 only compares signed integers.
+				const __m128i mask = _mm_cmplt_epi32(_mm_unpacklo_epi16(source, zero), _mm_unpacklo_epi16(destination, zero));
+				const int passes = _mm_movemask_ps(_mm_castsi128_ps(mask));
+				if (passes != 0) {
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(depths + i), select(_mm_packs_epi32(mask, mask), source, destination));
+					_mm_storeu_si128(pixels + (i / 4), select(mask, _mm_loadu_si128(layerPixels + (i / 4)), _mm_loadu_si128(pixels + (i / 4))));
+					compositeStencils(i, passes);
+				}
+			}
+			break;
+		}
+		default:
+			break;
+	}
+#endif
+	for (; i < length; ++i) {
+		compositeElement(layer, offset + i, layer.getEncodedDepth(offset + i));
+	}
+}
+
+
+void
+Framebuffer::compositeElement(const Framebuffer& layer, const std::size_t offset, const std::uint32_t depth) {
+	const std::uint32_t stored = getEncodedDepth(offset);
+	switch (depthFormat_) {
+		case DepthFormat::Float32: {
+			float source;
+			float destination;
+			std::memcpy(&source, &depth, sizeof(source));
+			std::memcpy(&destination, &stored, sizeof(destination));
+			if (source < destination) {
+				reinterpret_cast<std::uint32_t*>(depthBuffer_.get())[offset] = depth;
+				stencilBuffer_[offset] = layer.stencilBuffer_[offset];
+				break;
+			}
+			return;
+		}
+		case DepthFormat::D24S8:
+			if ((depth >> 8) < (stored >> 8)) {
+				reinterpret_cast<std::uint32_t*>(depthBuffer_.get())[offset] = depth;
+				break;
+			}
+			return;
+		case DepthFormat::Unorm16:
+			if (depth < stored) {
+				reinterpret_cast<std::uint16_t*>(depthBuffer_.get())[offset] = static_cast<std::uint16_t>(depth);
+				stencilBuffer_[offset] = layer.stencilBuffer_[offset];
+				break;
+			}
+			return;
+		default:
+			return;
+	}
+	pixelBuffer_[offset] = layer.pixelBuffer_[offset];
+}
+
+
+
+template<class Function> void
+Framebuffer::forEachClearedTile(const Function& function) const {
+	const std::uint32_t w = getWidth();
+	const std::uint32_t h = getHeight();
+	for (std::uint32_t y = 0; y < h; y += TILE_SIZE) {
+		for (std::uint32_t x = 0; x < w; x += TILE_SIZE) {
+			if (isTileCleared(x, y)) {
+				function(x, y, std::min(x + TILE_SIZE, w), std::min(y + TILE_SIZE, h));
+			}
+		}
+	}
+}
+
+
+template<class Function> void
+Framebuffer::forEachTileRow(const Function& function) {
+	const std::uint32_t storageHeight = getStorageHeight();
+	parallelFor(getTileCount(storageHeight), [&function, storageHeight](const std::size_t row) {
+		const std::uint32_t y0 = row * TILE_SIZE;
+		function(y0, std::min(y0 + TILE_SIZE, storageHeight));
+	});
+}
+
+
+template<class Function> void
+Framebuffer::forEachRun(const std::uint32_t stride, const Function& function) const {
+	if (layout_ == Layout::Tiled) {
+		for (std::size_t row = 0; row < getStorageHeight() / BLOCK_SIZE; ++row) {
+			forEachRun(row, stride, function);
+		}
+	} else {
+		const std::uint32_t w = getWidth();
+		const std::uint32_t h = getHeight();
+		if (pitch_ == stride) {
+			function(0, 0, static_cast<std::size_t>(pitch_) * h);
+		} else {
+			for (std::uint32_t y = 0; y < h; ++y) {
+				function(static_cast<std::size_t>(y) * pitch_, static_cast<std::size_t>(y) * stride, w);
+			}
+		}
+	}
+}
+
+
+template<class Function> void
+Framebuffer::forEachRun(const std::size_t row, const std::uint32_t stride, const Function& function) const {
+	const std::uint32_t w = getWidth();
+	const std::uint32_t h = getHeight();
+	const std::size_t blockLength = BLOCK_SIZE * BLOCK_SIZE;
+	for (std::uint32_t bx = 0; bx < blocksPerRow_; ++bx) {
+		const std::size_t block = (row * blocksPerRow_) + bx;
+		const std::uint32_t x = bx * BLOCK_SIZE;
+		const std::uint32_t length = std::min(BLOCK_SIZE, w - x);
+		for (std::uint32_t i = 0; i < BLOCK_SIZE; ++i) {
+			const std::uint32_t y = (row * BLOCK_SIZE) + i;
+			if (y >= h) {
+				break;
+			}
+			function((block * blockLength) + (i * BLOCK_SIZE), (static_cast<std::size_t>(y) * stride) + x, length);
+		}
+	}
+}
+
+
+std::uint32_t
+Framebuffer::quantize(const double depth, const std::uint32_t maximum) const {
+	float d = (static_cast<float>(depth) - depthRangeNear_) * depthRangeScale_;
+	d = std::min(std::max(d, 0.0f), 1.0f);
+	return static_cast<std::uint32_t>(std::lrint(d * static_cast<float>(maximum)));
+}
+
+
+std::uint32_t
+Framebuffer::getEncodedDepthBufferClearValue() const {
+	switch (depthFormat_) {
+		case DepthFormat::Float32: {
+			const float value = depthBufferClearValue_ < std::numeric_limits<float>::max() ?
+				static_cast<float>(depthBufferClearValue_) :
+				std::numeric_limits<float>::infinity();
+			std::uint32_t encoded;
+			std::memcpy(&encoded, &value, sizeof(encoded));
+			return encoded;
+		}
+		case DepthFormat::D24S8:
+			return (quantize(depthBufferClearValue_, D24_MAXIMUM) << 8) | stencilBufferClearValue_;
+		case DepthFormat::Unorm16:
+			return quantize(depthBufferClearValue_, UNORM16_MAXIMUM);
+		default:
+			return 0;
+	}
+}
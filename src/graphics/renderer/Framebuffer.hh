@@ -29,10 +29,14 @@
 #include <QSize>
 #include <QImage>
 #include <memory>
+#include "AlignedBuffer.hh"
 #include "enum_traits.hh"
 
 
 namespace clockwork {
+namespace testsuite {
+class TestFramebuffer;
+} // namespace testsuite
 /**
  *
  */
@@ -50,13 +54,77 @@ public:
 		SXGA,    // 1280 x 1024
 		FHD,     // 1920 x 1080
 		QSXGA,   // 2560 x 2048
-		UHD8K    // 7680 x 4320
+		UHD8K,   // 7680 x 4320
+		CUSTOM   // An arbitrary resolution.
+	};
+	/**
+	 * An enumeration of the ways pixels can be laid out in the framebuffer's buffers.
+	 */
+	enum class Layout {
+		Linear, // Pixels are stored row by row.
+		Tiled   // Pixels are stored in blocks of BLOCK_SIZE x BLOCK_SIZE pixels, which are stored row by row.
+	};
+	/**
+	 * The width and height of a block of pixels in the tiled layout.
+	 */
+	static constexpr std::uint32_t BLOCK_SIZE = 8;
+	/**
+	 * The width and height of a tile, in pixels. Tiles are cleared and their depth
+	 * compressed as a whole.
+	 */
+	static constexpr std::uint32_t TILE_SIZE = 32;
+	/**
+	 * The number of elements the rows of the linear layout are aligned to. Since
+	 * the buffers' elements are at least a byte large, their rows start on a 64-byte
+	 * boundary whatever the element size.
+	 */
+	static constexpr std::uint32_t ROW_ALIGNMENT = 64;
+	/**
+	 * An enumeration of all available depth buffer formats.
+	 */
+	enum class DepthFormat {
+		Float32, // 32-bit floating-point depth and a separate 8-bit stencil buffer.
+		D24S8,   // 24-bit fixed-point depth and 8-bit stencil packed in a 32-bit word.
+		Unorm16  // 16-bit fixed-point depth and a separate 8-bit stencil buffer.
+	};
+	/**
+	 * An enumeration of all available formats of the output buffer. Shaders and image
+	 * filters work with 32-bit ARGB values, whose bytes are in BGRA order on little-endian
+	 * machines, so the BGRA8 format is output as is while other formats are encoded.
+	 */
+	enum class PixelFormat {
+		BGRA8,  // 8-bit blue, green, red and alpha channels, in that byte order.
+		RGBA8,  // 8-bit red, green, blue and alpha channels, in that byte order.
+		RGB565  // 5-bit red, 6-bit green and 5-bit blue channels packed in a 16-bit word.
+	};
+	/**
+	 * A plane that gives the window-space depth of each pixel in a compressed tile,
+	 * i.e. depth(x, y) = (a * x) + (b * y) + c.
+	 */
+	struct DepthPlane {
+		/**
+		 * The depth's rate of change along the x axis.
+		 */
+		float a;
+		/**
+		 * The depth's rate of change along the y axis.
+		 */
+		float b;
+		/**
+		 * The depth at the origin.
+		 */
+		float c;
 	};
 	/**
 	 * Instantiates a Framebuffer object with the specified resolution.
 	 * @param resolution the framebuffer's resolution.
 	 */
 	explicit Framebuffer(const Resolution resolution = Resolution::ZERO);
+	/**
+	 * Instantiates a Framebuffer object with an arbitrary resolution.
+	 * @param resolution the framebuffer's resolution.
+	 */
+	explicit Framebuffer(const QSize& resolution);
 	/**
 	 * Deleted copy constructor.
 	 */
@@ -93,23 +161,75 @@ public:
 	 * Returns the framebuffer's height.
 	 */
 	std::uint32_t getHeight() const;
+	/**
+	 * Returns the number of elements between the starts of two consecutive rows
+	 * of the resolved pixel buffer, and of the pixel buffer in the linear layout.
+	 */
+	std::uint32_t getPitch() const;
 	/**
 	 * Resizes the framebuffer to the specified resolution.
 	 * @param resolution the framebuffer's new resolution.
 	 */
 	void setResolution(const Resolution resolution);
 	/**
-	 * Returns the pixel buffer.
+	 * Resizes the framebuffer to an arbitrary resolution. If the resolution matches
+	 * a predefined one, the framebuffer's resolution identifier is set to it,
+	 * otherwise the identifier is set to Resolution::CUSTOM. The framebuffer's
+	 * storage is reused if it is large enough to hold the new resolution.
+	 * @param resolution the framebuffer's new resolution.
+	 */
+	void setResolution(const QSize& resolution);
+	/**
+	 * Returns the pixel buffer, whose elements are laid out in the framebuffer's
+	 * layout. Use getOffset to find the element of a given <x, y> coordinate.
 	 */
 	std::uint32_t* getPixelBuffer();
 	/**
-	 * Returns the pixel buffer.
+	 * Returns the pixel buffer, whose elements are laid out in the framebuffer's
+	 * layout. Use getOffset to find the element of a given <x, y> coordinate.
 	 */
 	const std::uint32_t* getPixelBuffer() const;
 	/**
-	 * Returns the pixel buffer as a QImage.
+	 * Returns the pixel buffer in the linear layout, which holds the rendered image
+	 * once the framebuffer is resolved. Its rows are getPitch() elements apart.
+	 */
+	std::uint32_t* getResolvedPixelBuffer();
+	/**
+	 * Returns the pixel buffer in the linear layout, which holds the rendered image
+	 * once the framebuffer is resolved. Its rows are getPitch() elements apart.
+	 */
+	const std::uint32_t* getResolvedPixelBuffer() const;
+	/**
+	 * Returns the output buffer, which holds the resolved pixel buffer's image in the
+	 * framebuffer's pixel format once the framebuffer is resolved. Its rows are
+	 * getPitch() pixels apart. In the BGRA8 format, the output buffer is the
+	 * resolved pixel buffer itself.
+	 */
+	const void* getOutputBuffer() const;
+	/**
+	 * Returns the output buffer as a QImage.
 	 */
 	const QImage& getPixelBufferImage() const;
+	/**
+	 * Returns the output buffer's pixel format.
+	 */
+	PixelFormat getPixelFormat() const;
+	/**
+	 * Sets the output buffer's pixel format. Note that changing the format reallocates
+	 * and clears the framebuffer's buffers.
+	 * @param format the pixel format to set.
+	 */
+	void setPixelFormat(const PixelFormat format);
+	/**
+	 * Returns the framebuffer's memory layout.
+	 */
+	Layout getLayout() const;
+	/**
+	 * Sets the framebuffer's memory layout. Note that changing the layout reallocates
+	 * and clears the framebuffer's buffers.
+	 * @param layout the memory layout to set.
+	 */
+	void setLayout(const Layout layout);
 	/**
 	 * Returns the pixel buffer's clear value.
 	 */
@@ -120,13 +240,22 @@ public:
 	 */
 	void setPixelBufferClearValue(const std::uint32_t value);
 	/**
-	 * Returns the depth buffer.
+	 * Returns the depth buffer's format.
+	 */
+	DepthFormat getDepthFormat() const;
+	/**
+	 * Sets the depth buffer's format. Note that changing the format reallocates
+	 * and clears the depth and stencil buffers.
+	 * @param format the depth format to set.
 	 */
-	double* getDepthBuffer();
+	void setDepthFormat(const DepthFormat format);
 	/**
-	 * Returns the depth buffer.
+	 * Sets the range of window-space depth values that are mapped to the fixed-point
+	 * depth formats. Depth values outside of this range are clamped.
+	 * @param near the depth value that maps to the smallest fixed-point value.
+	 * @param far the depth value that maps to the largest fixed-point value.
 	 */
-	const double* getDepthBuffer() const;
+	void setDepthRange(const double near, const double far);
 	/**
 	 * Returns the depth buffer's clear value.
 	 */
@@ -137,13 +266,53 @@ public:
 	 */
 	void setDepthBufferClearValue(const double value);
 	/**
-	 * Returns the stencil buffer.
+	 * Returns true if the specified depth value is nearer than the value stored at
+	 * the given <x, y> coordinate, false otherwise.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 * @param depth the window-space depth value to test.
+	 */
+	bool testDepth(const std::uint32_t x, const std::uint32_t y, const double depth) const;
+	/**
+	 * Tests four depth values against the values stored from <x, y> to <x + 3, y>.
+	 * The i-th bit of the returned mask is set if the i-th depth value passes the test.
+	 * Elements past the framebuffer's width always fail the test.
+	 * @param x the first buffer element's row position.
+	 * @param y the buffer elements' column position.
+	 * @param depth the four window-space depth values to test.
+	 */
+	std::uint32_t testDepth(const std::uint32_t x, const std::uint32_t y, const float* const depth) const;
+	/**
+	 * Writes a depth value at the specified <x, y> coordinate.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 * @param depth the window-space depth value to write.
+	 */
+	void setDepth(const std::uint32_t x, const std::uint32_t y, const double depth);
+	/**
+	 * Converts the depth buffer to window-space depth values and writes them to the
+	 * specified output buffer. Cleared depth values are converted to infinity.
+	 * @param output a buffer that can hold width x height elements.
+	 */
+	void readDepthBuffer(float* const output) const;
+	/**
+	 * Returns the stencil value at the specified <x, y> coordinate.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 */
+	std::uint8_t getStencil(const std::uint32_t x, const std::uint32_t y) const;
+	/**
+	 * Writes a stencil value at the specified <x, y> coordinate.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 * @param value the stencil value to write.
 	 */
-	std::uint8_t* getStencilBuffer();
+	void setStencil(const std::uint32_t x, const std::uint32_t y, const std::uint8_t value);
 	/**
-	 * Returns the stencil buffer.
+	 * Writes the stencil buffer to the specified output buffer.
+	 * @param output a buffer that can hold width x height elements.
 	 */
-	const std::uint8_t* getStencilBuffer() const;
+	void readStencilBuffer(std::uint8_t* const output) const;
 	/**
 	 * Returns the stencil buffer's clear value.
 	 */
@@ -154,15 +323,118 @@ public:
 	 */
 	void setStencilBufferClearValue(const std::uint8_t value);
 	/**
-	 * Clears the framebuffer.
+	 * Clears the framebuffer. If fast clears are enabled, the framebuffer's tiles
+	 * are only marked as cleared and are filled with the clear values when they're
+	 * first written to, or when the framebuffer is resolved.
 	 */
 	void clear();
+	/**
+	 * Returns true if fast clears are enabled, false otherwise.
+	 */
+	bool isFastClearEnabled() const;
+	/**
+	 * Enables or disables fast clears.
+	 * @param enable true to enable fast clears, false to disable them.
+	 */
+	void enableFastClear(const bool enable = true);
+	/**
+	 * Fills all cleared tiles with their clear values and, in the tiled layout,
+	 * copies the pixel buffer to the resolved pixel buffer. The resolved pixels are
+	 * then encoded into the output buffer. The framebuffer must be resolved before
+	 * the resolved pixel buffer or the output buffer is read.
+	 */
+	void resolve();
+	/**
+	 * Encodes the resolved pixel buffer into the output buffer. This only needs to
+	 * be called after the resolved pixel buffer is modified, e.g. by image filters,
+	 * since resolve encodes the pixels while they're still in cache.
+	 */
+	void encode();
+	/**
+	 * Returns a hash of the resolved pixel buffer's image, which only depends on the
+	 * image's resolution and colors. Rows of tiles are hashed in parallel and their
+	 * hashes are combined in order, so the result doesn't depend on the number of
+	 * threads. The hash is meant to compare frames rather than to be secure. The
+	 * framebuffer must be resolved before it is hashed.
+	 */
+	std::uint64_t getHash() const;
+	/**
+	 * Fills the tile that contains the <x, y> coordinate with its clear values if
+	 * it is cleared. A tile must be resolved before its pixels are written directly,
+	 * which also marks the framebuffer as needing to be resolved.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 */
+	void resolveTile(const std::uint32_t x, const std::uint32_t y);
+	/**
+	 * Returns true if depth compression is enabled, false otherwise.
+	 */
+	bool isDepthCompressionEnabled() const;
+	/**
+	 * Enables or disables depth compression. Disabling it decompresses all tiles.
+	 * @param enable true to enable depth compression, false to disable it.
+	 */
+	void enableDepthCompression(const bool enable = true);
+	/**
+	 * Replaces the depth of the tile that contains the <x, y> coordinate with the
+	 * specified plane if every pixel's depth value passes the depth test, and the
+	 * plane reproduces each of them exactly in the depth buffer's format. In that case
+	 * true is returned. Otherwise, or if depth compression is disabled or unsupported
+	 * by the depth format, the tile is left unchanged and false is returned. The tile
+	 * is stored as the plane until a pixel's depth is written individually, and reads
+	 * back exactly as if each depth value had been written with setDepth. Since a
+	 * compressed tile is resolved, its pixels' colors and stencil values must all be
+	 * written afterwards.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 * @param plane the plane to write.
+	 * @param depths the window-space depth values of the tile's pixels, row by row in
+	 * a TILE_SIZE x TILE_SIZE array, clipped to the framebuffer's bounds.
+	 */
+	bool setDepthPlane(const std::uint32_t x, const std::uint32_t y, const DepthPlane& plane, const float* const depths);
 	/**
 	 * Discards (clears) the framebuffer element at the specified <x, y> coordinate.
 	 * @param x the buffer element's row position.
 	 * @param y the buffer element's column position.
 	 */
 	void discard(const std::uint32_t x, const std::uint32_t y);
+	/**
+	 * Merges the specified layer into the framebuffer. Each of the layer's pixels
+	 * that is closer than the framebuffer's replaces the framebuffer's color, depth
+	 * and stencil values, so pixels with equal depths keep the framebuffer's values.
+	 * Tiles that are cleared in the layer are skipped. The layer must have the same
+	 * resolution, layout, depth format and depth range as the framebuffer.
+	 * @param layer the framebuffer to merge.
+	 */
+	void composite(const Framebuffer& layer);
+	/**
+	 * Returns true if the tile that contains the <x, y> coordinate has not been
+	 * written to since the framebuffer was last cleared, false otherwise.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 */
+	bool isTileCleared(const std::uint32_t x, const std::uint32_t y) const;
+	/**
+	 * Copies the colors and depth buffer elements of the tile that contains the <x, y>
+	 * coordinate to the specified buffers, row by row. The tile is clipped to the
+	 * framebuffer's bounds, and its depth buffer elements are widened to 32 bits.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 * @param pixels the buffer that receives the tile's colors.
+	 * @param depths the buffer that receives the tile's depth buffer elements.
+	 */
+	void readTile(const std::uint32_t x, const std::uint32_t y, std::uint32_t* const pixels, std::uint32_t* const depths) const;
+	/**
+	 * Replaces the colors and depth buffer elements of the tile that contains the
+	 * <x, y> coordinate with those in the specified buffers, which are laid out as
+	 * readTile writes them. The tile's stencil values are cleared, except in the D24S8
+	 * format where they are packed with the depth values.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 * @param pixels the tile's colors.
+	 * @param depths the tile's depth buffer elements.
+	 */
+	void writeTile(const std::uint32_t x, const std::uint32_t y, const std::uint32_t* pixels, const std::uint32_t* depths);
 	/**
 	 * Return the buffer offset for a given <x, y> coordinate. If the coordinate
 	 * is out of the range <[0, width), [0, height)>, where width and height are the
@@ -176,15 +448,184 @@ public:
 	 */
 	static QList<Resolution> getAvailableResolutions();
 	/**
-	 * Returns the resolution based on the specified identifier.
+	 * Returns the resolution based on the specified identifier. Resolution::CUSTOM
+	 * has no predefined resolution, so an invalid size is returned for it.
 	 * @param resolutionIdentifier the resolution identifier to query.
 	 */
 	static QSize getResolution(const Resolution resolutionIdentifier);
+	/**
+	 * Returns the identifier of the predefined resolution with the specified size,
+	 * or Resolution::CUSTOM if there is none.
+	 * @param resolution the resolution to query.
+	 */
+	static Resolution getResolutionIdentifier(const QSize& resolution);
+	/**
+	 * Returns the size, in bytes, of a pixel in the specified format.
+	 * @param format the pixel format to query.
+	 */
+	static std::size_t getPixelSize(const PixelFormat format);
+	/**
+	 * Returns the QImage format that matches the specified pixel format.
+	 * @param format the pixel format to query.
+	 */
+	static QImage::Format getImageFormat(const PixelFormat format);
 private:
+	friend class testsuite::TestFramebuffer;
 	/**
-	 * Resizes the framebuffer's attachments to the current resolution.
+	 * Resizes the framebuffer's attachments to the current resolution. Their storage
+	 * only grows, so shrinking the framebuffer reuses it.
 	 */
 	void resize();
+	/**
+	 * Resizes the depth and stencil buffers to the current resolution and depth format.
+	 * Returns true if either buffer's storage was reallocated, false otherwise.
+	 */
+	bool resizeDepthStencilBuffers();
+	/**
+	 * Encodes the specified rows of the resolved pixel buffer into the output buffer.
+	 * @param y0 the first row to encode.
+	 * @param y1 the row after the last row to encode.
+	 */
+	void encodeRows(const std::uint32_t y0, const std::uint32_t y1);
+	/**
+	 * Returns the width of the buffers, which the linear layout pads to its pitch,
+	 * and the tiled layout to a whole number of blocks.
+	 */
+	std::uint32_t getStorageWidth() const;
+	/**
+	 * Returns the height of the buffers, which the tiled layout pads to a whole
+	 * number of blocks.
+	 */
+	std::uint32_t getStorageHeight() const;
+	/**
+	 * Returns the number of elements in each buffer.
+	 */
+	std::size_t getStorageSize() const;
+	/**
+	 * Fills a rectangle of the pixel, depth and stencil buffers with the tiles' clear
+	 * values. In the tiled layout, the rectangle must be aligned to blocks.
+	 * @param x0 the rectangle's left edge.
+	 * @param y0 the rectangle's top edge.
+	 * @param x1 the rectangle's right edge, exclusive.
+	 * @param y1 the rectangle's bottom edge, exclusive.
+	 */
+	void fillRectangle(const std::uint32_t x0, const std::uint32_t y0, const std::uint32_t x1, const std::uint32_t y1);
+	/**
+	 * Fills a range of the depth and stencil buffers with the tiles' clear values.
+	 * @param offset the buffer offset of the range's first element.
+	 * @param length the number of elements in the range.
+	 */
+	void fillDepthStencilBuffers(const std::size_t offset, const std::size_t length);
+	/**
+	 * Returns the depth buffer element at the specified buffer offset.
+	 * @param offset the buffer offset to read.
+	 */
+	std::uint32_t getEncodedDepth(const std::size_t offset) const;
+	/**
+	 * Returns the specified plane's depth at the <x, y> coordinate in the depth
+	 * buffer's format.
+	 * @param plane the plane to evaluate.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 */
+	std::uint32_t getEncodedDepth(const DepthPlane& plane, const std::uint32_t x, const std::uint32_t y) const;
+	/**
+	 * Converts a window-space depth value into the depth buffer's format, without
+	 * the D24S8 format's stencil value.
+	 * @param depth the window-space depth value to convert.
+	 */
+	std::uint32_t encodeDepth(const double depth) const;
+	/**
+	 * Writes a value in the depth buffer's format to the depth buffer element at the
+	 * specified buffer offset. The D24S8 format's stencil value is left unchanged.
+	 * @param offset the buffer offset to write.
+	 * @param depth the value to write.
+	 */
+	void setEncodedDepth(const std::size_t offset, const std::uint32_t depth);
+	/**
+	 * Returns the number of tiles needed to cover the specified number of pixels.
+	 * @param length the number of pixels to cover.
+	 */
+	static std::uint32_t getTileCount(const std::uint32_t length);
+	/**
+	 * Returns the index of the tile that contains the <x, y> coordinate.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 */
+	std::size_t getTileIndex(const std::uint32_t x, const std::uint32_t y) const;
+	/**
+	 * Returns true if the depth of the tile that contains the <x, y> coordinate is
+	 * stored as a plane, false otherwise.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 */
+	bool isTileCompressed(const std::uint32_t x, const std::uint32_t y) const;
+	/**
+	 * Writes the depth plane of the tile that contains the <x, y> coordinate to the
+	 * depth buffer if the tile is compressed.
+	 * @param x the buffer element's row position.
+	 * @param y the buffer element's column position.
+	 */
+	void decompressTile(const std::uint32_t x, const std::uint32_t y);
+	/**
+	 * Merges the specified number of consecutive buffer elements of the layer, from
+	 * the specified offset, into the framebuffer.
+	 * @param layer the framebuffer to merge.
+	 * @param offset the offset of the first buffer element.
+	 * @param length the number of buffer elements.
+	 */
+	void compositeRun(const Framebuffer& layer, const std::size_t offset, const std::size_t length);
+	/**
+	 * Replaces the buffer element at the specified offset with the layer's if the
+	 * layer's depth is less than the framebuffer's.
+	 * @param layer the framebuffer to merge.
+	 * @param offset the buffer element's offset.
+	 * @param depth the layer's depth buffer element.
+	 */
+	void compositeElement(const Framebuffer& layer, const std::size_t offset, const std::uint32_t depth);
+	/**
+	 * Calls the specified function for each cleared tile, with the tile's left, top,
+	 * right and bottom edges as arguments. The right and bottom edges are exclusive
+	 * and don't extend past the framebuffer's resolution.
+	 * @param function the function to call.
+	 */
+	template<class Function> void forEachClearedTile(const Function& function) const;
+	/**
+	 * Calls the specified function for each row of tiles in parallel, with the row's
+	 * top and bottom edges as arguments. The bottom edge is exclusive and doesn't
+	 * extend past the buffers' storage. Since a row of tiles is contiguous in both
+	 * layouts, buffers that are first written to this way have their pages placed
+	 * on the NUMA nodes of the threads that processed them.
+	 * @param function the function to call.
+	 */
+	template<class Function> void forEachTileRow(const Function& function);
+	/**
+	 * Calls the specified function for each run of consecutive buffer elements that
+	 * are also consecutive in a linear image, with the run's buffer offset, its offset
+	 * in the linear image and its length as arguments.
+	 * @param stride the number of elements between two rows of the linear image.
+	 * @param function the function to call.
+	 */
+	template<class Function> void forEachRun(const std::uint32_t stride, const Function& function) const;
+	/**
+	 * Calls the specified function for each run in a row of blocks in the tiled layout.
+	 * @param row the row of blocks.
+	 * @param stride the number of elements between two rows of the linear image.
+	 * @param function the function to call.
+	 * @see forEachRun(const std::uint32_t, const Function&).
+	 */
+	template<class Function> void forEachRun(const std::size_t row, const std::uint32_t stride, const Function& function) const;
+	/**
+	 * Converts a window-space depth value into the depth buffer's fixed-point
+	 * representation, where the largest value is given by the specified maximum.
+	 * @param depth the window-space depth value to convert.
+	 * @param maximum the largest fixed-point value.
+	 */
+	std::uint32_t quantize(const double depth, const std::uint32_t maximum) const;
+	/**
+	 * Returns the depth buffer's clear value in the depth buffer's format.
+	 */
+	std::uint32_t getEncodedDepthBufferClearValue() const;
 	/**
 	 * The framebuffer's resolution identifier.
 	 */
@@ -196,9 +637,9 @@ private:
 	/**
 	 * The framebuffer's pixel buffer attachment.
 	 */
-	std::unique_ptr<std::uint32_t[]> pixelBuffer_;
+	AlignedBuffer<std::uint32_t> pixelBuffer_;
 	/**
-	 * The framebuffer's pixel buffer encapsulated in a QImage.
+	 * The framebuffer's output buffer encapsulated in a QImage.
 	 * Note that the QImage instance does not create a copy of the pixel buffer
 	 * but instead uses the pixel buffer as its own underlying data.
 	 * For more information, please refer to http://doc.qt.io/qt-5/qimage.html#QImage-5
@@ -209,21 +650,119 @@ private:
 	 */
 	std::uint32_t pixelBufferClearValue_;
 	/**
-	 * The framebuffer's depth buffer attachment.
+	 * The pixel buffer in the linear layout, which is only allocated in the tiled
+	 * layout. In the linear layout, the pixel buffer is its own resolved pixel buffer.
 	 */
-	std::unique_ptr<double[]> depthBuffer_;
+	AlignedBuffer<std::uint32_t> resolvedPixelBuffer_;
 	/**
-	 * The pixel buffer's clear value.
+	 * The output buffer's pixel format.
+	 */
+	PixelFormat pixelFormat_;
+	/**
+	 * The resolved pixel buffer encoded in the pixel format, which is only allocated
+	 * if the format isn't BGRA8.
+	 */
+	AlignedBuffer<std::uint8_t> outputBuffer_;
+	/**
+	 * The framebuffer's memory layout.
+	 */
+	Layout layout_;
+	/**
+	 * The number of elements between the starts of two consecutive rows in the
+	 * linear layout.
+	 */
+	std::uint32_t pitch_;
+	/**
+	 * The number of blocks in a row of blocks in the tiled layout.
+	 */
+	std::uint32_t blocksPerRow_;
+	/**
+	 * True if the framebuffer has been cleared or written to since it was last resolved.
+	 */
+	bool dirty_;
+	/**
+	 * The depth buffer's format.
+	 */
+	DepthFormat depthFormat_;
+	/**
+	 * The framebuffer's depth buffer attachment. Its elements are 32-bit floating-point
+	 * values, packed 24-bit depth and 8-bit stencil values, or 16-bit fixed-point
+	 * values, depending on the depth format.
+	 */
+	AlignedBuffer<std::uint8_t> depthBuffer_;
+	/**
+	 * The depth buffer's clear value.
 	 */
 	double depthBufferClearValue_;
 	/**
-	 * The framebuffer's stencil buffer attachment.
+	 * The smallest window-space depth value mapped to the fixed-point depth formats.
+	 */
+	float depthRangeNear_;
+	/**
+	 * The factor that maps window-space depth values relative to depthRangeNear_
+	 * to the range [0, 1].
+	 */
+	float depthRangeScale_;
+	/**
+	 * The framebuffer's stencil buffer attachment, which is only allocated when the
+	 * stencil values are not packed in the depth buffer.
 	 */
-	std::unique_ptr<std::uint8_t[]> stencilBuffer_;
+	AlignedBuffer<std::uint8_t> stencilBuffer_;
 	/**
 	 * The stencil buffer's clear value.
 	 */
 	std::uint8_t stencilBufferClearValue_;
+	/**
+	 * True if fast clears are enabled, false otherwise.
+	 */
+	bool fastClear_;
+	/**
+	 * The framebuffer's generation, which is incremented on each fast clear.
+	 */
+	std::uint32_t generation_;
+	/**
+	 * The number of tiles in a row of tiles.
+	 */
+	std::uint32_t tilesPerRow_;
+	/**
+	 * The generation at which each tile was last resolved. A tile whose generation
+	 * differs from the framebuffer's is cleared.
+	 */
+	AlignedBuffer<std::uint32_t> tileGenerations_;
+	/**
+	 * True if depth compression is enabled, false otherwise.
+	 */
+	bool depthCompression_;
+	/**
+	 * True for each tile whose depth is stored as a plane. A cleared tile is never
+	 * compressed, whatever its flag.
+	 */
+	AlignedBuffer<std::uint8_t> tileCompressed_;
+	/**
+	 * The depth plane of each compressed tile.
+	 */
+	AlignedBuffer<DepthPlane> tileDepthPlanes_;
+	/**
+	 * The values a cleared tile holds.
+	 */
+	struct ClearValues {
+		/**
+		 * The pixel buffer's clear value.
+		 */
+		std::uint32_t pixel;
+		/**
+		 * The depth buffer's clear value, in the depth buffer's format.
+		 */
+		std::uint32_t depth;
+		/**
+		 * The stencil buffer's clear value.
+		 */
+		std::uint8_t stencil;
+	};
+	/**
+	 * The tiles' clear values, captured when the framebuffer was last cleared.
+	 */
+	ClearValues tileClearValues_;
 signals:
 	/**
 	 * A signal that is raised when the framebuffer is resized.
@@ -243,6 +782,7 @@ DECLARE_ENUMERATOR_LIST(Framebuffer::Resolution, {
 	Framebuffer::Resolution::FHD,
 	Framebuffer::Resolution::QSXGA,
 	Framebuffer::Resolution::UHD8K,
+	Framebuffer::Resolution::CUSTOM,
 })
 /**
  * Returns the human-readable name of the specified framebuffer resolution.
@@ -267,6 +807,58 @@ enum_traits<Framebuffer::Resolution>::name(const Framebuffer::Resolution resolut
 			return "QSXGA (2560 x 2048)";
 		case Framebuffer::Resolution::UHD8K:
 			return "UHD8K (7680 x 4320)";
+		case Framebuffer::Resolution::CUSTOM:
+			return "CUSTOM";
+		default:
+			return "???";
+	}
+}
+/**
+ * Declares a list of all available depth buffer formats.
+ */
+DECLARE_ENUMERATOR_LIST(Framebuffer::DepthFormat, {
+	Framebuffer::DepthFormat::Float32,
+	Framebuffer::DepthFormat::D24S8,
+	Framebuffer::DepthFormat::Unorm16,
+})
+/**
+ * Returns the human-readable name of the specified depth buffer format.
+ * @param format the depth buffer format to query.
+ */
+template<> template<class String> String
+enum_traits<Framebuffer::DepthFormat>::name(const Framebuffer::DepthFormat format) {
+	switch (format) {
+		case Framebuffer::DepthFormat::Float32:
+			return "32-bit floating-point";
+		case Framebuffer::DepthFormat::D24S8:
+			return "24-bit depth, 8-bit stencil";
+		case Framebuffer::DepthFormat::Unorm16:
+			return "16-bit fixed-point";
+		default:
+			return "???";
+	}
+}
+/**
+ * Declares a list of all available pixel formats.
+ */
+DECLARE_ENUMERATOR_LIST(Framebuffer::PixelFormat, {
+	Framebuffer::PixelFormat::BGRA8,
+	Framebuffer::PixelFormat::RGBA8,
+	Framebuffer::PixelFormat::RGB565,
+})
+/**
+ * Returns the human-readable name of the specified pixel format.
+ * @param format the pixel format to query.
+ */
+template<> template<class String> String
+enum_traits<Framebuffer::PixelFormat>::name(const Framebuffer::PixelFormat format) {
+	switch (format) {
+		case Framebuffer::PixelFormat::BGRA8:
+			return "BGRA8";
+		case Framebuffer::PixelFormat::RGBA8:
+			return "RGBA8";
+		case Framebuffer::PixelFormat::RGB565:
+			return "RGB565";
 		default:
 			return "???";
 	}
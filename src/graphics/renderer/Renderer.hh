@@ -27,6 +27,8 @@
 
 #include "BaseRenderer.hh"
 #include "ShaderProgram.hh"
+#include <QRect>
+#include <vector>
 
 
 namespace clockwork {
@@ -115,6 +117,9 @@ public:
 	static_assert(std::is_base_of<BaseFragment, Fragment>::value);
 	/**
 	 * Renders the specified mesh in the given context to the the specified framebuffer.
+	 * The mesh's faces are transformed and assembled into primitives in parallel, in
+	 * fixed-size chunks that each write to their own slice of a post-transform buffer,
+	 * then rasterized in their original order so that the output is deterministic.
 	 * @param context the rendering context.
 	 * @param mesh the polygon mesh to render.
 	 * @param framebuffer the framebuffer where the mesh is rendered to.
@@ -122,7 +127,8 @@ public:
 	static void draw(const RenderingContext& context, const Mesh& mesh, Framebuffer& framebuffer);
 private:
 	/**
-	 *
+	 * Applies the vertex shader to each vertex of the specified face. This function is
+	 * reentrant, so the faces of a mesh are processed in parallel.
 	 */
 	static VertexArray vertexProcessing(const RenderingContext& context, const Mesh::Face& face);
 	/**
@@ -215,6 +221,28 @@ private:
 		VertexArray& vertices,
 		Framebuffer& framebuffer
 	);
+	/**
+	 * Writes the depth plane of the specified triangle to each framebuffer tile that
+	 * the triangle covers entirely, whose depth values are all farther than the
+	 * triangle's, and where the plane reproduces the rasterized depth values exactly.
+	 * The vertices are ordered as in rasterizeTrianglePrimitives, i.e. a and
+	 * c lie on the triangle's horizontal edge and b is its apex. The rectangle of tiles
+	 * that may have been written to is returned, and the specified mask is set to one
+	 * for each tile that was, in row-major order. Triangles that are too small to cover
+	 * a tile return an empty rectangle.
+	 * @param a the first vertex of the triangle's horizontal edge.
+	 * @param b the triangle's apex.
+	 * @param c the second vertex of the triangle's horizontal edge.
+	 * @param framebuffer the framebuffer where the depth planes are written to.
+	 * @param mask the tiles whose depth planes were written.
+	 */
+	static QRect writeDepthPlanes(
+		const Vertex& a,
+		const Vertex& b,
+		const Vertex& c,
+		Framebuffer& framebuffer,
+		std::vector<std::uint8_t>& mask
+	);
 	/**
 	 * Draws a line from one fragment to another.
 	 * Note that this approach will use the Bresenham algorithm.
@@ -242,9 +270,16 @@ private:
 		Framebuffer& framebuffer
 	);
 	/**
-	 *
+	 * Writes the specified fragment to the framebuffer if it passes all tests. If the
+	 * fragment's depth was already written, e.g. as part of a tile's depth plane, its
+	 * depth is neither tested nor written again.
 	 */
-	static void fragmentProcessing(const RenderingContext&, const Fragment&, Framebuffer&);
+	static void fragmentProcessing(
+		const RenderingContext& context,
+		const Fragment& fragment,
+		Framebuffer& framebuffer,
+		const bool depthWritten = false
+	);
 };
 } // namespace clockwork
 
@@ -27,6 +27,9 @@
 
 #include "RenderingContext.hh"
 #include "Framebuffer.hh"
+#include "parallelFor.hh"
+#include <algorithm>
+#include <array>
 
 
 namespace clockwork {
@@ -70,19 +73,34 @@ Renderer<I>::draw(const RenderingContext& context, const Mesh& mesh, Framebuffer
 	if (mesh.faces.isEmpty()) {
 		return;
 	}
-	for (const auto& face : mesh.faces) {
-		VertexArray vertices = vertexProcessing(context, face);
-
-		vertexPostProcessing(context, vertices);
-		primitiveAssembly(context, vertices);
-		rasterization(context, vertices, framebuffer);
+	const auto faceCount = static_cast<std::size_t>(mesh.faces.size());
+	std::vector<VertexArray> primitives(std::min(faceCount, FACE_BATCH_SIZE));
+
+	for (std::size_t first = 0; first < faceCount; first += FACE_BATCH_SIZE) {
+		const auto batchSize = std::min(FACE_BATCH_SIZE, faceCount - first);
+		const auto chunkCount = (batchSize + FACE_CHUNK_SIZE - 1) / FACE_CHUNK_SIZE;
+
+		parallelFor(chunkCount, [&context, &mesh, &primitives, first, batchSize](const std::size_t chunk) {
+			const auto begin = chunk * FACE_CHUNK_SIZE;
+			const auto end = std::min(begin + FACE_CHUNK_SIZE, batchSize);
+			for (auto i = begin; i < end; ++i) {
+				auto& vertices = primitives[i];
+				vertices = vertexProcessing(context, mesh.faces.at(static_cast<int>(first + i)));
+
+				vertexPostProcessing(context, vertices);
+				primitiveAssembly(context, vertices);
+			}
+		});
+		for (std::size_t i = 0; i < batchSize; ++i) {
+			rasterization(context, primitives[i], framebuffer);
+		}
 	}
 }
 
 
 template<ShaderProgramIdentifier I> typename Renderer<I>::VertexArray
 Renderer<I>::vertexProcessing(const RenderingContext& context, const Mesh::Face& face) {
-	static VertexAttributes attributes;
+	VertexAttributes attributes;
 	VertexArray vertices;
 	for (std::size_t i = 0; i < face.length; ++i) {
 		ShaderProgram::setVertexAttributes(attributes, face, i);
@@ -396,7 +414,10 @@ Renderer<I>::rasterizeTrianglePrimitives(
 			drawLine(context, c, a, framebuffer);
 		}
 	} else {
+		std::vector<std::uint8_t> planarTileMask;
 		for (auto it = vertices.begin(); it != vertices.end(); it += 3) {
+			ShaderProgram::setupTriangle(it[0], it[1], it[2]);
+
 			const auto* a = &it[1];
 			const auto* b = &it[0];
 			const auto* c = &it[2];
@@ -416,8 +437,26 @@ Renderer<I>::rasterizeTrianglePrimitives(
 			if (ymax < ymin) {
 				std::swap(ymin, ymax);
 			}
+			// The depth of tiles covered entirely by the triangle is written once as a
+			// plane, so their fragments are neither depth-tested nor written individually.
+			// Planes are only written when neither the scissor nor the stencil test may discard fragments.
+			QRect planarTiles;
+			if (context.enableDepthTest && !context.enableScissorTest && !context.enableStencilTest && framebuffer.isDepthCompressionEnabled()) {
+				planarTiles = writeDepthPlanes(*a, *b, *c, framebuffer, planarTileMask);
+			}
+			const auto& isPlanar = [&planarTiles, &planarTileMask](const int x, const int y) {
+				if (planarTiles.isEmpty() || x < 0 || y < 0) {
+					return false;
+				}
+				const int tx = x / static_cast<int>(Framebuffer::TILE_SIZE);
+				const int ty = y / static_cast<int>(Framebuffer::TILE_SIZE);
+				return planarTiles.contains(tx, ty) &&
+					planarTileMask[((ty - planarTiles.top()) * planarTiles.width()) + tx - planarTiles.left()] != 0;
+			};
 			for (int y = ymin; y <= ymax; ++y) {
-				const qreal p = (y - ay) / static_cast<qreal>(dy);
+				// A triangle whose height rounds to zero covers a single row, which spans
+				// its 'a' and 'c' vertices.
+				const qreal p = dy == 0 ? 0.0 : (y - ay) / static_cast<qreal>(dy);
 				const Vertex from(Vertex::lerp(*a, *b, p));
 				const Vertex to(Vertex::lerp(*c, *b, p));
 
@@ -429,19 +468,41 @@ Renderer<I>::rasterizeTrianglePrimitives(
 				// considered identical so there's no need to interpolate any
 				// new vertices between them.
 				if (dx == 0) {
-					fragmentProcessing(context, Fragment(from), framebuffer);
+					fragmentProcessing(context, Fragment(from), framebuffer, isPlanar(Fx, y));
 				} else {
 					int xmin = Fx;
 					int xmax = Tx;
 					if (xmax < xmin) {
 						std::swap(xmin, xmax);
 					}
+					// Depth values are tested four fragments at a time so that fragments
+					// hidden by previously drawn geometry are neither interpolated nor shaded.
+					// Fragments that pass this early test are tested again before they're written.
+					std::uint32_t visible = ~0u;
 					for (int x = xmin; x <= xmax; ++x) {
+						const int i = (x - xmin) % 4;
+						if (context.enableDepthTest && i == 0) {
+							visible = ~0u;
+							if (framebuffer.getOffset(x, y) >= 0 && x + 3 <= xmax && framebuffer.getOffset(x + 3, y) >= 0) {
+								// The depths are interpolated exactly as the fragments' depths are,
+								// so that a fragment is never culled by the value it would write.
+								float z[4];
+								for (int k = 0; k < 4; ++k) {
+									const qreal p = (x + k - Fx) / static_cast<qreal>(dx);
+									z[k] = ShaderProgram::Vertex::lerp(from, to, p).position.z();
+								}
+								visible = framebuffer.testDepth(x, y, z);
+							}
+						}
+						const bool planar = isPlanar(x, y);
+						if (!planar && (visible & (1u << i)) == 0) {
+							continue;
+						}
 						const qreal p = (x - Fx) / static_cast<qreal>(dx);
 						Fragment fragment(Vertex::lerp(from, to, p));
 						fragment.x = x;
 						fragment.y = y;
-						fragmentProcessing(context, fragment, framebuffer);
+						fragmentProcessing(context, fragment, framebuffer, planar);
 					}
 				}
 			}
@@ -450,6 +511,91 @@ Renderer<I>::rasterizeTrianglePrimitives(
 }
 
 
+template<ShaderProgramIdentifier I> QRect
+Renderer<I>::writeDepthPlanes(
+	const Vertex& a,
+	const Vertex& b,
+	const Vertex& c,
+	Framebuffer& framebuffer,
+	std::vector<std::uint8_t>& mask
+) {
+	constexpr int T = Framebuffer::TILE_SIZE;
+	const int w = framebuffer.getWidth();
+	const int h = framebuffer.getHeight();
+	const int ay = qRound(a.position.y());
+	const int by = qRound(b.position.y());
+	const int dy = by - ay;
+	const int ymin = std::max(std::min(ay, by), 0);
+	const int ymax = std::min(std::max(ay, by), h - 1);
+
+	// A tile row is covered if all of its rows are, and the bottom tile row may be
+	// cut short by the framebuffer's height.
+	const int top = (ymin + T - 1) / T;
+	int bottom = top;
+	while (bottom * T < h && std::min((bottom + 1) * T, h) - 1 <= ymax) {
+		++bottom;
+	}
+	if (bottom == top || dy == 0) {
+		return QRect();
+	}
+	// The plane that passes through the triangle's window-space positions.
+	const QVector3D A(a.position.toVector3D());
+	const QVector3D normal(QVector3D::crossProduct(b.position.toVector3D() - A, c.position.toVector3D() - A));
+	if (qFuzzyIsNull(normal.z())) {
+		return QRect();
+	}
+	const Framebuffer::DepthPlane plane{
+		-normal.x() / normal.z(),
+		-normal.y() / normal.z(),
+		A.z() + (((normal.x() * A.x()) + (normal.y() * A.y())) / normal.z())
+	};
+	const int columns = (w + T - 1) / T;
+	const QRect tiles(0, top, columns, bottom - top);
+	mask.assign(tiles.width() * tiles.height(), 0);
+
+	// The spans' endpoints and the depth values of a tile's pixels, which are computed
+	// exactly as rasterizeTrianglePrimitives does so that the framebuffer only stores
+	// the plane if it reproduces them.
+	std::array<QVector4D, T> from;
+	std::array<QVector4D, T> to;
+	std::array<int, T> Fx;
+	std::array<int, T> Tx;
+	std::array<float, T * T> depths;
+	for (int ty = top; ty < bottom; ++ty) {
+		// The intersection of the tile row's spans.
+		const int y0 = ty * T;
+		const int y1 = std::min(y0 + T, h);
+		int left = std::numeric_limits<int>::min();
+		int right = std::numeric_limits<int>::max();
+		for (int y = y0; y < y1; ++y) {
+			const qreal p = (y - ay) / static_cast<qreal>(dy);
+			const int j = y - y0;
+			from[j] = clockwork::lerp(a.position, b.position, p);
+			to[j] = clockwork::lerp(c.position, b.position, p);
+			Fx[j] = qRound(from[j].x());
+			Tx[j] = qRound(to[j].x());
+			left = std::max(left, std::min(Fx[j], Tx[j]));
+			right = std::min(right, std::max(Fx[j], Tx[j]));
+		}
+		for (int tx = std::max(left + T - 1, 0) / T; tx < columns && std::min((tx + 1) * T, w) - 1 <= right; ++tx) {
+			const int x0 = tx * T;
+			const int x1 = std::min(x0 + T, w);
+			for (int j = 0; j < y1 - y0; ++j) {
+				const int dx = Tx[j] - Fx[j];
+				for (int x = x0; x < x1; ++x) {
+					const qreal p = (x - Fx[j]) / static_cast<qreal>(dx);
+					depths[(j * T) + (x - x0)] = dx == 0 ? from[j].z() : clockwork::lerp(from[j], to[j], p).z();
+				}
+			}
+			if (framebuffer.setDepthPlane(x0, y0, plane, depths.data())) {
+				mask[((ty - top) * columns) + tx] = 1;
+			}
+		}
+	}
+	return tiles;
+}
+
+
 template<ShaderProgramIdentifier I> void
 Renderer<I>::drawLine(
 	const RenderingContext& context,
@@ -515,17 +661,19 @@ template<ShaderProgramIdentifier I> void
 Renderer<I>::fragmentProcessing(
 	const RenderingContext& context,
 	const Fragment& fragment,
-	Framebuffer& framebuffer
+	Framebuffer& framebuffer,
+	const bool depthWritten
 ) {
 	auto* const pbuffer = framebuffer.getPixelBuffer();
-	auto* const zbuffer = framebuffer.getDepthBuffer();
-	auto* const sbuffer = framebuffer.getStencilBuffer();
 
-	const int offset = fragmentPasses(context, fragment);
+	const int offset = fragmentPasses(context, fragment, depthWritten);
 	if (offset >= 0) {
+		framebuffer.resolveTile(fragment.x, fragment.y);
 		pbuffer[offset] = ShaderProgram::fragmentShader(context.uniforms, fragment.varying, fragment);
-		zbuffer[offset] = fragment.z;
-		sbuffer[offset] = 0xFF;
+		if (!depthWritten) {
+			framebuffer.setDepth(fragment.x, fragment.y, fragment.z);
+		}
+		framebuffer.setStencil(fragment.x, fragment.y, 0xFF);
 	}
 }
 } // namespace clockwork
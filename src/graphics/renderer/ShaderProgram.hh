@@ -90,6 +90,11 @@ public:
 	 * Performs a basic per-vertex operation on the specified set of vertex attributes.
 	 */
 	static Vertex vertexShader(const Uniforms&, Varying&, const VertexAttributes&);
+	/**
+	 * Computes the values that are constant across a triangle, such as the screen-space
+	 * derivatives of a vertex attribute, and stores them in the triangle's vertices.
+	 */
+	static void setupTriangle(Vertex&, Vertex&, Vertex&);
 	/**
 	 * Returns a pixel value.
 	 */
@@ -88,6 +88,10 @@ ShaderProgram<I>::vertexShader(const Uniforms& uniforms, Varying&, const VertexA
 }
 
 
+template<ShaderProgramIdentifier I> void
+ShaderProgram<I>::setupTriangle(Vertex&, Vertex&, Vertex&) {}
+
+
 template<ShaderProgramIdentifier I> std::uint32_t
 ShaderProgram<I>::fragmentShader(const Uniforms&, const Varying&, const Fragment&) {
 	return 0xFFFFFFFF;
@@ -0,0 +1,70 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "SwapChain.hh"
+#include <cstring>
+
+using clockwork::SwapChain;
+
+
+constexpr std::uint8_t SwapChain::INDEX_MASK;
+constexpr std::uint8_t SwapChain::FRESH;
+
+
+SwapChain::SwapChain(const bool copyStencil) :
+copyStencil_(copyStencil),
+back_(0),
+front_(1),
+state_(2) {}
+
+
+void
+SwapChain::present(const Framebuffer& framebuffer) {
+	auto& frame = frames_[back_];
+	const auto pixelFormat = framebuffer.getPixelFormat();
+	const std::size_t size = framebuffer.getPitch() * framebuffer.getHeight() * Framebuffer::getPixelSize(pixelFormat);
+
+	frame.pixels.reserve(size);
+	std::memcpy(frame.pixels.get(), framebuffer.getOutputBuffer(), size);
+	frame.size = framebuffer.getResolution();
+	frame.pitch = framebuffer.getPitch();
+	frame.pixelFormat = pixelFormat;
+	if (copyStencil_) {
+		frame.stencil.reserve(static_cast<std::size_t>(framebuffer.getWidth()) * framebuffer.getHeight());
+		framebuffer.readStencilBuffer(frame.stencil.get());
+	}
+
+	// The release half publishes the frame's contents to the consumer, while the
+	// acquire half ensures the consumer is done reading the frame that is returned.
+	back_ = state_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+
+const SwapChain::Frame&
+SwapChain::acquire() {
+	if ((state_.load(std::memory_order_relaxed) & FRESH) != 0) {
+		front_ = state_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+	return frames_[front_];
+}
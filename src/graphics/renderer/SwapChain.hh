@@ -0,0 +1,121 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_SWAP_CHAIN_HH
+#define CLOCKWORK_SWAP_CHAIN_HH
+
+#include "Framebuffer.hh"
+#include <array>
+#include <atomic>
+
+
+namespace clockwork {
+/**
+ * A triple buffer of completed frames that hands frames from the renderer to the
+ * user interface without locks. The renderer presents each frame it completes,
+ * while the user interface acquires the most recently presented frame. The two
+ * never access the same frame, so a frame can't be torn by the next one and both
+ * sides may run concurrently. A swap chain has exactly one producer and one consumer.
+ */
+class SwapChain {
+public:
+	/**
+	 * A completed frame's pixels, in the framebuffer's output format.
+	 */
+	struct Frame {
+		/**
+		 * The frame's pixels, whose rows are padded to the frame's pitch.
+		 */
+		AlignedBuffer<std::uint8_t> pixels;
+		/**
+		 * The frame's resolution. An invalid size denotes a frame that was never presented.
+		 */
+		QSize size;
+		/**
+		 * The number of pixels between two rows of the frame.
+		 */
+		std::uint32_t pitch = 0;
+		/**
+		 * The frame's pixel format.
+		 */
+		Framebuffer::PixelFormat pixelFormat = Framebuffer::PixelFormat::BGRA8;
+		/**
+		 * The frame's stencil values, row by row without padding, if the swap chain
+		 * copies them.
+		 */
+		AlignedBuffer<std::uint8_t> stencil;
+	};
+	/**
+	 * Instantiates a SwapChain object.
+	 * @param copyStencil true if presented frames include the framebuffer's stencil values.
+	 */
+	explicit SwapChain(const bool copyStencil = false);
+	/**
+	 * Copies the specified framebuffer's resolved output to the frame that is being
+	 * written, and publishes it as the most recently completed frame. This may only
+	 * be called by the producer.
+	 * @param framebuffer the framebuffer to present.
+	 */
+	void present(const Framebuffer& framebuffer);
+	/**
+	 * Returns the most recently completed frame. The frame remains valid and unchanged
+	 * until the next call to acquire. This may only be called by the consumer.
+	 */
+	const Frame& acquire();
+private:
+	/**
+	 * The bits of the shared state that hold the index of the frame that was most
+	 * recently published.
+	 */
+	static constexpr std::uint8_t INDEX_MASK = 0x3;
+	/**
+	 * The bit of the shared state that is set when the published frame hasn't been
+	 * acquired yet.
+	 */
+	static constexpr std::uint8_t FRESH = 0x4;
+	/**
+	 * True if presented frames include the framebuffer's stencil values, false otherwise.
+	 */
+	const bool copyStencil_;
+	/**
+	 * The frames.
+	 */
+	std::array<Frame, 3> frames_;
+	/**
+	 * The index of the frame that is written by the producer.
+	 */
+	std::uint8_t back_;
+	/**
+	 * The index of the frame that is read by the consumer.
+	 */
+	std::uint8_t front_;
+	/**
+	 * The index of the frame that was most recently published, and whether it is
+	 * fresh. The producer and consumer exchange their frames with this one.
+	 */
+	std::atomic<std::uint8_t> state_;
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_SWAP_CHAIN_HH
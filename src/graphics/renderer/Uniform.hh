@@ -33,6 +33,14 @@
 
 
 namespace clockwork {
+/**
+ * @see graphics/Texture.hh.
+ */
+class Texture;
+/**
+ * @see graphics/filter/TextureFilter.hh.
+ */
+class TextureFilter;
 namespace {
 /**
  * Checks whether T is a valid Uniform value type.
@@ -44,6 +52,8 @@ std::integral_constant<bool,
 	std::is_base_of<QVector3D, T>::value ||
 	std::is_base_of<QMatrix2x3, T>::value ||
 	std::is_base_of<QMatrix4x4, T>::value ||
+	std::is_base_of<Texture, T>::value ||
+	std::is_base_of<TextureFilter, T>::value ||
 	std::is_arithmetic<T>::value> {};
 } // namespace
 /**
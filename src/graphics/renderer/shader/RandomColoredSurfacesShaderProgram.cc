@@ -23,6 +23,7 @@
  * THE SOFTWARE.
  */
 #include "RandomColoredSurfacesShaderProgram.hh"
+#include <cstring>
 
 using clockwork::ShaderProgramIdentifier;
 using ShaderProgram = clockwork::detail::ShaderProgram<ShaderProgramIdentifier::RandomColoredSurfaces>;
@@ -46,7 +47,18 @@ ShaderProgram::setVertexAttributes(VertexAttributes& attributes, const Mesh::Fac
 		return;
 	}
 	attributes.position = face.positions[i];
-	attributes.faceAddress = static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&face));
+
+	// The face's coordinates are hashed with 32-bit FNV-1a.
+	std::uint32_t hash = 0x811c9dc5;
+	for (std::size_t j = 0; j < face.length; ++j) {
+		const QVector3D& position = *face.positions[j];
+		for (const float coordinate : {position.x(), position.y(), position.z()}) {
+			std::uint32_t bits;
+			std::memcpy(&bits, &coordinate, sizeof(bits));
+			hash = (hash ^ bits) * 0x01000193;
+		}
+	}
+	attributes.faceHash = hash;
 }
 
 
@@ -58,9 +70,9 @@ ShaderProgram::vertexShader(const Uniforms& uniforms, Varying& varying, const Ve
 	Vertex output;
 	output.position = MVP * position;
 
-	// Note that 0xFF000000 is OR'd to the address to make sure the generated color's
+	// Note that 0xFF000000 is OR'd to the hash to make sure the generated color's
 	// alpha channel is equal to 1.0.
-	varying.faceColor = Color(attributes.faceAddress | 0xFF000000);
+	varying.faceColor = Color(attributes.faceHash | 0xFF000000);
 
 	return output;
 }
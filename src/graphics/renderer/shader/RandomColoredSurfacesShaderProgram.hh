@@ -50,11 +50,12 @@ struct ShaderProgram<ShaderProgramIdentifier::RandomColoredSurfaces>::Varying {
 template<>
 struct ShaderProgram<ShaderProgramIdentifier::RandomColoredSurfaces>::VertexAttributes : BaseVertexAttributes {
 	/**
-	 * The address of the face that the vertex belongs to. The memory address
-	 * is sufficiently random and can be converted into a 32-bit ARGB color
-	 * value that can in turn be transformed into a Color object.
+	 * A hash of the positions of the face that the vertex belongs to. The hash is
+	 * sufficiently random and can be converted into a 32-bit ARGB color value that
+	 * can in turn be transformed into a Color object. Unlike the face's address, it
+	 * is the same in every run and in every process that loads the mesh.
 	 */
-	std::uint32_t faceAddress;
+	std::uint32_t faceHash;
 };
 /**
  * Initializes the vertex attributes used by the vertex shader.
@@ -23,3 +23,104 @@
  * THE SOFTWARE.
  */
 #include "TextureMapShaderProgram.hh"
+#include "TextureFilter.hh"
+
+using clockwork::ShaderProgramIdentifier;
+using ShaderProgram = clockwork::detail::ShaderProgram<ShaderProgramIdentifier::TextureMaps>;
+
+
+ShaderProgram::Vertex
+ShaderProgram::Vertex::lerp(const Vertex& from, const Vertex& to, const double p) {
+	Vertex vertex;
+	vertex.position = clockwork::lerp(from.position, to.position, p);
+	vertex.uv = clockwork::lerp(from.uv, to.uv, p);
+	vertex.duvdx = from.duvdx;
+	vertex.duvdy = from.duvdy;
+	return vertex;
+}
+
+
+ShaderProgram::Fragment::Fragment(const Vertex& vertex) {
+	x = std::round(vertex.position.x());
+	y = std::round(vertex.position.y());
+	z = vertex.position.z();
+	uv = vertex.uv;
+	duvdx = vertex.duvdx;
+	duvdy = vertex.duvdy;
+}
+
+
+ShaderProgram::Fragment
+ShaderProgram::Fragment::lerp(const Fragment& from, const Fragment& to, const double p) {
+	Fragment fragment;
+//	fragment.x = 0;	// <x, y> are ignored because they are always set to some other value after
+//	fragment.y = 0;	// interpolation. For more info, please refer to any renderer's rasterize function.
+	fragment.z = ((1.0 - p) * from.z) + (p * to.z);
+	fragment.uv = clockwork::lerp(from.uv, to.uv, p);
+	fragment.duvdx = from.duvdx;
+	fragment.duvdy = from.duvdy;
+	return fragment;
+}
+
+
+template<> void
+ShaderProgram::setVertexAttributes(VertexAttributes& attributes, const Mesh::Face& face, const std::size_t i) {
+	if (Q_UNLIKELY(i >= face.length)) {
+		return;
+	}
+	attributes.position = face.positions[i];
+	attributes.textureCoordinates = face.textureCoordinates[i];
+}
+
+
+template<> ShaderProgram::Vertex
+ShaderProgram::vertexShader(const Uniforms& uniforms, Varying&, const VertexAttributes& attributes) {
+	const auto& MVP = uniforms["MODELVIEWPROJECTION"].as<const QMatrix4x4>();
+	const auto& position = QVector4D(*attributes.position, 1.0);
+
+	Vertex output;
+	output.position = MVP * position;
+	if (attributes.textureCoordinates != nullptr) {
+		output.uv = *attributes.textureCoordinates;
+	}
+
+	return output;
+}
+
+
+template<> void
+ShaderProgram::setupTriangle(Vertex& a, Vertex& b, Vertex& c) {
+	// The texture coordinates are interpolated linearly in screen space, so their
+	// derivatives are the same everywhere on the triangle. They are found by solving
+	// uv(x, y) = uv(a) + (x - ax) * duvdx + (y - ay) * duvdy for the other two vertices.
+	const double x1 = b.position.x() - a.position.x();
+	const double y1 = b.position.y() - a.position.y();
+	const double x2 = c.position.x() - a.position.x();
+	const double y2 = c.position.y() - a.position.y();
+	const double area = (x1 * y2) - (x2 * y1);
+
+	QPointF duvdx;
+	QPointF duvdy;
+	if (!qFuzzyIsNull(area)) {
+		const QPointF uv1 = b.uv - a.uv;
+		const QPointF uv2 = c.uv - a.uv;
+		duvdx = ((uv1 * y2) - (uv2 * y1)) / area;
+		duvdy = ((uv2 * x1) - (uv1 * x2)) / area;
+	}
+	a.duvdx = b.duvdx = c.duvdx = duvdx;
+	a.duvdy = b.duvdy = c.duvdy = duvdy;
+}
+
+
+template<> std::uint32_t
+ShaderProgram::fragmentShader(const Uniforms& uniforms, const Varying&, const Fragment& fragment) {
+	const auto& texture = uniforms["DIFFUSE_MAP"];
+	const auto& filter = uniforms["TEXTURE_FILTER"];
+	if (texture.isValid() && filter.isValid()) {
+		const auto& map = texture.as<const Texture>();
+		if (!map.isEmpty()) {
+			return filter.as<const TextureFilter>().sample(map, fragment.uv, fragment.duvdx, fragment.duvdy);
+		}
+	}
+	return 0xFFFFFFFF;
+}
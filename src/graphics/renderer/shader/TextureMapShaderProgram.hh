@@ -27,4 +27,84 @@
 
 #include "ShaderProgram.hh"
 
+
+namespace clockwork {
+namespace detail {
+/**
+ *
+ */
+template<>
+struct ShaderProgram<ShaderProgramIdentifier::TextureMaps>::Vertex : BaseVertex {
+	/**
+	 * Performs a linear interpolation to find the Vertex at a specified
+	 * percentage between two Vertex instances.
+	 */
+	static Vertex lerp(const Vertex& from, const Vertex& to, const double percentage);
+	/**
+	 * The vertex's texture coordinates.
+	 */
+	QPointF uv;
+	/**
+	 * The rate of change of the texture coordinates along the screen's x-axis.
+	 */
+	QPointF duvdx;
+	/**
+	 * The rate of change of the texture coordinates along the screen's y-axis.
+	 */
+	QPointF duvdy;
+};
+/**
+ *
+ */
+template<>
+struct ShaderProgram<ShaderProgramIdentifier::TextureMaps>::Fragment : BaseFragment {
+	/**
+	 * Instantiates a Fragment object.
+	 */
+	Fragment() = default;
+	/**
+	 *
+	 */
+	explicit Fragment(const Vertex&);
+	/**
+	 * Performs a linear interpolation to find the Fragment at a specified
+	 * percentage between two Fragment instances.
+	 */
+	static Fragment lerp(const Fragment& from, const Fragment& to, const double percentage);
+	/**
+	 * The fragment's texture coordinates.
+	 */
+	QPointF uv;
+	/**
+	 * The rate of change of the texture coordinates along the screen's x-axis.
+	 */
+	QPointF duvdx;
+	/**
+	 * The rate of change of the texture coordinates along the screen's y-axis.
+	 */
+	QPointF duvdy;
+};
+/**
+ * Initializes the vertex attributes used by the vertex shader.
+ */
+template<> void
+ShaderProgram<ShaderProgramIdentifier::TextureMaps>::setVertexAttributes(VertexAttributes&, const Mesh::Face&, const std::size_t);
+/**
+ * The vertex shader used by the texture mapping renderer.
+ */
+template<> ShaderProgram<ShaderProgramIdentifier::TextureMaps>::Vertex
+ShaderProgram<ShaderProgramIdentifier::TextureMaps>::vertexShader(const Uniforms&, Varying&, const VertexAttributes&);
+/**
+ * Computes the screen-space derivatives of the texture coordinates across a triangle.
+ */
+template<> void
+ShaderProgram<ShaderProgramIdentifier::TextureMaps>::setupTriangle(Vertex&, Vertex&, Vertex&);
+/**
+ * The fragment shader used by the texture mapping renderer.
+ */
+template<> std::uint32_t
+ShaderProgram<ShaderProgramIdentifier::TextureMaps>::fragmentShader(const Uniforms&, const Varying&, const Fragment&);
+} // namespace detail
+} // namespace clockwork
+
 #endif // CLOCKWORK_TEXTURE_MAP_SHADER_PROGRAM_HH
@@ -44,7 +44,7 @@ textureFilterIdentifier_(TextureFilter::Identifier::Bilinear) {
 
 	connect(this, &SceneObject::positionChanged, markViewTransformDirty);
 	connect(this, &SceneObject::rotationChanged, markViewTransformDirty);
-	connect(&Service::Graphics.getFramebuffer(), &Framebuffer::resized, markViewportTransformDirty);
+	connect(&Service::Graphics, &GraphicsSubsystem::framebufferResolutionChanged, markViewportTransformDirty);
 }
 
 
@@ -233,7 +233,7 @@ SceneViewer::updateViewportTransform() {
 	if (isViewportTransformDirty_) {
 		isViewportTransformDirty_ = false;
 
-		const QSize& resolution = Service::Graphics.getFramebuffer().getResolution();
+		const QSize& resolution = Service::Graphics.getFramebufferResolution();
 
 		const qreal x = viewport_.x * resolution.width();
 		const qreal y = viewport_.y * resolution.height();
@@ -24,19 +24,37 @@
  */
 #include "Application.hh"
 #include "Service.hh"
+#include "RenderCluster.hh"
+#include <QCommandLineParser>
+#include <QScreen>
 
 using clockwork::Application;
 
 
 Application::Application(int& argc, char** argv) :
 QGuiApplication(argc, argv),
-userInterface_(*this) {
+frameScheduler_(scene_),
+userInterface_(*this),
+renderWorkerCount_(0),
+enableDeterministicRendering_(false),
+renderWorker_(scene_) {
 	setApplicationName("Clockwork");
 	setApplicationVersion(APPLICATION_VERSION);
 	parseCommandLineArguments(argc, argv);
 
-	connect(&scene_, &Scene::updated, this, &Application::renderScene);
-	connect(&Service::Graphics, &GraphicsSubsystem::renderingContextChanged, this, &Application::renderScene);
+	// A render worker only draws the frames that its coordinator requests.
+	if (isRenderWorker()) {
+		return;
+	}
+
+	// Frames are paced to the display's refresh rate, since faster frames would never be seen.
+	const QScreen* const screen = primaryScreen();
+	if (screen != nullptr && screen->refreshRate() > 0.0) {
+		frameScheduler_.setFrameInterval(static_cast<int>(1000.0 / screen->refreshRate()));
+	}
+	connect(&scene_, &Scene::updated, &frameScheduler_, &FrameScheduler::requestFrame);
+	connect(&Service::Graphics, &GraphicsSubsystem::renderingContextChanged, &frameScheduler_, &FrameScheduler::requestFrame);
+	connect(&frameScheduler_, &FrameScheduler::frameRendered, this, &Application::frameRendered);
 }
 
 
@@ -49,6 +67,16 @@ Application::initialize() {
 	if (error != Error::None) {
 		return error;
 	}
+	Service::Graphics.enableDeterministicRendering(enableDeterministicRendering_);
+	if (isRenderWorker()) {
+		// The worker's scene must match the coordinator's, since frames only refer
+		// to the objects they contain.
+		scene_.load(QString());
+		return renderWorker_.connectToCoordinator(renderCoordinatorName_);
+	}
+	if (renderWorkerCount_ > 0) {
+		Service::Graphics.setRenderWorkerCount(renderWorkerCount_);
+	}
 	return userInterface_.initialize();
 }
 
@@ -71,17 +99,50 @@ Application::getScene() {
 }
 
 
-void
-Application::renderScene() {
-	Service::Graphics.clear();
-	Service::Graphics.render(scene_);
-	emit frameRendered();
-}
-
-
 void
 Application::parseCommandLineArguments(int& argc, char** argv) {
-	//TODO Implement me.
+	// QGuiApplication has already removed the arguments it handles, such as -platform.
 	Q_UNUSED(argc);
 	Q_UNUSED(argv);
+
+	const QCommandLineOption renderWorkersOption(
+		"render-workers",
+		"Draws frames with the specified number of worker processes.",
+		"count"
+	);
+	const QCommandLineOption renderWorkerOption(
+		RenderCluster::WORKER_OPTION,
+		"Draws parts of frames for the render coordinator at the specified server.",
+		"server"
+	);
+	const QCommandLineOption deterministicOption(
+		"deterministic",
+		"Renders frames whose pixels don't depend on the number of threads or on timing."
+	);
+	QCommandLineParser parser;
+	parser.setApplicationDescription("A software 3D renderer.");
+	parser.addHelpOption();
+	parser.addVersionOption();
+	parser.addOption(renderWorkersOption);
+	parser.addOption(renderWorkerOption);
+	parser.addOption(deterministicOption);
+	parser.process(*this);
+
+	if (parser.isSet(renderWorkersOption)) {
+		bool isValid = false;
+		const int count = parser.value(renderWorkersOption).toInt(&isValid);
+		if (isValid && count >= 0) {
+			renderWorkerCount_ = count;
+		} else {
+			qWarning("[Application::parseCommandLineArguments] Invalid render worker count.");
+		}
+	}
+	renderCoordinatorName_ = parser.value(renderWorkerOption);
+	enableDeterministicRendering_ = parser.isSet(deterministicOption);
+}
+
+
+bool
+Application::isRenderWorker() const {
+	return !renderCoordinatorName_.isEmpty();
 }
@@ -30,6 +30,8 @@
 #include "Error.hh"
 #include "UserInterface.hh"
 #include "Scene.hh"
+#include "FrameScheduler.hh"
+#include "RenderWorker.hh"
 
 
 namespace clockwork {
@@ -81,14 +83,15 @@ public:
 	 */
 	Scene& getScene();
 private:
-	/**
-	 * Renders the application's scene.
-	 */
-	void renderScene();
 	/**
 	 * Parses the specified command line arguments.
 	 */
 	void parseCommandLineArguments(int& argc, char** argv);
+	/**
+	 * Returns true if the application draws parts of frames for another instance of
+	 * the application, false otherwise.
+	 */
+	bool isRenderWorker() const;
 	/**
 	 * The application's configuration settings.
 	 */
@@ -97,10 +100,32 @@ private:
 	 * The application's scene.
 	 */
 	Scene scene_;
+	/**
+	 * The scheduler that renders the application's scene as pipelined frame task graphs.
+	 */
+	FrameScheduler frameScheduler_;
 	/**
 	 * The application's user interface.
 	 */
 	UserInterface userInterface_;
+	/**
+	 * The number of worker processes that frames are drawn with.
+	 */
+	int renderWorkerCount_;
+	/**
+	 * True if frames are rendered deterministically, false otherwise.
+	 */
+	bool enableDeterministicRendering_;
+	/**
+	 * The name of the server that the application draws frames for, if it runs as a
+	 * render worker.
+	 */
+	QString renderCoordinatorName_;
+	/**
+	 * Draws the frames that the render coordinator requests, if the application runs
+	 * as a render worker.
+	 */
+	RenderWorker renderWorker_;
 signals:
 	/**
 	 * A signal that is emitted when a frame has been successfully rendered.
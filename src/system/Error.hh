@@ -36,6 +36,7 @@ enum class Error {
 	None,
 	FileNotAccessible,
 	InvalidQmlContext,
+	CoordinatorNotAccessible,
 	Unknown,
 };
 /**
@@ -45,6 +46,7 @@ DECLARE_ENUMERATOR_LIST(Error, {
 	Error::None,
 	Error::FileNotAccessible,
 	Error::InvalidQmlContext,
+	Error::CoordinatorNotAccessible,
 	Error::Unknown,
 })
 /**
@@ -60,6 +62,8 @@ enum_traits<Error>::name(const Error error) {
 			return "File not accessible";
 		case Error::InvalidQmlContext:
 			return "Invalid QML context";
+		case Error::CoordinatorNotAccessible:
+			return "Render coordinator not accessible";
 		case Error::Unknown:
 			return "Unknown system error";
 		default:
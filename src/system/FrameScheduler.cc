@@ -0,0 +1,174 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "FrameScheduler.hh"
+#include "Service.hh"
+#include <algorithm>
+#include <functional>
+
+using clockwork::FrameScheduler;
+
+
+constexpr int FrameScheduler::DEFAULT_FRAME_INTERVAL;
+constexpr std::size_t FrameScheduler::PIPELINE_DEPTH;
+
+
+namespace {
+/**
+ * A task that executes one stage of a frame.
+ */
+class Stage final : public clockwork::Task {
+public:
+	/**
+	 * Instantiates a Stage object that executes the specified function.
+	 * @param function the function that executes the stage.
+	 * @param deadline the stage's soft deadline, in milliseconds.
+	 */
+	Stage(std::function<void()>&& function, const int deadline) :
+	Task(Priority::Critical),
+	function_(std::move(function)) {
+		setDeadline(deadline);
+	}
+	/**
+	 * Executes the stage.
+	 */
+	void run() override {
+		function_();
+	}
+private:
+	/**
+	 * The function that executes the stage.
+	 */
+	const std::function<void()> function_;
+};
+} // namespace
+
+
+FrameScheduler::FrameScheduler(const Scene& scene, QObject* const parent) :
+QObject(parent),
+scene_(scene),
+frameInterval_(DEFAULT_FRAME_INTERVAL),
+frameRequested_(false),
+frameCount_(0),
+frameNumber_(0) {
+	frameTimer_.setSingleShot(true);
+	connect(&frameTimer_, &QTimer::timeout, this, &FrameScheduler::beginFrame);
+	// The scheduler lives in the GUI thread, so the present task's signal is queued.
+	connect(this, &FrameScheduler::frameRendered, this, &FrameScheduler::endFrame, Qt::QueuedConnection);
+}
+
+
+FrameScheduler::~FrameScheduler() {
+	for (const auto& frame : frames_) {
+		if (frame.presentTask != nullptr) {
+			Service::Tasks.wait(*frame.presentTask);
+		}
+	}
+}
+
+
+int
+FrameScheduler::getFrameInterval() const {
+	return frameInterval_;
+}
+
+
+void
+FrameScheduler::setFrameInterval(const int interval) {
+	frameInterval_ = std::max(interval, 0);
+}
+
+
+void
+FrameScheduler::requestFrame() {
+	frameRequested_ = true;
+	scheduleFrame();
+}
+
+
+void
+FrameScheduler::scheduleFrame() {
+	if (frameRequested_ && frameCount_ < PIPELINE_DEPTH && !frameTimer_.isActive()) {
+		const qint64 elapsed = frameClock_.isValid() ? frameClock_.elapsed() : frameInterval_;
+		frameTimer_.start(static_cast<int>(std::max<qint64>(frameInterval_ - elapsed, 0)));
+	}
+}
+
+
+void
+FrameScheduler::beginFrame() {
+	frameRequested_ = false;
+	frameClock_.start();
+	++frameCount_;
+
+	auto& previous = frames_[(frameNumber_ + PIPELINE_DEPTH - 1) % PIPELINE_DEPTH];
+	auto& frame = frames_[frameNumber_ % PIPELINE_DEPTH];
+	++frameNumber_;
+
+	// The frame that last used this slot was presented, but its present task may still
+	// be returning.
+	if (frame.presentTask != nullptr) {
+		Service::Tasks.wait(*frame.presentTask);
+	}
+
+	// The scene is only modified by the GUI thread, so its state is captured here. The
+	// rest of the frame is rendered by tasks that only access the captured state, and
+	// the rendering context changes that are still pending.
+	Service::Graphics.flushRenderingContextChanges();
+	Service::Graphics.prepare(scene_, frame.state);
+
+	// A stage that has been ready for a whole frame interval is late, so it is executed
+	// before any other ready task.
+	auto* const state = &frame.state;
+	const int deadline = frameInterval_;
+	auto* const visibility = new Stage([state]() { Service::Graphics.cull(*state); }, deadline);
+	auto* const draw = new Stage([state]() { Service::Graphics.draw(*state); }, deadline);
+	auto* const filter = new Stage([state]() { Service::Graphics.filter(*state); }, deadline);
+	frame.presentTask.reset(new Stage([this]() {
+		Service::Graphics.present();
+		emit frameRendered();
+	}, deadline));
+	frame.presentTask->setAutoDelete(false);
+
+	visibility->then(*draw);
+	draw->then(*filter);
+	filter->then(*frame.presentTask);
+	// Frames share the framebuffer, so a frame is only drawn once the previous one
+	// has been presented. The frame's visibility is determined in the meantime.
+	if (previous.presentTask != nullptr) {
+		previous.presentTask->then(*draw);
+	}
+
+	Service::Tasks.submit(frame.presentTask.get());
+	Service::Tasks.submit(filter);
+	Service::Tasks.submit(draw);
+	Service::Tasks.submit(visibility);
+}
+
+
+void
+FrameScheduler::endFrame() {
+	--frameCount_;
+	scheduleFrame();
+}
@@ -0,0 +1,157 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_FRAME_SCHEDULER_HH
+#define CLOCKWORK_FRAME_SCHEDULER_HH
+
+#include "GraphicsSubsystem.hh"
+#include "Task.hh"
+#include <QTimer>
+#include <QElapsedTimer>
+#include <array>
+#include <memory>
+
+
+namespace clockwork {
+/**
+ * @see scene/Scene.hh.
+ */
+class Scene;
+/**
+ * Renders frames of a scene as task graphs on the TaskManager. Each frame's scene
+ * state is captured on the GUI thread, then culled, drawn, filtered and presented by
+ * tasks. Drawing a frame waits for the previous frame to be presented, since both
+ * share the framebuffer, but the next frame is captured and culled in the meantime.
+ *
+ * Any number of frame requests made while the pipeline is full, or before the next
+ * display interval begins, are coalesced into a single frame. The frame then reflects
+ * the most recent state of the scene, and no more than one frame begins per display
+ * interval.
+ */
+class FrameScheduler : public QObject {
+	Q_OBJECT
+public:
+	/**
+	 * The default number of milliseconds between two frames, i.e. 60 frames per second.
+	 */
+	static constexpr int DEFAULT_FRAME_INTERVAL = 16;
+	/**
+	 * The maximum number of frames in flight.
+	 */
+	static constexpr std::size_t PIPELINE_DEPTH = 2;
+	/**
+	 * Instantiates a FrameScheduler object that renders the specified scene.
+	 * @param scene the scene to render.
+	 * @param parent this FrameScheduler instance's parent.
+	 */
+	explicit FrameScheduler(const Scene& scene, QObject* const parent = nullptr);
+	/**
+	 * Waits for the frames in flight, if any.
+	 */
+	~FrameScheduler();
+	/**
+	 * Returns the minimum number of milliseconds between the start of two frames.
+	 */
+	int getFrameInterval() const;
+	/**
+	 * Sets the minimum number of milliseconds between the start of two frames.
+	 * @param interval the interval to set.
+	 */
+	void setFrameInterval(const int interval);
+	/**
+	 * Requests a frame. The frame begins at the start of the next display interval,
+	 * once there is room for it in the pipeline.
+	 */
+	void requestFrame();
+private:
+	/**
+	 * A frame in flight.
+	 */
+	struct Frame {
+		/**
+		 * The state of the scene that the frame is rendered from.
+		 */
+		GraphicsSubsystem::FrameState state;
+		/**
+		 * The task that presents the frame. The frame's other tasks are deleted once
+		 * they are executed, but this one is kept so that the next frame's draw task
+		 * can be made its continuation.
+		 */
+		std::unique_ptr<Task> presentTask;
+	};
+	/**
+	 * Starts a timer that begins the next frame at the start of the next display
+	 * interval, if a frame was requested and the pipeline isn't full.
+	 */
+	void scheduleFrame();
+	/**
+	 * Captures the requested frame's scene state on the GUI thread and submits the
+	 * tasks that render it.
+	 */
+	void beginFrame();
+	/**
+	 * Removes a presented frame from the pipeline, and schedules the next one.
+	 */
+	void endFrame();
+	/**
+	 * The scene to render.
+	 */
+	const Scene& scene_;
+	/**
+	 * The minimum number of milliseconds between the start of two frames.
+	 */
+	int frameInterval_;
+	/**
+	 * True if a frame was requested since the last frame began, false otherwise.
+	 */
+	bool frameRequested_;
+	/**
+	 * The number of frames that began but have yet to be presented.
+	 */
+	std::size_t frameCount_;
+	/**
+	 * The number of frames that began since the scheduler was instantiated.
+	 */
+	std::size_t frameNumber_;
+	/**
+	 * The frames in flight, indexed by frame number modulo the pipeline depth.
+	 */
+	std::array<Frame, PIPELINE_DEPTH> frames_;
+	/**
+	 * The timer that begins the next frame.
+	 */
+	QTimer frameTimer_;
+	/**
+	 * The time elapsed since the last frame began.
+	 */
+	QElapsedTimer frameClock_;
+signals:
+	/**
+	 * A signal that is emitted by the present task once a frame is presented.
+	 */
+	void frameRendered();
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_FRAME_SCHEDULER_HH
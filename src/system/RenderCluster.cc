@@ -0,0 +1,322 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "RenderCluster.hh"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <algorithm>
+
+using clockwork::RenderCluster;
+
+
+constexpr const char* RenderCluster::WORKER_OPTION;
+constexpr int RenderCluster::TIMEOUT;
+constexpr int RenderCluster::FRAME_TIMEOUT;
+constexpr int RenderCluster::CONNECTION_POLL_INTERVAL;
+
+
+RenderCluster::RenderCluster(const int workerCount) :
+requestedWorkerCount_(workerCount),
+workerCount_(-1),
+layout_(Framebuffer::Layout::Linear),
+depthFormat_(Framebuffer::DepthFormat::Float32),
+framePending_(false),
+stopped_(false) {
+	start();
+}
+
+
+RenderCluster::~RenderCluster() {
+	{
+		QMutexLocker locker(&mutex_);
+		stopped_ = true;
+		stateChanged_.wakeAll();
+	}
+	wait();
+}
+
+
+int
+RenderCluster::getWorkerCount() const {
+	QMutexLocker locker(&mutex_);
+	return std::max(workerCount_, 0);
+}
+
+
+void
+RenderCluster::beginFrame(const RenderingContext& context, const GraphicsSubsystem::FrameState& frame, const std::vector<std::vector<int>>& subsets) {
+	const auto& framebuffer = context.framebuffer;
+	std::vector<QByteArray> requests(subsets.size());
+	for (std::size_t i = 0; i < subsets.size(); ++i) {
+		QDataStream stream(&requests[i], QIODevice::WriteOnly);
+		stream
+			<< framebuffer.getResolution()
+			<< static_cast<qint32>(enum_traits<Framebuffer::DepthFormat>::ordinal(framebuffer.getDepthFormat()))
+			<< static_cast<qint32>(enum_traits<ShaderProgramIdentifier>::ordinal(context.shaderProgramIdentifier))
+			<< static_cast<qint32>(enum_traits<PrimitiveTopology>::ordinal(context.primitiveTopology))
+			<< context.enableClipping
+			<< context.enableBackfaceCulling
+			<< static_cast<qint32>(enum_traits<PolygonMode>::ordinal(context.polygonMode))
+			<< static_cast<qint32>(enum_traits<ShadeModel>::ordinal(context.shadeModel))
+			<< context.enableLineAntiAliasing
+			<< context.enableScissorTest
+			<< context.enableStencilTest
+			<< context.enableDepthTest
+			<< context.normalizedScissorBox
+			<< frame.view
+			<< frame.projection
+			<< frame.viewProjection
+			<< frame.viewportTransform
+			<< frame.viewpoint
+			<< static_cast<qint32>(frame.textureFilter)
+			<< static_cast<qint32>(subsets[i].size());
+		for (const int object : subsets[i]) {
+			stream << static_cast<qint32>(frame.objects[object].index) << frame.objects[object].model;
+		}
+	}
+
+	QMutexLocker locker(&mutex_);
+	requests_ = std::move(requests);
+	resolution_ = framebuffer.getResolution();
+	layout_ = framebuffer.getLayout();
+	depthFormat_ = framebuffer.getDepthFormat();
+	missingSubsets_.clear();
+	framePending_ = true;
+	stateChanged_.wakeAll();
+}
+
+
+void
+RenderCluster::endFrame(Framebuffer& framebuffer, const std::function<void(std::size_t)>& drawSubset) {
+	QMutexLocker locker(&mutex_);
+	while (framePending_) {
+		stateChanged_.wait(&mutex_);
+	}
+	const auto missingSubsets = std::move(missingSubsets_);
+	locker.unlock();
+
+	for (const auto subset : missingSubsets) {
+		drawSubset(subset);
+	}
+	for (const auto& layer : layers_) {
+		framebuffer.composite(*layer);
+	}
+}
+
+
+void
+RenderCluster::writeMessage(QLocalSocket& socket, const QByteArray& message) {
+	const quint32 size = static_cast<quint32>(message.size());
+	socket.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	socket.write(message);
+}
+
+
+QByteArray
+RenderCluster::writeLayer(const Framebuffer& framebuffer) {
+	// Tiles that weren't drawn to are left cleared in the coordinator's layer, so
+	// only those that were are written.
+	const std::uint32_t w = framebuffer.getWidth();
+	const std::uint32_t h = framebuffer.getHeight();
+	qint32 tileCount = 0;
+	for (std::uint32_t y = 0; y < h; y += Framebuffer::TILE_SIZE) {
+		for (std::uint32_t x = 0; x < w; x += Framebuffer::TILE_SIZE) {
+			tileCount += framebuffer.isTileCleared(x, y) ? 0 : 1;
+		}
+	}
+	QByteArray reply;
+	QDataStream stream(&reply, QIODevice::WriteOnly);
+	stream << tileCount;
+
+	std::vector<std::uint32_t> pixels(Framebuffer::TILE_SIZE * Framebuffer::TILE_SIZE);
+	std::vector<std::uint32_t> depths(pixels.size());
+	for (std::uint32_t y = 0; y < h; y += Framebuffer::TILE_SIZE) {
+		for (std::uint32_t x = 0; x < w; x += Framebuffer::TILE_SIZE) {
+			if (!framebuffer.isTileCleared(x, y)) {
+				const int length = static_cast<int>(sizeof(std::uint32_t) * std::min(Framebuffer::TILE_SIZE, w - x) * std::min(Framebuffer::TILE_SIZE, h - y));
+				framebuffer.readTile(x, y, pixels.data(), depths.data());
+				stream << static_cast<quint32>(x) << static_cast<quint32>(y);
+				stream.writeRawData(reinterpret_cast<const char*>(pixels.data()), length);
+				stream.writeRawData(reinterpret_cast<const char*>(depths.data()), length);
+			}
+		}
+	}
+	return reply;
+}
+
+
+void
+RenderCluster::run() {
+	// The server's name is unique to the cluster, so several coordinators can run at once.
+	QLocalServer server;
+	const QString name = QString("clockwork-%1-%2").arg(QCoreApplication::applicationPid()).arg(reinterpret_cast<quintptr>(this));
+	std::vector<std::unique_ptr<QLocalSocket>> sockets;
+	// Only the user that runs the application may connect, since workers are sent
+	// the scene's transforms and reply with its pixels.
+	server.setSocketOptions(QLocalServer::UserAccessOption);
+	if (server.listen(name)) {
+		// Workers are detached so they don't depend on this thread's lifetime, and exit
+		// when their connection to the cluster is closed.
+		const QStringList arguments{"-platform", "offscreen", QString("--%1").arg(WORKER_OPTION), server.fullServerName()};
+		for (int i = 0; i < requestedWorkerCount_; ++i) {
+			if (!QProcess::startDetached(QCoreApplication::applicationFilePath(), arguments)) {
+				qWarning("[RenderCluster::run] Could not launch a worker.");
+			}
+		}
+		// The wait stops early if the cluster is destroyed, so its destructor is only
+		// delayed by a poll interval at most.
+		QElapsedTimer timer;
+		timer.start();
+		while (static_cast<int>(sockets.size()) < requestedWorkerCount_ && timer.elapsed() < TIMEOUT) {
+			if (server.hasPendingConnections() || server.waitForNewConnection(CONNECTION_POLL_INTERVAL)) {
+				sockets.emplace_back(server.nextPendingConnection());
+			}
+			QMutexLocker locker(&mutex_);
+			if (stopped_) {
+				break;
+			}
+		}
+		server.close();
+	} else {
+		qWarning("[RenderCluster::run] Could not listen for workers.");
+	}
+
+	QMutexLocker locker(&mutex_);
+	for (std::size_t i = 0; i < sockets.size(); ++i) {
+		layers_.emplace_back(new Framebuffer);
+		layers_.back()->enableFastClear();
+	}
+	workerCount_ = static_cast<int>(sockets.size());
+	stateChanged_.wakeAll();
+
+	while (!stopped_) {
+		if (!framePending_) {
+			stateChanged_.wait(&mutex_);
+			continue;
+		}
+		const auto requests = std::move(requests_);
+		const QSize resolution = resolution_;
+		const Framebuffer::Layout layout = layout_;
+		const Framebuffer::DepthFormat depthFormat = depthFormat_;
+		locker.unlock();
+
+		// All requests are sent before any reply is read, so the workers draw concurrently.
+		// The frame's draw stage waits for the replies, so they share a single deadline.
+		QElapsedTimer timer;
+		timer.start();
+		for (std::size_t i = 0; i < sockets.size(); ++i) {
+			writeMessage(*sockets[i], requests[i]);
+			while (sockets[i]->bytesToWrite() > 0 && timer.elapsed() < FRAME_TIMEOUT && sockets[i]->waitForBytesWritten(static_cast<int>(FRAME_TIMEOUT - timer.elapsed()))) {}
+		}
+		std::vector<bool> isConnected(sockets.size(), true);
+		for (std::size_t i = 0; i < sockets.size(); ++i) {
+			auto& layer = *layers_[i];
+			layer.setLayout(layout);
+			layer.setResolution(resolution);
+			layer.setDepthFormat(depthFormat);
+			layer.clear();
+
+			QByteArray reply;
+			if (readMessage(*sockets[i], reply, timer, FRAME_TIMEOUT)) {
+				readLayer(reply, layer);
+			} else {
+				qWarning("[RenderCluster::run] A worker did not reply and was disconnected. Its objects are drawn locally.");
+				isConnected[i] = false;
+			}
+		}
+
+		locker.relock();
+		// The objects of workers that didn't reply are drawn by the coordinator, and the
+		// next frame's objects are divided among the remaining workers.
+		for (std::size_t i = sockets.size(); i-- > 0;) {
+			if (!isConnected[i]) {
+				sockets.erase(sockets.begin() + i);
+				layers_.erase(layers_.begin() + i);
+				missingSubsets_.insert(missingSubsets_.begin(), i);
+			}
+		}
+		workerCount_ = static_cast<int>(sockets.size());
+		framePending_ = false;
+		stateChanged_.wakeAll();
+	}
+}
+
+
+bool
+RenderCluster::readMessage(QLocalSocket& socket, QByteArray& message, const QElapsedTimer& timer, const int timeout) {
+	const auto& waitForReadyRead = [&socket, &timer, timeout]() {
+		const qint64 remaining = timeout - timer.elapsed();
+		return remaining > 0 && socket.waitForReadyRead(static_cast<int>(remaining));
+	};
+	quint32 size = 0;
+	while (socket.bytesAvailable() < static_cast<qint64>(sizeof(size))) {
+		if (!waitForReadyRead()) {
+			return false;
+		}
+	}
+	socket.read(reinterpret_cast<char*>(&size), sizeof(size));
+
+	message.resize(static_cast<int>(size));
+	qint64 received = 0;
+	while (received < size) {
+		if (socket.bytesAvailable() == 0 && !waitForReadyRead()) {
+			return false;
+		}
+		received += socket.read(message.data() + received, size - received);
+	}
+	return true;
+}
+
+
+void
+RenderCluster::readLayer(const QByteArray& reply, Framebuffer& layer) {
+	const std::uint32_t w = layer.getWidth();
+	const std::uint32_t h = layer.getHeight();
+	std::vector<std::uint32_t> pixels(Framebuffer::TILE_SIZE * Framebuffer::TILE_SIZE);
+	std::vector<std::uint32_t> depths(pixels.size());
+
+	QDataStream stream(reply);
+	qint32 tileCount = 0;
+	stream >> tileCount;
+	for (qint32 i = 0; i < tileCount; ++i) {
+		quint32 x = 0;
+		quint32 y = 0;
+		stream >> x >> y;
+		if (stream.status() != QDataStream::Ok || x >= w || y >= h || x % Framebuffer::TILE_SIZE != 0 || y % Framebuffer::TILE_SIZE != 0) {
+			qWarning("[RenderCluster::readLayer] Invalid tile.");
+			return;
+		}
+		const int length = static_cast<int>(sizeof(std::uint32_t) * std::min(Framebuffer::TILE_SIZE, w - x) * std::min(Framebuffer::TILE_SIZE, h - y));
+		if (stream.readRawData(reinterpret_cast<char*>(pixels.data()), length) != length ||
+			stream.readRawData(reinterpret_cast<char*>(depths.data()), length) != length) {
+			qWarning("[RenderCluster::readLayer] Truncated tile.");
+			return;
+		}
+		layer.writeTile(x, y, pixels.data(), depths.data());
+	}
+}
@@ -0,0 +1,216 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_RENDER_CLUSTER_HH
+#define CLOCKWORK_RENDER_CLUSTER_HH
+
+#include "GraphicsSubsystem.hh"
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class QElapsedTimer;
+class QLocalSocket;
+
+
+namespace clockwork {
+namespace testsuite {
+class TestRenderCluster;
+} // namespace testsuite
+/**
+ * A RenderCluster draws parts of each frame in worker processes. It launches the
+ * workers, which are headless instances of the application, and exchanges messages
+ * with them over local sockets from its own thread. The workers are launched and
+ * connect in the background, and frames are drawn locally until they do.
+ *
+ * For each frame, a worker receives the rendering context's state, the viewer's
+ * transforms and the subset of the scene's objects that it must draw. Each worker
+ * loads the same scene, so objects are identified by their position among the scene's
+ * objects. The worker draws its objects and replies with the colors and depth buffer
+ * elements of each tile that it drew to. The tiles are written to a layer per worker,
+ * and the layers are merged by depth into the framebuffer. Messages are prefixed with
+ * their size and encoded with a QDataStream in the host's byte order, since workers
+ * always run on the same machine as their coordinator.
+ *
+ * Workers have a long time to connect, but a frame's replies must arrive within a
+ * fraction of a second, since the frame's draw stage waits for them. A worker that
+ * misses the deadline is disconnected, and its objects are drawn locally.
+ */
+class RenderCluster : public QThread {
+public:
+	/**
+	 * The command line option that starts the application as a worker. Its value is
+	 * the name of the coordinator's server.
+	 */
+	static constexpr const char* WORKER_OPTION = "render-worker";
+	/**
+	 * The number of milliseconds to wait for workers to connect.
+	 */
+	static constexpr int TIMEOUT = 30000;
+	/**
+	 * The number of milliseconds that workers have to receive a frame's requests and
+	 * reply to them.
+	 */
+	static constexpr int FRAME_TIMEOUT = 250;
+	/**
+	 * Launches the specified number of workers without waiting for them to connect.
+	 * @param workerCount the number of workers to launch.
+	 */
+	explicit RenderCluster(const int workerCount);
+	/**
+	 *
+	 */
+	RenderCluster(const RenderCluster&) = delete;
+	/**
+	 *
+	 */
+	RenderCluster(RenderCluster&&) = delete;
+	/**
+	 * Disconnects from the workers, which then exit.
+	 */
+	~RenderCluster();
+	/**
+	 *
+	 */
+	RenderCluster& operator=(const RenderCluster&) = delete;
+	/**
+	 *
+	 */
+	RenderCluster& operator=(RenderCluster&&) = delete;
+	/**
+	 * Returns the number of workers that connected, which is 0 until the cluster
+	 * stops waiting for them.
+	 */
+	int getWorkerCount() const;
+	/**
+	 * Sends each worker the subset of the frame's objects that it must draw, and
+	 * returns without waiting for their replies.
+	 * @param context the rendering context that the frame is drawn with.
+	 * @param frame the frame to draw.
+	 * @param subsets the positions in the frame of each worker's objects.
+	 */
+	void beginFrame(const RenderingContext& context, const GraphicsSubsystem::FrameState& frame, const std::vector<std::vector<int>>& subsets);
+	/**
+	 * Waits for the workers' replies, then merges their layers into the specified
+	 * framebuffer. The subset of each worker that fails to reply is drawn with the
+	 * specified function before the layers are merged, so no object is missing from
+	 * the frame.
+	 * @param framebuffer the framebuffer to merge the layers into.
+	 * @param drawSubset draws the subset at the specified position in the frame's subsets.
+	 */
+	void endFrame(Framebuffer& framebuffer, const std::function<void(std::size_t)>& drawSubset);
+	/**
+	 * Writes the specified message to the socket.
+	 * @param socket the socket to write to.
+	 * @param message the message to write.
+	 */
+	static void writeMessage(QLocalSocket& socket, const QByteArray& message);
+	/**
+	 * Returns a reply that holds the colors and depth buffer elements of each tile
+	 * that was drawn to in the specified framebuffer.
+	 * @param framebuffer the framebuffer whose tiles are written.
+	 */
+	static QByteArray writeLayer(const Framebuffer& framebuffer);
+private:
+	friend class testsuite::TestRenderCluster;
+	/**
+	 * The number of milliseconds between checks of whether the cluster is being
+	 * destroyed while it waits for workers to connect.
+	 */
+	static constexpr int CONNECTION_POLL_INTERVAL = 100;
+	/**
+	 * Launches the workers and exchanges the frames' messages with them.
+	 */
+	void run() override;
+	/**
+	 * Reads a message from the socket and returns true if it was read completely
+	 * before the specified timer reached the timeout.
+	 * @param socket the socket to read from.
+	 * @param message the message that is read.
+	 * @param timer the timer that the timeout is measured with.
+	 * @param timeout the number of milliseconds after which the read fails.
+	 */
+	static bool readMessage(QLocalSocket& socket, QByteArray& message, const QElapsedTimer& timer, const int timeout);
+	/**
+	 * Writes the tiles in a worker's reply to the specified layer.
+	 * @param reply the worker's reply.
+	 * @param layer the layer to write to.
+	 */
+	static void readLayer(const QByteArray& reply, Framebuffer& layer);
+	/**
+	 * The number of workers to launch.
+	 */
+	const int requestedWorkerCount_;
+	/**
+	 * The number of workers that connected, or -1 until the cluster stops waiting
+	 * for them.
+	 */
+	int workerCount_;
+	/**
+	 * The request for each worker that the cluster's thread has yet to send.
+	 */
+	std::vector<QByteArray> requests_;
+	/**
+	 * The resolution of the frame's framebuffer.
+	 */
+	QSize resolution_;
+	/**
+	 * The layout of the frame's framebuffer.
+	 */
+	Framebuffer::Layout layout_;
+	/**
+	 * The depth format of the frame's framebuffer.
+	 */
+	Framebuffer::DepthFormat depthFormat_;
+	/**
+	 * The layer that each worker's tiles are written to.
+	 */
+	std::vector<std::unique_ptr<Framebuffer>> layers_;
+	/**
+	 * The positions of the frame's subsets whose workers failed to reply.
+	 */
+	std::vector<std::size_t> missingSubsets_;
+	/**
+	 * True if a frame began and its layers haven't been written yet, false otherwise.
+	 */
+	bool framePending_;
+	/**
+	 * True if the cluster is being destroyed, false otherwise.
+	 */
+	bool stopped_;
+	/**
+	 * A mutex that guards the cluster's state that is shared with its thread.
+	 */
+	mutable QMutex mutex_;
+	/**
+	 * A condition that is signaled when the cluster's state changes.
+	 */
+	QWaitCondition stateChanged_;
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_RENDER_CLUSTER_HH
@@ -0,0 +1,144 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "RenderWorker.hh"
+#include "RenderCluster.hh"
+#include "Scene.hh"
+#include "Service.hh"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <cstring>
+
+using clockwork::RenderWorker;
+
+
+RenderWorker::RenderWorker(const Scene& scene, QObject* const parent) :
+QObject(parent),
+scene_(scene) {
+	connect(&socket_, &QLocalSocket::readyRead, this, &RenderWorker::readRequests);
+	connect(&socket_, &QLocalSocket::disconnected, QCoreApplication::instance(), &QCoreApplication::quit);
+}
+
+
+clockwork::Error
+RenderWorker::connectToCoordinator(const QString& serverName) {
+	socket_.connectToServer(serverName);
+	return socket_.waitForConnected(RenderCluster::TIMEOUT) ? Error::None : Error::CoordinatorNotAccessible;
+}
+
+
+void
+RenderWorker::readRequests() {
+	buffer_.append(socket_.readAll());
+
+	quint32 size = 0;
+	while (buffer_.size() >= static_cast<int>(sizeof(size))) {
+		std::memcpy(&size, buffer_.constData(), sizeof(size));
+		if (static_cast<quint32>(buffer_.size()) - sizeof(size) < size) {
+			break;
+		}
+		render(buffer_.mid(sizeof(size), static_cast<int>(size)));
+		buffer_.remove(0, static_cast<int>(sizeof(size) + size));
+	}
+}
+
+
+void
+RenderWorker::render(const QByteArray& request) {
+	QDataStream stream(request);
+	QSize resolution;
+	qint32 depthFormat = 0;
+	qint32 shaderProgram = 0;
+	qint32 primitiveTopology = 0;
+	bool enableClipping = false;
+	bool enableBackfaceCulling = false;
+	qint32 polygonMode = 0;
+	qint32 shadeModel = 0;
+	bool enableLineAntiAliasing = false;
+	bool enableScissorTest = false;
+	bool enableStencilTest = false;
+	bool enableDepthTest = false;
+	QRectF normalizedScissorBox;
+	qint32 textureFilter = 0;
+	qint32 objectCount = 0;
+	GraphicsSubsystem::FrameState frame;
+	stream
+		>> resolution
+		>> depthFormat
+		>> shaderProgram
+		>> primitiveTopology
+		>> enableClipping
+		>> enableBackfaceCulling
+		>> polygonMode
+		>> shadeModel
+		>> enableLineAntiAliasing
+		>> enableScissorTest
+		>> enableStencilTest
+		>> enableDepthTest
+		>> normalizedScissorBox
+		>> frame.view
+		>> frame.projection
+		>> frame.viewProjection
+		>> frame.viewportTransform
+		>> frame.viewpoint
+		>> textureFilter
+		>> objectCount;
+
+	// The rendering context changes are applied when the frame is drawn, which happens
+	// on this thread.
+	auto& graphics = Service::Graphics;
+	graphics.setFramebufferResolution(resolution);
+	graphics.setFramebufferDepthFormat_(depthFormat);
+	graphics.setShaderProgram_(shaderProgram);
+	graphics.setPrimitiveTopology_(primitiveTopology);
+	graphics.enableClipping(enableClipping);
+	graphics.enableBackfaceCulling(enableBackfaceCulling);
+	graphics.setPolygonMode_(polygonMode);
+	graphics.setShadeModel_(shadeModel);
+	graphics.enableLineAntiAliasing(enableLineAntiAliasing);
+	graphics.enableScissorTest(enableScissorTest);
+	graphics.enableStencilTest(enableStencilTest);
+	graphics.enableDepthTest(enableDepthTest);
+	graphics.setNormalizedScissorBox(normalizedScissorBox);
+
+	frame.hasViewer = true;
+	frame.textureFilter = static_cast<TextureFilter::Identifier>(textureFilter);
+	const auto objects = scene_.getNodes<SceneObject>();
+	for (qint32 i = 0; i < objectCount && stream.status() == QDataStream::Ok; ++i) {
+		GraphicsSubsystem::FrameState::Object frameObject;
+		stream >> frameObject.index >> frameObject.model;
+
+		const auto* const object = frameObject.index >= 0 && frameObject.index < objects.size() ? objects[frameObject.index] : nullptr;
+		const auto* const appearance = object != nullptr ? object->getAppearance() : nullptr;
+		if (appearance != nullptr && appearance->hasMesh()) {
+			frameObject.mesh = appearance->getMesh();
+			frame.objects.append(frameObject);
+		}
+	}
+	graphics.flushRenderingContextChanges();
+	graphics.cull(frame);
+	graphics.draw(frame);
+
+	RenderCluster::writeMessage(socket_, RenderCluster::writeLayer(graphics.getFramebuffer()));
+}
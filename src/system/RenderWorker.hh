@@ -0,0 +1,100 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_RENDER_WORKER_HH
+#define CLOCKWORK_RENDER_WORKER_HH
+
+#include "Error.hh"
+#include <QLocalSocket>
+
+
+namespace clockwork {
+/**
+ * @see scene/Scene.hh.
+ */
+class Scene;
+/**
+ * A RenderWorker draws the parts of frames that a RenderCluster requests, in a
+ * headless instance of the application. It draws each request's objects from its
+ * own copy of the scene, and replies with the tiles that it drew to.
+ * @see RenderCluster.hh.
+ */
+class RenderWorker : public QObject {
+	Q_OBJECT
+public:
+	/**
+	 * Instantiates a RenderWorker object that draws objects of the specified scene.
+	 * @param scene the scene to draw.
+	 * @param parent this RenderWorker instance's parent.
+	 */
+	explicit RenderWorker(const Scene& scene, QObject* const parent = nullptr);
+	/**
+	 *
+	 */
+	RenderWorker(const RenderWorker&) = delete;
+	/**
+	 *
+	 */
+	RenderWorker(RenderWorker&&) = delete;
+	/**
+	 *
+	 */
+	RenderWorker& operator=(const RenderWorker&) = delete;
+	/**
+	 *
+	 */
+	RenderWorker& operator=(RenderWorker&&) = delete;
+	/**
+	 * Connects to the coordinator's server. The application exits once the connection
+	 * is closed.
+	 * @param serverName the name of the coordinator's server.
+	 */
+	Error connectToCoordinator(const QString& serverName);
+private:
+	/**
+	 * Reads the data that was received, and draws each request that is complete.
+	 */
+	void readRequests();
+	/**
+	 * Draws the objects in the specified request and replies with the tiles that
+	 * were drawn to.
+	 * @param request the request to draw.
+	 */
+	void render(const QByteArray& request);
+	/**
+	 * The scene to draw.
+	 */
+	const Scene& scene_;
+	/**
+	 * The connection to the coordinator.
+	 */
+	QLocalSocket socket_;
+	/**
+	 * The data that was received but doesn't form a complete request yet.
+	 */
+	QByteArray buffer_;
+};
+} // namespace clockwork
+
+#endif // CLOCKWORK_RENDER_WORKER_HH
@@ -24,12 +24,29 @@
  */
 #include "fileReader.hh"
 #include "Mesh.hh"
+#include "Service.hh"
+#include "Texture.hh"
 #include <QFile>
+#include <QDir>
 #include <QFileInfo>
 #include <QTextStream>
 #include <QtDebug>
 
 
+namespace {
+/**
+ * Loads the texture map with the specified filename, relative to the material file.
+ * Returns nullptr if the texture map is missing or can't be decoded, so that the
+ * material is left untextured.
+ */
+const clockwork::Texture*
+loadTextureMap(const QFile& file, const QString& filename) {
+	const auto* const texture = clockwork::Service::Resources.load<clockwork::Texture>(QFileInfo(file).absoluteDir().filePath(filename));
+	return texture != nullptr && texture->getLevelCount() > 0 ? texture : nullptr;
+}
+} // namespace
+
+
 clockwork::Error
 clockwork::parseMATFile(QFile& file, const QString& materialName, Material& material) {
 	if (materialName.isEmpty()) {
@@ -92,6 +109,12 @@ clockwork::parseMATFile(QFile& file, const QString& materialName, Material& mate
 				material.transparency = tokens.takeFirst().toDouble();
 			} else if (!QString::compare(command, "Ns", Qt::CaseInsensitive)) {
 				material.shininess = tokens.takeFirst().toDouble();
+			} else if (!QString::compare(command, "map_Ka", Qt::CaseInsensitive)) {
+				material.ambient = loadTextureMap(file, tokens.takeLast());
+			} else if (!QString::compare(command, "map_Kd", Qt::CaseInsensitive)) {
+				material.diffuse = loadTextureMap(file, tokens.takeLast());
+			} else if (!QString::compare(command, "map_Ks", Qt::CaseInsensitive)) {
+				material.specular = loadTextureMap(file, tokens.takeLast());
 			} else if (!QString::compare(command, "illum", Qt::CaseInsensitive)) {
 			} else {
 				qWarning() << "[parseMATFile] The .mat reader does not recognize the" << command << "command.";
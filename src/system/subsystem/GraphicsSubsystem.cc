@@ -28,11 +28,25 @@
 #include "RandomColoredSurfacesShaderProgram.hh"
 #include "NormalMapsShaderProgram.hh"
 #include "DepthMapShaderProgram.hh"
-#include <QElapsedTimer>
+#include "TextureMapShaderProgram.hh"
+#include "TextureFilterFactory.hh"
+#include "PageCache.hh"
+#include "RenderCluster.hh"
+#include "parallelFor.hh"
+#include <QThread>
+#include <algorithm>
+#include <numeric>
+#include <vector>
 
 using clockwork::GraphicsSubsystem;
 
 
+constexpr int GraphicsSubsystem::DETERMINISTIC_LAYER_COUNT;
+
+
+GraphicsSubsystem::~GraphicsSubsystem() {}
+
+
 clockwork::Error
 GraphicsSubsystem::initialize(const ApplicationSettings& settings) {
 	renderingContext_.shaderProgramIdentifier = settings.getShaderProgramIdentifier();
@@ -45,9 +59,12 @@ GraphicsSubsystem::initialize(const ApplicationSettings& settings) {
 	renderingContext_.enableScissorTest = settings.isScissorTestEnabled();
 	renderingContext_.enableStencilTest = settings.isStencilTestEnabled();
 	renderingContext_.enableDepthTest = settings.isDepthTestEnabled();
+	renderingContext_.framebuffer.setLayout(Framebuffer::Layout::Tiled);
 	renderingContext_.framebuffer.setResolution(Framebuffer::Resolution::XGA);
+	renderingContext_.framebuffer.enableFastClear();
 	renderingContext_.normalizedScissorBox.setRect(0.0, 0.0, 1.0, 1.0);
 	renderingContext_.scissorBox.setRect(0, 0, renderingContext_.framebuffer.getWidth(), renderingContext_.framebuffer.getHeight());
+	initializeContextState();
 
 	connect(this, &GraphicsSubsystem::shaderProgramChanged,         this, &GraphicsSubsystem::renderingContextChanged);
 	connect(this, &GraphicsSubsystem::primitiveTopologyChanged,     this, &GraphicsSubsystem::renderingContextChanged);
@@ -59,82 +76,414 @@ GraphicsSubsystem::initialize(const ApplicationSettings& settings) {
 	connect(this, &GraphicsSubsystem::scissorTestToggled,           this, &GraphicsSubsystem::renderingContextChanged);
 	connect(this, &GraphicsSubsystem::stencilTestToggled,           this, &GraphicsSubsystem::renderingContextChanged);
 	connect(this, &GraphicsSubsystem::depthTestToggled,             this, &GraphicsSubsystem::renderingContextChanged);
+	connect(this, &GraphicsSubsystem::sortLastRenderingToggled,     this, &GraphicsSubsystem::renderingContextChanged);
+	connect(this, &GraphicsSubsystem::deterministicRenderingToggled, this, &GraphicsSubsystem::renderingContextChanged);
 	connect(this, &GraphicsSubsystem::normalizedScissorBoxChanged,  this, &GraphicsSubsystem::renderingContextChanged);
 	connect(this, &GraphicsSubsystem::framebufferResolutionChanged, this, &GraphicsSubsystem::renderingContextChanged);
+	connect(this, &GraphicsSubsystem::framebufferDepthFormatChanged, this, &GraphicsSubsystem::renderingContextChanged);
+	connect(this, &GraphicsSubsystem::framebufferPixelFormatChanged, this, &GraphicsSubsystem::renderingContextChanged);
 
 	return Error::None;
 }
 
 
+void
+GraphicsSubsystem::initializeContextState() {
+	// No frame has been rendered yet, so the frame stages' rendering context was
+	// set directly. The GUI thread's copy of its state starts out identical.
+	contextState_.framebufferResolutionIdentifier = renderingContext_.framebuffer.getResolutionIdentifier();
+	contextState_.framebufferResolution = renderingContext_.framebuffer.getResolution();
+	contextState_.framebufferDepthFormat = renderingContext_.framebuffer.getDepthFormat();
+	contextState_.framebufferPixelFormat = renderingContext_.framebuffer.getPixelFormat();
+	contextState_.shaderProgramIdentifier = renderingContext_.shaderProgramIdentifier;
+	contextState_.primitiveTopology = renderingContext_.primitiveTopology;
+	contextState_.enableClipping = renderingContext_.enableClipping;
+	contextState_.enableBackfaceCulling = renderingContext_.enableBackfaceCulling;
+	contextState_.polygonMode = renderingContext_.polygonMode;
+	contextState_.shadeModel = renderingContext_.shadeModel;
+	contextState_.enableLineAntiAliasing = renderingContext_.enableLineAntiAliasing;
+	contextState_.enableScissorTest = renderingContext_.enableScissorTest;
+	contextState_.enableStencilTest = renderingContext_.enableStencilTest;
+	contextState_.enableDepthTest = renderingContext_.enableDepthTest;
+	contextState_.enableSortLastRendering = enableSortLastRendering_;
+	contextState_.renderWorkerCount = 0;
+	contextState_.enableDeterministicRendering = enableDeterministicRendering_;
+	contextState_.normalizedScissorBox = renderingContext_.normalizedScissorBox;
+}
+
+
 const QSize&
 GraphicsSubsystem::getFramebufferResolution() const {
-	return renderingContext_.framebuffer.getResolution();
+	return contextState_.framebufferResolution;
 }
 
 
 void
 GraphicsSubsystem::setFramebufferResolution(const Framebuffer::Resolution resolutionIdentifier) {
-	if (renderingContext_.framebuffer.getResolutionIdentifier() != resolutionIdentifier) {
-		renderingContext_.framebuffer.setResolution(resolutionIdentifier);
-		updateScissorBox();
+	if (resolutionIdentifier == Framebuffer::Resolution::CUSTOM) {
+		qWarning("[GraphicsSubsystem::setFramebufferResolution] Use a QSize to set a custom resolution.");
+		return;
+	}
+	setFramebufferResolution(Framebuffer::getResolution(resolutionIdentifier));
+}
+
+
+void
+GraphicsSubsystem::setFramebufferResolution(const QSize& resolution) {
+	if (!resolution.isValid()) {
+		qWarning("[GraphicsSubsystem::setFramebufferResolution] Invalid resolution.");
+		return;
+	}
+	if (contextState_.framebufferResolution != resolution) {
+		const auto resolutionIdentifier = Framebuffer::getResolutionIdentifier(resolution);
+		contextState_.framebufferResolutionIdentifier = resolutionIdentifier;
+		contextState_.framebufferResolution = resolution;
+		updateRenderingContext([resolution](RenderingContext& context) {
+			context.framebuffer.setResolution(resolution);
+		});
 		emit framebufferResolutionChanged(resolutionIdentifier);
 		emit framebufferResolutionChanged_(enum_traits<Framebuffer::Resolution>::ordinal(resolutionIdentifier));
+		emit framebufferSizeChanged(resolution);
 	}
 }
 
 
-void
-GraphicsSubsystem::clear() {
-	renderingContext_.framebuffer.clear();
+clockwork::Framebuffer::DepthFormat
+GraphicsSubsystem::getFramebufferDepthFormat() const {
+	return contextState_.framebufferDepthFormat;
 }
 
 
 void
-GraphicsSubsystem::render(const Scene& scene) {
-	static QElapsedTimer TIMER;
-	if (!TIMER.isValid()) {
-		TIMER.start();
+GraphicsSubsystem::setFramebufferDepthFormat(const Framebuffer::DepthFormat format) {
+	if (contextState_.framebufferDepthFormat != format) {
+		contextState_.framebufferDepthFormat = format;
+		updateRenderingContext([format](RenderingContext& context) { context.framebuffer.setDepthFormat(format); });
+		emit framebufferDepthFormatChanged(format);
+		emit framebufferDepthFormatChanged_(enum_traits<Framebuffer::DepthFormat>::ordinal(format));
 	}
-	frameRenderTime_ = TIMER.elapsed();
+}
 
-	const auto* const viewer = scene.getViewer();
-	if (viewer != nullptr) {
-		const QMatrix4x4& VIEW = viewer->getViewTransform();
-		const QMatrix4x4& PROJECTION = viewer->getProjectionTransform();
-		const QMatrix4x4& VIEWPROJECTION = viewer->getViewProjectionTransform();
 
-		renderingContext_.viewportTransform = viewer->getViewportTransform();
+clockwork::Framebuffer::PixelFormat
+GraphicsSubsystem::getFramebufferPixelFormat() const {
+	return contextState_.framebufferPixelFormat;
+}
 
-		renderingContext_.uniforms.insert("PROJECTION", Uniform::create<const QMatrix4x4>(PROJECTION));
-		renderingContext_.uniforms.insert("VIEW", Uniform::create<const QMatrix4x4>(VIEW));
-		renderingContext_.uniforms.insert("viewpoint", Uniform::create<const QVector3D>(viewer->getPosition()));
-		renderingContext_.uniforms.insert("VIEWPROJECTION", Uniform::create<const QMatrix4x4>(VIEWPROJECTION));
 
-		const auto draw = getDrawCommand();
+void
+GraphicsSubsystem::setFramebufferPixelFormat(const Framebuffer::PixelFormat format) {
+	if (contextState_.framebufferPixelFormat != format) {
+		contextState_.framebufferPixelFormat = format;
+		updateRenderingContext([format](RenderingContext& context) { context.framebuffer.setPixelFormat(format); });
+		emit framebufferPixelFormatChanged(format);
+		emit framebufferPixelFormatChanged_(enum_traits<Framebuffer::PixelFormat>::ordinal(format));
+	}
+}
 
-		for (const SceneObject* object : scene.getNodes<SceneObject>()) {
+
+void
+GraphicsSubsystem::prepare(const Scene& scene, FrameState& frame) const {
+	frame.objects.clear();
+
+	const auto* const viewer = scene.getViewer();
+	frame.hasViewer = viewer != nullptr;
+	if (viewer != nullptr) {
+		frame.view = viewer->getViewTransform();
+		frame.projection = viewer->getProjectionTransform();
+		frame.viewProjection = viewer->getViewProjectionTransform();
+		frame.viewportTransform = viewer->getViewportTransform();
+		frame.viewpoint = viewer->getPosition();
+		frame.textureFilter = viewer->getTextureFilter();
+		frame.imageFilters = viewer->getImageFilters();
+
+		const auto objects = scene.getNodes<SceneObject>();
+		for (int i = 0; i < objects.size(); ++i) {
+			const SceneObject* const object = objects[i];
 			if (object != nullptr && !object->isPruned() && viewer->isObjectVisible(*object)) {
 				const auto* appearance = object->getAppearance();
 				if (appearance != nullptr && appearance->hasMesh()) {
-					const auto& MODEL = object->getModelTransform();
-					const auto& MODELVIEW = VIEW * MODEL;
-					const auto& MODELVIEWPROJECTION = VIEWPROJECTION * MODEL;
-					const auto& INVERSE_MODEL = MODEL.inverted();
-					const auto& NORMAL = MODELVIEW.inverted().transposed();
-
-					renderingContext_.uniforms.insert("MODEL", Uniform::create<const QMatrix4x4>(MODEL));
-					renderingContext_.uniforms.insert("MODELVIEW", Uniform::create<const QMatrix4x4>(MODELVIEW));
-					renderingContext_.uniforms.insert("MODELVIEWPROJECTION", Uniform::create<const QMatrix4x4>(MODELVIEWPROJECTION));
-					renderingContext_.uniforms.insert("INVERSE_MODEL", Uniform::create<const QMatrix4x4>(INVERSE_MODEL));
-					renderingContext_.uniforms.insert("NORMAL", Uniform::create<const QMatrix4x4>(NORMAL));
-
-					draw(renderingContext_, *appearance->getMesh(), renderingContext_.framebuffer);
+					FrameState::Object frameObject;
+					frameObject.index = i;
+					frameObject.model = object->getModelTransform();
+					frameObject.mesh = appearance->getMesh();
+					frame.objects.append(frameObject);
 				}
 			}
 		}
 	}
+}
+
+
+namespace {
+/**
+ * Returns true if the specified mesh lies entirely outside the view frustum, i.e. if
+ * each corner of its bounding box is on the outer side of the same clipping plane.
+ */
+bool
+isOutsideViewFrustum(const clockwork::Mesh& mesh, const QMatrix4x4& MODELVIEWPROJECTION) {
+	if (mesh.positions.isEmpty()) {
+		return true;
+	}
+	QVector3D minimum = mesh.positions.first();
+	QVector3D maximum = minimum;
+	for (const auto& position : mesh.positions) {
+		minimum = QVector3D(std::min(minimum.x(), position.x()), std::min(minimum.y(), position.y()), std::min(minimum.z(), position.z()));
+		maximum = QVector3D(std::max(maximum.x(), position.x()), std::max(maximum.y(), position.y()), std::max(maximum.z(), position.z()));
+	}
+	// Each bit of the outcode is set if the corner is outside a clipping plane.
+	unsigned int outcode = 0x3f;
+	for (unsigned int corner = 0; corner < 8; ++corner) {
+		const QVector4D position = MODELVIEWPROJECTION * QVector4D(
+			(corner & 1) ? maximum.x() : minimum.x(),
+			(corner & 2) ? maximum.y() : minimum.y(),
+			(corner & 4) ? maximum.z() : minimum.z(),
+			1.0f
+		);
+		const float w = position.w();
+		outcode &=
+			(position.x() < -w ? 0x01 : 0) |
+			(position.x() >  w ? 0x02 : 0) |
+			(position.y() < -w ? 0x04 : 0) |
+			(position.y() >  w ? 0x08 : 0) |
+			(position.z() < -w ? 0x10 : 0) |
+			(position.z() >  w ? 0x20 : 0);
+		if (outcode == 0) {
+			break;
+		}
+	}
+	return outcode != 0;
+}
+} // namespace
+
+
+void
+GraphicsSubsystem::cull(FrameState& frame) const {
+	if (!frame.hasViewer) {
+		frame.objects.clear();
+		return;
+	}
+	std::vector<char> isVisible(frame.objects.size());
+	parallelFor(frame.objects.size(), [&frame, &isVisible](const std::size_t i) {
+		auto& object = frame.objects[static_cast<int>(i)];
+		object.modelView = frame.view * object.model;
+		object.modelViewProjection = frame.viewProjection * object.model;
+		object.inverseModel = object.model.inverted();
+		object.normal = object.modelView.inverted().transposed();
+		isVisible[i] = !isOutsideViewFrustum(*object.mesh, object.modelViewProjection);
+	});
+
+	QList<FrameState::Object> visibleObjects;
+	for (int i = 0; i < frame.objects.size(); ++i) {
+		if (isVisible[i]) {
+			visibleObjects.append(frame.objects[i]);
+		}
+	}
+	frame.objects.swap(visibleObjects);
+}
+
+
+void
+GraphicsSubsystem::draw(const FrameState& frame) {
+	frameTimer_.start();
+
+	// The rendering context is only modified between frames, so it remains unchanged
+	// while the frame is rendered.
+	applyRenderingContextChanges();
+	renderingContext_.framebuffer.clear();
+
+	if (frame.hasViewer) {
+		renderingContext_.viewportTransform = frame.viewportTransform;
+
+		// The fixed-point depth formats map the viewport's depth range, i.e. the
+		// window-space depth of the near and far clipping planes, to their full range.
+		const qreal depthScale = renderingContext_.viewportTransform(2, 0);
+		const qreal depthTranslation = renderingContext_.viewportTransform(2, 1);
+		const qreal depthRangeNear = depthTranslation - depthScale;
+		const qreal depthRangeFar = depthTranslation + depthScale;
+		renderingContext_.framebuffer.setDepthRange(depthRangeNear, depthRangeFar);
+
+		renderingContext_.uniforms.insert("PROJECTION", Uniform::create<const QMatrix4x4>(frame.projection));
+		renderingContext_.uniforms.insert("VIEW", Uniform::create<const QMatrix4x4>(frame.view));
+		renderingContext_.uniforms.insert("viewpoint", Uniform::create<const QVector3D>(frame.viewpoint));
+		renderingContext_.uniforms.insert("VIEWPROJECTION", Uniform::create<const QMatrix4x4>(frame.viewProjection));
+
+		const auto* const textureFilter = TextureFilterFactory::getInstance().get(frame.textureFilter);
+		if (textureFilter != nullptr) {
+			renderingContext_.uniforms.insert("TEXTURE_FILTER", Uniform::create<const TextureFilter>(*textureFilter));
+		} else {
+			renderingContext_.uniforms.remove("TEXTURE_FILTER");
+		}
+
+		// The merged layers only match a serial draw if the frame doesn't depend on
+		// the order objects are drawn in. Where pixels have equal depths, the merged
+		// result depends on how objects are divided among layers, so deterministic
+		// frames always use the same number of layers. Workers are never used since
+		// the objects of those that don't reply in time are drawn to the framebuffer
+		// instead of a layer.
+		const bool isOrderIndependent = renderingContext_.enableDepthTest && !renderingContext_.enableStencilTest;
+		const int maximumLayerCount = enableDeterministicRendering_ ? DETERMINISTIC_LAYER_COUNT : QThread::idealThreadCount();
+		const int layerCount = std::min(maximumLayerCount, frame.objects.size());
+		const bool hasRenderWorkers = renderCluster_ != nullptr && renderCluster_->getWorkerCount() > 0;
+		if (hasRenderWorkers && !enableDeterministicRendering_ && frame.objects.size() > 1 && isOrderIndependent) {
+			drawDistributed(frame);
+		} else if (enableSortLastRendering_ && layerCount > 1 && isOrderIndependent) {
+			drawLayers(frame, layerCount, depthRangeNear, depthRangeFar);
+		} else {
+			for (const auto& object : frame.objects) {
+				drawObject(renderingContext_, object);
+			}
+		}
+	}
+}
+
+
+void
+GraphicsSubsystem::drawObject(RenderingContext& context, const FrameState::Object& object) {
+	context.uniforms.insert("MODEL", Uniform::create<const QMatrix4x4>(object.model));
+	context.uniforms.insert("MODELVIEW", Uniform::create<const QMatrix4x4>(object.modelView));
+	context.uniforms.insert("MODELVIEWPROJECTION", Uniform::create<const QMatrix4x4>(object.modelViewProjection));
+	context.uniforms.insert("INVERSE_MODEL", Uniform::create<const QMatrix4x4>(object.inverseModel));
+	context.uniforms.insert("NORMAL", Uniform::create<const QMatrix4x4>(object.normal));
+
+	const auto* const diffuseMap = object.mesh->material.diffuse;
+	if (diffuseMap != nullptr) {
+		context.uniforms.insert("DIFFUSE_MAP", Uniform::create<const Texture>(*diffuseMap));
+	} else {
+		context.uniforms.remove("DIFFUSE_MAP");
+	}
+
+	const auto draw = getDrawCommand();
+	draw(context, *object.mesh, context.framebuffer);
+}
+
+
+namespace {
+/**
+ * Divides the frame's objects into the specified number of disjoint subsets that have
+ * about as many faces, by adding the largest remaining object to the subset with the
+ * fewest faces. Each subset holds the positions of its objects in the frame, in the
+ * order they are drawn.
+ */
+std::vector<std::vector<int>>
+partition(const GraphicsSubsystem::FrameState& frame, const int count) {
+	std::vector<int> objects(frame.objects.size());
+	std::iota(objects.begin(), objects.end(), 0);
+	std::stable_sort(objects.begin(), objects.end(), [&frame](const int a, const int b) {
+		return frame.objects[a].mesh->faces.size() > frame.objects[b].mesh->faces.size();
+	});
+	std::vector<std::vector<int>> subsets(count);
+	std::vector<int> faceCounts(count, 0);
+	for (const int object : objects) {
+		const auto subset = std::min_element(faceCounts.begin(), faceCounts.end()) - faceCounts.begin();
+		subsets[subset].push_back(object);
+		faceCounts[subset] += frame.objects[object].mesh->faces.size();
+	}
+	// Each subset's objects are drawn in the scene's order, so a subset matches the
+	// part of a serial draw that its objects contribute.
+	for (auto& subset : subsets) {
+		std::sort(subset.begin(), subset.end());
+	}
+	return subsets;
+}
+} // namespace
+
+
+void
+GraphicsSubsystem::drawLayers(const FrameState& frame, const int layerCount, const qreal depthRangeNear, const qreal depthRangeFar) {
+	const auto subsets = partition(frame, layerCount);
+
+	// The layers draw with the same state as the rendering context, to framebuffers
+	// that match its own. They are kept between frames so they're only reallocated
+	// when the framebuffer changes.
+	const auto& framebuffer = renderingContext_.framebuffer;
+	layers_.resize(layerCount - 1);
+	for (auto& layer : layers_) {
+		if (layer == nullptr) {
+			layer.reset(new RenderingContext);
+			layer->framebuffer.enableFastClear();
+		}
+		layer->shaderProgramIdentifier = renderingContext_.shaderProgramIdentifier;
+		layer->primitiveTopology = renderingContext_.primitiveTopology;
+		layer->enableClipping = renderingContext_.enableClipping;
+		layer->enableBackfaceCulling = renderingContext_.enableBackfaceCulling;
+		layer->polygonMode = renderingContext_.polygonMode;
+		layer->shadeModel = renderingContext_.shadeModel;
+		layer->enableLineAntiAliasing = renderingContext_.enableLineAntiAliasing;
+		layer->uniforms = renderingContext_.uniforms;
+		layer->enableScissorTest = renderingContext_.enableScissorTest;
+		layer->enableStencilTest = renderingContext_.enableStencilTest;
+		layer->enableDepthTest = renderingContext_.enableDepthTest;
+		layer->viewportTransform = renderingContext_.viewportTransform;
+		layer->normalizedScissorBox = renderingContext_.normalizedScissorBox;
+		layer->scissorBox = renderingContext_.scissorBox;
+		layer->framebuffer.setLayout(framebuffer.getLayout());
+		layer->framebuffer.setResolution(framebuffer.getResolution());
+		layer->framebuffer.setDepthFormat(framebuffer.getDepthFormat());
+		layer->framebuffer.setDepthRange(depthRangeNear, depthRangeFar);
+		layer->framebuffer.setDepthBufferClearValue(framebuffer.getDepthBufferClearValue());
+		layer->framebuffer.enableDepthCompression(framebuffer.isDepthCompressionEnabled());
+	}
+
+	parallelFor(layerCount, [this, &frame, &subsets](const std::size_t i) {
+		auto& context = i == 0 ? renderingContext_ : *layers_[i - 1];
+		if (i > 0) {
+			context.framebuffer.clear();
+		}
+		for (const int object : subsets[i]) {
+			drawObject(context, frame.objects[object]);
+		}
+	});
+	for (const auto& layer : layers_) {
+		renderingContext_.framebuffer.composite(layer->framebuffer);
+	}
+}
+
+
+void
+GraphicsSubsystem::drawDistributed(const FrameState& frame) {
+	// The workers draw their subsets while the first one is drawn here.
+	auto subsets = partition(frame, renderCluster_->getWorkerCount() + 1);
+	const auto localSubset = std::move(subsets.front());
+	subsets.erase(subsets.begin());
+
+	renderCluster_->beginFrame(renderingContext_, frame, subsets);
+	for (const int object : localSubset) {
+		drawObject(renderingContext_, frame.objects[object]);
+	}
+	renderCluster_->endFrame(renderingContext_.framebuffer, [this, &frame, &subsets](const std::size_t subset) {
+		for (const int object : subsets[subset]) {
+			drawObject(renderingContext_, frame.objects[object]);
+		}
+	});
+}
+
+
+void
+GraphicsSubsystem::filter(const FrameState& frame) {
+	// Apply the viewer's post-processing image filters in the order they were added.
+	if (frame.hasViewer) {
+		imageFilterChain_.apply(frame.imageFilters, renderingContext_, renderingContext_.framebuffer);
+	}
+}
 
-	frameRenderTime_ = TIMER.elapsed() - frameRenderTime_;
+
+void
+GraphicsSubsystem::present() {
+	// Tiles that weren't drawn to must be filled with their clear values and the pixel
+	// buffer copied to the output buffer, which is then presented to the user interface.
+	// Each swap chain has a single consumer, so the framebuffer view and the image
+	// provider are handed their own copies.
+	renderingContext_.framebuffer.resolve();
+	frameHash_ = enableDeterministicRendering_ ? renderingContext_.framebuffer.getHash() : 0;
+	swapChain_.present(renderingContext_.framebuffer);
+	snapshotSwapChain_.present(renderingContext_.framebuffer);
+
+	// Load the texture pages that were requested while the frame was rendered, and
+	// evict those that haven't been sampled recently.
+	PageCache::getInstance().update();
+
+	frameRenderTime_ = static_cast<int>(frameTimer_.elapsed());
 }
 
 
@@ -144,6 +493,18 @@ GraphicsSubsystem::getFramebuffer() {
 }
 
 
+clockwork::SwapChain&
+GraphicsSubsystem::getSwapChain() {
+	return swapChain_;
+}
+
+
+clockwork::SwapChain&
+GraphicsSubsystem::getSnapshotSwapChain() {
+	return snapshotSwapChain_;
+}
+
+
 bool
 GraphicsSubsystem::isFpsCounterEnabled() const {
 	return false;
@@ -158,14 +519,15 @@ GraphicsSubsystem::enableFpsCounter(const bool enable) {
 
 clockwork::ShaderProgramIdentifier
 GraphicsSubsystem::getShaderProgramIdentifier() const {
-	return renderingContext_.shaderProgramIdentifier;
+	return contextState_.shaderProgramIdentifier;
 }
 
 
 void
 GraphicsSubsystem::setShaderProgram(const ShaderProgramIdentifier identifier) {
-	if (renderingContext_.shaderProgramIdentifier != identifier) {
-		renderingContext_.shaderProgramIdentifier = identifier;
+	if (contextState_.shaderProgramIdentifier != identifier) {
+		contextState_.shaderProgramIdentifier = identifier;
+		updateRenderingContext([identifier](RenderingContext& context) { context.shaderProgramIdentifier = identifier; });
 		emit shaderProgramChanged(identifier);
 		emit shaderProgramChanged_(enum_traits<ShaderProgramIdentifier>::ordinal(identifier));
 	}
@@ -174,14 +536,15 @@ GraphicsSubsystem::setShaderProgram(const ShaderProgramIdentifier identifier) {
 
 clockwork::PrimitiveTopology
 GraphicsSubsystem::getPrimitiveTopology() const {
-	return renderingContext_.primitiveTopology;
+	return contextState_.primitiveTopology;
 }
 
 
 void
 GraphicsSubsystem::setPrimitiveTopology(const PrimitiveTopology topology) {
-	if (renderingContext_.primitiveTopology != topology) {
-		renderingContext_.primitiveTopology = topology;
+	if (contextState_.primitiveTopology != topology) {
+		contextState_.primitiveTopology = topology;
+		updateRenderingContext([topology](RenderingContext& context) { context.primitiveTopology = topology; });
 		emit primitiveTopologyChanged(topology);
 		emit primitiveTopologyChanged_(enum_traits<PrimitiveTopology>::ordinal(topology));
 	}
@@ -190,14 +553,15 @@ GraphicsSubsystem::setPrimitiveTopology(const PrimitiveTopology topology) {
 
 bool
 GraphicsSubsystem::isClippingEnabled() const {
-	return renderingContext_.enableClipping;
+	return contextState_.enableClipping;
 }
 
 
 void
 GraphicsSubsystem::enableClipping(const bool enable) {
-	if (renderingContext_.enableClipping != enable) {
-		renderingContext_.enableClipping = enable;
+	if (contextState_.enableClipping != enable) {
+		contextState_.enableClipping = enable;
+		updateRenderingContext([enable](RenderingContext& context) { context.enableClipping = enable; });
 		emit clippingToggled(enable);
 	}
 }
@@ -205,14 +569,15 @@ GraphicsSubsystem::enableClipping(const bool enable) {
 
 bool
 GraphicsSubsystem::isBackfaceCullingEnabled() const {
-	return renderingContext_.enableBackfaceCulling;
+	return contextState_.enableBackfaceCulling;
 }
 
 
 void
 GraphicsSubsystem::enableBackfaceCulling(const bool enable) {
-	if (renderingContext_.enableBackfaceCulling != enable) {
-		renderingContext_.enableBackfaceCulling = enable;
+	if (contextState_.enableBackfaceCulling != enable) {
+		contextState_.enableBackfaceCulling = enable;
+		updateRenderingContext([enable](RenderingContext& context) { context.enableBackfaceCulling = enable; });
 		emit backfaceCullingToggled(enable);
 	}
 }
@@ -220,14 +585,15 @@ GraphicsSubsystem::enableBackfaceCulling(const bool enable) {
 
 clockwork::PolygonMode
 GraphicsSubsystem::getPolygonMode() const {
-	return renderingContext_.polygonMode;
+	return contextState_.polygonMode;
 }
 
 
 void
 GraphicsSubsystem::setPolygonMode(const PolygonMode mode) {
-	if (renderingContext_.polygonMode != mode) {
-		renderingContext_.polygonMode = mode;
+	if (contextState_.polygonMode != mode) {
+		contextState_.polygonMode = mode;
+		updateRenderingContext([mode](RenderingContext& context) { context.polygonMode = mode; });
 		emit polygonModeChanged(mode);
 		emit polygonModeChanged_(enum_traits<PolygonMode>::ordinal(mode));
 	}
@@ -236,14 +602,15 @@ GraphicsSubsystem::setPolygonMode(const PolygonMode mode) {
 
 clockwork::ShadeModel
 GraphicsSubsystem::getShadeModel() const {
-	return renderingContext_.shadeModel;
+	return contextState_.shadeModel;
 }
 
 
 void
 GraphicsSubsystem::setShadeModel(const ShadeModel model) {
-	if (renderingContext_.shadeModel != model) {
-		renderingContext_.shadeModel = model;
+	if (contextState_.shadeModel != model) {
+		contextState_.shadeModel = model;
+		updateRenderingContext([model](RenderingContext& context) { context.shadeModel = model; });
 		emit shadeModelChanged(model);
 		emit shadeModelChanged_(enum_traits<ShadeModel>::ordinal(model));
 	}
@@ -252,14 +619,15 @@ GraphicsSubsystem::setShadeModel(const ShadeModel model) {
 
 bool
 GraphicsSubsystem::isLineAntiAliasingEnabled() const {
-	return renderingContext_.enableLineAntiAliasing;
+	return contextState_.enableLineAntiAliasing;
 }
 
 
 void
 GraphicsSubsystem::enableLineAntiAliasing(const bool enable) {
-	if (renderingContext_.enableLineAntiAliasing != enable) {
-		renderingContext_.enableLineAntiAliasing = enable;
+	if (contextState_.enableLineAntiAliasing != enable) {
+		contextState_.enableLineAntiAliasing = enable;
+		updateRenderingContext([enable](RenderingContext& context) { context.enableLineAntiAliasing = enable; });
 		emit lineAntiAliasingToggled(enable);
 	}
 }
@@ -267,14 +635,15 @@ GraphicsSubsystem::enableLineAntiAliasing(const bool enable) {
 
 bool
 GraphicsSubsystem::isScissorTestEnabled() const {
-	return renderingContext_.enableScissorTest;
+	return contextState_.enableScissorTest;
 }
 
 
 void
 GraphicsSubsystem::enableScissorTest(const bool enable) {
-	if (renderingContext_.enableScissorTest != enable) {
-		renderingContext_.enableScissorTest = enable;
+	if (contextState_.enableScissorTest != enable) {
+		contextState_.enableScissorTest = enable;
+		updateRenderingContext([enable](RenderingContext& context) { context.enableScissorTest = enable; });
 		emit scissorTestToggled(enable);
 	}
 }
@@ -282,14 +651,15 @@ GraphicsSubsystem::enableScissorTest(const bool enable) {
 
 bool
 GraphicsSubsystem::isStencilTestEnabled() const {
-	return renderingContext_.enableStencilTest;
+	return contextState_.enableStencilTest;
 }
 
 
 void
 GraphicsSubsystem::enableStencilTest(const bool enable) {
-	if (renderingContext_.enableStencilTest != enable) {
-		renderingContext_.enableStencilTest = enable;
+	if (contextState_.enableStencilTest != enable) {
+		contextState_.enableStencilTest = enable;
+		updateRenderingContext([enable](RenderingContext& context) { context.enableStencilTest = enable; });
 		emit stencilTestToggled(enable);
 	}
 }
@@ -297,30 +667,95 @@ GraphicsSubsystem::enableStencilTest(const bool enable) {
 
 bool
 GraphicsSubsystem::isDepthTestEnabled() const {
-	return renderingContext_.enableDepthTest;
+	return contextState_.enableDepthTest;
 }
 
 
 void
 GraphicsSubsystem::enableDepthTest(const bool enable) {
-	if (renderingContext_.enableDepthTest != enable) {
-		renderingContext_.enableDepthTest = enable;
+	if (contextState_.enableDepthTest != enable) {
+		contextState_.enableDepthTest = enable;
+		updateRenderingContext([enable](RenderingContext& context) { context.enableDepthTest = enable; });
 		emit depthTestToggled(enable);
 	}
 }
 
 
+bool
+GraphicsSubsystem::isSortLastRenderingEnabled() const {
+	return contextState_.enableSortLastRendering;
+}
+
+
+void
+GraphicsSubsystem::enableSortLastRendering(const bool enable) {
+	if (contextState_.enableSortLastRendering != enable) {
+		contextState_.enableSortLastRendering = enable;
+		updateRenderingContext([this, enable](RenderingContext&) { enableSortLastRendering_ = enable; });
+		emit sortLastRenderingToggled(enable);
+	}
+}
+
+
+int
+GraphicsSubsystem::getRenderWorkerCount() const {
+	return contextState_.renderWorkerCount;
+}
+
+
+void
+GraphicsSubsystem::setRenderWorkerCount(const int count) {
+	if (contextState_.renderWorkerCount != count && count >= 0) {
+		contextState_.renderWorkerCount = count;
+		// The cluster is created here since its workers connect in the background, so
+		// the draw stage only swaps it in.
+		std::shared_ptr<RenderCluster> cluster(count > 0 ? new RenderCluster(count) : nullptr);
+		updateRenderingContext([this, cluster](RenderingContext&) {
+			renderCluster_ = cluster;
+		});
+	}
+}
+
+
+bool
+GraphicsSubsystem::isDeterministicRenderingEnabled() const {
+	return contextState_.enableDeterministicRendering;
+}
+
+
+void
+GraphicsSubsystem::enableDeterministicRendering(const bool enable) {
+	if (contextState_.enableDeterministicRendering != enable) {
+		contextState_.enableDeterministicRendering = enable;
+		updateRenderingContext([this, enable](RenderingContext&) {
+			enableDeterministicRendering_ = enable;
+			PageCache::getInstance().enableDeterministicLoading(enable);
+		});
+		emit deterministicRenderingToggled(enable);
+	}
+}
+
+
+QString
+GraphicsSubsystem::getFrameHash_() const {
+	const std::uint64_t hash = frameHash_;
+	return hash != 0 ? QString("%1").arg(hash, 16, 16, QChar('0')) : QString();
+}
+
+
 const QRectF&
 GraphicsSubsystem::getNormalizedScissorBox() const {
-	return renderingContext_.normalizedScissorBox;
+	return contextState_.normalizedScissorBox;
 }
 
 
 void
 GraphicsSubsystem::setNormalizedScissorBox(const QRectF& normalizedScissorBox) {
-	if (renderingContext_.normalizedScissorBox != normalizedScissorBox) {
-		renderingContext_.normalizedScissorBox = normalizedScissorBox;
-		updateScissorBox();
+	if (contextState_.normalizedScissorBox != normalizedScissorBox) {
+		contextState_.normalizedScissorBox = normalizedScissorBox;
+		updateRenderingContext([normalizedScissorBox](RenderingContext& context) {
+			context.normalizedScissorBox = normalizedScissorBox;
+		});
 		emit normalizedScissorBoxChanged(normalizedScissorBox);
 	}
 }
@@ -348,6 +783,35 @@ void
 }
 
 
+void
+GraphicsSubsystem::updateRenderingContext(std::function<void(RenderingContext&)>&& change) {
+	// Changes that don't fit in the queue are kept until the draw stage makes room,
+	// and must stay behind older changes that are still pending.
+	flushRenderingContextChanges();
+	if (!pendingRenderingContextChanges_.empty() || !renderingContextChanges_.push(std::move(change))) {
+		pendingRenderingContextChanges_.push_back(std::move(change));
+	}
+}
+
+
+void
+GraphicsSubsystem::flushRenderingContextChanges() {
+	while (!pendingRenderingContextChanges_.empty() && renderingContextChanges_.push(std::move(pendingRenderingContextChanges_.front()))) {
+		pendingRenderingContextChanges_.pop_front();
+	}
+}
+
+
+void
+GraphicsSubsystem::applyRenderingContextChanges() {
+	std::function<void(RenderingContext&)> change;
+	while (renderingContextChanges_.pop(change)) {
+		change(renderingContext_);
+	}
+	updateScissorBox();
+}
+
+
 void
 GraphicsSubsystem::updateScissorBox() {
 	const int w = renderingContext_.framebuffer.getWidth();
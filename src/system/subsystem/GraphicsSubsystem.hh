@@ -26,10 +26,23 @@
 #define CLOCKWORK_GRAPHICS_SUBSYSTEM_HH
 
 #include "RenderingContext.hh"
+#include "ImageFilterChain.hh"
+#include "SwapChain.hh"
+#include "TextureFilter.hh"
+#include "SpscQueue.hh"
 #include "Error.hh"
+#include <QElapsedTimer>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
 
 
 namespace clockwork {
+namespace testsuite {
+class TestSortLastRendering;
+} // namespace testsuite
 /**
  * @see ApplicationSettings.hh.
  */
@@ -38,6 +51,10 @@ class ApplicationSettings;
  * @see Mesh.hh.
  */
 class Mesh;
+/**
+ * @see RenderCluster.hh.
+ */
+class RenderCluster;
 /**
  * @see scene/Scene.hh.
  */
@@ -58,16 +75,30 @@ class GraphicsSubsystem : public QObject {
 	Q_PROPERTY(bool enableScissorTest READ isScissorTestEnabled WRITE enableScissorTest NOTIFY scissorTestToggled)
 	Q_PROPERTY(bool enableStencilTest READ isStencilTestEnabled WRITE enableStencilTest NOTIFY stencilTestToggled)
 	Q_PROPERTY(bool enableDepthTest READ isDepthTestEnabled WRITE enableDepthTest NOTIFY depthTestToggled)
+	Q_PROPERTY(bool enableSortLastRendering READ isSortLastRenderingEnabled WRITE enableSortLastRendering NOTIFY sortLastRenderingToggled)
+	Q_PROPERTY(bool enableDeterministicRendering READ isDeterministicRenderingEnabled WRITE enableDeterministicRendering NOTIFY deterministicRenderingToggled)
 	Q_PROPERTY(QRectF normalizedScissorBox READ getNormalizedScissorBox WRITE setNormalizedScissorBox NOTIFY normalizedScissorBoxChanged)
 	Q_PROPERTY(int framebufferResolution READ getFramebufferResolution_ WRITE setFramebufferResolution_ NOTIFY framebufferResolutionChanged_)
+	Q_PROPERTY(QSize framebufferSize READ getFramebufferResolution WRITE setFramebufferResolution NOTIFY framebufferSizeChanged)
+	Q_PROPERTY(int framebufferDepthFormat READ getFramebufferDepthFormat_ WRITE setFramebufferDepthFormat_ NOTIFY framebufferDepthFormatChanged_)
+	Q_PROPERTY(int framebufferPixelFormat READ getFramebufferPixelFormat_ WRITE setFramebufferPixelFormat_ NOTIFY framebufferPixelFormatChanged_)
 	Q_PROPERTY(int frameRenderTime READ getFrameRenderTime CONSTANT)
+	Q_PROPERTY(QString frameHash READ getFrameHash_ CONSTANT)
 	friend class Service;
+	friend class testsuite::TestSortLastRendering;
 	static_assert(std::is_same<int, enum_traits<ShaderProgramIdentifier>::Ordinal>::value);
 	static_assert(std::is_same<int, enum_traits<PrimitiveTopology>::Ordinal>::value);
 	static_assert(std::is_same<int, enum_traits<PolygonMode>::Ordinal>::value);
 	static_assert(std::is_same<int, enum_traits<ShadeModel>::Ordinal>::value);
 	static_assert(std::is_same<int, enum_traits<Framebuffer::Resolution>::Ordinal>::value);
+	static_assert(std::is_same<int, enum_traits<Framebuffer::DepthFormat>::Ordinal>::value);
+	static_assert(std::is_same<int, enum_traits<Framebuffer::PixelFormat>::Ordinal>::value);
 public:
+	/**
+	 * The number of layers that sort-last rendering draws with in deterministic mode,
+	 * regardless of the number of threads.
+	 */
+	static constexpr int DETERMINISTIC_LAYER_COUNT = 4;
 	/**
 	 *
 	 */
@@ -84,6 +115,10 @@ public:
 	 *
 	 */
 	GraphicsSubsystem& operator=(GraphicsSubsystem&&) = delete;
+	/**
+	 * Disconnects from the render workers, if any.
+	 */
+	~GraphicsSubsystem();
 	/**
 	 * Initializes the graphics engine.
 	 * @param settings the application's settings.
@@ -97,13 +132,19 @@ public:
 	 * Returns the framebuffer resolution identifier as an integer value.
 	 */
 	inline int getFramebufferResolution_() const {
-		return enum_traits<Framebuffer::Resolution>::ordinal(renderingContext_.framebuffer.getResolutionIdentifier());
+		return enum_traits<Framebuffer::Resolution>::ordinal(contextState_.framebufferResolutionIdentifier);
 	}
 	/**
-	 * Sets the framebuffer's resolution.
+	 * Sets the framebuffer's resolution. Resolution::CUSTOM has no predefined size,
+	 * so it is rejected: use the QSize overload to set a custom resolution.
 	 * @param resolutionIdentifier the identifier of the resolution to set.
 	 */
 	void setFramebufferResolution(const Framebuffer::Resolution resolutionIdentifier);
+	/**
+	 * Sets the framebuffer's resolution to an arbitrary size.
+	 * @param resolution the resolution to set.
+	 */
+	void setFramebufferResolution(const QSize& resolution);
 	/**
 	 * Sets the framebuffer's resolution.
 	 * @param resolution the integer value of the resolution identifier to set.
@@ -112,17 +153,175 @@ public:
 		setFramebufferResolution(enum_traits<Framebuffer::Resolution>::enumerator(resolution));
 	}
 	/**
-	 * Clears the framebuffer.
+	 * Returns the framebuffer's depth format.
+	 */
+	Framebuffer::DepthFormat getFramebufferDepthFormat() const;
+	/**
+	 * Returns the framebuffer's depth format as an integer value.
 	 */
-	void clear();
+	inline int getFramebufferDepthFormat_() const {
+		return enum_traits<Framebuffer::DepthFormat>::ordinal(getFramebufferDepthFormat());
+	}
 	/**
-	 * Renders the specified scene.
+	 * Sets the framebuffer's depth format.
+	 * @param format the depth format to set.
 	 */
-	void render(const Scene& scene);
+	void setFramebufferDepthFormat(const Framebuffer::DepthFormat format);
+	/**
+	 * Sets the framebuffer's depth format.
+	 * @param format the integer value of the depth format to set.
+	 */
+	inline void setFramebufferDepthFormat_(const int format) {
+		setFramebufferDepthFormat(enum_traits<Framebuffer::DepthFormat>::enumerator(format));
+	}
+	/**
+	 * Returns the framebuffer's pixel format.
+	 */
+	Framebuffer::PixelFormat getFramebufferPixelFormat() const;
+	/**
+	 * Returns the framebuffer's pixel format as an integer value.
+	 */
+	inline int getFramebufferPixelFormat_() const {
+		return enum_traits<Framebuffer::PixelFormat>::ordinal(getFramebufferPixelFormat());
+	}
+	/**
+	 * Sets the framebuffer's pixel format.
+	 * @param format the pixel format to set.
+	 */
+	void setFramebufferPixelFormat(const Framebuffer::PixelFormat format);
+	/**
+	 * Sets the framebuffer's pixel format.
+	 * @param format the integer value of the pixel format to set.
+	 */
+	inline void setFramebufferPixelFormat_(const int format) {
+		setFramebufferPixelFormat(enum_traits<Framebuffer::PixelFormat>::enumerator(format));
+	}
+	/**
+	 * The state of the scene that a frame is rendered from.
+	 */
+	struct FrameState {
+		/**
+		 * An object that is drawn.
+		 */
+		struct Object {
+			/**
+			 * The object's position among the scene's objects, which identifies it in
+			 * render workers.
+			 */
+			int index;
+			/**
+			 * The object's model transform.
+			 */
+			QMatrix4x4 model;
+			/**
+			 * The object's polygon mesh.
+			 */
+			const Mesh* mesh;
+			/**
+			 * The object's model-view transform.
+			 */
+			QMatrix4x4 modelView;
+			/**
+			 * The object's model-view-projection transform.
+			 */
+			QMatrix4x4 modelViewProjection;
+			/**
+			 * The inverse of the object's model transform.
+			 */
+			QMatrix4x4 inverseModel;
+			/**
+			 * The object's normal transform.
+			 */
+			QMatrix4x4 normal;
+		};
+		/**
+		 * True if the scene has a viewer, false otherwise. Nothing is drawn without one.
+		 */
+		bool hasViewer = false;
+		/**
+		 * The viewer's view transform.
+		 */
+		QMatrix4x4 view;
+		/**
+		 * The viewer's projection transform.
+		 */
+		QMatrix4x4 projection;
+		/**
+		 * The viewer's combined view and projection transforms.
+		 */
+		QMatrix4x4 viewProjection;
+		/**
+		 * The viewer's viewport transform.
+		 */
+		QMatrix2x3 viewportTransform;
+		/**
+		 * The viewer's position.
+		 */
+		QVector3D viewpoint;
+		/**
+		 * The viewer's texture filter.
+		 */
+		TextureFilter::Identifier textureFilter;
+		/**
+		 * The viewer's post-processing image filters, in the order they are applied.
+		 */
+		QList<ImageFilter::Identifier> imageFilters;
+		/**
+		 * The objects that have a polygon mesh and, once the frame is culled, are
+		 * potentially visible.
+		 */
+		QList<Object> objects;
+	};
+	/**
+	 * Captures the state of the specified scene that a frame is rendered from. This
+	 * must be called from the thread that modifies the scene.
+	 * @param scene the scene to capture.
+	 * @param frame the frame state to fill.
+	 */
+	void prepare(const Scene& scene, FrameState& frame) const;
+	/**
+	 * Moves the rendering context changes that didn't fit in the queue to it, in the
+	 * order they were made, until the queue is full. This must be called from the
+	 * GUI thread before a frame is started, so that the frame's draw stage applies them.
+	 */
+	void flushRenderingContextChanges();
+	/**
+	 * Computes the transforms of the frame's objects and removes those that lie
+	 * outside the viewer's view frustum. This does not access the rendering context,
+	 * so it may run while another frame is drawn.
+	 * @param frame the frame state to cull.
+	 */
+	void cull(FrameState& frame) const;
+	/**
+	 * Applies the rendering context changes made since the previous frame, clears the
+	 * framebuffer and draws the frame's objects.
+	 * @param frame the frame to draw.
+	 */
+	void draw(const FrameState& frame);
+	/**
+	 * Applies the viewer's post-processing image filters to the drawn frame.
+	 * @param frame the frame to filter.
+	 */
+	void filter(const FrameState& frame);
+	/**
+	 * Resolves the framebuffer and presents the frame to the swap chain, then updates
+	 * the texture page cache. The draw, filter and present stages of one frame must
+	 * complete before those of the next frame begin.
+	 */
+	void present();
 	/**
 	 * Returns the framebuffer instance.
 	 */
 	Framebuffer& getFramebuffer();
+	/**
+	 * Returns the swap chain that completed frames are presented to.
+	 */
+	SwapChain& getSwapChain();
+	/**
+	 * Returns the swap chain that completed frames and their stencil values are
+	 * presented to, for consumers other than the framebuffer view.
+	 */
+	SwapChain& getSnapshotSwapChain();
 	/**
 	 * Returns true if the FPS counter is enabled, false otherwise.
 	 */
@@ -274,6 +473,48 @@ public:
 	 * @param enable enables the depth test if set to true, disables it otherwise.
 	 */
 	void enableDepthTest(const bool enable = true);
+	/**
+	 * Returns true if sort-last rendering is enabled, false otherwise.
+	 */
+	bool isSortLastRenderingEnabled() const;
+	/**
+	 * Toggles sort-last rendering, where disjoint subsets of a frame's objects are
+	 * drawn concurrently to separate framebuffers that are then merged by depth.
+	 * Frames are drawn serially while the depth test is disabled or the stencil test
+	 * is enabled, since their result then depends on the order objects are drawn in.
+	 * @param enable enables sort-last rendering if set to true, disables it otherwise.
+	 */
+	void enableSortLastRendering(const bool enable = true);
+	/**
+	 * Returns the number of worker processes that frames are drawn with.
+	 */
+	int getRenderWorkerCount() const;
+	/**
+	 * Sets the number of worker processes that frames are drawn with. Each frame's
+	 * objects are divided among the workers and the application itself, and the
+	 * workers' tiles are merged by depth into the framebuffer. As with sort-last
+	 * rendering, frames are drawn locally when their result depends on the order
+	 * objects are drawn in. The workers are launched in the background, and frames
+	 * are drawn locally until they connect.
+	 * @param count the number of workers, or 0 to draw frames locally.
+	 * @see RenderCluster.hh.
+	 */
+	void setRenderWorkerCount(const int count);
+	/**
+	 * Returns true if deterministic rendering is enabled, false otherwise.
+	 */
+	bool isDeterministicRenderingEnabled() const;
+	/**
+	 * Toggles deterministic rendering, where a frame's pixels only depend on the scene
+	 * and the rendering context, and not on the number of threads, the order tasks
+	 * run in or how long they take. Sort-last rendering then draws a fixed number of
+	 * layers, frames are drawn locally instead of in render workers, and texture pages
+	 * are loaded deterministically. Each frame's hash is also computed, so frames can
+	 * be compared across runs.
+	 * @param enable enables deterministic rendering if set to true, disables it otherwise.
+	 * @see PageCache::enableDeterministicLoading.
+	 */
+	void enableDeterministicRendering(const bool enable = true);
 	/**
 	 * Returns the viewport's normalized scissor box.
 	 */
@@ -289,28 +530,214 @@ public:
 	int getFrameRenderTime() const {
 		return frameRenderTime_;
 	}
+	/**
+	 * Returns the hash of the previous frame's pixels if deterministic rendering is
+	 * enabled, 0 otherwise.
+	 * @see Framebuffer::getHash.
+	 */
+	std::uint64_t getFrameHash() const {
+		return frameHash_;
+	}
+	/**
+	 * Returns the hash of the previous frame's pixels as a hexadecimal string, or an
+	 * empty string if deterministic rendering is disabled.
+	 */
+	QString getFrameHash_() const;
 private:
 	/**
 	 * Instantiates a GraphicsSubsystem object.
 	 */
 	GraphicsSubsystem() = default;
+	/**
+	 * Copies the rendering context's state to the GUI thread's copy of it. This must
+	 * be called once the rendering context is set up, before any frame is drawn.
+	 */
+	void initializeContextState();
 	/**
 	 * Returns the current shader program's draw command.
 	 */
 	void (*getDrawCommand())(const RenderingContext&, const Mesh&, Framebuffer&);
+	/**
+	 * Sets the specified object's uniforms in the rendering context and draws the
+	 * object to the context's framebuffer.
+	 * @param context the rendering context to draw with.
+	 * @param object the object to draw.
+	 */
+	void drawObject(RenderingContext& context, const FrameState::Object& object);
+	/**
+	 * Draws disjoint subsets of the frame's objects concurrently, the first to the
+	 * framebuffer and the others to layers, then merges the layers into the framebuffer.
+	 * @param frame the frame to draw.
+	 * @param layerCount the number of subsets, including the framebuffer's.
+	 * @param depthRangeNear the framebuffer's smallest window-space depth value.
+	 * @param depthRangeFar the framebuffer's largest window-space depth value.
+	 */
+	void drawLayers(const FrameState& frame, const int layerCount, const qreal depthRangeNear, const qreal depthRangeFar);
+	/**
+	 * Draws disjoint subsets of the frame's objects, the first to the framebuffer and
+	 * the others in the render workers, then merges the workers' tiles into the
+	 * framebuffer.
+	 * @param frame the frame to draw.
+	 */
+	void drawDistributed(const FrameState& frame);
+	/**
+	 * Queues a change to the rendering context, which is applied before the next frame
+	 * is drawn. This must be called from the GUI thread.
+	 * @param change the function that applies the change to the rendering context.
+	 */
+	void updateRenderingContext(std::function<void(RenderingContext&)>&& change);
+	/**
+	 * Applies the queued rendering context changes. This must be called by the draw
+	 * stage, between two frames.
+	 */
+	void applyRenderingContextChanges();
 	/**
 	 * Updates the viewport's scissor box based on the normalized scissor box
 	 * and the framebuffer's current resolution.
 	 */
 	void updateScissorBox();
 	/**
-	 * The rendering context.
+	 * The state of the rendering context as last set on the GUI thread. The frame
+	 * stages' rendering context catches up with it at the start of each frame.
+	 */
+	struct ContextState {
+		/**
+		 * The framebuffer's resolution identifier.
+		 */
+		Framebuffer::Resolution framebufferResolutionIdentifier;
+		/**
+		 * The framebuffer's resolution.
+		 */
+		QSize framebufferResolution;
+		/**
+		 * The framebuffer's depth format.
+		 */
+		Framebuffer::DepthFormat framebufferDepthFormat;
+		/**
+		 * The framebuffer's pixel format.
+		 */
+		Framebuffer::PixelFormat framebufferPixelFormat;
+		/**
+		 * The shader program's identifier.
+		 */
+		ShaderProgramIdentifier shaderProgramIdentifier;
+		/**
+		 * The primitive topology.
+		 */
+		PrimitiveTopology primitiveTopology;
+		/**
+		 * True if clipping is enabled, false otherwise.
+		 */
+		bool enableClipping;
+		/**
+		 * True if backface culling is enabled, false otherwise.
+		 */
+		bool enableBackfaceCulling;
+		/**
+		 * The polygon mode.
+		 */
+		PolygonMode polygonMode;
+		/**
+		 * The shade model.
+		 */
+		ShadeModel shadeModel;
+		/**
+		 * True if line anti-aliasing is enabled, false otherwise.
+		 */
+		bool enableLineAntiAliasing;
+		/**
+		 * True if the scissor test is enabled, false otherwise.
+		 */
+		bool enableScissorTest;
+		/**
+		 * True if the stencil test is enabled, false otherwise.
+		 */
+		bool enableStencilTest;
+		/**
+		 * True if the depth test is enabled, false otherwise.
+		 */
+		bool enableDepthTest;
+		/**
+		 * True if sort-last rendering is enabled, false otherwise.
+		 */
+		bool enableSortLastRendering;
+		/**
+		 * The number of render workers.
+		 */
+		int renderWorkerCount;
+		/**
+		 * True if deterministic rendering is enabled, false otherwise.
+		 */
+		bool enableDeterministicRendering;
+		/**
+		 * The normalized scissor box.
+		 */
+		QRectF normalizedScissorBox;
+	};
+	/**
+	 * The rendering context, which only the frame stages access once initialized.
 	 */
 	RenderingContext renderingContext_;
 	/**
-	 * The time it took to render the previous frame in milliseconds.
+	 * The state of the rendering context as last set on the GUI thread.
 	 */
-	int frameRenderTime_;
+	ContextState contextState_;
+	/**
+	 * True if the draw stage uses sort-last rendering, false otherwise.
+	 */
+	bool enableSortLastRendering_ = false;
+	/**
+	 * True if the frame stages render deterministically, false otherwise.
+	 */
+	bool enableDeterministicRendering_ = false;
+	/**
+	 * The rendering contexts that the draw stage draws subsets of a frame's objects
+	 * with during sort-last rendering, besides the rendering context itself.
+	 */
+	std::vector<std::unique_ptr<RenderingContext>> layers_;
+	/**
+	 * The render workers that the draw stage divides frames among, if any.
+	 */
+	std::shared_ptr<RenderCluster> renderCluster_;
+	/**
+	 * The rendering context changes made on the GUI thread that the draw stage
+	 * hasn't applied yet.
+	 */
+	SpscQueue<std::function<void(RenderingContext&)>, 256> renderingContextChanges_;
+	/**
+	 * The rendering context changes made on the GUI thread that didn't fit in the
+	 * queue, oldest first. They are only accessed by the GUI thread, which moves them
+	 * to the queue before any newer change, so that the GUI thread never waits for
+	 * the draw stage.
+	 */
+	std::deque<std::function<void(RenderingContext&)>> pendingRenderingContextChanges_;
+	/**
+	 * Measures the time it takes to draw, filter and present a frame.
+	 */
+	QElapsedTimer frameTimer_;
+	/**
+	 * The chain that applies the scene viewer's image filters to rendered frames.
+	 */
+	ImageFilterChain imageFilterChain_;
+	/**
+	 * The swap chain that hands completed frames to the user interface.
+	 */
+	SwapChain swapChain_;
+	/**
+	 * The swap chain that hands completed frames, along with their stencil values,
+	 * to the framebuffer image provider.
+	 */
+	SwapChain snapshotSwapChain_{true};
+	/**
+	 * The time it took to render the previous frame in milliseconds. It is written by
+	 * the present stage and read by the GUI thread.
+	 */
+	std::atomic<int> frameRenderTime_{0};
+	/**
+	 * The hash of the previous frame's pixels, or 0 if deterministic rendering is
+	 * disabled. It is written by the present stage and read by the GUI thread.
+	 */
+	std::atomic<std::uint64_t> frameHash_{0};
 signals:
 	/**
 	 * A signal that is emitted when the rendering context changes.
@@ -384,6 +811,14 @@ signals:
 	 * A signal that is emitted when the depth test is toggled.
 	 */
 	void depthTestToggled(const bool enabled);
+	/**
+	 * A signal that is emitted when sort-last rendering is toggled.
+	 */
+	void sortLastRenderingToggled(const bool enabled);
+	/**
+	 * A signal that is emitted when deterministic rendering is toggled.
+	 */
+	void deterministicRenderingToggled(const bool enabled);
 	/**
 	 * A signal that is emitted when the viewport's normalized scissor box changes.
 	 * @param scissorBox the new scissor box.
@@ -399,6 +834,31 @@ signals:
 	 * @param resolution the integer value of the new framebuffer resolution's identifier.
 	 */
 	void framebufferResolutionChanged_(const int resolution);
+	/**
+	 * A signal that is emitted when the framebuffer's resolution changes.
+	 * @param resolution the new framebuffer resolution.
+	 */
+	void framebufferSizeChanged(const QSize& resolution);
+	/**
+	 * A signal that is emitted when the framebuffer's depth format changes.
+	 * @param format the new depth format.
+	 */
+	void framebufferDepthFormatChanged(const Framebuffer::DepthFormat format);
+	/**
+	 * A signal that is emitted when the framebuffer's depth format changes.
+	 * @param format the integer value of the new depth format.
+	 */
+	void framebufferDepthFormatChanged_(const int format);
+	/**
+	 * A signal that is emitted when the framebuffer's pixel format changes.
+	 * @param format the new pixel format.
+	 */
+	void framebufferPixelFormatChanged(const Framebuffer::PixelFormat format);
+	/**
+	 * A signal that is emitted when the framebuffer's pixel format changes.
+	 * @param format the integer value of the new pixel format.
+	 */
+	void framebufferPixelFormatChanged_(const int format);
 };
 } // namespace clockwork
 #endif // CLOCKWORK_GRAPHICS_SUBSYSTEM_HH
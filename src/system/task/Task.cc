@@ -23,15 +23,63 @@
  * THE SOFTWARE.
  */
 #include "Task.hh"
+#include <QMutexLocker>
 
 using clockwork::Task;
 
 
-Task::Task(const int priority) :
-priority_(priority) {}
+Task::Task(const Priority priority) :
+priority_(priority),
+deadline_(-1),
+dueTime_(0),
+sequenceNumber_(0),
+autoDelete_(true),
+dependencies_(1),
+finished_(false),
+released_(false) {}
 
 
-int
+Task::Priority
 Task::getPriority() const {
 	return priority_;
 }
+
+
+int
+Task::getDeadline() const {
+	return deadline_;
+}
+
+
+void
+Task::setDeadline(const int deadline) {
+	deadline_ = deadline;
+}
+
+
+bool
+Task::autoDelete() const {
+	return autoDelete_;
+}
+
+
+void
+Task::setAutoDelete(const bool autoDelete) {
+	autoDelete_ = autoDelete;
+}
+
+
+bool
+Task::isFinished() const {
+	return finished_.load(std::memory_order_acquire);
+}
+
+
+void
+Task::then(Task& continuation) {
+	QMutexLocker locker(&mutex_);
+	if (!released_) {
+		continuation.dependencies_.fetch_add(1, std::memory_order_relaxed);
+		continuations_.push_back(&continuation);
+	}
+}
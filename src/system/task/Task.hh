@@ -25,15 +25,27 @@
 #ifndef CLOCKWORK_TASK_HH
 #define CLOCKWORK_TASK_HH
 
-#include <QRunnable>
+#include <QMutex>
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
 
 
 namespace clockwork {
 /**
- *
+ * A unit of work that is executed by the TaskManager.
  */
-class Task : public QRunnable {
+class Task {
 public:
+	/**
+	 * The priority class that a task is scheduled with. Ready tasks of a higher class
+	 * are executed before those of a lower class.
+	 */
+	enum class Priority {
+		Background,  // Work that may be deferred, such as streaming assets from disk.
+		Normal,      // Work that has no particular urgency.
+		Critical     // Work that the current frame depends on.
+	};
 	/**
 	 *
 	 */
@@ -42,6 +54,10 @@ public:
 	 *
 	 */
 	Task(const Task&&) = delete;
+	/**
+	 *
+	 */
+	virtual ~Task() = default;
 	/**
 	 *
 	 */
@@ -53,23 +69,98 @@ public:
 	/**
 	 * Return the task's priority.
 	 */
-	int getPriority() const;
-//public slots:
+	Priority getPriority() const;
+	/**
+	 * Returns the task's soft deadline, in milliseconds, or -1 if it has none.
+	 */
+	int getDeadline() const;
+	/**
+	 * Sets the task's soft deadline, i.e. the time within which the task should start
+	 * once it's ready for execution. A task whose deadline has passed is executed before
+	 * any other ready task, whatever its priority. This function must be called before
+	 * the task is submitted.
+	 * @param deadline the deadline in milliseconds, or -1 if the task has none.
+	 */
+	void setDeadline(const int deadline);
+	/**
+	 * Returns true if the task is deleted by the TaskManager once it has been executed,
+	 * false otherwise. Tasks are deleted automatically by default.
+	 */
+	bool autoDelete() const;
+	/**
+	 * Sets whether the task is deleted by the TaskManager once it has been executed.
+	 * A task that is waited upon must not be deleted automatically.
+	 */
+	void setAutoDelete(const bool autoDelete);
+	/**
+	 * Returns true if the task has been executed, false otherwise.
+	 */
+	bool isFinished() const;
+	/**
+	 * Makes the specified task a continuation of this task, i.e. the continuation will
+	 * not be scheduled before this task has been executed. A task may be the continuation
+	 * of several tasks, in which case it is scheduled once all of them have been executed.
+	 * The continuation must still be submitted to the TaskManager. If this task is
+	 * deleted automatically, this function must be called before it's submitted.
+	 * @param continuation the task to execute once this task has been executed.
+	 */
+	void then(Task& continuation);
 	/**
-	 * Terminate the task's execution.
+	 * Executes the task.
 	 */
-//   void terminate();
+	virtual void run() = 0;
 protected:
 	/**
 	 * Instantiate a task with a specified priority.
 	 * @param priority the tasks's priority.
 	 */
-	explicit Task(const int priority = 0);
+	explicit Task(const Priority priority = Priority::Normal);
 private:
+	friend class TaskManager;
 	/**
 	 * The task's priority.
 	 */
-	const int priority_;
+	const Priority priority_;
+	/**
+	 * The task's soft deadline, in milliseconds.
+	 */
+	int deadline_;
+	/**
+	 * The time at which the task's deadline passes, on the TaskManager's clock. This is
+	 * set when the task becomes ready for execution.
+	 */
+	qint64 dueTime_;
+	/**
+	 * The order in which the task became ready for execution, which breaks ties
+	 * between tasks with the same due time.
+	 */
+	quint64 sequenceNumber_;
+	/**
+	 * True if the task is deleted once it has been executed.
+	 */
+	bool autoDelete_;
+	/**
+	 * The number of events that must occur before the task can be scheduled, i.e. its
+	 * submission plus the execution of each task that it is a continuation of.
+	 */
+	std::atomic<int> dependencies_;
+	/**
+	 * True once the task has been executed. This is the last member that the TaskManager
+	 * writes, so a task that has finished may be safely destroyed.
+	 */
+	std::atomic<bool> finished_;
+	/**
+	 * A mutex that guards the continuation list.
+	 */
+	QMutex mutex_;
+	/**
+	 * True once the task's continuations have been released. Guarded by the mutex.
+	 */
+	bool released_;
+	/**
+	 * The tasks that are scheduled once this task has been executed.
+	 */
+	std::vector<Task*> continuations_;
 };
 } // namespace clockwork
 
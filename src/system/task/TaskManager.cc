@@ -23,5 +23,596 @@
  * THE SOFTWARE.
  */
 #include "TaskManager.hh"
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
 
+using clockwork::Task;
 using clockwork::TaskManager;
+
+
+constexpr int TaskManager::CRITICAL_BUDGET;
+constexpr int TaskManager::NORMAL_BUDGET;
+
+
+/**
+ * A bounded work-stealing deque (Chase and Lev, as formalized for the C++11 memory
+ * model by Lê et al.). The owning worker pushes and pops tasks at the bottom without
+ * locking, while other threads steal tasks from the top.
+ */
+class TaskManager::Deque {
+public:
+	/**
+	 * The maximum number of tasks in the deque.
+	 */
+	static constexpr std::int64_t CAPACITY = 1024;
+	/**
+	 * The size of a cache line, in bytes.
+	 */
+	static constexpr std::size_t CACHE_LINE_SIZE = 64;
+	/**
+	 * Instantiates an empty Deque object.
+	 */
+	Deque() :
+	top_(0),
+	bottom_(0) {
+		for (auto& task : tasks_) {
+			task.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+	/**
+	 * Pushes a task onto the bottom of the deque. Returns false if the deque is full.
+	 * This function may only be called by the deque's owner.
+	 */
+	bool push(Task* const task) {
+		const auto b = bottom_.load(std::memory_order_relaxed);
+		const auto t = top_.load(std::memory_order_acquire);
+		if (b - t >= CAPACITY) {
+			return false;
+		}
+		tasks_[b & (CAPACITY - 1)].store(task, std::memory_order_relaxed);
+		bottom_.store(b + 1, std::memory_order_release);
+		return true;
+	}
+	/**
+	 * Pops a task from the bottom of the deque, or returns nullptr if it's empty. This
+	 * function may only be called by the deque's owner.
+	 */
+	Task* pop() {
+		const auto b = bottom_.load(std::memory_order_relaxed) - 1;
+		bottom_.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto t = top_.load(std::memory_order_relaxed);
+
+		Task* task = nullptr;
+		if (t <= b) {
+			task = tasks_[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (t == b) {
+				// The last task may be stolen concurrently, in which case the thief wins.
+				if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					task = nullptr;
+				}
+				bottom_.store(b + 1, std::memory_order_relaxed);
+			}
+		} else {
+			bottom_.store(b + 1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+	/**
+	 * Steals a task from the top of the deque, or returns nullptr if it's empty or
+	 * the task was taken by another thread.
+	 */
+	Task* steal() {
+		auto t = top_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const auto b = bottom_.load(std::memory_order_acquire);
+		if (t < b) {
+			auto* const task = tasks_[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				return task;
+			}
+		}
+		return nullptr;
+	}
+private:
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "The capacity must be a power of two.");
+	/**
+	 * The index of the task at the top of the deque, which is only ever incremented.
+	 */
+	std::atomic<std::int64_t> top_;
+	/**
+	 * Keeps the top and bottom indices on separate cache lines, so that thieves and
+	 * the owner don't falsely share them. The deque is padded rather than over-aligned,
+	 * since operator new ignores extended alignments before C++17.
+	 */
+	char padding_[CACHE_LINE_SIZE - sizeof(std::atomic<std::int64_t>)];
+	/**
+	 * The index one past the task at the bottom of the deque.
+	 */
+	std::atomic<std::int64_t> bottom_;
+	/**
+	 * The tasks, indexed modulo the capacity.
+	 */
+	std::array<std::atomic<Task*>, CAPACITY> tasks_;
+};
+
+
+constexpr std::int64_t TaskManager::Deque::CAPACITY;
+constexpr std::size_t TaskManager::Deque::CACHE_LINE_SIZE;
+
+
+/**
+ * A worker thread executes tasks until its TaskManager stops.
+ */
+class TaskManager::Worker final : public QThread {
+public:
+	/**
+	 * Instantiates a Worker object.
+	 * @param manager the TaskManager that the worker belongs to.
+	 * @param index the worker's position in the manager's worker list.
+	 */
+	Worker(TaskManager& manager, const std::size_t index) :
+	manager_(manager),
+	index_(index) {}
+	/**
+	 * Returns the TaskManager that the worker belongs to.
+	 */
+	TaskManager& getManager() const {
+		return manager_;
+	}
+	/**
+	 * Returns the worker's position in the manager's worker list.
+	 */
+	std::size_t getIndex() const {
+		return index_;
+	}
+	/**
+	 * Returns the worker's task deque.
+	 */
+	Deque& getDeque() {
+		return deque_;
+	}
+protected:
+	/**
+	 * Executes tasks until the TaskManager stops.
+	 */
+	void run() override {
+		currentWorker_ = this;
+		while (auto* const task = manager_.acquire(*this)) {
+			manager_.execute(*task);
+		}
+		currentWorker_ = nullptr;
+	}
+private:
+	/**
+	 * The TaskManager that the worker belongs to.
+	 */
+	TaskManager& manager_;
+	/**
+	 * The worker's position in the manager's worker list.
+	 */
+	const std::size_t index_;
+	/**
+	 * The tasks that were submitted by the worker.
+	 */
+	Deque deque_;
+};
+
+
+thread_local TaskManager::Worker* TaskManager::currentWorker_ = nullptr;
+thread_local const Task* TaskManager::currentTask_ = nullptr;
+
+
+TaskManager::TaskManager() :
+streaks_{{0, 0, 0}},
+sequenceNumber_(0),
+backgroundTaskLimit_(1),
+queuedBackgroundTasks_(0),
+runningBackgroundTasks_(0),
+queued_(0),
+sleeping_(0),
+stopping_(false),
+waiting_(0) {
+	// One core is left to the GUI thread, which also executes the tasks it forks
+	// whenever it waits for them.
+	const auto workerCount = static_cast<std::size_t>(std::max(1, QThread::idealThreadCount() - 1));
+
+	// Background tasks are only preempted at task boundaries, so at least half of the
+	// workers are kept available for the tasks that the current frame depends on.
+	backgroundTaskLimit_ = std::max<int>(1, workerCount / 2);
+	clock_.start();
+	for (std::size_t i = 0; i < workerCount; ++i) {
+		workers_.emplace_back(new Worker(*this, i));
+	}
+	for (auto& worker : workers_) {
+		worker->start();
+	}
+}
+
+
+TaskManager::~TaskManager() {
+	{
+		QMutexLocker locker(&mutex_);
+		stopping_ = true;
+		taskAvailable_.wakeAll();
+	}
+	for (auto& worker : workers_) {
+		worker->wait();
+	}
+}
+
+
+std::size_t
+TaskManager::getWorkerCount() const {
+	return workers_.size();
+}
+
+
+std::size_t
+TaskManager::getBackgroundTaskLimit() const {
+	return static_cast<std::size_t>(backgroundTaskLimit_);
+}
+
+
+void
+TaskManager::submit(Task* const task) {
+	if (task != nullptr) {
+		release(*task);
+	}
+}
+
+
+void
+TaskManager::wait(const Task& task) {
+	auto* const worker = getCurrentWorker();
+	if (worker != nullptr) {
+		while (!task.isFinished()) {
+			auto* const other = take(worker, false);
+			if (other != nullptr) {
+				execute(*other);
+			} else {
+				QThread::yieldCurrentThread();
+			}
+		}
+		return;
+	}
+	// Any other thread, such as the GUI thread, must not be held up by unrelated
+	// tasks, so it only executes the task it waits for, and only if no worker has
+	// taken it yet.
+	auto* const reclaimed = reclaim(task);
+	if (reclaimed != nullptr) {
+		execute(*reclaimed);
+	}
+	if (!task.finished_.load(std::memory_order_seq_cst)) {
+		QMutexLocker locker(&mutex_);
+		waiting_.fetch_add(1, std::memory_order_seq_cst);
+		while (!task.finished_.load(std::memory_order_seq_cst)) {
+			taskFinished_.wait(&mutex_);
+		}
+		waiting_.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+
+namespace {
+/**
+ * A task that processes a range of indices on behalf of TaskManager::parallelFor.
+ */
+class Range final : public Task {
+public:
+	/**
+	 * Instantiates a Range object.
+	 */
+	Range(TaskManager& manager, const Priority priority, const std::size_t begin, const std::size_t end, const std::size_t grain, const std::function<void(std::size_t)>& function) :
+	Task(priority),
+	manager_(manager),
+	begin_(begin),
+	end_(end),
+	grain_(grain),
+	function_(function) {
+		setAutoDelete(false);
+	}
+	/**
+	 * Processes the range of indices [begin, end). A range that is larger than the
+	 * grain size is split in two: the upper half is forked as a new task while the
+	 * lower half is processed, and the halves are joined before returning.
+	 */
+	void run() override {
+		process(manager_, getPriority(), begin_, end_, grain_, function_);
+	}
+	/**
+	 * Processes the range of indices [begin, end).
+	 */
+	static void process(TaskManager& manager, const Priority priority, const std::size_t begin, const std::size_t end, const std::size_t grain, const std::function<void(std::size_t)>& function) {
+		if (end - begin > grain) {
+			const auto middle = begin + (end - begin) / 2;
+			Range upper(manager, priority, middle, end, grain, function);
+			manager.submit(&upper);
+			process(manager, priority, begin, middle, grain, function);
+			manager.wait(upper);
+		} else {
+			for (auto i = begin; i < end; ++i) {
+				function(i);
+			}
+		}
+	}
+private:
+	/**
+	 * The TaskManager that executes the forked halves.
+	 */
+	TaskManager& manager_;
+	/**
+	 * The first index in the range.
+	 */
+	const std::size_t begin_;
+	/**
+	 * The index one past the last index in the range.
+	 */
+	const std::size_t end_;
+	/**
+	 * The size of the ranges that are no longer split.
+	 */
+	const std::size_t grain_;
+	/**
+	 * The function that processes a single index.
+	 */
+	const std::function<void(std::size_t)>& function_;
+};
+} // namespace
+
+
+void
+TaskManager::parallelFor(const std::size_t count, const std::function<void(std::size_t)>& function) {
+	// Splitting the range into a few times as many tasks as there are threads is
+	// enough for stealing to balance uneven workloads.
+	const auto grain = std::max<std::size_t>(1, count / (8 * (workers_.size() + 1)));
+
+	// A thread that isn't executing a task waits for the loop to complete, which makes
+	// the loop critical.
+	const auto priority = currentTask_ != nullptr ? currentTask_->getPriority() : Task::Priority::Critical;
+	Range::process(*this, priority, 0, count, grain, function);
+}
+
+
+void
+TaskManager::schedule(Task* const task) {
+	queued_.fetch_add(1, std::memory_order_seq_cst);
+
+	// Background tasks are always placed in the shared queues, so that they are
+	// scheduled according to their priority rather than in fork-join order.
+	auto* const worker = getCurrentWorker();
+	const auto background = task->priority_ == Task::Priority::Background;
+	if (background || worker == nullptr || !worker->getDeque().push(task)) {
+		QMutexLocker locker(&queueMutex_);
+		const auto now = clock_.elapsed();
+		task->dueTime_ = task->deadline_ < 0 ? std::numeric_limits<qint64>::max() : now + task->deadline_;
+		task->sequenceNumber_ = sequenceNumber_++;
+
+		auto& queue = queues_[static_cast<std::size_t>(task->priority_)];
+		queue.push_back(task);
+		std::push_heap(queue.begin(), queue.end(), isLater);
+		if (background) {
+			queuedBackgroundTasks_.fetch_add(1, std::memory_order_seq_cst);
+		}
+	}
+	if (sleeping_.load(std::memory_order_seq_cst) > 0) {
+		QMutexLocker locker(&mutex_);
+		taskAvailable_.wakeOne();
+	}
+}
+
+
+void
+TaskManager::release(Task& task) {
+	if (task.dependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		schedule(&task);
+	}
+}
+
+
+void
+TaskManager::execute(Task& task) {
+	const auto background = task.priority_ == Task::Priority::Background;
+	const auto* const previousTask = currentTask_;
+	currentTask_ = &task;
+	task.run();
+	currentTask_ = previousTask;
+
+	std::vector<Task*> continuations;
+	{
+		QMutexLocker locker(&task.mutex_);
+		task.released_ = true;
+		continuations.swap(task.continuations_);
+	}
+	for (auto* const continuation : continuations) {
+		release(*continuation);
+	}
+	if (task.autoDelete_) {
+		delete &task;
+	} else {
+		task.finished_.store(true, std::memory_order_seq_cst);
+		if (waiting_.load(std::memory_order_seq_cst) > 0) {
+			QMutexLocker locker(&mutex_);
+			taskFinished_.wakeAll();
+		}
+	}
+
+	// A worker may be waiting for a background task to complete before it can take
+	// the next one.
+	if (background) {
+		runningBackgroundTasks_.fetch_sub(1, std::memory_order_seq_cst);
+		if (queuedBackgroundTasks_.load(std::memory_order_seq_cst) > 0 && sleeping_.load(std::memory_order_seq_cst) > 0) {
+			QMutexLocker locker(&mutex_);
+			taskAvailable_.wakeOne();
+		}
+	}
+}
+
+
+Task*
+TaskManager::take(Worker* const worker, const bool background) {
+	if (queued_.load(std::memory_order_acquire) <= 0) {
+		return nullptr;
+	}
+	Task* task = nullptr;
+	if (worker != nullptr) {
+		task = worker->getDeque().pop();
+	}
+	if (task == nullptr) {
+		QMutexLocker locker(&queueMutex_);
+		task = dequeue(background);
+	}
+	// Steal from the other workers, starting with the next one so that thieves spread
+	// out rather than contend for the same deque.
+	const auto workerCount = workers_.size();
+	const auto first = worker != nullptr ? worker->getIndex() + 1 : 0;
+	for (std::size_t i = 0; task == nullptr && i < workerCount; ++i) {
+		auto& victim = *workers_[(first + i) % workerCount];
+		if (&victim != worker) {
+			task = victim.getDeque().steal();
+		}
+	}
+	if (task != nullptr) {
+		queued_.fetch_sub(1, std::memory_order_relaxed);
+	}
+	return task;
+}
+
+
+Task*
+TaskManager::dequeue(const bool background) {
+	const auto& isEligible = [this, background](const std::size_t priority) {
+		if (queues_[priority].empty()) {
+			return false;
+		} else if (priority == static_cast<std::size_t>(Task::Priority::Background)) {
+			return background && runningBackgroundTasks_.load(std::memory_order_seq_cst) < backgroundTaskLimit_;
+		} else {
+			return true;
+		}
+	};
+	const auto priorityCount = queues_.size();
+
+	// A task whose deadline has passed is taken first, whatever its priority.
+	const auto now = clock_.elapsed();
+	auto selected = priorityCount;
+	for (std::size_t priority = 0; priority < priorityCount; ++priority) {
+		if (isEligible(priority)) {
+			const auto* const task = queues_[priority].front();
+			if (task->dueTime_ <= now && (selected == priorityCount || task->dueTime_ < queues_[selected].front()->dueTime_)) {
+				selected = priority;
+			}
+		}
+	}
+	// Otherwise, the task is taken from the highest priority class, unless it has
+	// exhausted its budget while lower priority tasks were waiting.
+	for (auto priority = priorityCount; selected == priorityCount && priority-- > 0;) {
+		if (isEligible(priority)) {
+			bool isLowerPriorityWaiting = false;
+			for (std::size_t lower = 0; lower < priority && !isLowerPriorityWaiting; ++lower) {
+				isLowerPriorityWaiting = isEligible(lower);
+			}
+			auto& streak = streaks_[priority];
+			if (isLowerPriorityWaiting && streak >= getBudget(static_cast<Task::Priority>(priority))) {
+				streak = 0;
+			} else {
+				streak = isLowerPriorityWaiting ? streak + 1 : 0;
+				selected = priority;
+			}
+		}
+	}
+	if (selected == priorityCount) {
+		return nullptr;
+	}
+
+	auto& queue = queues_[selected];
+	std::pop_heap(queue.begin(), queue.end(), isLater);
+	auto* const task = queue.back();
+	queue.pop_back();
+	if (task->priority_ == Task::Priority::Background) {
+		queuedBackgroundTasks_.fetch_sub(1, std::memory_order_seq_cst);
+		runningBackgroundTasks_.fetch_add(1, std::memory_order_seq_cst);
+	}
+	return task;
+}
+
+
+Task*
+TaskManager::reclaim(const Task& task) {
+	if (task.priority_ == Task::Priority::Background) {
+		return nullptr;
+	}
+	QMutexLocker locker(&queueMutex_);
+	auto& queue = queues_[static_cast<std::size_t>(task.priority_)];
+	const auto it = std::find(queue.begin(), queue.end(), &task);
+	if (it == queue.end()) {
+		return nullptr;
+	}
+	auto* const reclaimed = *it;
+	queue.erase(it);
+	std::make_heap(queue.begin(), queue.end(), isLater);
+	queued_.fetch_sub(1, std::memory_order_relaxed);
+	return reclaimed;
+}
+
+
+bool
+TaskManager::hasReadyTasks() const {
+	auto count = queued_.load(std::memory_order_seq_cst);
+	if (runningBackgroundTasks_.load(std::memory_order_seq_cst) >= backgroundTaskLimit_) {
+		count -= queuedBackgroundTasks_.load(std::memory_order_seq_cst);
+	}
+	return count > 0;
+}
+
+
+Task*
+TaskManager::acquire(Worker& worker) {
+	for (;;) {
+		auto* const task = take(&worker, true);
+		if (task != nullptr) {
+			return task;
+		}
+		QMutexLocker locker(&mutex_);
+		sleeping_.fetch_add(1, std::memory_order_seq_cst);
+		while (!hasReadyTasks() && !(stopping_ && queued_.load(std::memory_order_seq_cst) <= 0)) {
+			taskAvailable_.wait(&mutex_);
+		}
+		sleeping_.fetch_sub(1, std::memory_order_relaxed);
+		if (stopping_ && queued_.load(std::memory_order_seq_cst) <= 0) {
+			return nullptr;
+		}
+	}
+}
+
+
+int
+TaskManager::getBudget(const Task::Priority priority) {
+	switch (priority) {
+		case Task::Priority::Critical:
+			return CRITICAL_BUDGET;
+		case Task::Priority::Normal:
+			return NORMAL_BUDGET;
+		default:
+			return 0;
+	}
+}
+
+
+bool
+TaskManager::isLater(const Task* const a, const Task* const b) {
+	if (a->dueTime_ != b->dueTime_) {
+		return a->dueTime_ > b->dueTime_;
+	}
+	return a->sequenceNumber_ > b->sequenceNumber_;
+}
+
+
+TaskManager::Worker*
+TaskManager::getCurrentWorker() const {
+	auto* const worker = currentWorker_;
+	return worker != nullptr && &worker->getManager() == this ? worker : nullptr;
+}
@@ -25,9 +25,238 @@
 #ifndef CLOCKWORK_TASK_MANAGER_HH
 #define CLOCKWORK_TASK_MANAGER_HH
 
-namespace clockwork {
+#include "Task.hh"
+#include <QElapsedTimer>
+#include <QWaitCondition>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
 
-class TaskManager {};
+namespace clockwork {
+/**
+ * The TaskManager is the thread pool that executes the application's tasks. Each
+ * worker thread owns a deque of tasks: tasks submitted by a worker are pushed onto,
+ * and popped from, the bottom of its own deque, while idle workers steal tasks from
+ * the top of the other workers' deques. Tasks submitted by any other thread, and
+ * background tasks, are placed in shared queues, one per priority class, that all
+ * workers take tasks from.
+ *
+ * A worker picks a task from the shared queues at each task boundary: tasks whose
+ * soft deadline has passed come first, then tasks of the highest priority class that
+ * has not exhausted its budget. Within a class, tasks are ordered by their deadlines.
+ * Only so many background tasks may run concurrently, so that frame-critical work
+ * always finds idle workers.
+ */
+class TaskManager {
+public:
+	/**
+	 * The number of critical tasks that are executed in a row while tasks of a lower
+	 * priority are waiting.
+	 */
+	static constexpr int CRITICAL_BUDGET = 16;
+	/**
+	 * The number of normal tasks that are executed in a row while background tasks
+	 * are waiting.
+	 */
+	static constexpr int NORMAL_BUDGET = 4;
+	/**
+	 * Instantiates a TaskManager object and starts its worker threads.
+	 */
+	TaskManager();
+	/**
+	 *
+	 */
+	TaskManager(const TaskManager&) = delete;
+	/**
+	 *
+	 */
+	TaskManager(TaskManager&&) = delete;
+	/**
+	 * Executes the remaining tasks, then stops the worker threads.
+	 */
+	~TaskManager();
+	/**
+	 *
+	 */
+	TaskManager& operator=(const TaskManager&) = delete;
+	/**
+	 *
+	 */
+	TaskManager& operator=(TaskManager&&) = delete;
+	/**
+	 * Returns the number of worker threads.
+	 */
+	std::size_t getWorkerCount() const;
+	/**
+	 * Returns the maximum number of background tasks that are executed concurrently.
+	 */
+	std::size_t getBackgroundTaskLimit() const;
+	/**
+	 * Submits a task for execution. The task is scheduled once every task that it is
+	 * a continuation of has been executed.
+	 * @param task the task to execute.
+	 */
+	void submit(Task* const task);
+	/**
+	 * Waits for the specified task to be executed. Rather than block, a worker thread
+	 * executes other tasks in the meantime, except background tasks. Any other thread
+	 * executes the task itself if it's still in a shared queue, e.g. a task it forked
+	 * in parallelFor, and otherwise blocks until the task is executed.
+	 * @param task the task to wait for. The task must not be deleted automatically.
+	 */
+	void wait(const Task& task);
+	/**
+	 * Calls the specified function once for each index in the range [0, count), in
+	 * parallel. The range is split recursively, with one half forked as a task while
+	 * the calling thread processes the other, and the halves are joined before the
+	 * function returns. The forked tasks inherit the priority of the task that the
+	 * calling thread is executing, and are critical if it's not executing any.
+	 * @param count the number of indices to process.
+	 * @param function the function that processes a single index.
+	 */
+	void parallelFor(const std::size_t count, const std::function<void(std::size_t)>& function);
+private:
+	/**
+	 * A bounded work-stealing deque.
+	 */
+	class Deque;
+	/**
+	 * A worker thread.
+	 */
+	class Worker;
+	/**
+	 * Schedules a task whose dependencies have been satisfied.
+	 */
+	void schedule(Task* const task);
+	/**
+	 * Decrements the number of dependencies of the specified task, and schedules the
+	 * task once there are none left.
+	 */
+	void release(Task& task);
+	/**
+	 * Executes the specified task, then releases its continuations.
+	 */
+	void execute(Task& task);
+	/**
+	 * Takes a task that is ready for execution, or returns nullptr if there is none.
+	 * @param worker the calling worker, or nullptr if the caller is not a worker.
+	 * @param background true if a background task may be taken, false otherwise.
+	 */
+	Task* take(Worker* const worker, const bool background);
+	/**
+	 * Takes the next task from the shared queues, or returns nullptr if there is none.
+	 * The shared queues' mutex must be held.
+	 * @param background true if a background task may be taken, false otherwise.
+	 */
+	Task* dequeue(const bool background);
+	/**
+	 * Removes the specified task from the shared queues and returns it, or returns
+	 * nullptr if it isn't in them. Background tasks are never reclaimed.
+	 * @param task the task to reclaim.
+	 */
+	Task* reclaim(const Task& task);
+	/**
+	 * Returns true if a worker may take a task, false otherwise.
+	 */
+	bool hasReadyTasks() const;
+	/**
+	 * Takes a task for the specified worker, blocking until one is available. Returns
+	 * nullptr once the TaskManager is stopping and no tasks remain.
+	 */
+	Task* acquire(Worker& worker);
+	/**
+	 * Returns the calling thread's worker, or nullptr if it's not one of this
+	 * TaskManager's workers.
+	 */
+	Worker* getCurrentWorker() const;
+	/**
+	 * Returns the specified priority class's budget.
+	 */
+	static int getBudget(const Task::Priority priority);
+	/**
+	 * Returns true if task a is executed after task b when both have the same priority,
+	 * false otherwise.
+	 */
+	static bool isLater(const Task* const a, const Task* const b);
+	/**
+	 * The worker that the calling thread runs, if any.
+	 */
+	static thread_local Worker* currentWorker_;
+	/**
+	 * The task that the calling thread is executing, if any.
+	 */
+	static thread_local const Task* currentTask_;
+	/**
+	 * The worker threads.
+	 */
+	std::vector<std::unique_ptr<Worker>> workers_;
+	/**
+	 * The shared task queues, indexed by priority. Each queue is a heap ordered by
+	 * the tasks' due times.
+	 */
+	std::array<std::vector<Task*>, 3> queues_;
+	/**
+	 * The number of tasks of each priority class that were taken in a row while tasks
+	 * of a lower priority were waiting.
+	 */
+	std::array<int, 3> streaks_;
+	/**
+	 * The sequence number of the next task that is placed in a shared queue.
+	 */
+	quint64 sequenceNumber_;
+	/**
+	 * The clock that task deadlines are measured against.
+	 */
+	QElapsedTimer clock_;
+	/**
+	 * A mutex that guards the shared task queues.
+	 */
+	QMutex queueMutex_;
+	/**
+	 * The maximum number of background tasks that are executed concurrently.
+	 */
+	int backgroundTaskLimit_;
+	/**
+	 * The number of background tasks in the shared queues.
+	 */
+	std::atomic<int> queuedBackgroundTasks_;
+	/**
+	 * The number of background tasks that are being executed.
+	 */
+	std::atomic<int> runningBackgroundTasks_;
+	/**
+	 * The number of tasks that are ready for execution but have yet to be taken.
+	 */
+	std::atomic<int> queued_;
+	/**
+	 * The number of workers that are waiting for tasks.
+	 */
+	std::atomic<int> sleeping_;
+	/**
+	 * True if the worker threads must stop. Guarded by the mutex.
+	 */
+	bool stopping_;
+	/**
+	 * A mutex that idle workers wait on.
+	 */
+	QMutex mutex_;
+	/**
+	 * A condition that is signaled when tasks become available.
+	 */
+	QWaitCondition taskAvailable_;
+	/**
+	 * The number of threads other than the workers that are waiting for a task to
+	 * be executed.
+	 */
+	std::atomic<int> waiting_;
+	/**
+	 * A condition that is signaled when a task that isn't deleted automatically has
+	 * been executed, while threads other than the workers are waiting.
+	 */
+	QWaitCondition taskFinished_;
+};
 } // namespace clockwork
 
 #endif // CLOCKWORK_TASK_MANAGER_HH
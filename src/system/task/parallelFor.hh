@@ -0,0 +1,44 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_PARALLEL_FOR_HH
+#define CLOCKWORK_PARALLEL_FOR_HH
+
+#include <cstddef>
+#include <functional>
+
+
+namespace clockwork {
+/**
+ * Calls the specified function once for each index in the range [0, count), in
+ * parallel, on the application's TaskManager. The range is split into tasks that
+ * idle threads steal so that uneven workloads remain balanced. The function returns
+ * once every index has been processed.
+ * @param count the number of indices to process.
+ * @param function the function that processes a single index.
+ */
+void parallelFor(const std::size_t count, const std::function<void(std::size_t)>& function);
+} // namespace clockwork
+
+#endif // CLOCKWORK_PARALLEL_FOR_HH
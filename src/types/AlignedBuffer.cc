@@ -0,0 +1,93 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "AlignedBuffer.hh"
+#ifdef __linux__
+#include <sys/mman.h>
+#include <cstdint>
+#endif
+
+
+#ifdef __linux__
+/**
+ * The size of a huge page on x86-64 and most AArch64 configurations.
+ */
+static constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+
+/**
+ * Returns the specified size rounded up to a whole number of huge pages.
+ */
+static std::size_t
+getMappingLength(const std::size_t size) {
+	return ((size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+}
+#endif
+
+
+void*
+clockwork::detail::allocateAlignedMemory(const std::size_t size, const std::size_t alignment) {
+#ifdef __linux__
+	Q_ASSERT(alignment <= HUGE_PAGE_SIZE);
+	if (size >= HUGE_PAGE_SIZE) {
+		// A range is only backed by a huge page if it is aligned to one, so an extra
+		// huge page is mapped and the excess on either side of the aligned block is
+		// unmapped. The block is rounded up to whole huge pages for the same reason.
+		const std::size_t length = getMappingLength(size);
+		void* const mapping = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapping == MAP_FAILED) {
+			return nullptr;
+		}
+		const auto begin = reinterpret_cast<std::uintptr_t>(mapping);
+		const auto aligned = (begin + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+		if (aligned > begin) {
+			munmap(mapping, aligned - begin);
+		}
+		const std::size_t tail = (begin + length + HUGE_PAGE_SIZE) - (aligned + length);
+		if (tail > 0) {
+			munmap(reinterpret_cast<void*>(aligned + length), tail);
+		}
+		// The advice fails if transparent huge pages are disabled, in which case the
+		// block is simply backed by regular pages.
+		void* const memory = reinterpret_cast<void*>(aligned);
+		madvise(memory, length, MADV_HUGEPAGE);
+		return memory;
+	}
+#endif
+	return qMallocAligned(size, alignment);
+}
+
+
+void
+clockwork::detail::freeAlignedMemory(void* const memory, const std::size_t size) {
+#ifdef __linux__
+	if (size >= HUGE_PAGE_SIZE) {
+		if (memory != nullptr) {
+			munmap(memory, getMappingLength(size));
+		}
+		return;
+	}
+#endif
+	qFreeAligned(memory);
+}
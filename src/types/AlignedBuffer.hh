@@ -0,0 +1,191 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_ALIGNED_BUFFER_HH
+#define CLOCKWORK_ALIGNED_BUFFER_HH
+
+#include <QtGlobal>
+#include <cstddef>
+#include <type_traits>
+
+
+namespace clockwork {
+namespace detail {
+/**
+ * Allocates a block of memory of the specified size and alignment. On Linux, blocks
+ * that span at least one huge page are mapped directly and aligned to a huge page,
+ * so they may be backed by transparent huge pages. A mapped block's pages are only
+ * allocated when they are first written to, i.e. on the NUMA node of the thread
+ * that first writes to them. Returns nullptr if the memory could not be allocated.
+ * @param size the block's size, in bytes.
+ * @param alignment the block's alignment, in bytes.
+ */
+void* allocateAlignedMemory(const std::size_t size, const std::size_t alignment);
+/**
+ * Frees a block of memory that was allocated by allocateAlignedMemory.
+ * @param memory the block to free.
+ * @param size the block's size, in bytes, as passed to allocateAlignedMemory.
+ */
+void freeAlignedMemory(void* const memory, const std::size_t size);
+} // namespace detail
+/**
+ * A buffer of elements of type T whose storage is aligned to a cache line. The
+ * buffer only grows, so resizing it to a smaller size reuses its storage. Large
+ * buffers are backed by huge pages where available.
+ * @see detail::allocateAlignedMemory.
+ */
+template<class T>
+class AlignedBuffer {
+	static_assert(std::is_trivially_copyable<T>::value);
+public:
+	/**
+	 * The alignment, in bytes, of the buffer's storage.
+	 */
+	static constexpr std::size_t ALIGNMENT = 64;
+	/**
+	 * Instantiates an empty AlignedBuffer object.
+	 */
+	AlignedBuffer();
+	/**
+	 * Deleted copy constructor.
+	 */
+	AlignedBuffer(const AlignedBuffer&) = delete;
+	/**
+	 * Deleted move constructor.
+	 */
+	AlignedBuffer(AlignedBuffer&&) = delete;
+	/**
+	 * Frees the buffer's storage.
+	 */
+	~AlignedBuffer();
+	/**
+	 * Deleted copy operator.
+	 */
+	AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+	/**
+	 * Deleted move operator.
+	 */
+	AlignedBuffer& operator=(AlignedBuffer&&) = delete;
+	/**
+	 * Returns the buffer's storage, or nullptr if the buffer is empty.
+	 */
+	T* get();
+	/**
+	 * Returns the buffer's storage, or nullptr if the buffer is empty.
+	 */
+	const T* get() const;
+	/**
+	 * Returns the element at the specified index.
+	 * @param index the element's index.
+	 */
+	T& operator[](const std::size_t index);
+	/**
+	 * Returns the element at the specified index.
+	 * @param index the element's index.
+	 */
+	const T& operator[](const std::size_t index) const;
+	/**
+	 * Returns the number of elements the buffer can hold without reallocating its storage.
+	 */
+	std::size_t getCapacity() const;
+	/**
+	 * Makes sure the buffer can hold at least the specified number of elements. If
+	 * the buffer's storage is too small, it is reallocated and its contents are lost.
+	 * Returns true if the storage was reallocated, false otherwise.
+	 * @param size the number of elements the buffer must hold.
+	 */
+	bool reserve(const std::size_t size);
+private:
+	/**
+	 * The buffer's storage.
+	 */
+	T* data_;
+	/**
+	 * The number of elements the buffer's storage can hold.
+	 */
+	std::size_t capacity_;
+};
+
+
+template<class T> constexpr std::size_t AlignedBuffer<T>::ALIGNMENT;
+
+
+template<class T>
+AlignedBuffer<T>::AlignedBuffer() :
+data_(nullptr),
+capacity_(0) {}
+
+
+template<class T>
+AlignedBuffer<T>::~AlignedBuffer() {
+	detail::freeAlignedMemory(data_, capacity_ * sizeof(T));
+}
+
+
+template<class T> T*
+AlignedBuffer<T>::get() {
+	return data_;
+}
+
+
+template<class T> const T*
+AlignedBuffer<T>::get() const {
+	return data_;
+}
+
+
+template<class T> T&
+AlignedBuffer<T>::operator[](const std::size_t index) {
+	return data_[index];
+}
+
+
+template<class T> const T&
+AlignedBuffer<T>::operator[](const std::size_t index) const {
+	return data_[index];
+}
+
+
+template<class T> std::size_t
+AlignedBuffer<T>::getCapacity() const {
+	return capacity_;
+}
+
+
+template<class T> bool
+AlignedBuffer<T>::reserve(const std::size_t size) {
+	if (size > capacity_) {
+		detail::freeAlignedMemory(data_, capacity_ * sizeof(T));
+		data_ = static_cast<T*>(detail::allocateAlignedMemory(size * sizeof(T), ALIGNMENT));
+		if (data_ == nullptr) {
+			qFatal("[AlignedBuffer::reserve] Could not allocate memory!");
+		}
+		capacity_ = size;
+		return true;
+	}
+	return false;
+}
+} // namespace clockwork
+
+#endif // CLOCKWORK_ALIGNED_BUFFER_HH
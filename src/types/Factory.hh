@@ -82,9 +82,10 @@ protected:
 	Factory() = default;
 private:
 	/**
-	 *
+	 * A cached value. Note that QHash requires its values to be copyable, which
+	 * rules out std::unique_ptr.
 	 */
-	using CacheEntry = std::unique_ptr<Value>;
+	using CacheEntry = std::shared_ptr<Value>;
 	/**
 	 * Instantiates the Value object assigned to the specified key.
 	 * @param key the Value object's unique key.
@@ -114,7 +115,7 @@ Factory<K, V>::get(const K& key) {
 	if (!contains(key)) {
 		cache_[key] = Factory::CacheEntry(Factory::create(key));
 	}
-	return cache_[key];
+	return cache_[key].get();
 }
 
 
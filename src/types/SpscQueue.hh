@@ -0,0 +1,125 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_SPSC_QUEUE_HH
+#define CLOCKWORK_SPSC_QUEUE_HH
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+
+namespace clockwork {
+/**
+ * A bounded lock-free queue with a single producer and a single consumer, i.e.
+ * exactly one thread may push values and exactly one thread may pop them. Neither
+ * thread ever waits for the other: pushing to a full queue or popping from an empty
+ * one fails immediately.
+ */
+template<class T, std::size_t CAPACITY>
+class SpscQueue {
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "The capacity must be a power of two.");
+public:
+	/**
+	 * Instantiates an empty SpscQueue object.
+	 */
+	SpscQueue();
+	/**
+	 * Deleted copy constructor.
+	 */
+	SpscQueue(const SpscQueue&) = delete;
+	/**
+	 * Deleted move constructor.
+	 */
+	SpscQueue(SpscQueue&&) = delete;
+	/**
+	 * Deleted copy assignment operator.
+	 */
+	SpscQueue& operator=(const SpscQueue&) = delete;
+	/**
+	 * Deleted move assignment operator.
+	 */
+	SpscQueue& operator=(SpscQueue&&) = delete;
+	/**
+	 * Appends the specified value to the queue and returns true, or returns false,
+	 * leaving the value untouched, if the queue is full. Only the producer may call this.
+	 * @param value the value to append.
+	 */
+	bool push(T&& value);
+	/**
+	 * Removes the value at the front of the queue, moves it to the specified output
+	 * and returns true, or returns false if the queue is empty. Only the consumer
+	 * may call this.
+	 * @param value the value's output.
+	 */
+	bool pop(T& value);
+private:
+	/**
+	 * The queue's values, indexed by the head and tail counters modulo the capacity.
+	 */
+	std::array<T, CAPACITY> values_;
+	/**
+	 * The number of values that were popped. It is written by the consumer only,
+	 * and kept on its own cache line so the two threads don't falsely share it.
+	 */
+	alignas(64) std::atomic<std::size_t> head_;
+	/**
+	 * The number of values that were pushed. It is written by the producer only.
+	 */
+	alignas(64) std::atomic<std::size_t> tail_;
+};
+
+
+template<class T, std::size_t CAPACITY>
+SpscQueue<T, CAPACITY>::SpscQueue() :
+head_(0),
+tail_(0) {}
+
+
+template<class T, std::size_t CAPACITY> bool
+SpscQueue<T, CAPACITY>::push(T&& value) {
+	const std::size_t tail = tail_.load(std::memory_order_relaxed);
+	if (tail - head_.load(std::memory_order_acquire) == CAPACITY) {
+		return false;
+	}
+	values_[tail & (CAPACITY - 1)] = std::move(value);
+	tail_.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+
+template<class T, std::size_t CAPACITY> bool
+SpscQueue<T, CAPACITY>::pop(T& value) {
+	const std::size_t head = head_.load(std::memory_order_relaxed);
+	if (head == tail_.load(std::memory_order_acquire)) {
+		return false;
+	}
+	value = std::move(values_[head & (CAPACITY - 1)]);
+	head_.store(head + 1, std::memory_order_release);
+	return true;
+}
+} // namespace clockwork
+
+#endif // CLOCKWORK_SPSC_QUEUE_HH
@@ -23,21 +23,14 @@
  * THE SOFTWARE.
  */
 #include "FramebufferProvider.hh"
-#include "Framebuffer.hh"
-#include <QObject>
+#include "SwapChain.hh"
 
 using clockwork::FramebufferProvider;
 
 
-FramebufferProvider::FramebufferProvider(Framebuffer& framebuffer) :
+FramebufferProvider::FramebufferProvider(SwapChain& swapChain) :
 QQuickImageProvider(QQmlImageProviderBase::Image, QQmlImageProviderBase::ForceAsynchronousImageLoading),
-framebuffer_(framebuffer),
-pixelBufferImage_(nullptr),
-//depthBufferImageData_(nullptr),
-depthBufferImage_(nullptr),
-stencilBufferImage_(nullptr) {
-	using std::placeholders::_1;
-
+swapChain_(swapChain) {
 	// Generate a color for each possible stencil value. When this color table was
 	// initially implemented, only two stencil values were used (0x00 and 0xFF),
 	// making it a little bit overkill to generate all 255 values. Since I don't
@@ -45,41 +38,32 @@ stencilBufferImage_(nullptr) {
 	for (std::uint8_t i = 0; i < std::numeric_limits<std::uint8_t>::max(); ++i) {
 		stencilBufferImageColorTable_.push_back(qRgb(i, i, i));
 	}
-
-	onFramebufferResized(framebuffer.getResolution());
-	QObject::connect(&framebuffer, &Framebuffer::resized, std::bind(&FramebufferProvider::onFramebufferResized, this, _1));
 }
 
 
 QImage
 FramebufferProvider::requestImage(const QString& id, QSize* const size, const QSize&) {
-	if (size != nullptr)
-		*size = framebuffer_.getResolution();
+	QMutexLocker locker(&mutex_);
 
-	if (id == "pixel" && pixelBufferImage_ != nullptr) {
-		return *pixelBufferImage_;
-	} else if (id == "depth" && depthBufferImage_ != nullptr) {
-		return *depthBufferImage_;
-	} else if (id == "stencil" && stencilBufferImage_ != nullptr) {
-		return *stencilBufferImage_;
+	// The acquired frame is only valid until the next frame is acquired, so the
+	// images that refer to it are copied.
+	const auto& frame = swapChain_.acquire();
+	if (size != nullptr) {
+		*size = frame.size;
+	}
+	if (!frame.size.isValid()) {
+		return QImage();
+	}
+	const int w = frame.size.width();
+	const int h = frame.size.height();
+	if (id == "pixel") {
+		const int bytesPerLine = frame.pitch * Framebuffer::getPixelSize(frame.pixelFormat);
+		return QImage(frame.pixels.get(), w, h, bytesPerLine, Framebuffer::getImageFormat(frame.pixelFormat)).copy();
+	} else if (id == "stencil" && frame.stencil.get() != nullptr) {
+		QImage image(frame.stencil.get(), w, h, w, QImage::Format_Indexed8);
+		image.setColorTable(stencilBufferImageColorTable_);
+		return image.copy();
 	} else {
 		return QImage();
 	}
 }
-
-
-void
-FramebufferProvider::onFramebufferResized(const QSize& resolution) {
-	const std::size_t w = resolution.width();
-	const std::size_t h = resolution.height();
-
-	uchar* const pb = reinterpret_cast<uchar*>(framebuffer_.getPixelBuffer());
-	pixelBufferImage_.reset(new QImage(pb, w, h, QImage::Format_ARGB32));
-/*
-	depthBufferImageData_.reset(new std::uint32_t[size]);
-	depthBufferImage_.reset(new QImage(reinterpret_cast<uchar*>(depthBufferImageData_.get()), width, height, QImage::Format_RGB32));
-*/
-	uchar* const sb = reinterpret_cast<uchar*>(framebuffer_.getStencilBuffer());
-	stencilBufferImage_.reset(new QImage(sb, w, h, QImage::Format_Indexed8));
-	stencilBufferImage_->setColorTable(stencilBufferImageColorTable_);
-}
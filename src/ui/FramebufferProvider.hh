@@ -27,53 +27,40 @@
 #define CLOCKWORK_FRAMEBUFFER_PROVIDER_HH
 
 #include <QQuickImageProvider>
-#include <memory>
+#include <QMutex>
 
 
 namespace clockwork {
 /**
  *
  */
-class Framebuffer;
+class SwapChain;
 /**
- *
+ * Provides images of the most recently completed frame. The images are made from
+ * the frames that the renderer presents to a swap chain, so the framebuffer itself
+ * is never read while it is being rendered to.
  */
 class FramebufferProvider final : public QQuickImageProvider {
 public:
 	/**
-	 *
+	 * Instantiates a FramebufferProvider object that consumes the specified swap
+	 * chain's frames. The swap chain must copy its frames' stencil values.
+	 * @param swapChain the swap chain to consume.
 	 */
-	explicit FramebufferProvider(Framebuffer& framebuffer);
+	explicit FramebufferProvider(SwapChain& swapChain);
 	/**
 	 *
 	 */
 	QImage requestImage(const QString& id, QSize* const size, const QSize&) override;
 private:
 	/**
-	 * A function that is called when the framebuffer is resized.
-	 * @param resolution the framebuffer's new resolution.
-	 */
-	void onFramebufferResized(const QSize& resolution);
-	/**
-	 *
-	 */
-	Framebuffer& framebuffer_;
-	/**
-	 * An image representation of the framebuffer's pixel buffer attachment.
-	 */
-	std::unique_ptr<QImage> pixelBufferImage_;
-	/**
-	 * An integer representation of the depth buffer's data.
-	 */
-//	std::unique_ptr<std::uint32_t[]> depthBufferImageData_;
-	/**
-	 * An image representation of the framebuffer's depth buffer attachment.
+	 * The swap chain whose frames are provided.
 	 */
-	std::unique_ptr<QImage> depthBufferImage_;
+	SwapChain& swapChain_;
 	/**
-	 * An image representation of the framebuffer's stencil buffer attachment.
+	 * The mutex that makes concurrent image requests a single consumer of the swap chain.
 	 */
-	std::unique_ptr<QImage> stencilBufferImage_;
+	QMutex mutex_;
 	/**
 	 * The stencil buffer image's color table.
 	 */
@@ -42,7 +42,7 @@ application_(application) {}
 
 clockwork::Error
 UserInterface::initialize() {
-	engine_.addImageProvider("framebuffer", new FramebufferProvider(Service::Graphics.getFramebuffer()));
+	engine_.addImageProvider("framebuffer", new FramebufferProvider(Service::Graphics.getSnapshotSwapChain()));
 
 	auto* const qmlContext = engine_.rootContext();
 	if (qmlContext != nullptr) {
@@ -28,10 +28,28 @@
 #include "Service.hh"
 #include <QSGGeometryNode>
 #include <QOpenGLFunctions>
+#include <utility>
 
 using clockwork::FramebufferView;
 
 
+/**
+ * Returns the OpenGL pixel format and type of the specified framebuffer pixel format.
+ * Frames are uploaded in their own pixel format, so the texels need no conversion.
+ */
+static std::pair<QOpenGLTexture::PixelFormat, QOpenGLTexture::PixelType>
+getTextureFormat(const clockwork::Framebuffer::PixelFormat format) {
+	switch (format) {
+		case clockwork::Framebuffer::PixelFormat::RGBA8:
+			return {QOpenGLTexture::RGBA, QOpenGLTexture::UInt8};
+		case clockwork::Framebuffer::PixelFormat::RGB565:
+			return {QOpenGLTexture::RGB, QOpenGLTexture::UInt16_R5G6B5};
+		default:
+			return {QOpenGLTexture::BGRA, QOpenGLTexture::UInt8};
+	}
+}
+
+
 FramebufferView::FramebufferView(QQuickItem* const parent) :
 QQuickItem(parent) {
 	// Indicate that this object should be rendered by the scene graph.
@@ -58,7 +76,7 @@ FramebufferView::updatePaintNode(QSGNode* const oldNode, UpdatePaintNodeData*) {
 
 
 FramebufferView::Texture::Texture() :
-cpuRenderTarget_(nullptr),
+swapChain_(nullptr),
 gpuRenderTarget_(QOpenGLTexture::Target2D) {}
 
 
@@ -94,17 +112,26 @@ FramebufferView::Texture::textureSize() const {
 
 bool
 FramebufferView::Texture::updateTexture() {
-	if (gpuRenderTarget_.isCreated()) {
-		gpuRenderTarget_.setData(QOpenGLTexture::RGBA, QOpenGLTexture::UInt32_RGBA8, cpuRenderTarget_);
-		return true;
+	if (swapChain_ == nullptr) {
+		return false;
 	}
-	return false;
+	const auto& frame = swapChain_->acquire();
+	if (!frame.size.isValid()) {
+		return false;
+	}
+	if (!gpuRenderTarget_.isCreated() || textureSize() != frame.size) {
+		resize(frame.size);
+	}
+	const auto& format = getTextureFormat(frame.pixelFormat);
+	cpuRenderTargetTransferOptions_.setRowLength(frame.pitch);
+	gpuRenderTarget_.setData(format.first, format.second, frame.pixels.get(), &cpuRenderTargetTransferOptions_);
+	return true;
 }
 
 
 void
-FramebufferView::Texture::setClientSideRenderTarget(const void* target) {
-	cpuRenderTarget_ = target;
+FramebufferView::Texture::setSwapChain(SwapChain& swapChain) {
+	swapChain_ = &swapChain;
 }
 
 
@@ -164,15 +191,7 @@ FramebufferView::MaterialShader::createMaterial(FramebufferView::Texture& textur
 	Material* const material = createMaterial();
 	material->state()->texture = &texture;
 
-	if (!texture.isCreated()) {
-		const auto& framebuffer = Service::Graphics.getFramebuffer();
-		const auto& onFramebufferResized = [&texture, &framebuffer](const QSize& size) {
-			texture.resize(size);
-			texture.setClientSideRenderTarget(framebuffer.getPixelBuffer());
-		};
-		connect(&framebuffer, &Framebuffer::resized, onFramebufferResized);
-		onFramebufferResized(framebuffer.getResolution());
-	}
+	texture.setSwapChain(Service::Graphics.getSwapChain());
 
 	return material;
 }
@@ -200,24 +219,12 @@ FramebufferView::MaterialShader::vertexShader() const {
 
 const char*
 FramebufferView::MaterialShader::fragmentShader() const {
-	// This is a very basic fragment shader except for one simple quirk:
-	// The color buffer's pixels are in a 32-bit ARGB format however when
-	// they are uploaded to the GPU render target, they are assumed to be
-	// in RGBA format which is not the case. This means that the texel's
-	// color channels are mismatched like so:
-	// Expected format | Actual format
-	//               R | A
-	//               G | R
-	//               B | G
-	//               A | B
-	// So Red actually contains the Alpha channel, Green contains Red, etc.
-	// The solution is to simply swizzle the texel to GBAR.
 	return
 	"uniform lowp sampler2D texture;\n"
 	"uniform lowp float qt_Opacity;\n"
 	"varying highp vec2 texCoord;\n"
 	"void main() {\n"
-		"gl_FragColor = texture2D(texture, texCoord).gbar * qt_Opacity;\n"
+		"gl_FragColor = texture2D(texture, texCoord) * qt_Opacity;\n"
 	"}";
 }
 
@@ -26,11 +26,13 @@
 #ifndef CLOCKWORK_FRAMEBUFFER_VIEW_HH
 #define CLOCKWORK_FRAMEBUFFER_VIEW_HH
 
+#include "SwapChain.hh"
 #include <QQuickItem>
 #include <QSGDynamicTexture>
 #include <QSGGeometry>
 #include <QSGSimpleMaterialShader>
 #include <QOpenGLTexture>
+#include <QOpenGLPixelTransferOptions>
 
 
 namespace clockwork {
@@ -80,14 +82,15 @@ private:
 		 */
 		QSize textureSize() const Q_DECL_OVERRIDE;
 		/**
-		 * Uploads the client-side buffer to the render texture's GPU memory.
+		 * Uploads the swap chain's most recently completed frame to the render texture's
+		 * GPU memory, resizing the texture if the frame's resolution changed.
 		 */
 		bool updateTexture() Q_DECL_OVERRIDE;
 		/**
-		 * Sets the client-side (CPU) render target.
-		 * @param target the client-side render target to set.
+		 * Sets the swap chain whose frames are uploaded.
+		 * @param swapChain the swap chain to set.
 		 */
-		void setClientSideRenderTarget(const void* const target);
+		void setSwapChain(SwapChain& swapChain);
 		/**
 		 * Resizes the texture.
 		 * @param size the texture's new size.
@@ -103,11 +106,15 @@ private:
 		void destroy();
 	private:
 		/**
-		 * The buffer located in CPU (client-side) memory that contains pixels that are
-		 * uploaded to GPU (server-side) memory. If it helps, you may think of client-side
-		 * memory as a backbuffer and server-side memory as a frontbuffer.
+		 * The swap chain whose frames, located in CPU (client-side) memory, are uploaded
+		 * to GPU (server-side) memory. The renderer writes to one frame while another is
+		 * uploaded, so an upload never contains parts of two frames.
 		 */
-		const void* cpuRenderTarget_;
+		SwapChain* swapChain_;
+		/**
+		 * The options used to upload a frame, whose rows may be padded.
+		 */
+		QOpenGLPixelTransferOptions cpuRenderTargetTransferOptions_;
 		/**
 		 * The buffer located in GPU (server-side) memory that contains pixels that are
 		 * displayed on the screen.
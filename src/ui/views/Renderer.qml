@@ -136,11 +136,12 @@ Item {
 	Text {
 		property int frameRenderTime
 		property int framesPerSecond
+		property string frameHash
 		font {
 			bold: true
 			pixelSize: 16
 		}
-		text: "%1 ms (%2 FPS)".arg(frameRenderTime).arg(framesPerSecond)
+		text: "%1 ms (%2 FPS)".arg(frameRenderTime).arg(framesPerSecond) + (frameHash ? "\n" + frameHash : "")
 		color: {
 			if (framesPerSecond < 30) {
 				return "red"
@@ -157,6 +158,7 @@ Item {
 			application.frameRendered.connect(function(){
 				frameRenderTime = graphics.frameRenderTime
 				framesPerSecond = 1000 / frameRenderTime
+				frameHash = graphics.frameHash
 			});
 		}
 	}
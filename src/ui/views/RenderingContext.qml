@@ -209,6 +209,34 @@ Flickable {
 				graphics.enableDepthTest = toggleDepthTest.checked
 			}
 		}
+		ListItem.Divider {}
+		ListItem.Subtitled {
+			text: qsTr("Enable sort-last rendering")
+			subText: qsTr("Draws subsets of the scene's objects on separate threads, then merges them by depth.")
+			secondaryItem: Material.Switch {
+				id: toggleSortLastRendering
+				checked: graphics.enableSortLastRendering
+				anchors.verticalCenter: parent.verticalCenter
+			}
+			onClicked: {
+				toggleSortLastRendering.checked = !toggleSortLastRendering.checked
+				graphics.enableSortLastRendering = toggleSortLastRendering.checked
+			}
+		}
+		ListItem.Divider {}
+		ListItem.Subtitled {
+			text: qsTr("Enable deterministic rendering")
+			subText: qsTr("Renders identical frames regardless of the number of threads or timing, and hashes each frame.")
+			secondaryItem: Material.Switch {
+				id: toggleDeterministicRendering
+				checked: graphics.enableDeterministicRendering
+				anchors.verticalCenter: parent.verticalCenter
+			}
+			onClicked: {
+				toggleDeterministicRendering.checked = !toggleDeterministicRendering.checked
+				graphics.enableDeterministicRendering = toggleDeterministicRendering.checked
+			}
+		}
 
 
 		ListItem.Subheader {
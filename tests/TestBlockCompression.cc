@@ -0,0 +1,208 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "TestBlockCompression.hh"
+#include "blockCompression.hh"
+#include <cstdlib>
+
+using clockwork::testsuite::TestBlockCompression;
+
+
+namespace {
+/**
+ * Returns the largest difference between two colors' channels, among the channels
+ * selected by the specified mask.
+ */
+int
+getError(const std::uint32_t a, const std::uint32_t b, const std::uint32_t mask) {
+	int error = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		if ((mask >> shift) & 0xFF) {
+			error = std::max(error, std::abs(static_cast<int>((a >> shift) & 0xFF) - static_cast<int>((b >> shift) & 0xFF)));
+		}
+	}
+	return error;
+}
+/**
+ * Fills a block with texels that go from one color to another. A gradient block
+ * interpolates the colors linearly, otherwise its first half holds the first
+ * color and its second half holds the second color.
+ */
+void
+fillBlock(const std::uint32_t from, const std::uint32_t to, const bool gradient, std::uint32_t* const texels) {
+	for (int i = 0; i < 16; ++i) {
+		if (gradient) {
+			texels[i] = 0;
+			for (int shift = 0; shift < 32; shift += 8) {
+				const int a = (from >> shift) & 0xFF;
+				const int b = (to >> shift) & 0xFF;
+				texels[i] |= static_cast<std::uint32_t>(a + (((b - a) * i) / 15)) << shift;
+			}
+		} else {
+			texels[i] = i < 8 ? from : to;
+		}
+	}
+}
+} // namespace
+
+
+TestBlockCompression::TestBlockCompression(QObject& parent) :
+Test(parent)
+{}
+
+
+void
+TestBlockCompression::testDecodeColorBlock_data() {
+	QTest::addColumn<bool>("transparency");
+	QTest::addColumn<quint32>("c0");
+	QTest::addColumn<quint32>("c1");
+	QTest::addColumn<quint32>("p0");
+	QTest::addColumn<quint32>("p1");
+	QTest::addColumn<quint32>("p2");
+	QTest::addColumn<quint32>("p3");
+
+	// Red and blue in RGB565, whose palettes are easy to work out by hand.
+	QTest::newRow("Four colors") << false << 0xF800u << 0x001Fu << 0xFFFF0000u << 0xFF0000FFu << 0xFFAA0055u << 0xFF5500AAu;
+	QTest::newRow("Four colors with transparency") << true << 0xF800u << 0x001Fu << 0xFFFF0000u << 0xFF0000FFu << 0xFFAA0055u << 0xFF5500AAu;
+	QTest::newRow("Three colors") << true << 0x001Fu << 0xF800u << 0xFF0000FFu << 0xFFFF0000u << 0xFF800080u << 0x00000000u;
+	QTest::newRow("Three colors without transparency") << false << 0x001Fu << 0xF800u << 0xFF0000FFu << 0xFFFF0000u << 0xFF5500AAu << 0xFFAA0055u;
+}
+
+
+void
+TestBlockCompression::testDecodeColorBlock() {
+	QFETCH(bool, transparency);
+	QFETCH(quint32, c0);
+	QFETCH(quint32, c1);
+	QFETCH(quint32, p0);
+	QFETCH(quint32, p1);
+	QFETCH(quint32, p2);
+	QFETCH(quint32, p3);
+
+	// Texel i selects palette entry i % 4.
+	const std::uint64_t indices = 0xE4E4E4E4;
+	const std::uint64_t block = c0 | (static_cast<std::uint64_t>(c1) << 16) | (indices << 32);
+	const std::uint32_t palette[] = {p0, p1, p2, p3};
+
+	std::uint32_t texels[16];
+	decodeColorBlock(block, transparency, texels);
+	for (int i = 0; i < 16; ++i) {
+		QCOMPARE(texels[i], palette[i % 4]);
+	}
+}
+
+
+void
+TestBlockCompression::testDecodeAlphaBlock() {
+	// With a0 > a1, the six values between the endpoints are interpolated.
+	const std::uint32_t palette[] = {255, 0, 219, 182, 146, 109, 73, 36};
+	std::uint64_t indices = 0;
+	for (std::uint64_t i = 0; i < 16; ++i) {
+		indices |= (i % 8) << (3 * i);
+	}
+	const std::uint64_t block = 255 | (indices << 16);
+
+	std::uint32_t texels[16];
+	for (int i = 0; i < 16; ++i) {
+		texels[i] = 0x00123456;
+	}
+	decodeAlphaBlock(block, texels);
+	for (int i = 0; i < 16; ++i) {
+		QCOMPARE(texels[i] >> 24, palette[i % 8]);
+		QCOMPARE(texels[i] & 0x00FFFFFF, 0x00123456u);
+	}
+}
+
+
+void
+TestBlockCompression::testColorBlockRoundTrip_data() {
+	QTest::addColumn<quint32>("from");
+	QTest::addColumn<quint32>("to");
+	QTest::addColumn<bool>("gradient");
+	QTest::addColumn<int>("maximumError");
+
+	// Colors that RGB565 represents exactly are decoded exactly, as long as the
+	// block's colors all lie on the palette. Other colors lose up to half of a
+	// 5-bit step, and a gradient also loses up to half the palette's spacing.
+	QTest::newRow("Solid exact color") << 0xFF00FF00u << 0xFF00FF00u << false << 0;
+	QTest::newRow("Solid inexact color") << 0xFF123456u << 0xFF123456u << false << 4;
+	QTest::newRow("Two exact colors") << 0xFFFF0000u << 0xFF0000FFu << false << 0;
+	QTest::newRow("Two inexact colors") << 0xFF102030u << 0xFFC0B0A0u << false << 4;
+	QTest::newRow("Gray gradient") << 0xFF000000u << 0xFFFFFFFFu << true << 43;
+	QTest::newRow("Narrow gradient") << 0xFF406080u << 0xFF507090u << true << 7;
+}
+
+
+void
+TestBlockCompression::testColorBlockRoundTrip() {
+	QFETCH(quint32, from);
+	QFETCH(quint32, to);
+	QFETCH(bool, gradient);
+	QFETCH(int, maximumError);
+
+	std::uint32_t texels[16];
+	fillBlock(from, to, gradient, texels);
+
+	std::uint32_t decoded[16];
+	decodeColorBlock(encodeColorBlock(texels), false, decoded);
+	for (int i = 0; i < 16; ++i) {
+		QVERIFY(getError(texels[i], decoded[i], 0x00FFFFFF) <= maximumError);
+		QCOMPARE(decoded[i] >> 24, 0xFFu);
+	}
+}
+
+
+void
+TestBlockCompression::testAlphaBlockRoundTrip_data() {
+	QTest::addColumn<quint32>("from");
+	QTest::addColumn<quint32>("to");
+	QTest::addColumn<bool>("gradient");
+	QTest::addColumn<int>("maximumError");
+
+	// The endpoints are stored exactly, and the six values in between are 1/7 of
+	// the range apart.
+	QTest::newRow("Opaque") << 0xFF000000u << 0xFF000000u << false << 0;
+	QTest::newRow("Translucent") << 0x80000000u << 0x80000000u << false << 0;
+	QTest::newRow("Two values") << 0x00000000u << 0xFF000000u << false << 0;
+	QTest::newRow("Full gradient") << 0x00000000u << 0xFF000000u << true << 19;
+	QTest::newRow("Narrow gradient") << 0x60000000u << 0x70000000u << true << 2;
+}
+
+
+void
+TestBlockCompression::testAlphaBlockRoundTrip() {
+	QFETCH(quint32, from);
+	QFETCH(quint32, to);
+	QFETCH(bool, gradient);
+	QFETCH(int, maximumError);
+
+	std::uint32_t texels[16];
+	fillBlock(from, to, gradient, texels);
+
+	std::uint32_t decoded[16] = {};
+	decodeAlphaBlock(encodeAlphaBlock(texels), decoded);
+	for (int i = 0; i < 16; ++i) {
+		QVERIFY(getError(texels[i], decoded[i], 0xFF000000) <= maximumError);
+	}
+}
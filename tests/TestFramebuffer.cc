@@ -24,6 +24,12 @@
  */
 #include "TestFramebuffer.hh"
 #include "Framebuffer.hh"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 using clockwork::testsuite::TestFramebuffer;
 
@@ -60,3 +66,387 @@ TestFramebuffer::testClear() {
 		framebuffer.clear();
 	}
 }
+
+
+void
+TestFramebuffer::testFastClear_data() {
+	testClear_data();
+}
+
+
+void
+TestFramebuffer::testFastClear() {
+	using enum_traits = enum_traits<Framebuffer::Resolution>;
+	QFETCH(enum_traits::Ordinal, resolution);
+
+	Framebuffer framebuffer(enum_traits::enumerator(resolution));
+	framebuffer.enableFastClear();
+
+	QBENCHMARK {
+		framebuffer.clear();
+	}
+}
+
+
+void
+TestFramebuffer::testFastClearValues_data() {
+	QTest::addColumn<bool>("tiled");
+	QTest::addColumn<bool>("wrap");
+
+	QTest::newRow("Linear") << false << false;
+	QTest::newRow("Tiled") << true << false;
+	QTest::newRow("Linear, generation wrap-around") << false << true;
+	QTest::newRow("Tiled, generation wrap-around") << true << true;
+}
+
+
+void
+TestFramebuffer::testFastClearValues() {
+	QFETCH(bool, tiled);
+	QFETCH(bool, wrap);
+
+	const std::uint32_t pixelClearValue = 0xFF336699;
+	const std::uint8_t stencilClearValue = 0x0F;
+
+	// The framebuffer's size isn't a multiple of the tile size, so partial tiles are cleared too.
+	const QSize resolution(72, 40);
+	Framebuffer framebuffer(resolution);
+	framebuffer.setLayout(tiled ? Framebuffer::Layout::Tiled : Framebuffer::Layout::Linear);
+	framebuffer.setDepthRange(0.0, 1.0);
+	framebuffer.setPixelBufferClearValue(pixelClearValue);
+	framebuffer.setDepthBufferClearValue(0.75);
+	framebuffer.setStencilBufferClearValue(stencilClearValue);
+	framebuffer.enableFastClear();
+	if (wrap) {
+		// The next two clears overflow the generation counter.
+		framebuffer.generation_ = std::numeric_limits<std::uint32_t>::max() - 1;
+	}
+	framebuffer.clear();
+
+	// Draw to some of the pixels in every tile.
+	const std::uint32_t width = resolution.width();
+	const std::uint32_t height = resolution.height();
+	for (std::uint32_t y = 0; y < height; ++y) {
+		for (std::uint32_t x = y % 3; x < width; x += 3) {
+			framebuffer.resolveTile(x, y);
+			framebuffer.getPixelBuffer()[framebuffer.getOffset(x, y)] = 0xFFFFFFFF;
+			framebuffer.setDepth(x, y, 0.25);
+			framebuffer.setStencil(x, y, 0xF0);
+		}
+	}
+	framebuffer.clear();
+	if (wrap) {
+		QCOMPARE(framebuffer.generation_, 1U);
+	}
+	for (std::uint32_t y = 0; y < height; y += Framebuffer::TILE_SIZE) {
+		for (std::uint32_t x = 0; x < width; x += Framebuffer::TILE_SIZE) {
+			QVERIFY(framebuffer.isTileCleared(x, y));
+		}
+	}
+	framebuffer.resolve();
+
+	const std::size_t size = width * height;
+	std::vector<float> depthBuffer(size);
+	std::vector<std::uint8_t> stencilBuffer(size);
+	framebuffer.readDepthBuffer(depthBuffer.data());
+	framebuffer.readStencilBuffer(stencilBuffer.data());
+
+	// Cleared depth values are read as infinity, so they're tested against the clear value.
+	const std::uint32_t* const pixels = framebuffer.getResolvedPixelBuffer();
+	for (std::uint32_t y = 0; y < height; ++y) {
+		for (std::uint32_t x = 0; x < width; ++x) {
+			const std::size_t i = y * width + x;
+			QCOMPARE(pixels[y * framebuffer.getPitch() + x], pixelClearValue);
+			QCOMPARE(depthBuffer[i], std::numeric_limits<float>::infinity());
+			QVERIFY(framebuffer.testDepth(x, y, 0.7));
+			QVERIFY(!framebuffer.testDepth(x, y, 0.8));
+			QCOMPARE(stencilBuffer[i], stencilClearValue);
+		}
+	}
+}
+
+
+void
+TestFramebuffer::testResolve_data() {
+	using enum_traits = enum_traits<Framebuffer::PixelFormat>;
+	QTest::addColumn<QSize>("resolution");
+	QTest::addColumn<enum_traits::Ordinal>("format");
+
+	QTest::newRow("1x1 BGRA8") << QSize(1, 1) << enum_traits::ordinal(Framebuffer::PixelFormat::BGRA8);
+	QTest::newRow("100x70 BGRA8") << QSize(100, 70) << enum_traits::ordinal(Framebuffer::PixelFormat::BGRA8);
+	QTest::newRow("37x13 RGBA8") << QSize(37, 13) << enum_traits::ordinal(Framebuffer::PixelFormat::RGBA8);
+	QTest::newRow("67x33 RGB565") << QSize(67, 33) << enum_traits::ordinal(Framebuffer::PixelFormat::RGB565);
+}
+
+
+void
+TestFramebuffer::testResolve() {
+	using enum_traits = enum_traits<Framebuffer::PixelFormat>;
+	QFETCH(QSize, resolution);
+	QFETCH(enum_traits::Ordinal, format);
+
+	const std::uint32_t width = resolution.width();
+	const std::uint32_t height = resolution.height();
+
+	Framebuffer linear(resolution);
+	Framebuffer tiled(resolution);
+	tiled.setLayout(Framebuffer::Layout::Tiled);
+	for (auto* const framebuffer : {&linear, &tiled}) {
+		framebuffer->setPixelFormat(enum_traits::enumerator(format));
+		framebuffer->setPixelBufferClearValue(0xFF336699);
+		framebuffer->enableFastClear();
+		framebuffer->clear();
+
+		// Every pixel is drawn to, except those in the first tile, which is resolved
+		// with its clear value.
+		for (std::uint32_t y = 0; y < height; ++y) {
+			for (std::uint32_t x = 0; x < width; ++x) {
+				if (x >= Framebuffer::TILE_SIZE || y >= Framebuffer::TILE_SIZE) {
+					framebuffer->resolveTile(x, y);
+					framebuffer->getPixelBuffer()[framebuffer->getOffset(x, y)] = 0xFF000000 | ((x * 2654435761U) ^ (y * 40503U));
+				}
+			}
+		}
+		framebuffer->resolve();
+	}
+
+	QCOMPARE(tiled.getPitch(), linear.getPitch());
+	const std::size_t pitch = linear.getPitch();
+	const std::size_t pixelSize = Framebuffer::getPixelSize(enum_traits::enumerator(format));
+	const auto* const linearOutput = static_cast<const std::uint8_t*>(linear.getOutputBuffer());
+	const auto* const tiledOutput = static_cast<const std::uint8_t*>(tiled.getOutputBuffer());
+	for (std::size_t y = 0; y < height; ++y) {
+		const std::size_t offset = y * pitch;
+		QVERIFY(std::memcmp(linear.getResolvedPixelBuffer() + offset, tiled.getResolvedPixelBuffer() + offset, width * sizeof(std::uint32_t)) == 0);
+		QVERIFY(std::memcmp(linearOutput + (offset * pixelSize), tiledOutput + (offset * pixelSize), width * pixelSize) == 0);
+	}
+}
+
+
+void
+TestFramebuffer::testDepth_data() {
+	using enum_traits = enum_traits<Framebuffer::DepthFormat>;
+	QTest::addColumn<enum_traits::Ordinal>("format");
+	QTest::addColumn<double>("precision");
+
+	QTest::newRow("Float32") << enum_traits::ordinal(Framebuffer::DepthFormat::Float32) << 0.0;
+	QTest::newRow("D24S8") << enum_traits::ordinal(Framebuffer::DepthFormat::D24S8) << 1.0 / 0xFFFFFF;
+	QTest::newRow("Unorm16") << enum_traits::ordinal(Framebuffer::DepthFormat::Unorm16) << 1.0 / 0xFFFF;
+}
+
+
+void
+TestFramebuffer::testDepth() {
+	using enum_traits = enum_traits<Framebuffer::DepthFormat>;
+	QFETCH(enum_traits::Ordinal, format);
+	QFETCH(double, precision);
+
+	// The framebuffer's size isn't a multiple of the tile size, so the tested row
+	// lies in the last row of tiles.
+	const QSize resolution(40, 36);
+	const std::uint32_t y = 35;
+	Framebuffer framebuffer(resolution);
+	framebuffer.setDepthFormat(enum_traits::enumerator(format));
+	framebuffer.setDepthRange(0.0, 1.0);
+	framebuffer.clear();
+
+	// Cleared depth values are at least as far as the depth range's far plane.
+	QVERIFY(framebuffer.testDepth(0, y, 0.99));
+
+	// Stencil values are written before depth values, which must not overwrite them.
+	for (std::uint32_t x = 0; x < 4; ++x) {
+		framebuffer.setStencil(x, y, 0xA5);
+		framebuffer.setDepth(x, y, 0.5);
+		QCOMPARE(framebuffer.getStencil(x, y), static_cast<std::uint8_t>(0xA5));
+	}
+
+	// Only strictly nearer depth values pass the test.
+	QVERIFY(framebuffer.testDepth(0, y, 0.25));
+	QVERIFY(framebuffer.testDepth(0, y, 0.5 - 0.001));
+	QVERIFY(!framebuffer.testDepth(0, y, 0.5));
+	QVERIFY(!framebuffer.testDepth(0, y, 0.5 + 0.001));
+	QVERIFY(!framebuffer.testDepth(0, y, 0.75));
+
+	// Depth values outside of the depth range are clamped.
+	QVERIFY(framebuffer.testDepth(0, y, -1.0));
+	QVERIFY(!framebuffer.testDepth(0, y, 2.0));
+
+	// The vectorized test must agree with the scalar test.
+	const std::array<float, 4> depths = {{0.25f, 0.5f, 0.75f, 0.4f}};
+	QCOMPARE(framebuffer.testDepth(0, y, depths.data()), 0x9U);
+
+	// Elements past the framebuffer's width fail the test.
+	const auto last = static_cast<std::uint32_t>(resolution.width() - 2);
+	QCOMPARE(framebuffer.testDepth(last, y, depths.data()), 0x3U);
+
+	// A nearer depth value replaces the stored one, and the stencil value is kept.
+	framebuffer.setDepth(0, y, 0.25);
+	QVERIFY(!framebuffer.testDepth(0, y, 0.25));
+	QVERIFY(!framebuffer.testDepth(0, y, 0.4));
+	QVERIFY(framebuffer.testDepth(0, y, 0.2));
+	QCOMPARE(framebuffer.getStencil(0, y), static_cast<std::uint8_t>(0xA5));
+
+	// Writing a stencil value leaves the depth value untouched.
+	framebuffer.setStencil(1, y, 0x5A);
+	QVERIFY(framebuffer.testDepth(1, y, 0.4));
+	QVERIFY(!framebuffer.testDepth(1, y, 0.5));
+
+	const std::size_t width = resolution.width();
+	const std::size_t size = width * resolution.height();
+	std::vector<float> depthBuffer(size);
+	std::vector<std::uint8_t> stencilBuffer(size);
+	framebuffer.readDepthBuffer(depthBuffer.data());
+	framebuffer.readStencilBuffer(stencilBuffer.data());
+
+	const std::array<double, 4> expectedDepths = {{0.25, 0.5, 0.5, 0.5}};
+	const std::array<std::uint8_t, 4> expectedStencils = {{0xA5, 0x5A, 0xA5, 0xA5}};
+	for (std::uint32_t x = 0; x < 4; ++x) {
+		const std::size_t i = y * width + x;
+		QVERIFY(std::abs(depthBuffer[i] - expectedDepths[x]) <= precision + 1e-7);
+		QCOMPARE(stencilBuffer[i], expectedStencils[x]);
+	}
+	QCOMPARE(depthBuffer[y * width + 4], std::numeric_limits<float>::infinity());
+	QCOMPARE(stencilBuffer[y * width + 4], static_cast<std::uint8_t>(0x00));
+}
+
+
+void
+TestFramebuffer::testComposite_data() {
+	using enum_traits = enum_traits<Framebuffer::DepthFormat>;
+	QTest::addColumn<enum_traits::Ordinal>("format");
+	QTest::addColumn<bool>("tiled");
+
+	QTest::newRow("Float32, linear") << enum_traits::ordinal(Framebuffer::DepthFormat::Float32) << false;
+	QTest::newRow("Float32, tiled") << enum_traits::ordinal(Framebuffer::DepthFormat::Float32) << true;
+	QTest::newRow("D24S8, linear") << enum_traits::ordinal(Framebuffer::DepthFormat::D24S8) << false;
+	QTest::newRow("D24S8, tiled") << enum_traits::ordinal(Framebuffer::DepthFormat::D24S8) << true;
+	QTest::newRow("Unorm16, linear") << enum_traits::ordinal(Framebuffer::DepthFormat::Unorm16) << false;
+	QTest::newRow("Unorm16, tiled") << enum_traits::ordinal(Framebuffer::DepthFormat::Unorm16) << true;
+}
+
+
+void
+TestFramebuffer::testComposite() {
+	using enum_traits = enum_traits<Framebuffer::DepthFormat>;
+	QFETCH(enum_traits::Ordinal, format);
+	QFETCH(bool, tiled);
+
+	constexpr std::uint32_t TILE_SIZE = Framebuffer::TILE_SIZE;
+	const QSize resolution(72, 40);
+	const std::uint32_t width = resolution.width();
+	const std::uint32_t height = resolution.height();
+
+	// A fragment is only written if it passes the depth test, like the rasterizer's.
+	const auto& draw = [](Framebuffer& framebuffer, const std::uint32_t x, const std::uint32_t y, const double depth, const std::uint32_t color, const std::uint8_t stencil) {
+		if (framebuffer.testDepth(x, y, depth)) {
+			framebuffer.setDepth(x, y, depth);
+			framebuffer.getPixelBuffer()[framebuffer.getOffset(x, y)] = color;
+			framebuffer.setStencil(x, y, stencil);
+		}
+	};
+	// Draws a plane over the tile that contains the <x, y> coordinate, compressing
+	// the tile when the framebuffer allows it.
+	const auto& drawPlane = [&draw, width, height](Framebuffer& framebuffer, const std::uint32_t x, const std::uint32_t y, const Framebuffer::DepthPlane& plane, const std::uint32_t color, const std::uint8_t stencil) {
+		const std::uint32_t x0 = x - (x % TILE_SIZE);
+		const std::uint32_t y0 = y - (y % TILE_SIZE);
+		const std::uint32_t x1 = std::min(x0 + TILE_SIZE, width);
+		const std::uint32_t y1 = std::min(y0 + TILE_SIZE, height);
+		std::array<float, TILE_SIZE * TILE_SIZE> depths;
+		for (std::uint32_t j = y0; j < y1; ++j) {
+			for (std::uint32_t i = x0; i < x1; ++i) {
+				depths[((j - y0) * TILE_SIZE) + (i - x0)] = (plane.a * static_cast<float>(i)) + (plane.b * static_cast<float>(j)) + plane.c;
+			}
+		}
+		const bool compressed = framebuffer.setDepthPlane(x0, y0, plane, depths.data());
+		for (std::uint32_t j = y0; j < y1; ++j) {
+			for (std::uint32_t i = x0; i < x1; ++i) {
+				if (compressed) {
+					framebuffer.getPixelBuffer()[framebuffer.getOffset(i, j)] = color;
+					framebuffer.setStencil(i, j, stencil);
+				} else {
+					draw(framebuffer, i, j, depths[((j - y0) * TILE_SIZE) + (i - x0)], color, stencil);
+				}
+			}
+		}
+	};
+	// The tile at <32, 0> holds a plane in both the framebuffer and the layer. The
+	// layer's plane is nearer left of x = 48, where both are equally deep.
+	const Framebuffer::DepthPlane basePlane = {0.0f, 0.0f, 0.4375f};
+	const Framebuffer::DepthPlane layerPlane = {1.0f / 256.0f, 0.0f, 0.25f};
+	const auto& inPlaneTile = [](const std::uint32_t x, const std::uint32_t y) {
+		return x >= TILE_SIZE && x < 2 * TILE_SIZE && y < TILE_SIZE;
+	};
+	// The framebuffer's fragments leave the tile at <64, 32> cleared, and the layer's
+	// leave the tile at <0, 32> cleared. The layer's fragments are nearer, farther or
+	// as deep as the framebuffer's.
+	const auto& drawBase = [&](Framebuffer& framebuffer) {
+		drawPlane(framebuffer, TILE_SIZE, 0, basePlane, 0xFF0000FF, 0x11);
+		for (std::uint32_t y = 0; y < height; ++y) {
+			for (std::uint32_t x = 0; x < width; ++x) {
+				if ((x + y) % 3 == 0 && !inPlaneTile(x, y) && !(x >= 2 * TILE_SIZE && y >= TILE_SIZE)) {
+					draw(framebuffer, x, y, 0.5, 0xFF00FF00 | x, 0x22);
+				}
+			}
+		}
+	};
+	const auto& drawLayer = [&](Framebuffer& framebuffer) {
+		const std::array<double, 3> depths = {{0.25, 0.5, 0.75}};
+		drawPlane(framebuffer, TILE_SIZE, 0, layerPlane, 0xFFFF0000, 0x33);
+		for (std::uint32_t y = 0; y < height; ++y) {
+			for (std::uint32_t x = 0; x < width; ++x) {
+				if ((x + (2 * y)) % 5 < 2 && !inPlaneTile(x, y) && !(x < TILE_SIZE && y >= TILE_SIZE)) {
+					draw(framebuffer, x, y, depths[(x * y) % depths.size()], 0xFF000000 | (y << 8), static_cast<std::uint8_t>(x));
+				}
+			}
+		}
+	};
+
+	Framebuffer serial(resolution);
+	Framebuffer framebuffer(resolution);
+	Framebuffer layer(resolution);
+	for (auto* const target : {&serial, &framebuffer, &layer}) {
+		target->setLayout(tiled ? Framebuffer::Layout::Tiled : Framebuffer::Layout::Linear);
+		target->setDepthFormat(enum_traits::enumerator(format));
+		target->setDepthRange(0.0, 1.0);
+		target->setPixelBufferClearValue(0xFF336699);
+		target->enableFastClear();
+		target->clear();
+	}
+	framebuffer.enableDepthCompression();
+	layer.enableDepthCompression();
+
+	// The serial framebuffer receives the layer's fragments after the framebuffer's.
+	drawBase(serial);
+	drawLayer(serial);
+	drawBase(framebuffer);
+	drawLayer(layer);
+	if (enum_traits::enumerator(format) != Framebuffer::DepthFormat::D24S8) {
+		QVERIFY(framebuffer.isTileCompressed(TILE_SIZE, 0));
+		QVERIFY(layer.isTileCompressed(TILE_SIZE, 0));
+	}
+	QVERIFY(framebuffer.isTileCleared(2 * TILE_SIZE, TILE_SIZE));
+	QVERIFY(layer.isTileCleared(0, TILE_SIZE));
+
+	framebuffer.composite(layer);
+	serial.resolve();
+	framebuffer.resolve();
+
+	const std::size_t size = static_cast<std::size_t>(width) * height;
+	std::vector<float> serialDepths(size);
+	std::vector<float> depths(size);
+	std::vector<std::uint8_t> serialStencils(size);
+	std::vector<std::uint8_t> stencils(size);
+	serial.readDepthBuffer(serialDepths.data());
+	framebuffer.readDepthBuffer(depths.data());
+	serial.readStencilBuffer(serialStencils.data());
+	framebuffer.readStencilBuffer(stencils.data());
+	for (std::uint32_t y = 0; y < height; ++y) {
+		for (std::uint32_t x = 0; x < width; ++x) {
+			const std::size_t i = (y * width) + x;
+			QCOMPARE(framebuffer.getPixelBuffer()[framebuffer.getOffset(x, y)], serial.getPixelBuffer()[serial.getOffset(x, y)]);
+			QCOMPARE(depths[i], serialDepths[i]);
+			QCOMPARE(stencils[i], serialStencils[i]);
+		}
+	}
+	QCOMPARE(framebuffer.getHash(), serial.getHash());
+}
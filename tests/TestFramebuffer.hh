@@ -41,6 +41,16 @@ public:
 private slots:
 	void testClear_data();
 	void testClear();
+	void testFastClear_data();
+	void testFastClear();
+	void testFastClearValues_data();
+	void testFastClearValues();
+	void testResolve_data();
+	void testResolve();
+	void testDepth_data();
+	void testDepth();
+	void testComposite_data();
+	void testComposite();
 };
 } // namespace testsuite
 } // namespace clockwork
@@ -0,0 +1,221 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "TestRenderCluster.hh"
+#include "RenderCluster.hh"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <memory>
+#include <vector>
+
+using clockwork::testsuite::TestRenderCluster;
+
+
+namespace {
+/**
+ * Connects a worker's socket to the specified server, and returns the coordinator's
+ * end of the connection, or nullptr if the worker could not connect.
+ * @param server the coordinator's server.
+ * @param worker the worker's socket.
+ */
+std::unique_ptr<QLocalSocket>
+connectWorker(QLocalServer& server, QLocalSocket& worker) {
+	const QString name = QString("clockwork-test-%1").arg(QCoreApplication::applicationPid());
+	QLocalServer::removeServer(name);
+	server.setSocketOptions(QLocalServer::UserAccessOption);
+	if (!server.listen(name)) {
+		return nullptr;
+	}
+	worker.connectToServer(server.fullServerName());
+	if (!worker.waitForConnected(clockwork::RenderCluster::TIMEOUT) || !server.waitForNewConnection(clockwork::RenderCluster::TIMEOUT)) {
+		return nullptr;
+	}
+	return std::unique_ptr<QLocalSocket>(server.nextPendingConnection());
+}
+} // namespace
+
+
+TestRenderCluster::TestRenderCluster(QObject& parent) :
+Test(parent)
+{}
+
+
+void
+TestRenderCluster::testLayer_data() {
+	using enum_traits = enum_traits<Framebuffer::DepthFormat>;
+	QTest::addColumn<enum_traits::Ordinal>("format");
+	QTest::addColumn<bool>("tiled");
+
+	QTest::newRow("Float32, linear") << enum_traits::ordinal(Framebuffer::DepthFormat::Float32) << false;
+	QTest::newRow("Float32, tiled") << enum_traits::ordinal(Framebuffer::DepthFormat::Float32) << true;
+	QTest::newRow("D24S8, linear") << enum_traits::ordinal(Framebuffer::DepthFormat::D24S8) << false;
+	QTest::newRow("D24S8, tiled") << enum_traits::ordinal(Framebuffer::DepthFormat::D24S8) << true;
+	QTest::newRow("Unorm16, linear") << enum_traits::ordinal(Framebuffer::DepthFormat::Unorm16) << false;
+	QTest::newRow("Unorm16, tiled") << enum_traits::ordinal(Framebuffer::DepthFormat::Unorm16) << true;
+}
+
+
+void
+TestRenderCluster::testLayer() {
+	using enum_traits = enum_traits<Framebuffer::DepthFormat>;
+	QFETCH(enum_traits::Ordinal, format);
+	QFETCH(bool, tiled);
+
+	constexpr std::uint32_t TILE_SIZE = Framebuffer::TILE_SIZE;
+	const QSize resolution(72, 40);
+	const std::uint32_t width = resolution.width();
+	const std::uint32_t height = resolution.height();
+
+	const auto& draw = [](Framebuffer& framebuffer, const std::uint32_t x, const std::uint32_t y, const double depth, const std::uint32_t color) {
+		if (framebuffer.testDepth(x, y, depth)) {
+			framebuffer.setDepth(x, y, depth);
+			framebuffer.getPixelBuffer()[framebuffer.getOffset(x, y)] = color;
+		}
+	};
+
+	Framebuffer worker(resolution);
+	Framebuffer layer(resolution);
+	Framebuffer serial(resolution);
+	Framebuffer framebuffer(resolution);
+	for (auto* const target : {&worker, &layer, &serial, &framebuffer}) {
+		target->setLayout(tiled ? Framebuffer::Layout::Tiled : Framebuffer::Layout::Linear);
+		target->setDepthFormat(enum_traits::enumerator(format));
+		target->setDepthRange(0.0, 1.0);
+		target->setPixelBufferClearValue(0xFF336699);
+		target->enableFastClear();
+		target->clear();
+	}
+	worker.enableDepthCompression();
+
+	// The worker draws a plane over the tile at <32, 0>, leaves the tile at <0, 32>
+	// cleared, and draws fragments that are nearer, farther or as deep as the
+	// coordinator's elsewhere. The last column and row of tiles are partial.
+	const Framebuffer::DepthPlane plane = {1.0f / 256.0f, 0.0f, 0.25f};
+	std::vector<float> planeDepths(TILE_SIZE * TILE_SIZE);
+	for (std::uint32_t j = 0; j < TILE_SIZE; ++j) {
+		for (std::uint32_t i = 0; i < TILE_SIZE; ++i) {
+			planeDepths[(j * TILE_SIZE) + i] = (plane.a * static_cast<float>(TILE_SIZE + i)) + (plane.b * static_cast<float>(j)) + plane.c;
+		}
+	}
+	const bool compressed = worker.setDepthPlane(TILE_SIZE, 0, plane, planeDepths.data());
+	for (std::uint32_t j = 0; j < TILE_SIZE; ++j) {
+		for (std::uint32_t i = TILE_SIZE; i < 2 * TILE_SIZE; ++i) {
+			if (compressed) {
+				worker.getPixelBuffer()[worker.getOffset(i, j)] = 0xFFFF0000;
+			} else {
+				draw(worker, i, j, planeDepths[(j * TILE_SIZE) + i - TILE_SIZE], 0xFFFF0000);
+			}
+		}
+	}
+	const std::vector<double> depths = {0.25, 0.5, 0.75};
+	for (std::uint32_t y = 0; y < height; ++y) {
+		for (std::uint32_t x = 0; x < width; ++x) {
+			const bool inPlaneTile = x >= TILE_SIZE && x < 2 * TILE_SIZE && y < TILE_SIZE;
+			if ((x + (2 * y)) % 5 < 2 && !inPlaneTile && !(x < TILE_SIZE && y >= TILE_SIZE)) {
+				draw(worker, x, y, depths[(x * y) % depths.size()], 0xFF000000 | (y << 8));
+			}
+		}
+	}
+	for (auto* const target : {&serial, &framebuffer}) {
+		for (std::uint32_t y = 0; y < height; ++y) {
+			for (std::uint32_t x = 0; x < width; ++x) {
+				if ((x + y) % 3 == 0) {
+					draw(*target, x, y, 0.5, 0xFF00FF00 | x);
+				}
+			}
+		}
+	}
+	QVERIFY(worker.isTileCleared(0, TILE_SIZE));
+
+	// The worker's reply goes through a local socket, as it does when a frame is drawn.
+	QLocalServer server;
+	QLocalSocket workerSocket;
+	const auto coordinatorSocket = connectWorker(server, workerSocket);
+	QVERIFY(coordinatorSocket != nullptr);
+	RenderCluster::writeMessage(workerSocket, RenderCluster::writeLayer(worker));
+	workerSocket.flush();
+
+	QByteArray reply;
+	QElapsedTimer timer;
+	timer.start();
+	QVERIFY(RenderCluster::readMessage(*coordinatorSocket, reply, timer, RenderCluster::TIMEOUT));
+	RenderCluster::readLayer(reply, layer);
+
+	// Only the tiles that the worker drew to are sent, so the others stay cleared.
+	for (std::uint32_t y = 0; y < height; y += TILE_SIZE) {
+		for (std::uint32_t x = 0; x < width; x += TILE_SIZE) {
+			QCOMPARE(layer.isTileCleared(x, y), worker.isTileCleared(x, y));
+		}
+	}
+
+	// Merging the received layer is the same as merging the worker's framebuffer.
+	serial.composite(worker);
+	framebuffer.composite(layer);
+	serial.resolve();
+	framebuffer.resolve();
+
+	const std::size_t size = static_cast<std::size_t>(width) * height;
+	std::vector<float> serialDepths(size);
+	std::vector<float> layerDepths(size);
+	serial.readDepthBuffer(serialDepths.data());
+	framebuffer.readDepthBuffer(layerDepths.data());
+	for (std::uint32_t y = 0; y < height; ++y) {
+		for (std::uint32_t x = 0; x < width; ++x) {
+			QCOMPARE(framebuffer.getPixelBuffer()[framebuffer.getOffset(x, y)], serial.getPixelBuffer()[serial.getOffset(x, y)]);
+			QCOMPARE(layerDepths[(y * width) + x], serialDepths[(y * width) + x]);
+		}
+	}
+	QCOMPARE(framebuffer.getHash(), serial.getHash());
+}
+
+
+void
+TestRenderCluster::testReplyTimeout() {
+	QLocalServer server;
+	QLocalSocket workerSocket;
+	const auto coordinatorSocket = connectWorker(server, workerSocket);
+	QVERIFY(coordinatorSocket != nullptr);
+
+	// A worker that stops replying in the middle of a message makes the read fail
+	// once the deadline passes, rather than after the connection timeout.
+	constexpr int timeout = 50;
+	const quint32 size = 1024;
+	workerSocket.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	workerSocket.write(QByteArray(16, '\0'));
+	workerSocket.flush();
+
+	QByteArray message;
+	QElapsedTimer timer;
+	timer.start();
+	QVERIFY(!RenderCluster::readMessage(*coordinatorSocket, message, timer, timeout));
+	QVERIFY(timer.elapsed() >= timeout);
+	QVERIFY(timer.elapsed() < RenderCluster::TIMEOUT);
+
+	// A deadline that has passed fails the read without waiting.
+	timer.start();
+	QVERIFY(!RenderCluster::readMessage(*coordinatorSocket, message, timer, 0));
+	QVERIFY(timer.elapsed() < timeout);
+}
@@ -0,0 +1,273 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "TestSortLastRendering.hh"
+#include "GraphicsSubsystem.hh"
+#include "Mesh.hh"
+#include "PageCache.hh"
+#include "Texture.hh"
+#include <QImage>
+#include <array>
+#include <random>
+
+using clockwork::testsuite::TestSortLastRendering;
+
+
+TestSortLastRendering::TestSortLastRendering(QObject& parent) :
+Test(parent)
+{}
+
+
+std::vector<std::unique_ptr<clockwork::Mesh>>
+TestSortLastRendering::createScene(const Texture* const diffuseMap) {
+	constexpr std::size_t MESH_COUNT = 6;
+	constexpr std::size_t FACE_COUNT = 40;
+	constexpr std::size_t BAND_COUNT = MESH_COUNT * FACE_COUNT;
+
+	// Each face lies in a band of depths of its own, and the bands are shuffled so
+	// that the meshes interleave in depth. Each mesh's first face is parallel to the
+	// screen and covers half of it, so the tiles that it covers entirely may be
+	// compressed. The other faces are small and slanted. Texture coordinates follow
+	// the positions, so that the faces sample about one texel per pixel.
+	std::mt19937 generator(5);
+	std::uniform_real_distribution<float> center(-0.65f, 0.65f);
+	std::uniform_real_distribution<float> extent(-0.25f, 0.25f);
+	std::uniform_real_distribution<float> offset(-0.3f, 0.3f);
+	const float bandSize = 1.8f / BAND_COUNT;
+	const std::array<QPointF, 4> corners = {{QPointF(-0.9, -0.9), QPointF(0.9, -0.9), QPointF(0.9, 0.9), QPointF(-0.9, 0.9)}};
+
+	std::vector<std::unique_ptr<Mesh>> scene;
+	for (std::size_t i = 0; i < MESH_COUNT; ++i) {
+		scene.emplace_back(new Mesh);
+		auto& mesh = *scene.back();
+		mesh.material.diffuse = diffuseMap;
+		for (std::size_t j = 0; j < FACE_COUNT; ++j) {
+			const std::size_t band = (((j * MESH_COUNT) + i) * 97) % BAND_COUNT;
+			const float depth = -0.9f + ((band + 0.5f) * bandSize);
+			const float x = center(generator);
+			const float y = center(generator);
+			for (std::size_t k = 0; k < Mesh::Face::length; ++k) {
+				if (j == 0) {
+					const auto& corner = corners[(i + k) % corners.size()];
+					mesh.positions.append(QVector3D(corner.x(), corner.y(), depth));
+				} else {
+					mesh.positions.append(QVector3D(x + extent(generator), y + extent(generator), depth + (offset(generator) * bandSize)));
+				}
+				mesh.textureCoordinates.append(0.25 * mesh.positions.last().toPointF());
+				mesh.normals.append(QVector3D());
+			}
+		}
+		for (int j = 0; j < mesh.positions.size(); j += Mesh::Face::length) {
+			mesh.faces.append(Mesh::Face(
+				{{&mesh.positions[j], &mesh.positions[j + 1], &mesh.positions[j + 2]}},
+				{{&mesh.textureCoordinates[j], &mesh.textureCoordinates[j + 1], &mesh.textureCoordinates[j + 2]}},
+				{{&mesh.normals[j], &mesh.normals[j + 1], &mesh.normals[j + 2]}}
+			));
+		}
+	}
+	return scene;
+}
+
+
+std::unique_ptr<clockwork::GraphicsSubsystem>
+TestSortLastRendering::createGraphicsSubsystem(
+	const QSize& resolution,
+	const Framebuffer::Layout layout,
+	const Framebuffer::DepthFormat depthFormat,
+	const bool enableDepthCompression
+) {
+	// The rendering context is set up as GraphicsSubsystem::initialize does, but
+	// without reading the application's settings. Clipping is disabled, so faces
+	// are drawn exactly as they are laid out.
+	std::unique_ptr<GraphicsSubsystem> graphics(new GraphicsSubsystem);
+	auto& context = graphics->renderingContext_;
+	context.shaderProgramIdentifier = ShaderProgramIdentifier::RandomColoredSurfaces;
+	context.primitiveTopology = PrimitiveTopology::Triangle;
+	context.enableClipping = false;
+	context.enableBackfaceCulling = false;
+	context.polygonMode = PolygonMode::Fill;
+	context.shadeModel = ShadeModel::Flat;
+	context.enableLineAntiAliasing = false;
+	context.enableScissorTest = false;
+	context.enableStencilTest = false;
+	context.enableDepthTest = true;
+	context.framebuffer.setLayout(layout);
+	context.framebuffer.setResolution(resolution);
+	context.framebuffer.setDepthFormat(depthFormat);
+	context.framebuffer.enableFastClear();
+	context.framebuffer.enableDepthCompression(enableDepthCompression);
+	context.normalizedScissorBox.setRect(0.0, 0.0, 1.0, 1.0);
+	context.scissorBox.setRect(0, 0, resolution.width(), resolution.height());
+	graphics->initializeContextState();
+	return graphics;
+}
+
+
+std::uint64_t
+TestSortLastRendering::render(GraphicsSubsystem& graphics, const std::vector<std::unique_ptr<Mesh>>& scene) {
+	// The viewer looks down the z axis with identity transforms, and its viewport
+	// covers the framebuffer and maps the depth range to [0, 1], as a SceneViewer does.
+	const QSize& resolution = graphics.getFramebufferResolution();
+	GraphicsSubsystem::FrameState frame;
+	frame.hasViewer = true;
+	frame.viewportTransform(0, 0) = 0.5 * resolution.width();
+	frame.viewportTransform(1, 0) = 0.5 * resolution.height();
+	frame.viewportTransform(2, 0) = 0.5;
+	frame.viewportTransform(0, 1) = 0.5 * resolution.width();
+	frame.viewportTransform(1, 1) = 0.5 * resolution.height();
+	frame.viewportTransform(2, 1) = 0.5;
+	frame.textureFilter = TextureFilter::Identifier::Trilinear;
+	for (std::size_t i = 0; i < scene.size(); ++i) {
+		GraphicsSubsystem::FrameState::Object object;
+		object.index = static_cast<int>(i);
+		object.mesh = scene[i].get();
+		frame.objects.append(object);
+	}
+	graphics.cull(frame);
+	graphics.draw(frame);
+	graphics.present();
+	return graphics.getFramebuffer().getHash();
+}
+
+
+void
+TestSortLastRendering::cleanup() {
+	// Deterministic rendering is enabled on the PageCache's unique instance, which
+	// outlives the graphics subsystems that the tests create.
+	PageCache::getInstance().enableDeterministicLoading(false);
+}
+
+
+void
+TestSortLastRendering::testDeterminism_data() {
+	using enum_traits = enum_traits<Framebuffer::DepthFormat>;
+	QTest::addColumn<enum_traits::Ordinal>("format");
+	QTest::addColumn<bool>("deterministic");
+
+	QTest::newRow("Float32") << enum_traits::ordinal(Framebuffer::DepthFormat::Float32) << false;
+	QTest::newRow("Float32, deterministic") << enum_traits::ordinal(Framebuffer::DepthFormat::Float32) << true;
+	QTest::newRow("D24S8") << enum_traits::ordinal(Framebuffer::DepthFormat::D24S8) << false;
+	QTest::newRow("D24S8, deterministic") << enum_traits::ordinal(Framebuffer::DepthFormat::D24S8) << true;
+	QTest::newRow("Unorm16") << enum_traits::ordinal(Framebuffer::DepthFormat::Unorm16) << false;
+	QTest::newRow("Unorm16, deterministic") << enum_traits::ordinal(Framebuffer::DepthFormat::Unorm16) << true;
+}
+
+
+void
+TestSortLastRendering::testDeterminism() {
+	using enum_traits = enum_traits<Framebuffer::DepthFormat>;
+	QFETCH(enum_traits::Ordinal, format);
+	QFETCH(bool, deterministic);
+
+	const auto scene = createScene();
+	const QSize resolution(160, 120);
+	const auto depthFormat = enum_traits::enumerator(format);
+	const auto layout = Framebuffer::Layout::Tiled;
+
+	const auto serial = createGraphicsSubsystem(resolution, layout, depthFormat, false);
+	const auto expected = render(*serial, scene);
+
+	// No two meshes share a depth value, so the merged frame matches a serial draw
+	// with or without depth compression, and doesn't change from one frame to the
+	// next. Deterministic frames are always drawn with the same number of layers.
+	for (const bool enableDepthCompression : {true, false}) {
+		const auto graphics = createGraphicsSubsystem(resolution, layout, depthFormat, enableDepthCompression);
+		graphics->enableSortLastRendering();
+		graphics->enableDeterministicRendering(deterministic);
+		QCOMPARE(render(*graphics, scene), expected);
+		QCOMPARE(render(*graphics, scene), expected);
+		if (deterministic) {
+			QCOMPARE(graphics->getFrameHash(), expected);
+			QCOMPARE(static_cast<int>(graphics->layers_.size()), GraphicsSubsystem::DETERMINISTIC_LAYER_COUNT - 1);
+		}
+	}
+}
+
+
+void
+TestSortLastRendering::testLayout_data() {
+	QTest::addColumn<QSize>("resolution");
+
+	QTest::newRow("1x1") << QSize(1, 1);
+	QTest::newRow("37x13") << QSize(37, 13);
+	QTest::newRow("67x33") << QSize(67, 33);
+	QTest::newRow("101x77") << QSize(101, 77);
+}
+
+
+void
+TestSortLastRendering::testLayout() {
+	QFETCH(QSize, resolution);
+
+	const auto scene = createScene();
+	const auto depthFormat = Framebuffer::DepthFormat::Float32;
+	const auto expected = render(*createGraphicsSubsystem(resolution, Framebuffer::Layout::Linear, depthFormat, false), scene);
+	QCOMPARE(render(*createGraphicsSubsystem(resolution, Framebuffer::Layout::Tiled, depthFormat, false), scene), expected);
+	for (const auto layout : {Framebuffer::Layout::Linear, Framebuffer::Layout::Tiled}) {
+		const auto graphics = createGraphicsSubsystem(resolution, layout, depthFormat, true);
+		graphics->enableSortLastRendering();
+		graphics->enableDeterministicRendering();
+		QCOMPARE(render(*graphics, scene), expected);
+	}
+}
+
+
+void
+TestSortLastRendering::testTextureLoading() {
+	constexpr int FRAME_COUNT = 4;
+	const QSize resolution(160, 120);
+
+	// The scene samples a sparse texture, whose largest levels are split into pages
+	// that are loaded as frames request them. With deterministic rendering, a page is
+	// resident from the frame after next, so each frame of a sequence is the same
+	// whether it's drawn serially or with sort-last rendering. The texels are random,
+	// so frames change as finer pages become resident. Each sequence uses a texture
+	// of its own, since pages stay resident once they're loaded.
+	QImage image(4 * Texture::PAGE_SIZE, 4 * Texture::PAGE_SIZE, QImage::Format_ARGB32);
+	std::mt19937 generator(7);
+	for (int y = 0; y < image.height(); ++y) {
+		auto* const scanLine = reinterpret_cast<std::uint32_t*>(image.scanLine(y));
+		for (int x = 0; x < image.width(); ++x) {
+			scanLine[x] = 0xFF000000 | (generator() & 0x00FFFFFF);
+		}
+	}
+	const auto& renderSequence = [&image, &resolution](const bool enableSortLastRendering) {
+		const Texture texture(image, Texture::Format::ARGB32, true);
+		const auto scene = createScene(&texture);
+		const auto graphics = createGraphicsSubsystem(resolution, Framebuffer::Layout::Tiled, Framebuffer::DepthFormat::Float32, true);
+		graphics->setShaderProgram(ShaderProgramIdentifier::TextureMaps);
+		graphics->enableSortLastRendering(enableSortLastRendering);
+		graphics->enableDeterministicRendering();
+
+		std::vector<std::uint64_t> hashes;
+		for (int i = 0; i < FRAME_COUNT; ++i) {
+			hashes.push_back(render(*graphics, scene));
+		}
+		return hashes;
+	};
+	const auto expected = renderSequence(false);
+	QVERIFY(expected.front() != expected.back());
+	QCOMPARE(renderSequence(false), expected);
+	QCOMPARE(renderSequence(true), expected);
+}
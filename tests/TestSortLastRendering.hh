@@ -0,0 +1,88 @@
+/*
+ * This file is part of Clockwork.
+ *
+ * Copyright (c) 2013-2017 Jeremy Othieno.
+ *
+ * The MIT License (MIT)
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CLOCKWORK_TEST_SORT_LAST_RENDERING_HH
+#define CLOCKWORK_TEST_SORT_LAST_RENDERING_HH
+
+#include "Test.hh"
+#include "Framebuffer.hh"
+#include <memory>
+#include <vector>
+
+
+namespace clockwork {
+class GraphicsSubsystem;
+class Mesh;
+class Texture;
+namespace testsuite {
+/**
+ * Tests that frames that the graphics subsystem draws with sort-last rendering are
+ * identical to frames it draws serially, whatever the depth format and framebuffer
+ * layout, and that deterministic frames don't change from one run to the next.
+ * @see src/system/subsystem/GraphicsSubsystem.hh.
+ */
+class TestSortLastRendering : public Test {
+	Q_OBJECT
+public:
+	explicit TestSortLastRendering(QObject& parent);
+private:
+	/**
+	 * Creates a fixed scene of meshes whose faces overlap on screen and interleave
+	 * in depth, without any two meshes sharing a depth value.
+	 * @param diffuseMap the texture that the meshes' faces are mapped with, if any.
+	 */
+	static std::vector<std::unique_ptr<Mesh>> createScene(const Texture* const diffuseMap = nullptr);
+	/**
+	 * Creates a graphics subsystem that draws random colored surfaces with the depth
+	 * test, to a framebuffer with the specified properties.
+	 * @param resolution the framebuffer's resolution.
+	 * @param layout the framebuffer's memory layout.
+	 * @param depthFormat the framebuffer's depth format.
+	 * @param enableDepthCompression true if the framebuffer compresses depth values.
+	 */
+	static std::unique_ptr<GraphicsSubsystem> createGraphicsSubsystem(
+		const QSize& resolution,
+		const Framebuffer::Layout layout,
+		const Framebuffer::DepthFormat depthFormat,
+		const bool enableDepthCompression
+	);
+	/**
+	 * Draws and presents a frame of the scene with the specified graphics subsystem,
+	 * and returns the hash of the frame's pixels.
+	 * @param graphics the graphics subsystem to draw with.
+	 * @param scene the scene to draw.
+	 */
+	static std::uint64_t render(GraphicsSubsystem& graphics, const std::vector<std::unique_ptr<Mesh>>& scene);
+private slots:
+	void cleanup();
+	void testDeterminism_data();
+	void testDeterminism();
+	void testLayout_data();
+	void testLayout();
+	void testTextureLoading();
+};
+} // namespace testsuite
+} // namespace clockwork
+
+#endif // CLOCKWORK_TEST_SORT_LAST_RENDERING_HH
@@ -48,10 +48,16 @@ UI_DIR = ../$${UI_DIR}
 
 HEADERS += \
 	Test.hh \
+	TestBlockCompression.hh \
 	TestFramebuffer.hh \
 	TestLerp.hh \
+	TestRenderCluster.hh \
+	TestSortLastRendering.hh \
 	testsuite.hh
 SOURCES += \
+	TestBlockCompression.cc \
 	TestFramebuffer.cc \
 	TestLerp.cc \
+	TestRenderCluster.cc \
+	TestSortLastRendering.cc \
 	testsuite.cc
@@ -23,13 +23,19 @@
  * THE SOFTWARE.
  */
 #include "testsuite.hh"
+#include "TestBlockCompression.hh"
 #include "TestFramebuffer.hh"
 #include "TestLerp.hh"
+#include "TestRenderCluster.hh"
+#include "TestSortLastRendering.hh"
 
 
 int main(int argc, char** argv) {
 	return clockwork::testsuite::run<
+		clockwork::testsuite::TestBlockCompression,
 		clockwork::testsuite::TestFramebuffer,
-		clockwork::testsuite::TestLerp
+		clockwork::testsuite::TestLerp,
+		clockwork::testsuite::TestRenderCluster,
+		clockwork::testsuite::TestSortLastRendering
 	>(argc, argv);
 }